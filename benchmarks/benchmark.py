@@ -4,14 +4,28 @@
 Usage:
     python benchmarks/benchmark.py          # Uses C extension
     NOC=1 python benchmarks/benchmark.py    # Uses pure Python
+    pypy3 benchmarks/benchmark.py --fallback --against python3
+                                            # Pure Python on PyPy vs C on CPython
+
+--fallback times the same workloads with the pure-Python DequeDict (NOC=1,
+on this interpreter) and with the C extension (on --against, default this
+interpreter), each in a subprocess, and prints how many times slower the
+fallback is.
 """
 from __future__ import annotations
 
+import argparse
+import itertools
+import json
+import os
+import platform
+import subprocess
+import sys
 import time
 from collections import OrderedDict, deque
 from typing import Any, Callable
 
-from dequedict import DequeDict
+from dequedict import HAS_C_EXTENSION, DequeDict
 
 
 def benchmark(func: Callable[[], Any], iterations: int = 100_000) -> float:
@@ -35,8 +49,7 @@ def main() -> None:
     print("DequeDict Benchmarks")
     print("=" * 72)
 
-    is_c = "abc.ABCMeta" not in str(type(DequeDict))
-    print(f"Implementation: {'C extension' if is_c else 'Pure Python'}\n")
+    print(f"Implementation: {'C extension' if HAS_C_EXTENSION else 'Pure Python'}\n")
 
     n = 1000
     keys = [f"key_{i}" for i in range(n)]
@@ -112,8 +125,13 @@ def main() -> None:
         for _ in range(100):
             x.popleft()
 
+    def pop_left_n_dd():
+        x = DequeDict(zip(keys[:100], values[:100]))
+        x.popleft_n(100)
+
     print("\n--- Pop Left 100 Items ---")
     print(f"  DequeDict   : {format_ns(benchmark(pop_left_dd, 10_000))}")
+    print(f"  popleft_n   : {format_ns(benchmark(pop_left_n_dd, 10_000))}")
     print(f"  OrderedDict : {format_ns(benchmark(pop_left_od, 10_000))}")
     print(f"  deque       : {format_ns(benchmark(pop_left_dq, 10_000))}")
     print("  dict         : N/A")
@@ -159,6 +177,79 @@ def main() -> None:
     print(f"  OrderedDict : {format_ns(benchmark(del_od, 10_000))}")
     print("  deque        : O(n)")
 
+    lru = DequeDict(zip(keys, values), maxsize=n, touch=True)
+    manual = DequeDict(zip(keys, values))
+    od_lru = OrderedDict(zip(keys, values))
+
+    def manual_hit():
+        manual.move_to_end(lookup_key)
+        return manual[lookup_key]
+
+    def od_hit():
+        od_lru.move_to_end(lookup_key)
+        return od_lru[lookup_key]
+
+    print("\n--- LRU Hit ---")
+    print(f"  DequeDict touch   : {format_ns(benchmark(lambda: lru[lookup_key], 1_000_000))}")
+    print(f"  DequeDict manual  : {format_ns(benchmark(manual_hit, 1_000_000))}")
+    print(f"  OrderedDict       : {format_ns(benchmark(od_hit, 1_000_000))}")
+
+    fresh = itertools.count()
+
+    def lru_miss():
+        for _ in range(100):
+            lru[next(fresh)] = 0
+
+    def manual_miss():
+        for _ in range(100):
+            manual[next(fresh)] = 0
+            if len(manual) > n:
+                manual.popleft()
+
+    def od_miss():
+        for _ in range(100):
+            od_lru[next(fresh)] = 0
+            if len(od_lru) > n:
+                od_lru.popitem(last=False)
+
+    print("\n--- LRU Miss 100 Items (evicting) ---")
+    print(f"  DequeDict maxsize : {format_ns(benchmark(lru_miss, 10_000))}")
+    print(f"  DequeDict manual  : {format_ns(benchmark(manual_miss, 10_000))}")
+    print(f"  OrderedDict       : {format_ns(benchmark(od_miss, 10_000))}")
+
+    calls = DequeDict(zip(keys, values))
+    missing = "missing"
+
+    def appendleft_popleft():
+        calls.appendleft(missing, 0)
+        calls.popleft()
+
+    # Per call, best of 7 timeit runs (x86-64 Linux, Python 3.11), before and
+    # after moving from METH_VARARGS/PyArg_ParseTuple to METH_FASTCALL/METH_O
+    # and adding tp_vectorcall for construction. The lambdas below add ~30 ns.
+    #   get(k)                     105 ns ->  45 ns
+    #   get(k, d) miss             106 ns ->  47 ns
+    #   pop(k, d) miss              94 ns ->  47 ns
+    #   setdefault(k, d)           114 ns ->  59 ns
+    #   at(i)                       82 ns ->  29 ns
+    #   move_to_end(k)             115 ns ->  52 ns
+    #   move_to_end(k, last=False) 332 ns -> 102 ns
+    #   appendleft + popleft       201 ns ->  65 ns
+    #   DequeDict()                115 ns ->  65 ns
+    #   DequeDict(maxsize=8)       356 ns ->  89 ns
+    print("\n--- Method Call Overhead ---")
+    print(f"  get(k)            : {format_ns(benchmark(lambda: calls.get(lookup_key), 1_000_000))}")
+    print(f"  get(k, d) miss    : {format_ns(benchmark(lambda: calls.get(missing, None), 1_000_000))}")
+    print(f"  pop(k, d) miss    : {format_ns(benchmark(lambda: calls.pop(missing, None), 1_000_000))}")
+    print(f"  setdefault(k, d)  : {format_ns(benchmark(lambda: calls.setdefault(lookup_key, 0), 1_000_000))}")
+    print(f"  at(i)             : {format_ns(benchmark(lambda: calls.at(500), 1_000_000))}")
+    print(f"  move_to_end(k)    : {format_ns(benchmark(lambda: calls.move_to_end(lookup_key), 1_000_000))}")
+    print(f"  move_to_end(k, last=False) : "
+          f"{format_ns(benchmark(lambda: calls.move_to_end(lookup_key, last=False), 1_000_000))}")
+    print(f"  appendleft+popleft: {format_ns(benchmark(appendleft_popleft, 1_000_000))}")
+    print(f"  DequeDict()       : {format_ns(benchmark(DequeDict, 1_000_000))}")
+    print(f"  DequeDict(maxsize=8) : {format_ns(benchmark(lambda: DequeDict(maxsize=8), 1_000_000))}")
+
     print("\n--- Iterate 1000 Items ---")
     print(f"  DequeDict   : {format_ns(benchmark(lambda: list(dd.items()), 10_000))}")
     print(f"  dict        : {format_ns(benchmark(lambda: list(d.items()), 10_000))}")
@@ -168,5 +259,106 @@ def main() -> None:
     print("\n" + "=" * 72)
 
 
+def workloads() -> dict[str, tuple[Callable[[], Any], int]]:
+    """Fallback comparison workloads: name -> (function, iterations)."""
+    n = 1000
+    keys = [f"key_{i}" for i in range(n)]
+    values = list(range(n))
+    lookup_key = keys[n // 2]
+    dd = DequeDict(zip(keys, values))
+    lru = DequeDict(zip(keys, values), maxsize=n, touch=True)
+    fresh = itertools.count()
+
+    def insert_100() -> None:
+        x = DequeDict()
+        for i in range(100):
+            x[keys[i]] = i
+
+    def popleft_100() -> None:
+        x = DequeDict(zip(keys[:100], values[:100]))
+        for _ in range(100):
+            x.popleft()
+
+    def delete_100() -> None:
+        x = DequeDict(zip(keys[:100], values[:100]))
+        for k in keys[:100]:
+            del x[k]
+
+    def lru_miss_100() -> None:
+        for _ in range(100):
+            lru[next(fresh)] = 0
+
+    def appendleft_popleft() -> None:
+        dd.appendleft("missing", 0)
+        dd.popleft()
+
+    def update() -> None:
+        dd[lookup_key] = 0
+
+    return {
+        "key lookup": (lambda: dd[lookup_key], 1_000_000),
+        "contains": (lambda: lookup_key in dd, 1_000_000),
+        "get(k, d) miss": (lambda: dd.get("missing", None), 1_000_000),
+        "update": (update, 1_000_000),
+        "move_to_end(k)": (lambda: dd.move_to_end(lookup_key), 1_000_000),
+        "appendleft+popleft": (appendleft_popleft, 1_000_000),
+        "LRU hit": (lambda: lru[lookup_key], 1_000_000),
+        "insert x100": (insert_100, 10_000),
+        "popleft x100": (popleft_100, 10_000),
+        "delete x100": (delete_100, 10_000),
+        "LRU miss x100": (lru_miss_100, 10_000),
+        "iterate x1000": (lambda: list(dd.items()), 10_000),
+    }
+
+
+def run_workloads() -> dict[str, Any]:
+    """Time workloads() with whichever DequeDict was imported; warm up first for a JIT."""
+    results = {}
+    for name, (func, iterations) in workloads().items():
+        benchmark(func, iterations // 10)
+        results[name] = min(benchmark(func, iterations) for _ in range(3))
+    return {
+        "impl": "C extension" if HAS_C_EXTENSION else "Pure Python",
+        "python": f"{platform.python_implementation()} {platform.python_version()}",
+        "results": results,
+    }
+
+
+def measure(python: str, pure: bool) -> dict[str, Any]:
+    env = dict(os.environ)
+    if pure:
+        env["NOC"] = "1"
+    else:
+        env.pop("NOC", None)
+    out = subprocess.run([python, __file__, "--workloads"], env=env, check=True, capture_output=True, text=True)
+    return json.loads(out.stdout)
+
+
+def fallback_main(against: str) -> None:
+    fallback = measure(sys.executable, pure=True)
+    c = measure(against, pure=False)
+    if c["impl"] != "C extension":
+        sys.exit(f"{against} does not import the C extension")
+    print("=" * 72)
+    print("Pure-Python fallback vs C extension")
+    print("=" * 72)
+    print(f"Fallback: {fallback['python']}, C extension: {c['python']}\n")
+    print(f"  {'workload':<20}  {'fallback':>10}  {'C':>10}  ratio")
+    for name, ns in fallback["results"].items():
+        c_ns = c["results"][name]
+        print(f"  {name:<20}  {format_ns(ns)}  {format_ns(c_ns)}  {ns / c_ns:5.1f}x")
+    print("\n" + "=" * 72)
+
+
 if __name__ == "__main__":
-    main()
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--fallback", action="store_true", help="compare the pure-Python fallback to the C extension")
+    parser.add_argument("--against", default=sys.executable, help="interpreter with the C extension for --fallback")
+    parser.add_argument("--workloads", action="store_true", help=argparse.SUPPRESS)
+    args = parser.parse_args()
+    if args.workloads:
+        json.dump(run_workloads(), sys.stdout)
+    elif args.fallback:
+        fallback_main(args.against)
+    else:
+        main()
@@ -0,0 +1,428 @@
+#!/usr/bin/env python3
+"""Scaling, trace, memory and GC benchmarks with machine-readable output.
+
+Scaling cases are timed without per-call lambda overhead: C-level loops
+(``map`` drained into a zero-length deque) drive the operations, and the
+remaining per-call cost of the driver is reported as the ``harness`` case so
+it can be subtracted. Trace cases run a Python loop per access, like an
+application would, and time the same loop for every implementation.
+
+Usage:
+    python benchmarks/suite.py                          # n = 10^2 .. 10^6
+    python benchmarks/suite.py --full                   # n = 10^2 .. 10^7
+    python benchmarks/suite.py --json results.json      # Also write JSON
+    python benchmarks/suite.py --compare base.json      # Exit 1 on regressions
+    NOC=1 python benchmarks/suite.py --sizes 1e3,1e4    # Pure Python
+
+Groups (``--groups``): scaling, traces, memory, gc.
+"""
+from __future__ import annotations
+
+import argparse
+import contextlib
+import gc
+import json
+import platform
+import random
+import sys
+import time
+import tracemalloc
+from collections import OrderedDict, deque
+from itertools import repeat, starmap
+from operator import contains, getitem, setitem
+from typing import Any, Callable
+
+from dequedict import HAS_C_EXTENSION, DequeDict, TypedDequeDict
+
+DEFAULT_SIZES = [10**e for e in range(2, 7)]
+FULL_SIZES = [10**e for e in range(2, 8)]
+GROUPS = ("scaling", "traces", "memory", "gc")
+
+consume = deque(maxlen=0).extend
+# map(getitem, repeat(d), keys) rather than map(d.__getitem__, keys): the
+# operator functions call the type slots directly, while d.__getitem__ is a
+# slot wrapper for types that do not define a fast __getitem__ method like dict
+
+
+class Results:
+    """Collects measurements and prints each one as it arrives."""
+
+    def __init__(self) -> None:
+        self.rows: list[dict[str, Any]] = []
+
+    def add(self, group: str, case: str, impl: str, n: int, value: float, unit: str, **extra: Any) -> None:
+        row: dict[str, Any] = {"group": group, "case": case, "impl": impl, "n": n, "value": value, "unit": unit}
+        if extra:
+            row["extra"] = extra
+        self.rows.append(row)
+        note = "".join(f"  {k}={v:.3f}" if isinstance(v, float) else f"  {k}={v}" for k, v in extra.items())
+        print(f"  {case:<22} {impl:<22} n={n:<9} {value:>10.1f} {unit}{note}")
+
+
+def best_ns(setup: Callable[[], Any], run: Callable[[Any], object], ops: int, repeat_: int) -> float:
+    """Best time per operation in ns over repeat_ runs, each on a fresh setup()."""
+    best = float("inf")
+    for _ in range(repeat_):
+        state = setup()
+        gc.disable()
+        try:
+            start = time.perf_counter_ns()
+            run(state)
+            elapsed = time.perf_counter_ns() - start
+        finally:
+            gc.enable()
+        best = min(best, elapsed)
+        del state
+    return best / ops
+
+
+def repeats_for(n: int, base: int) -> int:
+    """Fewer repeats for large n, so 10^7 finishes in reasonable time."""
+    return max(1, min(base, 10**6 // n * base)) if n > 10**5 else base
+
+
+# --- Scaling: one operation at many sizes -----------------------------------
+
+
+def bench_scaling(results: Results, sizes: list[int], repeat_: int) -> None:
+    print("\n--- Scaling (ns per operation) ---")
+    for n in sizes:
+        rng = random.Random(n)
+        keys = [f"key_{i}" for i in range(n)]
+        values = list(range(n))
+        probes = rng.sample(keys, min(n, 10**6))
+        misses = [f"miss_{i}" for i in range(len(probes))]
+        r = repeats_for(n, repeat_)
+        filled = {
+            "DequeDict": lambda: DequeDict(zip(keys, values)),
+            "OrderedDict": lambda: OrderedDict(zip(keys, values)),
+            "dict": lambda: dict(zip(keys, values)),
+        }
+
+        zeros = [0] * len(probes)
+        ns = best_ns(lambda: [None], lambda d: consume(map(getitem, repeat(d), zeros)), len(zeros), r)
+        results.add("scaling", "harness", "list", n, ns, "ns/op")
+
+        for impl, empty in (("DequeDict", DequeDict), ("OrderedDict", OrderedDict), ("dict", dict)):
+            ns = best_ns(empty, lambda d: consume(map(setitem, repeat(d), keys, values)), n, r)
+            results.add("scaling", "insert", impl, n, ns, "ns/op")
+
+        for impl, make in filled.items():
+            d = make()
+            ns = best_ns(lambda d=d: d, lambda d: consume(map(getitem, repeat(d), probes)), len(probes), r)
+            results.add("scaling", "lookup_random", impl, n, ns, "ns/op")
+            ns = best_ns(lambda d=d: d, lambda d: consume(map(contains, repeat(d), misses)), len(misses), r)
+            results.add("scaling", "contains_miss", impl, n, ns, "ns/op")
+            ns = best_ns(lambda d=d: d, lambda d: consume(d.items()), n, r)
+            results.add("scaling", "iterate_items", impl, n, ns, "ns/op")
+            del d
+
+        ns = best_ns(filled["DequeDict"], lambda d: consume(starmap(d.popleft, repeat((), n))), n, r)
+        results.add("scaling", "popleft_drain", "DequeDict", n, ns, "ns/op")
+        ns = best_ns(filled["OrderedDict"], lambda d: consume(starmap(d.popitem, repeat((False,), n))), n, r)
+        results.add("scaling", "popleft_drain", "OrderedDict", n, ns, "ns/op")
+        ns = best_ns(lambda: deque(zip(keys, values)), lambda d: consume(starmap(d.popleft, repeat((), n))), n, r)
+        results.add("scaling", "popleft_drain", "deque", n, ns, "ns/op")
+
+        for impl in ("DequeDict", "OrderedDict"):
+            ns = best_ns(filled[impl], lambda d: consume(map(d.move_to_end, probes)), len(probes), r)
+            results.add("scaling", "move_to_end_churn", impl, n, ns, "ns/op")
+
+        bench_positional(results, n, keys, values, rng, r)
+
+
+def bench_positional(results: Results, n: int, keys: list[str], values: list[int], rng: random.Random, r: int) -> None:
+    """at()/index_of() interleaved with mutations that invalidate the position cache."""
+    rounds = min(n // 2, 10**5)
+    victims = rng.sample(keys, rounds)
+    indices = [rng.randrange(n - rounds) for _ in range(rounds)]
+
+    def at_after_delete(d: DequeDict) -> None:
+        delete, at = d.__delitem__, d.at
+        for key, i in zip(victims, indices):
+            delete(key)
+            at(i)
+
+    def at_after_move(d: DequeDict) -> None:
+        move, at = d.move_to_end, d.at
+        for key, i in zip(victims, indices):
+            move(key, False)
+            at(i)
+
+    ns = best_ns(lambda: DequeDict(zip(keys, values)), at_after_delete, rounds, r)
+    results.add("scaling", "at_after_delete", "DequeDict", n, ns, "ns/round")
+    ns = best_ns(lambda: DequeDict(zip(keys, values)), at_after_move, rounds, r)
+    results.add("scaling", "at_after_move_to_front", "DequeDict", n, ns, "ns/round")
+    d = DequeDict(zip(keys, values))
+    ns = best_ns(lambda: d, lambda d: consume(map(d.index_of, victims)), rounds, r)
+    results.add("scaling", "index_of", "DequeDict", n, ns, "ns/op")
+
+
+# --- Traces: realistic access streams ---------------------------------------
+
+
+def skewed_keys(rng: random.Random, universe: int, count: int, skew: float = 3.0) -> list[int]:
+    """Key stream over range(universe), denser at low keys: hot keys and a long cold tail.
+
+    With universe = 10 * capacity and skew 3, about half the accesses fall
+    on keys that fit in the cache.
+    """
+    rand = rng.random
+    return [int(universe * rand() ** skew) for _ in range(count)]
+
+
+def lru_dequedict(capacity: int, stream: list[int]) -> int:
+    cache: DequeDict[int, int] = DequeDict(maxsize=capacity, touch=True)
+    get = cache.get_and_touch
+    hits = 0
+    for key in stream:
+        if get(key) is None:
+            cache[key] = key
+        else:
+            hits += 1
+    return hits
+
+
+def lru_ordereddict(capacity: int, stream: list[int]) -> int:
+    cache: OrderedDict[int, int] = OrderedDict()
+    move, popitem = cache.move_to_end, cache.popitem
+    hits = 0
+    for key in stream:
+        if key in cache:
+            move(key)
+            hits += 1
+        else:
+            cache[key] = key
+            if len(cache) > capacity:
+                popitem(last=False)
+    return hits
+
+
+def fifo_dequedict(capacity: int, stream: list[int]) -> int:
+    """Deduplicating bounded queue: drop keys already queued, evict the oldest."""
+    queue: DequeDict[int, int] = DequeDict(maxsize=capacity)
+    dupes = 0
+    for key in stream:
+        if key in queue:
+            dupes += 1
+        else:
+            queue[key] = key
+    return dupes
+
+
+def fifo_deque_set(capacity: int, stream: list[int]) -> int:
+    queue: deque[int] = deque()
+    queued: set[int] = set()
+    append, popleft, add, discard = queue.append, queue.popleft, queued.add, queued.discard
+    dupes = 0
+    for key in stream:
+        if key in queued:
+            dupes += 1
+        else:
+            append(key)
+            add(key)
+            if len(queue) > capacity:
+                discard(popleft())
+    return dupes
+
+
+def window_dequedict(width: int, stream: list[int]) -> int:
+    """Sliding time window: insert at t, expire entries older than t - width, look back."""
+    window: DequeDict[int, int] = DequeDict()
+    peekleftitem, popleft, get = window.peekleftitem, window.popleft, window.get
+    found = 0
+    for t, key in enumerate(stream):
+        window[t] = key
+        while peekleftitem()[0] <= t - width:
+            popleft()
+        if get(t - key % width) is not None:
+            found += 1
+    return found
+
+
+def window_ordereddict(width: int, stream: list[int]) -> int:
+    window: OrderedDict[int, int] = OrderedDict()
+    get, popitem = window.get, window.popitem
+    found = 0
+    for t, key in enumerate(stream):
+        window[t] = key
+        while next(iter(window)) <= t - width:
+            popitem(last=False)
+        if get(t - key % width) is not None:
+            found += 1
+    return found
+
+
+TRACES: dict[str, dict[str, Callable[[int, list[int]], int]]] = {
+    "lru": {"DequeDict": lru_dequedict, "OrderedDict": lru_ordereddict},
+    "fifo_dedupe": {"DequeDict": fifo_dequedict, "deque+set": fifo_deque_set},
+    "sliding_window": {"DequeDict": window_dequedict, "OrderedDict": window_ordereddict},
+}
+
+
+def bench_traces(results: Results, sizes: list[int], repeat_: int) -> None:
+    print("\n--- Traces (ns per access, capacity n) ---")
+    for n in sizes:
+        rng = random.Random(n)
+        count = min(max(10 * n, 10**5), 2 * 10**6)
+        stream = skewed_keys(rng, 10 * n, count)
+        r = repeats_for(n, repeat_)
+        for trace, impls in TRACES.items():
+            for impl, func in impls.items():
+                ns = best_ns(lambda: None, lambda _: func(n, stream), count, r)
+                rate = func(n, stream) / count
+                results.add("traces", trace, impl, n, ns, "ns/op", hit_rate=rate)
+
+
+# --- Memory: bytes per entry -------------------------------------------------
+
+
+def traced_bytes(build: Callable[[], Any]) -> tuple[int, Any]:
+    gc.collect()
+    tracemalloc.start()
+    try:
+        obj = build()
+        current = tracemalloc.get_traced_memory()[0]
+    finally:
+        tracemalloc.stop()
+    return current, obj
+
+
+def bench_memory(results: Results, sizes: list[int]) -> None:
+    # Keys and values exist before tracing starts, so the object containers
+    # count only their own tables; TypedDequeDict stores the numbers unboxed
+    print("\n--- Memory (container bytes per entry, keys and values excluded) ---")
+    for n in sizes:
+        keys = list(range(10**9, 10**9 + n))
+        values = [float(i) for i in range(n)]
+        builds: dict[str, Callable[[], Any]] = {
+            "DequeDict": lambda: DequeDict(zip(keys, values)),
+            "DequeDict+index": lambda: _with_rank(keys, values),
+            "OrderedDict": lambda: OrderedDict(zip(keys, values)),
+            "dict": lambda: dict(zip(keys, values)),
+            "TypedDequeDict": lambda: TypedDequeDict(zip(keys, values), key_type="i8", value_type="f8"),
+        }
+        for impl, build in builds.items():
+            size, obj = traced_bytes(build)
+            del obj
+            results.add("memory", "bytes_per_entry", impl, n, size / n, "B/entry")
+
+
+def _with_rank(keys: list[int], values: list[float]) -> DequeDict:
+    """DequeDict after index_of() has built its positional index."""
+    d = DequeDict(zip(keys, values))
+    d.index_of(keys[len(keys) // 2])
+    return d
+
+
+# --- GC: collector pause with many live containers ---------------------------
+
+
+def bench_gc(results: Results, sizes: list[int], repeat_: int) -> None:
+    print("\n--- GC pause (gc.collect() with n entries in 100-entry containers) ---")
+    for n in sizes:
+        count = max(1, n // 100)
+        pairs = [(f"k{i}", i) for i in range(100)]
+        builds: dict[str, Callable[[], Any]] = {
+            "dict": lambda: dict(pairs),
+            "OrderedDict": lambda: OrderedDict(pairs),
+            "DequeDict": lambda: DequeDict(pairs),
+            "DequeDict(no gc)": lambda: DequeDict(pairs, gc_tracking=False),
+            "DequeDict(list values)": lambda: DequeDict((k, [v]) for k, v in pairs),
+        }
+        for impl, build in builds.items():
+            live = [build() for _ in range(count)]
+            gc.collect()
+            best = float("inf")
+            for _ in range(repeat_):
+                start = time.perf_counter_ns()
+                gc.collect()
+                best = min(best, time.perf_counter_ns() - start)
+            results.add("gc", "collect_pause", impl, n, best / 1e6, "ms", tracked=gc.is_tracked(live[0]))
+            del live
+
+
+# --- Reporting ---------------------------------------------------------------
+
+
+def machine_info() -> dict[str, Any]:
+    return {
+        "python": sys.version.split()[0],
+        "implementation": "C extension" if HAS_C_EXTENSION else "Pure Python",
+        "gil_disabled": not getattr(sys, "_is_gil_enabled", lambda: True)(),
+        "platform": platform.platform(),
+        "machine": platform.machine(),
+        "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+    }
+
+
+def compare(rows: list[dict[str, Any]], baseline_path: str, threshold: float) -> int:
+    """Print cases slower than the baseline by more than threshold; return their count."""
+    with open(baseline_path) as f:
+        baseline = {(r["group"], r["case"], r["impl"], r["n"]): r["value"] for r in json.load(f)["results"]}
+    regressions = 0
+    print(f"\n--- Compared with {baseline_path} (threshold {threshold:.0%}) ---")
+    for row in rows:
+        old = baseline.get((row["group"], row["case"], row["impl"], row["n"]))
+        if not old:
+            continue
+        change = row["value"] / old - 1
+        if change > threshold:
+            regressions += 1
+            print(f"  REGRESSION {row['case']:<22} {row['impl']:<22} n={row['n']:<9} "
+                  f"{old:.1f} -> {row['value']:.1f} {row['unit']} ({change:+.0%})")
+    print(f"  {regressions} regression(s)")
+    return regressions
+
+
+def parse_sizes(text: str) -> list[int]:
+    return [int(float(part)) for part in text.split(",") if part]
+
+
+def main(argv: list[str] | None = None) -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--sizes", type=parse_sizes, help="comma-separated sizes, e.g. 1e2,1e4,1e6")
+    parser.add_argument("--full", action="store_true", help="sizes 10^2 .. 10^7")
+    parser.add_argument("--groups", default=",".join(GROUPS), help="comma-separated subset of " + ", ".join(GROUPS))
+    parser.add_argument("--repeat", type=int, default=5, help="runs per case; the best is kept")
+    parser.add_argument("--json", metavar="PATH", help="write results as JSON ('-' for stdout)")
+    parser.add_argument("--compare", metavar="PATH", help="baseline JSON to check for regressions")
+    parser.add_argument("--threshold", type=float, default=0.10, help="allowed slowdown for --compare")
+    args = parser.parse_args(argv)
+
+    sizes = args.sizes or (FULL_SIZES if args.full else DEFAULT_SIZES)
+    groups = [g for g in args.groups.split(",") if g]
+    unknown = set(groups) - set(GROUPS)
+    if unknown:
+        parser.error(f"unknown groups: {', '.join(sorted(unknown))}")
+
+    info = machine_info()
+    results = Results()
+    # With --json -, progress goes to stderr so stdout is only the report
+    with contextlib.redirect_stdout(sys.stderr) if args.json == "-" else contextlib.nullcontext():
+        print("=" * 72)
+        print(f"DequeDict suite: {info['implementation']}, Python {info['python']}, {info['machine']}")
+        print("=" * 72)
+        if "scaling" in groups:
+            bench_scaling(results, sizes, args.repeat)
+        if "traces" in groups:
+            bench_traces(results, sizes, args.repeat)
+        if "memory" in groups:
+            bench_memory(results, sizes)
+        if "gc" in groups:
+            bench_gc(results, sizes, args.repeat)
+
+    report = {"machine": info, "sizes": sizes, "results": results.rows}
+    if args.json == "-":
+        json.dump(report, sys.stdout, indent=1)
+        print()
+    elif args.json:
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=1)
+    if args.compare:
+        return 1 if compare(results.rows, args.compare, args.threshold) else 0
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,102 @@
+"""pytest-benchmark cases for DequeDict, for CI tracking with --benchmark-json.
+
+Usage:
+    pip install -e ".[dev]"
+    python -m pytest benchmarks/test_benchmarks.py --benchmark-json=bench.json
+    python -m pytest benchmarks/test_benchmarks.py --benchmark-compare --benchmark-compare-fail=mean:10%
+
+Not collected by a plain ``pytest`` run (testpaths is tests/). Sizes go up
+to 10^5 so a run stays short; ``benchmarks/suite.py --full`` covers 10^7.
+"""
+from __future__ import annotations
+
+import random
+from collections import deque
+from itertools import repeat, starmap
+from operator import contains, getitem, setitem
+
+import pytest
+
+pytest.importorskip("pytest_benchmark")
+
+from dequedict import DequeDict  # noqa: E402
+
+from suite import TRACES, skewed_keys  # noqa: E402
+
+SIZES = [10**2, 10**3, 10**4, 10**5]
+
+consume = deque(maxlen=0).extend
+
+
+def _filled(n: int) -> tuple[DequeDict, list[str]]:
+    keys = [f"key_{i}" for i in range(n)]
+    return DequeDict(zip(keys, range(n))), random.Random(n).sample(keys, n)
+
+
+@pytest.mark.parametrize("n", SIZES)
+def test_insert(benchmark, n):
+    keys = [f"key_{i}" for i in range(n)]
+    values = list(range(n))
+    benchmark.pedantic(
+        lambda d: consume(map(setitem, repeat(d), keys, values)),
+        setup=lambda: ((DequeDict(),), {}),
+        rounds=20,
+    )
+
+
+@pytest.mark.parametrize("n", SIZES)
+def test_lookup_random(benchmark, n):
+    dd, probes = _filled(n)
+    benchmark(lambda: consume(map(getitem, repeat(dd), probes)))
+
+
+@pytest.mark.parametrize("n", SIZES)
+def test_contains_miss(benchmark, n):
+    dd, _ = _filled(n)
+    misses = [f"miss_{i}" for i in range(n)]
+    benchmark(lambda: consume(map(contains, repeat(dd), misses)))
+
+
+@pytest.mark.parametrize("n", SIZES)
+def test_popleft_drain(benchmark, n):
+    benchmark.pedantic(
+        lambda d: consume(starmap(d.popleft, repeat((), n))),
+        setup=lambda: ((_filled(n)[0],), {}),
+        rounds=20,
+    )
+
+
+@pytest.mark.parametrize("n", SIZES)
+def test_move_to_end_churn(benchmark, n):
+    dd, probes = _filled(n)
+    benchmark(lambda: consume(map(dd.move_to_end, probes)))
+
+
+@pytest.mark.parametrize("n", SIZES)
+def test_at_after_delete(benchmark, n):
+    rounds = n // 2
+    rng = random.Random(n)
+
+    def setup():
+        dd, probes = _filled(n)
+        return (dd, probes[:rounds], [rng.randrange(n - rounds) for _ in range(rounds)]), {}
+
+    def run(dd, victims, indices):
+        for key, i in zip(victims, indices):
+            del dd[key]
+            dd.at(i)
+
+    benchmark.pedantic(run, setup=setup, rounds=10)
+
+
+@pytest.mark.parametrize("n", SIZES)
+def test_iterate_items(benchmark, n):
+    dd, _ = _filled(n)
+    benchmark(lambda: consume(dd.items()))
+
+
+@pytest.mark.parametrize("trace", sorted(TRACES))
+@pytest.mark.parametrize("n", SIZES[:3])
+def test_trace(benchmark, trace, n):
+    stream = skewed_keys(random.Random(n), 10 * n, max(10 * n, 10**4))
+    benchmark(TRACES[trace]["DequeDict"], n, stream)
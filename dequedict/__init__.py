@@ -1,20 +1,68 @@
 """DequeDict - Ordered dictionary with O(1) deque operations at both ends."""
 from __future__ import annotations
 
+import array
+import bisect
+import copy as _copy
+import functools
+import operator
 import os
+import threading
+import time
 import types
+from collections import deque
 from collections.abc import Iterable, Mapping
 from contextlib import suppress
+from pathlib import Path
 from typing import TYPE_CHECKING, Callable, Generic, ItemsView, Iterator, KeysView, TypeVar, ValuesView, overload
 
 from typing_extensions import TypeIs
 
-__all__ = ["DequeDict", "DefaultDequeDict"]
+if TYPE_CHECKING:
+    import asyncio
+
+__all__ = [
+    "DequeDict", "AsyncDequeDict", "DefaultDequeDict", "PriorityDequeDict", "ShardedDequeDict", "TypedDequeDict",
+    "get_include", "HAS_C_EXTENSION",
+]
+
+_POLICIES = ("clock", "slru", "2q", "s3fifo")
+_SEGMENTED = ("slru", "2q", "s3fifo")
+
+# DequeDict._meta bits: the reference bit (clock) or frequency (s3fifo), and
+# membership in the tail segment of a segmented policy
+_REF = 3
+_IN_TAIL = 4
+
+# Fewest slots for which a DequeDict that empties drops its lists; smaller
+# ones keep them on the freelist, like a dict keeps its table
+_SHRINK_MIN = 256
+
+# Counter names of DequeDict.stats(), in the C extension's order
+_STAT_NAMES = (
+    "hits", "misses", "evictions", "expirations", "probes", "collisions", "max_probe",
+    "index_resizes", "cache_rebuilds", "compactions", "freelist_hits", "freelist_misses",
+)
 
 K = TypeVar("K")
 V = TypeVar("V")
 
 
+def _array_view(type_code: object, items: Iterable[object]) -> memoryview:
+    """Read-only memoryview of int64 ("q") or float64 ("d") items."""
+    if not isinstance(type_code, str):
+        raise TypeError("type code must be a str")
+    if type_code not in ("i8", "f8"):
+        raise ValueError(f"type code must be 'i8' or 'f8', not {type_code!r}")
+    fmt = "q" if type_code == "i8" else "d"
+    return memoryview(array.array(fmt, items).tobytes()).cast(fmt)
+
+
+def get_include() -> str:
+    """Return the directory holding dequedict.h, the header of the C API capsule."""
+    return str(Path(__file__).resolve().parent)
+
+
 def _is_iterable_of_pairs(items: object) -> TypeIs[Iterable[tuple[K, V]]]:
     return not isinstance(items, Mapping) and getattr(items, "__iter__", None) is not None
 
@@ -29,116 +77,752 @@ class DequeDict(Mapping[K, V]):
     - O(1) appendleft
     - O(1) move_to_end
     - O(1) at(index) — amortized via incremental cache
+    - index_of/insert_at/del_at/islice — O(log n) in the C extension
+
+    With ``maxsize`` set, inserting past capacity evicts from the opposite
+    end and passes the evicted pairs, as one list per call, to ``on_evict``.
+    ``touch=True`` makes lookups and updates move the key to the end, which
+    turns the container into an LRU cache. ``ttl`` (seconds) stamps each
+    write with ``clock()`` (default ``time.monotonic``) and moves it to the
+    end, so ``expire()`` can pop the expired prefix at the head; lookups of
+    an expired key remove it and treat it as missing. ``policy`` picks the
+    victims at capacity instead: "clock", "slru", "2q" or "s3fifo" ("fifo"
+    is the default order, "lru" the same as ``touch=True``). ``stats=True`` keeps
+    the counters returned by ``stats()``; the key index here is a dict, so
+    probes, collisions, max_probe, index_resizes and compactions stay 0. ``gc_tracking=False``
+    keeps the C extension's DequeDict out of the cyclic garbage collector; it
+    is accepted and kept, but has no effect, here. ``track_values=True`` keeps
+    a reverse index from each (hashable) value to its keys, so
+    ``v in dd.values()``, ``keys_for()`` and ``remove_value()`` cost O(1)
+    average instead of a scan.
     """
 
-    __slots__ = ("_dict", "_head", "_tail", "_cache", "_cache_offset")
+    # Entries live in parallel lists indexed by slot: _keys, _vals, the
+    # _prev/_next links (-1 ends the list), _stamps with a clock and _meta
+    # (reference bits and _IN_TAIL) under a policy. _slot maps each key to
+    # its slot, freed slots are reused from _free, and the lists only shrink
+    # when the DequeDict empties. _lean is true without clock, stats or
+    # policy, where the hot methods skip straight to the lists.
+    __slots__ = (
+        "_slot", "_keys", "_vals", "_prev", "_next", "_stamps", "_meta", "_free", "_head", "_tail", "_lean",
+        "_version", "_cache", "_cache_offset", "_maxsize", "_on_evict", "_evicted", "touch",
+        "_gc_tracking", "_ttl", "_clock", "_now", "_stats",
+        "_policy", "_seg", "_seg_count", "_ghost", "_value_keys",
+    )
     __hash__ = None  # type: ignore[assignment]
 
     def __class_getitem__(cls, params: object) -> types.GenericAlias:
         return types.GenericAlias(cls, params)
 
-    class _Node:
-        __slots__ = ("key", "value", "prev", "next", "cache_idx")
-
-        def __init__(self, key: K, value: V) -> None:
-            self.key = key
-            self.value = value
-            self.prev: DequeDict._Node | None = None
-            self.next: DequeDict._Node | None = None
-            self.cache_idx: int = -1
-
-    def __init__(self, items: Mapping[K, V] | Iterable[tuple[K, V]] | None = None) -> None:
-        self._dict: dict[K, DequeDict._Node] = {}
-        self._head: DequeDict._Node | None = None
-        self._tail: DequeDict._Node | None = None
-        self._cache: list[V] | None = None
+    def __init__(
+        self,
+        items: Mapping[K, V] | Iterable[tuple[K, V]] | None = None,
+        *,
+        maxsize: int | None = None,
+        on_evict: Callable[[list[tuple[K, V]]], object] | None = None,
+        touch: bool = False,
+        gc_tracking: bool = True,
+        ttl: float | None = None,
+        clock: Callable[[], float] | None = None,
+        stats: bool = False,
+        policy: str | None = None,
+        track_values: bool = False,
+    ) -> None:
+        if maxsize is not None:
+            maxsize = operator.index(maxsize)
+            if maxsize < 0:
+                raise ValueError("maxsize must be non-negative or None")
+        if on_evict is not None and not callable(on_evict):
+            raise TypeError("on_evict must be callable or None")
+        if ttl is not None:
+            ttl = float(ttl)
+            if not ttl > 0:
+                raise ValueError("ttl must be positive or None")
+        if clock is not None and not callable(clock):
+            raise TypeError("clock must be callable or None")
+        if policy is not None and not isinstance(policy, str):
+            raise TypeError("policy must be a str or None")
+        if policy == "lru":
+            touch = True
+        if policy in ("fifo", "lru"):
+            policy = None
+        if policy is not None:
+            if policy not in _POLICIES:
+                raise ValueError(
+                    f"policy must be 'fifo', 'lru', 'clock', 'slru', '2q', 's3fifo' or None, not {policy!r}"
+                )
+            if maxsize is None:
+                raise ValueError("policy needs maxsize")
+            if touch:
+                raise ValueError("policy cannot be combined with touch=True")
+            if ttl is not None or clock is not None:
+                raise ValueError("policy cannot be combined with ttl or clock")
+        self._policy = policy
+        self._seg = -1  # First slot of the tail segment
+        self._seg_count = 0
+        self._ghost: dict[int, None] = {}  # Hashes of recently evicted keys, oldest first
+        self._ttl = ttl
+        self._clock = clock if clock is not None or ttl is None else time.monotonic
+        self._now = 0.0
+        self._stats: dict[str, int] | None = dict.fromkeys(_STAT_NAMES, 0) if stats else None
+        self._slot: dict[K, int] = {}
+        self._keys: list[K | None] = []
+        self._vals: list[V | None] = []
+        self._prev: list[int] = []
+        self._next: list[int] = []
+        self._stamps: list[float] | None = [] if self._clock is not None else None
+        self._meta: list[int] | None = [] if policy is not None else None
+        self._free: list[int] = []
+        self._head = -1
+        self._tail = -1
+        self._version = 0  # Bumped whenever the links change; checked by iterators
+        self._cache: list[int] | None = None  # Slots in list order from _cache_offset
         self._cache_offset: int = 0
+        self._maxsize = maxsize
+        self._on_evict = on_evict
+        self._evicted: list[tuple[K, V]] = []
+        self._gc_tracking = bool(gc_tracking)
+        # Keys of each value, in insertion order, or None without track_values
+        self._value_keys: dict[object, dict[K, None]] | None = {} if track_values else None
+        self.touch = bool(touch)
+        self._lean = self._clock is None and self._stats is None and policy is None
         if items is not None:
-            if _is_iterable_of_pairs(items):
-                for k, v in items:
-                    self[k] = v
+            self._tick()
+            set_one = self._setter()
+            try:
+                if _is_iterable_of_pairs(items):
+                    for k, v in items:
+                        set_one(k, v)
+                else:
+                    for k, v in items.items():
+                        set_one(k, v)
+            finally:
+                self._flush_evicted()
+
+    @property
+    def maxsize(self) -> int | None:
+        """Capacity, or None if unbounded."""
+        return self._maxsize
+
+    @property
+    def policy(self) -> str:
+        """Eviction policy: 'fifo', 'lru', 'clock', 'slru', '2q' or 's3fifo'."""
+        if self._policy is not None:
+            return self._policy
+        return "lru" if self.touch else "fifo"
+
+    @property
+    def ttl(self) -> float | None:
+        """Entry lifetime in seconds, or None."""
+        return self._ttl
+
+    @property
+    def track_values(self) -> bool:
+        """If true, values are indexed for keys_for(), remove_value() and value membership."""
+        return self._value_keys is not None
+
+    @property
+    def on_evict(self) -> Callable[[list[tuple[K, V]]], object] | None:
+        """Called with a list of evicted (key, value) pairs, or None."""
+        return self._on_evict
+
+    @on_evict.setter
+    def on_evict(self, callback: Callable[[list[tuple[K, V]]], object] | None) -> None:
+        if callback is not None and not callable(callback):
+            raise TypeError("on_evict must be callable or None")
+        self._on_evict = callback
+
+    def _options(self) -> dict[str, object]:
+        options: dict[str, object] = {}
+        if self._maxsize is not None:
+            options["maxsize"] = self._maxsize
+        if self._on_evict is not None:
+            options["on_evict"] = self._on_evict
+        if self.touch:
+            options["touch"] = True
+        if not self._gc_tracking:
+            options["gc_tracking"] = False
+        if self._ttl is not None:
+            options["ttl"] = self._ttl
+        if self._clock is not None and (self._clock is not time.monotonic or self._ttl is None):
+            options["clock"] = self._clock
+        if self._stats is not None:
+            options["stats"] = True
+        if self._policy is not None:
+            options["policy"] = self._policy
+        if self._value_keys is not None:
+            options["track_values"] = True
+        return options
+
+    def _tick(self) -> None:
+        if self._clock is not None:
+            self._now = self._clock()
+
+    def _find_live(self, key: object) -> int:
+        """Slot of key, or -1; with a ttl, an expired entry is removed and -1 returned."""
+        if self._clock is None:
+            i = self._slot.get(key, -1)  # type: ignore[call-overload]
+            if self._stats is not None:
+                self._stats["misses" if i < 0 else "hits"] += 1
+            return i
+        self._tick()
+        i = self._slot.get(key, -1)  # type: ignore[call-overload]
+        if i >= 0 and self._ttl is not None and self._stamps[i] <= self._now - self._ttl:  # type: ignore[index]
+            if self._stats is not None:
+                self._stats["expirations"] += 1
+                self._stats["misses"] += 1
+            pair = (self._keys[i], self._vals[i])
+            self._drop(i)
+            if self._on_evict is not None:
+                self._evicted.append(pair)  # type: ignore[arg-type]
+            self._flush_evicted()
+            return -1
+        if self._stats is not None:
+            self._stats["misses" if i < 0 else "hits"] += 1
+        return i
+
+    def stats(self) -> dict[str, int]:
+        """Hit, miss, eviction, probe, rebuild and freelist counters."""
+        if self._stats is None:
+            raise ValueError("stats() needs a DequeDict created with stats=True")
+        return dict(self._stats)
+
+    def reset_stats(self) -> None:
+        """Zero the counters."""
+        if self._stats is None:
+            raise ValueError("reset_stats() needs a DequeDict created with stats=True")
+        self._stats = dict.fromkeys(_STAT_NAMES, 0)
+
+    def _touch_slot(self, i: int) -> None:
+        if self._stamps is not None:
+            self._stamps[i] = self._now
+        self._move_to_tail(i)
+
+    def _expire_prefix(self, keep: Callable[[float], bool]) -> int:
+        n = 0
+        try:
+            while self._head >= 0 and not keep(self._stamps[self._head]):  # type: ignore[index]
+                pair = self.popleftitem()
+                if self._stats is not None:
+                    self._stats["expirations"] += 1
+                if self._on_evict is not None:
+                    self._evicted.append(pair)
+                n += 1
+        finally:
+            self._flush_evicted()
+        return n
+
+    def expire_before(self, ts: float) -> int:
+        """Remove entries stamped before ts from the head; return how many."""
+        ts = float(ts)
+        if self._clock is None:
+            raise ValueError("expire_before() needs a DequeDict created with ttl or clock")
+        return self._expire_prefix(lambda stamp: stamp >= ts)
+
+    def expire(self, now: float | None = None) -> int:
+        """Remove entries older than ttl at now (default clock()) from the head; return how many."""
+        if self._ttl is None:
+            raise ValueError("expire() needs a DequeDict created with ttl")
+        if now is None:
+            self._tick()
+            now = self._now
+        cutoff = float(now) - self._ttl
+        return self._expire_prefix(lambda stamp: stamp > cutoff)
+
+    def _join_tail(self, i: int) -> None:
+        """Put slot i, just linked at the tail, in the tail segment."""
+        self._meta[i] |= _IN_TAIL  # type: ignore[index]
+        self._seg_count += 1
+        if self._seg < 0:
+            self._seg = i
+        if self._policy == "slru":
+            # However i got here, protected is capped at 80% of maxsize
+            while self._seg_count > self._maxsize - self._maxsize // 5:  # type: ignore[operator]
+                self._advance_seg()
+
+    def _advance_seg(self) -> None:
+        """Move the first entry of the tail segment into the head segment."""
+        i = self._seg
+        self._meta[i] &= ~_IN_TAIL  # type: ignore[index]
+        self._seg = self._next[i]
+        self._seg_count -= 1
+
+    def _link_head_segment(self, i: int) -> None:
+        """Link slot i at the end of the head segment, just before the tail segment."""
+        self._version += 1
+        self._invalidate_cache()
+        at = self._seg
+        p = self._prev[at] if at >= 0 else self._tail
+        self._next[i] = at
+        self._prev[i] = p
+        if p >= 0:
+            self._next[p] = i
+        else:
+            self._head = i
+        if at >= 0:
+            self._prev[at] = i
+        else:
+            self._tail = i
+
+    def _policy_hit(self, i: int) -> None:
+        policy = self._policy
+        meta: list[int] = self._meta  # type: ignore[assignment]
+        if policy == "clock":
+            meta[i] |= 1
+        elif policy == "s3fifo":
+            if meta[i] & _REF < 3:
+                meta[i] += 1
+        elif policy == "2q":
+            if not meta[i] & _IN_TAIL and self._next[i] != self._seg:
+                self._unlink(i)
+                self._link_head_segment(i)
+        elif policy == "slru":
+            if i != self._tail:
+                self._move_to_tail(i)
+            elif not meta[i] & _IN_TAIL:
+                self._join_tail(i)
+
+    def _hit(self, i: int) -> None:
+        if self._policy is not None:
+            self._policy_hit(i)
+        elif self.touch:
+            self._touch_slot(i)
+
+    def _ghost_add(self, i: int) -> None:
+        ghost = self._ghost
+        ghost[hash(self._keys[i])] = None
+        if len(ghost) > self._maxsize:  # type: ignore[operator]
+            del ghost[next(iter(ghost))]
+
+    def _ghost_take(self, key: K) -> bool:
+        """True if key was evicted recently; forgets it."""
+        try:
+            del self._ghost[hash(key)]
+        except KeyError:
+            return False
+        return True
+
+    def _policy_victim(self) -> int:
+        maxsize: int = self._maxsize  # type: ignore[assignment]
+        policy = self._policy
+        meta: list[int] = self._meta  # type: ignore[assignment]
+        while True:
+            head = self._head
+            seg = self._seg
+            if policy == "clock":
+                if not meta[head] & _REF:
+                    return head
+                meta[head] &= ~_REF
+                self._move_to_tail(head)
+            elif policy == "2q":
+                if seg >= 0 and (seg == head or self._seg_count > maxsize // 4):
+                    self._ghost_add(seg)
+                    return seg
+                return head
+            elif policy == "s3fifo":
+                if seg >= 0 and (seg == head or self._seg_count > maxsize // 10):
+                    if meta[seg] & _REF <= 1:
+                        self._ghost_add(seg)
+                        return seg
+                    meta[seg] &= ~_REF
+                    self._advance_seg()
+                elif not meta[head] & _REF:
+                    return head
+                else:
+                    meta[head] -= 1
+                    self._unlink(head)
+                    self._link_head_segment(head)
+            else:
+                return head
+
+    def _evict(self, from_head: bool) -> None:
+        while len(self._slot) > self._maxsize:  # type: ignore[operator]
+            if self._policy is not None:
+                i = self._policy_victim()
             else:
-                for k, v in items.items():
-                    self[k] = v
+                i = self._head if from_head else self._tail
+            if self._stats is not None:
+                self._stats["evictions"] += 1
+            pair = (self._keys[i], self._vals[i])
+            self._drop(i)
+            if self._on_evict is not None:
+                self._evicted.append(pair)  # type: ignore[arg-type]
+
+    def _flush_evicted(self) -> None:
+        batch = self._evicted
+        if batch:
+            self._evicted = []
+            if self._on_evict is not None:
+                self._on_evict(batch)
 
     def _invalidate_cache(self) -> None:
         self._cache = None
         self._cache_offset = 0
 
-    def _build_cache(self) -> list[_Node]:
-        cache: list[DequeDict._Node] = []
-        node = self._head
-        i = 0
-        while node:
-            node.cache_idx = i
-            cache.append(node)
-            node = node.next
-            i += 1
+    def _build_cache(self) -> list[int]:
+        cache: list[int] = []
+        nxt = self._next
+        i = self._head
+        while i >= 0:
+            cache.append(i)
+            i = nxt[i]
+        if self._stats is not None:
+            self._stats["cache_rebuilds"] += 1
         self._cache = cache
         self._cache_offset = 0
         return cache
 
     def __len__(self) -> int:
-        return len(self._dict)
+        return len(self._slot)
 
     def __contains__(self, key: object) -> bool:
-        return key in self._dict
+        if self._lean:
+            return key in self._slot
+        return self._find_live(key) >= 0
 
     def __getitem__(self, key: K) -> V:
-        if key not in self._dict:
-            raise KeyError(key)
-        return self._dict[key].value
+        if self._lean:
+            if not self.touch:
+                try:
+                    return self._vals[self._slot[key]]  # type: ignore[return-value]
+                except KeyError:
+                    pass
+            else:
+                i = self._slot.get(key, -1)
+                if i >= 0:
+                    self._move_to_tail(i)
+                    return self._vals[i]  # type: ignore[return-value]
+        else:
+            i = self._find_live(key)
+            if i >= 0:
+                self._hit(i)
+                return self._vals[i]  # type: ignore[return-value]
+        missing = getattr(type(self), "__missing__", None)
+        if missing is not None:
+            return missing(self, key)
+        raise KeyError(key)
 
     def __setitem__(self, key: K, value: V) -> None:
-        if key in self._dict:
-            node = self._dict[key]
-            node.value = value
+        if self._lean and self._value_keys is None:
+            # _set_plain(), with the update of an existing key inlined
+            free = self._free
+            version = self._version
+            i = free[-1] if free else len(self._keys)
+            j = self._slot.setdefault(key, i)
+            if j != i:
+                self._vals[j] = value
+                if self.touch:
+                    self._move_to_tail(j)
+                return
+            self._append_plain(i, key, value, version)
+            if self._evicted:
+                self._flush_evicted()
+            return
+        self._tick()
+        try:
+            self._set(key, value)
+        finally:
+            self._flush_evicted()
+
+    def _set_plain(self, key: K, value: V) -> None:
+        """_set() without clock, stats, policy or track_values: one dict lookup claims the slot."""
+        free = self._free
+        version = self._version
+        i = free[-1] if free else len(self._keys)
+        j = self._slot.setdefault(key, i)
+        if j != i:
+            self._vals[j] = value
+            if self.touch:
+                self._move_to_tail(j)
             return
-        node = self._Node(key, value)
-        self._dict[key] = node
+        self._append_plain(i, key, value, version)
+
+    def _append_plain(self, i: int, key: K, value: V, version: int) -> None:
+        """Fill free slot i, just claimed for key in _slot, and link it at the tail."""
+        if self._version != version:  # key's __eq__ changed the slots during the lookup
+            del self._slot[key]
+            self._set_plain(key, value)
+            return
+        keys = self._keys
+        free = self._free
+        tail = self._tail
+        if free:
+            free.pop()
+            keys[i] = key
+            self._vals[i] = value
+            self._prev[i] = tail
+            self._next[i] = -1
+        else:
+            keys.append(key)
+            self._vals.append(value)
+            self._prev.append(tail)
+            self._next.append(-1)
+        if tail >= 0:
+            self._next[tail] = i
+        else:
+            self._head = i
+        self._tail = i
+        self._version += 1
         if self._cache is not None:
-            node.cache_idx = len(self._cache)
-            self._cache.append(node)
-        if self._tail is None:
-            self._head = self._tail = node
+            self._cache.append(i)
+        if self._maxsize is not None and len(self._slot) > self._maxsize:
+            i = self._head  # One insert evicts one entry
+            pair = (self._keys[i], self._vals[i])
+            self._drop(i)
+            if self._on_evict is not None:
+                self._evicted.append(pair)  # type: ignore[arg-type]
+
+    def _new_slot(self, key: K, value: V) -> int:
+        """Store key and value in a free slot, unlinked, and return it; the caller adds it to _slot."""
+        free = self._free
+        if self._stats is not None:
+            self._stats["freelist_hits" if free else "freelist_misses"] += 1
+        if free:
+            i = free.pop()
+            self._keys[i] = key
+            self._vals[i] = value
+            if self._stamps is not None:
+                self._stamps[i] = self._now
+            if self._meta is not None:
+                self._meta[i] = 0
+        else:
+            i = len(self._keys)
+            self._keys.append(key)
+            self._vals.append(value)
+            self._prev.append(-1)
+            self._next.append(-1)
+            if self._stamps is not None:
+                self._stamps.append(self._now)
+            if self._meta is not None:
+                self._meta.append(0)
+        return i
+
+    def _link_tail(self, i: int) -> None:
+        tail = self._tail
+        self._version += 1
+        self._prev[i] = tail
+        self._next[i] = -1
+        if tail >= 0:
+            self._next[tail] = i
         else:
-            node.prev = self._tail
-            self._tail.next = node
-            self._tail = node
+            self._head = i
+        self._tail = i
+
+    def _link_head(self, i: int) -> None:
+        head = self._head
+        self._version += 1
+        self._prev[i] = -1
+        self._next[i] = head
+        if head >= 0:
+            self._prev[head] = i
+        else:
+            self._tail = i
+        self._head = i
+
+    def _setter(self) -> Callable[[K, V], None]:
+        """_set(), or _set_plain() when it applies, for loops over many pairs."""
+        return self._set_plain if self._lean and self._value_keys is None else self._set
+
+    def _set(self, key: K, value: V) -> None:
+        value_keys = self._value_keys
+        if value_keys is not None:
+            hash(value)  # Unhashable values raise before any change
+        i = self._slot.get(key, -1)
+        if i >= 0:
+            if value_keys is not None:
+                self._unindex_value(key, self._vals[i])  # type: ignore[arg-type]
+                self._index_value(key, value)
+            self._vals[i] = value
+            if self._policy is not None:
+                self._policy_hit(i)
+            elif self.touch or self._clock is not None:
+                self._touch_slot(i)
+            return
+        self._index_value(key, value)
+        i = self._new_slot(key, value)
+        self._slot[key] = i
+        policy = self._policy
+        if policy == "slru" or (policy in ("2q", "s3fifo") and self._ghost_take(key)):
+            self._link_head_segment(i)
+            if len(self._slot) > self._maxsize:  # type: ignore[operator]
+                self._evict(from_head=True)
+            return
+        if self._cache is not None:
+            self._cache.append(i)
+        self._link_tail(i)
+        if policy in _SEGMENTED:
+            self._join_tail(i)
+        if self._maxsize is not None and len(self._slot) > self._maxsize:
+            self._evict(from_head=True)
 
     def __delitem__(self, key: K) -> None:
-        if key not in self._dict:
+        i = self._slot.get(key, -1)
+        if i < 0:
             raise KeyError(key)
-        node = self._dict.pop(key)
-        self._unlink(node)
+        self._drop(i)
+
+    def _cache_prepend(self, i: int) -> None:
+        cache = self._cache
+        if cache is not None:
+            if self._cache_offset:
+                self._cache_offset -= 1
+                cache[self._cache_offset] = i
+            else:
+                cache.insert(0, i)
+
+    def _index_value(self, key: K, value: V) -> None:
+        value_keys = self._value_keys
+        if value_keys is not None:
+            value_keys.setdefault(value, {})[key] = None
+
+    def _unindex_value(self, key: K, value: V) -> None:
+        value_keys = self._value_keys
+        if value_keys is not None:
+            keys = value_keys[value]
+            del keys[key]
+            if not keys:
+                del value_keys[value]
+
+    def _drop(self, i: int) -> None:
+        """Remove slot i from the key and value indexes, the cache and the list, and free it."""
+        keys = self._keys
+        vals = self._vals
+        key = keys[i]
+        del self._slot[key]
+        if self._value_keys is not None:
+            self._unindex_value(key, vals[i])  # type: ignore[arg-type]
+        cache = self._cache
+        if cache is not None:
+            if i == self._head:
+                self._cache_offset += 1
+            elif i == self._tail:
+                cache.pop()
+            else:
+                del cache[cache.index(i, self._cache_offset)]
+        if self._meta is not None:
+            self._unlink(i)
+        else:
+            self._version += 1
+            p = self._prev[i]
+            n = self._next[i]
+            if p >= 0:
+                self._next[p] = n
+            else:
+                self._head = n
+            if n >= 0:
+                self._prev[n] = p
+            else:
+                self._tail = p
+        keys[i] = vals[i] = None
+        if self._slot or len(keys) <= _SHRINK_MIN:
+            self._free.append(i)
+        else:
+            self._reset_slots()
+
+    def _reset_slots(self) -> None:
+        """Replace the slot lists with empty ones; the DequeDict must be empty."""
+        self._keys = []
+        self._vals = []
+        self._prev = []
+        self._next = []
+        if self._stamps is not None:
+            self._stamps = []
+        if self._meta is not None:
+            self._meta = []
+        self._free = []
+        self._head = -1
+        self._tail = -1
+        self._seg = -1
+        self._seg_count = 0
         self._invalidate_cache()
 
-    def _unlink(self, node: _Node) -> None:
-        if node.prev:
-            node.prev.next = node.next
+    def _unlink(self, i: int) -> None:
+        self._version += 1
+        meta = self._meta
+        if meta is not None and meta[i] & _IN_TAIL:
+            meta[i] &= ~_IN_TAIL
+            self._seg_count -= 1
+            if i == self._seg:
+                self._seg = self._next[i]
+        p = self._prev[i]
+        n = self._next[i]
+        if p >= 0:
+            self._next[p] = n
         else:
-            self._head = node.next
-        if node.next:
-            node.next.prev = node.prev
+            self._head = n
+        if n >= 0:
+            self._prev[n] = p
         else:
-            self._tail = node.prev
+            self._tail = p
+
+    def _move_to_tail(self, i: int) -> None:
+        tail = self._tail
+        if i == tail:
+            return
+        cache = self._cache
+        if cache is not None:
+            del cache[cache.index(i, self._cache_offset)]
+            cache.append(i)
+        if self._meta is not None:
+            self._unlink(i)
+            self._link_tail(i)
+            if self._policy in _SEGMENTED:
+                self._join_tail(i)
+            return
+        self._version += 1
+        prev, nxt = self._prev, self._next
+        p = prev[i]
+        n = nxt[i]
+        if p >= 0:
+            nxt[p] = n
+        else:
+            self._head = n
+        prev[n] = p
+        prev[i] = tail
+        nxt[i] = -1
+        nxt[tail] = i
+        self._tail = i
+
+    def _walk(self, column: int, reverse: bool = False) -> Iterator[object]:
+        """Yield keys (column 0), values (1) or pairs (2) in list order, or reversed."""
+        version = self._version
+        keys, vals = self._keys, self._vals
+        links = self._prev if reverse else self._next
+        i = self._tail if reverse else self._head
+        while i >= 0:
+            following = links[i]
+            if column == 0:
+                yield keys[i]
+            elif column == 1:
+                yield vals[i]
+            else:
+                yield (keys[i], vals[i])
+            if following < 0:
+                return
+            if self._version != version:
+                raise RuntimeError("DequeDict mutated during iteration")
+            i = following
 
     def __iter__(self) -> Iterator[K]:
-        node = self._head
-        while node:
-            yield node.key
-            node = node.next
+        version = self._version
+        keys, nxt = self._keys, self._next
+        i = self._head
+        while i >= 0:
+            following = nxt[i]
+            yield keys[i]  # type: ignore[misc]
+            if following < 0:
+                return
+            if self._version != version:
+                raise RuntimeError("DequeDict mutated during iteration")
+            i = following
 
     def __reversed__(self) -> Iterator[K]:
-        node = self._tail
-        while node:
-            yield node.key
-            node = node.prev
+        return self._walk(0, reverse=True)  # type: ignore[return-value]
 
     def __repr__(self) -> str:
-        if not self._dict:
+        if not self._slot:
             return "DequeDict()"
-        items = [(n.key, n.value) for n in self._iter_nodes()]
+        items = list(self._walk(2))
         return f"DequeDict({items!r})"
 
     def __eq__(self, other: object) -> bool:
@@ -148,63 +832,94 @@ class DequeDict(Mapping[K, V]):
             return False
         return all(not (k not in other or other[k] != v) for k, v in self.items())
 
-    def _iter_nodes(self) -> Iterator[_Node]:
-        node = self._head
-        while node:
-            yield node
-            node = node.next
+    def __or__(self, other: object) -> DequeDict[K, V]:
+        if not isinstance(other, (dict, DequeDict)):
+            return NotImplemented
+        merged = self._empty_like()
+        merged._clone_from(self)
+        merged.update(other)
+        return merged
+
+    def __ror__(self, other: object) -> DequeDict[K, V]:
+        if not isinstance(other, (dict, DequeDict)):
+            return NotImplemented
+        merged = self._empty_like()
+        merged.update(other)
+        merged.update(self)
+        return merged
+
+    def __ior__(self, other: Mapping[K, V] | Iterable[tuple[K, V]]) -> DequeDict[K, V]:
+        self.update(other)
+        return self
 
     def peekleft(self) -> V:
         """Return first value without removing."""
-        if self._head is None:
+        if self._head < 0:
             raise IndexError("peek from an empty DequeDict")
-        return self._head.value
+        return self._vals[self._head]  # type: ignore[return-value]
 
     def peekleftitem(self) -> tuple[K, V]:
         """Return first (key, value) without removing."""
-        if self._head is None:
+        i = self._head
+        if i < 0:
             raise IndexError("peek from an empty DequeDict")
-        return (self._head.key, self._head.value)
+        return (self._keys[i], self._vals[i])  # type: ignore[return-value]
 
     def peekleftkey(self) -> K:
         """Return first key without removing."""
-        if self._head is None:
+        if self._head < 0:
             raise IndexError("peek from an empty DequeDict")
-        return self._head.key
+        return self._keys[self._head]  # type: ignore[return-value]
 
     def peek(self) -> V:
         """Return last value without removing."""
-        if self._tail is None:
+        if self._tail < 0:
             raise IndexError("peek from an empty DequeDict")
-        return self._tail.value
+        return self._vals[self._tail]  # type: ignore[return-value]
 
     def peekitem(self) -> tuple[K, V]:
         """Return last (key, value) without removing."""
-        if self._tail is None:
+        i = self._tail
+        if i < 0:
             raise IndexError("peek from an empty DequeDict")
-        return (self._tail.key, self._tail.value)
+        return (self._keys[i], self._vals[i])  # type: ignore[return-value]
 
-    def popleft(self) -> V:
-        """Remove and return first value."""
-        if self._head is None:
+    def _wait(self, timeout: float | None) -> None:
+        """Poll until an entry arrives or timeout seconds pass."""
+        if timeout is None:
+            return
+        if not timeout >= 0:
+            raise ValueError("timeout must be a non-negative number or None")
+        deadline = time.monotonic() + timeout
+        delay = 0.0001
+        while self._head < 0:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return
+            time.sleep(min(delay, remaining))
+            delay = min(delay * 2, 0.01)
+
+    def popleft(self, timeout: float | None = None) -> V:
+        """Remove and return first value, waiting up to timeout seconds if empty."""
+        if timeout is not None:
+            self._wait(timeout)
+        i = self._head
+        if i < 0:
             raise IndexError("pop from an empty DequeDict")
-        node = self._head
-        del self._dict[node.key]
-        self._unlink(node)
-        if self._cache is not None:
-            self._cache_offset += 1
-        return node.value
-
-    def popleftitem(self) -> tuple[K, V]:
-        """Remove and return first (key, value)."""
-        if self._head is None:
+        value = self._vals[i]
+        self._drop(i)
+        return value  # type: ignore[return-value]
+
+    def popleftitem(self, timeout: float | None = None) -> tuple[K, V]:
+        """Remove and return first (key, value), waiting up to timeout seconds if empty."""
+        if timeout is not None:
+            self._wait(timeout)
+        i = self._head
+        if i < 0:
             raise KeyError("popleftitem from an empty DequeDict")
-        node = self._head
-        del self._dict[node.key]
-        self._unlink(node)
-        if self._cache is not None:
-            self._cache_offset += 1
-        return (node.key, node.value)
+        pair = (self._keys[i], self._vals[i])
+        self._drop(i)
+        return pair  # type: ignore[return-value]
 
     @overload
     def pop(self) -> V: ...
@@ -216,81 +931,135 @@ class DequeDict(Mapping[K, V]):
     def pop(self, key: K | None = None, default: V | None = None) -> V:  # type: ignore[misc]
         """Remove and return value by key, or from end if no key given."""
         if key is None:
-            if self._tail is None:
+            i = self._tail
+            if i < 0:
                 if default is not None:
                     return default
                 raise IndexError("pop from an empty DequeDict")
-            node = self._tail
-            del self._dict[node.key]
-            self._unlink(node)
-            if self._cache is not None:
-                self._cache.pop()
-            return node.value
-        if key not in self._dict:
-            if default is not None:
-                return default
-            raise KeyError(key)
-        node = self._dict.pop(key)
-        self._unlink(node)
-        self._invalidate_cache()
-        return node.value
+        else:
+            i = self._slot.get(key, -1)
+            if i < 0:
+                if default is not None:
+                    return default
+                raise KeyError(key)
+        value = self._vals[i]
+        self._drop(i)
+        return value  # type: ignore[return-value]
 
     def popitem(self) -> tuple[K, V]:
         """Remove and return last (key, value)."""
-        if self._tail is None:
+        i = self._tail
+        if i < 0:
             raise KeyError("popitem from an empty DequeDict")
-        node = self._tail
-        del self._dict[node.key]
-        self._unlink(node)
-        if self._cache is not None:
-            self._cache.pop()
-        return (node.key, node.value)
+        pair = (self._keys[i], self._vals[i])
+        self._drop(i)
+        return pair  # type: ignore[return-value]
 
     def appendleft(self, key: K, value: V) -> None:
-        """Insert (key, value) at front."""
-        if key in self._dict:
+        """Insert (key, value) at front, evicting from the end when over capacity."""
+        if key in self._slot:
             raise KeyError("key already exists")
-        node = self._Node(key, value)
-        self._dict[key] = node
-        self._invalidate_cache()
-        if self._head is None:
-            self._head = self._tail = node
-        else:
-            node.next = self._head
-            self._head.prev = node
-            self._head = node
+        if self._clock is not None:
+            self._now = self._clock()
+        if self._value_keys is not None:
+            self._index_value(key, value)
+        i = self._new_slot(key, value)
+        self._slot[key] = i
+        if self._cache is not None:
+            self._cache_prepend(i)
+        self._link_head(i)
+        if self._maxsize is not None and len(self._slot) > self._maxsize:
+            try:
+                self._evict(from_head=False)
+            finally:
+                self._flush_evicted()
+
+    def try_popleft(self, default: V | None = None) -> V | None:
+        """Remove and return first value, or default if empty."""
+        if self._head < 0:
+            return default
+        return self.popleft()
+
+    def popleft_n(self, n: int) -> list[V]:
+        """Remove and return up to n first values."""
+        return [value for _, value in self.popleftitems_n(n)]
+
+    def pop_n(self, n: int) -> list[V]:
+        """Remove and return up to n last values, last first."""
+        n = operator.index(n)
+        if n < 0:
+            raise ValueError("n must be non-negative")
+        return [self.pop() for _ in range(min(n, len(self)))]
+
+    def popleftitems_n(self, n: int) -> list[tuple[K, V]]:
+        """Remove and return up to n first (key, value) pairs."""
+        n = operator.index(n)
+        if n < 0:
+            raise ValueError("n must be non-negative")
+        return [self.popleftitem() for _ in range(min(n, len(self)))]
+
+    def extend(self, pairs: Mapping[K, V] | Iterable[tuple[K, V]]) -> None:
+        """Set each (key, value) pair, appending new keys."""
+        self.update(pairs)
+
+    def extendleft(self, pairs: Mapping[K, V] | Iterable[tuple[K, V]]) -> None:
+        """appendleft() each (key, value) pair, so they end up in reverse order."""
+        items = pairs.items() if isinstance(pairs, Mapping) else pairs
+        for key, value in items:
+            self.appendleft(key, value)
 
     def move_to_end(self, key: K, last: bool = True) -> None:
         """Move existing key to front (last=False) or back (last=True)."""
-        if key not in self._dict:
+        i = self._slot.get(key, -1)
+        if i < 0:
             raise KeyError(key)
-        node = self._dict[key]
-        if (last and node is self._tail) or (not last and node is self._head):
-            return
-        self._unlink(node)
-        self._invalidate_cache()
         if last:
-            node.prev = self._tail
-            node.next = None
-            if self._tail:
-                self._tail.next = node
-            else:
-                self._head = node
-            self._tail = node
-        else:
-            node.prev = None
-            node.next = self._head
-            if self._head:
-                self._head.prev = node
-            else:
-                self._tail = node
-            self._head = node
+            self._move_to_tail(i)
+        elif i != self._head:
+            self._unlink(i)
+            cache = self._cache
+            if cache is not None:
+                del cache[cache.index(i, self._cache_offset)]
+            self._cache_prepend(i)
+            self._link_head(i)
 
     def get(self, key: K, default: V | None = None) -> V | None:
         """Return value for key, or default if key not present."""
-        if key not in self._dict:
+        if self._lean:
+            i = self._slot.get(key, -1)
+            return default if i < 0 else self._vals[i]
+        i = self._find_live(key)
+        if i < 0:
             return default
-        return self._dict[key].value
+        if self._policy is not None:
+            self._policy_hit(i)
+        return self._vals[i]
+
+    def get_and_touch(self, key: K, default: V | None = None) -> V | None:
+        """Like get(), but move key to the end if present (under a policy, a plain hit)."""
+        i = self._find_live(key)
+        if i < 0:
+            return default
+        if self._policy is not None:
+            self._policy_hit(i)
+        else:
+            self._touch_slot(i)
+        return self._vals[i]
+
+    # The C version skips hashing key again; here the dict hashes it anyway
+    def get_with_hash(self, key: K, h: int, default: V | None = None) -> V | None:  # noqa: ARG002
+        """Like get(), given h == hash(key)."""
+        return self.get(key, default)
+
+    def set_with_hash(self, key: K, h: int, value: V) -> None:  # noqa: ARG002
+        """Like self[key] = value, given h == hash(key)."""
+        self[key] = value
+
+    def pop_with_hash(self, key: K, h: int, *default: V) -> V:  # noqa: ARG002
+        """Like pop(key[, default]), given h == hash(key)."""
+        if default and key not in self._slot:
+            return default[0]
+        return self.pop(key)
 
     def keys(self) -> KeysView[K]:
         """Return view of keys in insertion order."""
@@ -304,36 +1073,158 @@ class DequeDict(Mapping[K, V]):
         """Return view of (key, value) pairs in insertion order."""
         return _DequeDictItemsView(self)
 
+    def keys_array(self, type_code: str = "i8") -> memoryview:
+        """Return a read-only memoryview of the keys in order as int64 ("i8") or float64 ("f8")."""
+        return _array_view(type_code, self.keys())
+
+    def values_array(self, type_code: str = "f8") -> memoryview:
+        """Return a read-only memoryview of the values in order as int64 ("i8") or float64 ("f8")."""
+        return _array_view(type_code, self.values())
+
     def clear(self) -> None:
         """Remove all items."""
-        self._dict.clear()
-        self._head = None
-        self._tail = None
-        self._invalidate_cache()
+        self._slot.clear()
+        self._reset_slots()
+        self._ghost.clear()
+        if self._value_keys is not None:
+            self._value_keys.clear()
+        self._version += 1
 
     def copy(self) -> DequeDict[K, V]:
-        """Return a shallow copy."""
-        return DequeDict(self.items())
+        """Return a shallow copy with the same maxsize, on_evict and touch."""
+        clone: DequeDict[K, V] = DequeDict(**self._options())  # type: ignore[arg-type]
+        clone._clone_from(self)
+        return clone
+
+    def _clone_from(self, other: DequeDict[K, V]) -> None:
+        """Fill this empty DequeDict with other's entries, packed in list order."""
+        order = []
+        nxt = other._next
+        i = other._head
+        while i >= 0:
+            order.append(i)
+            i = nxt[i]
+        n = len(order)
+        self._tick()
+        keys = list(map(other._keys.__getitem__, order))
+        vals = list(map(other._vals.__getitem__, order))
+        for key, value in zip(keys, vals):
+            self._index_value(key, value)  # type: ignore[arg-type]
+        self._keys = keys
+        self._vals = vals
+        self._prev = list(range(-1, n - 1))
+        self._next = list(range(1, n + 1))
+        if n:
+            self._next[-1] = -1
+        if self._stamps is not None:
+            if self._clock is other._clock:
+                self._stamps = list(map(other._stamps.__getitem__, order))  # type: ignore[union-attr]
+            else:
+                self._stamps = [self._now] * n
+        if self._meta is not None:
+            self._meta = [0] * n
+        self._slot = dict(zip(keys, range(n)))  # type: ignore[arg-type]
+        self._head = 0 if n else -1
+        self._tail = n - 1
+        self._version += 1
+
+    def _empty_like(self) -> DequeDict[K, V]:
+        """Return an empty instance of this type with the same constructor arguments."""
+        return type(self)(*self._reduce_args(), **self._options())  # type: ignore[arg-type]
+
+    def __copy__(self) -> DequeDict[K, V]:
+        clone = self._empty_like()
+        clone._clone_from(self)
+        return clone
+
+    def __deepcopy__(self, memo: dict[int, object]) -> DequeDict[K, V]:
+        items = list(self.items())
+        clone = type(self)(*self._reduce_args(), **self._options())  # type: ignore[arg-type]
+        memo[id(self)] = clone
+        for k, v in items:
+            clone[_copy.deepcopy(k, memo)] = _copy.deepcopy(v, memo)
+        return clone
+
+    def _reduce_args(self) -> tuple[object, ...]:
+        return ()
+
+    def __reduce__(self) -> tuple[object, ...]:
+        """Pickle as flat key and value lists plus the constructor options."""
+        keys = list(self._walk(0))
+        values = list(self._walk(1))
+        state: tuple[object, ...] = (keys, values, self._options())
+        extra = getattr(self, "__dict__", None)
+        if extra:
+            state += (extra,)
+        return (type(self), self._reduce_args(), state)
+
+    def __setstate__(self, state: tuple[object, ...]) -> None:
+        keys, values, options = state[:3]
+        if len(keys) != len(values):  # type: ignore[arg-type]
+            raise ValueError("__setstate__ expects as many keys as values")
+        DequeDict.__init__(self, **options)  # type: ignore[arg-type]
+        self._tick()
+        set_one = self._setter()
+        try:
+            for k, v in zip(keys, values):  # type: ignore[call-overload]
+                set_one(k, v)
+        finally:
+            self._flush_evicted()
+        if len(state) > 3:
+            self.__dict__.update(state[3])  # type: ignore[arg-type]
+
+    def presize(self, n: int) -> None:
+        """Reserve room for n more items (a no-op in pure Python)."""
+        if operator.index(n) < 0:
+            raise ValueError("n must be non-negative")
 
     def update(self, other: Mapping[K, V] | Iterable[tuple[K, V]] | None = None, **kwargs: V) -> None:
         """Update from dict, iterable of pairs, or keyword arguments."""
-        if other is not None:
-            if isinstance(other, Mapping):
-                for k, v in other.items():
-                    self[k] = v
-            else:
-                for k, v in other:
-                    self[k] = v
-        for k, v in kwargs.items():
-            self[k] = v  # type: ignore[index]
+        self._tick()
+        set_one = self._setter()
+        try:
+            if other is not None and other is not self:
+                if isinstance(other, Mapping):
+                    for k, v in other.items():
+                        set_one(k, v)
+                else:
+                    for k, v in other:
+                        set_one(k, v)
+            for k, v in kwargs.items():
+                set_one(k, v)  # type: ignore[arg-type]
+        finally:
+            self._flush_evicted()
 
     def setdefault(self, key: K, default: V | None = None) -> V | None:
         """Return value for key, setting default if not present."""
-        if key in self._dict:
-            return self._dict[key].value
+        i = self._find_live(key)
+        if i >= 0:
+            if self._policy is not None:
+                self._policy_hit(i)
+            return self._vals[i]
         self[key] = default  # type: ignore[assignment]
         return default
 
+    def keys_for(self, value: object) -> list[K]:
+        """Return the keys whose value equals value (in no particular order under track_values)."""
+        value_keys = self._value_keys
+        if value_keys is not None:
+            try:
+                return list(value_keys.get(value, ()))
+            except TypeError:  # Tracked values are all hashable
+                return []
+        return [k for k, v in self._walk(2) if v is value or v == value]  # type: ignore[misc]
+
+    def remove_value(self, value: object) -> int:
+        """Remove every key whose value equals value and return how many were removed."""
+        removed = 0
+        for key in self.keys_for(value):
+            i = self._slot.get(key, -1)
+            if i >= 0:
+                self._drop(i)
+                removed += 1
+        return removed
+
     def at(self, index: int) -> V:
         """Return value at index position. Supports negative indexing. O(1) amortized."""
         cache = self._cache
@@ -344,7 +1235,95 @@ class DequeDict(Mapping[K, V]):
             index += logical_size
         if index < 0 or index >= logical_size:
             raise IndexError("index out of range")
-        return cache[self._cache_offset + index].value
+        return self._vals[cache[self._cache_offset + index]]  # type: ignore[return-value]
+
+    def _slot_at(self, index: int) -> int:
+        n = len(self._slot)
+        if index < n // 2:
+            nxt = self._next
+            i = self._head
+            for _ in range(index):
+                i = nxt[i]
+        else:
+            prev = self._prev
+            i = self._tail
+            for _ in range(n - 1 - index):
+                i = prev[i]
+        return i
+
+    def index_of(self, key: K) -> int:
+        """Return the position of key."""
+        i = self._slot.get(key, -1)
+        if i < 0:
+            raise KeyError(key)
+        prev = self._prev
+        index = 0
+        i = prev[i]
+        while i >= 0:
+            i = prev[i]
+            index += 1
+        return index
+
+    def insert_at(self, index: int, key: K, value: V) -> None:
+        """Insert (key, value) before position index, clamped like list.insert()."""
+        if key in self._slot:
+            raise KeyError("key already exists")
+        n = len(self._slot)
+        if index < 0:
+            index = max(0, index + n)
+        if index >= n:
+            self[key] = value
+            return
+        if index == 0:
+            self.appendleft(key, value)
+            return
+        after = self._slot_at(index)
+        self._tick()
+        self._index_value(key, value)
+        i = self._new_slot(key, value)
+        self._slot[key] = i
+        self._version += 1
+        before = self._prev[after]
+        self._prev[i] = before
+        self._next[i] = after
+        self._next[before] = i
+        self._prev[after] = i
+        meta = self._meta
+        if meta is not None and meta[after] & _IN_TAIL and after != self._seg:
+            meta[i] |= _IN_TAIL
+            self._seg_count += 1
+        if self._cache is not None:
+            self._cache.insert(self._cache_offset + index, i)
+        if self._maxsize is not None and len(self._slot) > self._maxsize:
+            try:
+                self._evict(from_head=True)
+            finally:
+                self._flush_evicted()
+
+    def del_at(self, index: int) -> tuple[K, V]:
+        """Remove and return the (key, value) at position index."""
+        n = len(self._slot)
+        if index < 0:
+            index += n
+        if index < 0 or index >= n:
+            raise IndexError("index out of range")
+        i = self._slot_at(index)
+        pair = (self._keys[i], self._vals[i])
+        self._drop(i)
+        return pair  # type: ignore[return-value]
+
+    def islice(self, start: int | None = None, stop: int | None = None) -> list[tuple[K, V]]:
+        """Return the (key, value) pairs in positions [start, stop)."""
+        start, stop, _ = slice(start, stop).indices(len(self._slot))
+        if start >= stop:
+            return []
+        keys, vals, nxt = self._keys, self._vals, self._next
+        i = self._slot_at(start)
+        items = []
+        for _ in range(stop - start):
+            items.append((keys[i], vals[i]))
+            i = nxt[i]
+        return items  # type: ignore[return-value]
 
 
 class _DequeDictKeysView(KeysView[K]):
@@ -376,17 +1355,19 @@ class _DequeDictValuesView(ValuesView[V]):
         return len(self._dd)
 
     def __iter__(self) -> Iterator[V]:
-        for node in self._dd._iter_nodes():
-            yield node.value
+        return self._dd._walk(1)  # type: ignore[return-value]
 
     def __reversed__(self) -> Iterator[V]:
-        node = self._dd._tail
-        while node:
-            yield node.value
-            node = node.prev
+        return self._dd._walk(1, reverse=True)  # type: ignore[return-value]
 
     def __contains__(self, value: object) -> bool:
-        return any(node.value == value for node in self._dd._iter_nodes())
+        value_keys = self._dd._value_keys
+        if value_keys is not None:
+            try:
+                return value in value_keys
+            except TypeError:  # Tracked values are all hashable
+                return False
+        return any(v == value for v in self._dd._walk(1))
 
 
 class _DequeDictItemsView(ItemsView[K, V]):
@@ -399,14 +1380,10 @@ class _DequeDictItemsView(ItemsView[K, V]):
         return len(self._dd)
 
     def __iter__(self) -> Iterator[tuple[K, V]]:
-        for node in self._dd._iter_nodes():
-            yield (node.key, node.value)
+        return self._dd._walk(2)  # type: ignore[return-value]
 
     def __reversed__(self) -> Iterator[tuple[K, V]]:
-        node = self._dd._tail
-        while node:
-            yield (node.key, node.value)
-            node = node.prev
+        return self._dd._walk(2, reverse=True)  # type: ignore[return-value]
 
     def __contains__(self, item: object) -> bool:
         if not isinstance(item, tuple) or len(item) != 2:
@@ -426,9 +1403,22 @@ class DefaultDequeDict(DequeDict[K, V]):
         self,
         default_factory: Callable[[], V] | None = None,
         items: Mapping[K, V] | Iterable[tuple[K, V]] | None = None,
+        *,
+        maxsize: int | None = None,
+        on_evict: Callable[[list[tuple[K, V]]], object] | None = None,
+        touch: bool = False,
+        gc_tracking: bool = True,
+        ttl: float | None = None,
+        clock: Callable[[], float] | None = None,
+        stats: bool = False,
+        policy: str | None = None,
+        track_values: bool = False,
     ) -> None:
         self.default_factory = default_factory
-        super().__init__(items)
+        super().__init__(
+            items, maxsize=maxsize, on_evict=on_evict, touch=touch, gc_tracking=gc_tracking, ttl=ttl, clock=clock,
+            stats=stats, policy=policy, track_values=track_values,
+        )
 
     def __missing__(self, key: K) -> V:
         if self.default_factory is None:
@@ -437,20 +1427,813 @@ class DefaultDequeDict(DequeDict[K, V]):
         self[key] = value
         return value
 
+    def __repr__(self) -> str:
+        return f"DefaultDequeDict({self.default_factory}, {list(self.items())!r})"
+
+    def copy(self) -> DefaultDequeDict[K, V]:
+        clone: DefaultDequeDict[K, V] = DefaultDequeDict(self.default_factory, **self._options())  # type: ignore[arg-type]
+        clone._clone_from(self)
+        return clone
+
+    def _reduce_args(self) -> tuple[object, ...]:
+        return (self.default_factory,)
+
+
+class AsyncDequeDict(DequeDict[K, V]):
+    """DequeDict whose consumers can await apopleft() and apopleft_n() on an asyncio loop.
+
+    A consumer that finds no entry for it parks a Future; inserts resolve
+    one per new entry, in waiting order, once the inserting call is done.
+    A woken consumer is owed an entry and takes it when it resumes, waiting
+    again at the front if a synchronous pop took it first. Producers on
+    another thread hand the wakeup to the loop with call_soon_threadsafe().
+    """
+
+    __slots__ = ("_waiters", "_woken", "_swept", "_loop", "_loop_thread")
+
+    def __init__(self, *args: object, **kwargs: object) -> None:
+        self._waiters: deque[asyncio.Future[bool | None]] = deque()
+        self._woken = 0
+        self._swept = 0
+        self._loop: asyncio.AbstractEventLoop | None = None
+        self._loop_thread = 0
+        super().__init__(*args, **kwargs)  # type: ignore[arg-type]
+
+    def _wake(self) -> None:
+        """Resolve waiting Futures while entries outnumber the consumers owed one."""
+        waiters = self._waiters
+        if not waiters or len(self) <= self._woken:
+            return
+        if threading.get_ident() != self._loop_thread:
+            self._loop.call_soon_threadsafe(self._wake)  # type: ignore[union-attr]
+            return
+        while waiters and len(self) > self._woken:
+            fut = waiters.popleft()
+            if not fut.done():
+                fut.set_result(None)
+                self._woken += 1
+
+    async def _ready(self, timeout: float | None) -> bool:
+        """Wait until an entry is free for this consumer; False on timeout."""
+        if timeout is not None and not timeout >= 0:
+            raise ValueError("timeout must be a non-negative number or None")
+        if len(self) > self._woken:
+            return True
+        import asyncio
+
+        loop = asyncio.get_running_loop()
+        if self._loop is not loop:
+            if self._woken or any(not fut.done() for fut in self._waiters):
+                raise RuntimeError("AsyncDequeDict is already awaited on another event loop")
+            self._waiters.clear()
+            self._loop = loop
+            self._loop_thread = threading.get_ident()
+        deadline = None if timeout is None or timeout == float("inf") else loop.time() + timeout
+        front = False
+        while len(self) <= self._woken:
+            if deadline is not None and loop.time() >= deadline:
+                return False
+            waiters = self._waiters
+            if len(waiters) >= 2 * self._swept + 8:
+                self._waiters = waiters = deque(fut for fut in waiters if not fut.done())
+                self._swept = len(waiters)
+            fut = loop.create_future()
+            if front:
+                waiters.appendleft(fut)
+            else:
+                waiters.append(fut)
+            timer = None if deadline is None else loop.call_at(deadline, _expire_future, fut)
+            try:
+                woken = await fut is None
+            except BaseException:
+                # Cancelled after its wakeup: pass the entry on
+                if fut.done() and not fut.cancelled() and fut.result() is None:
+                    self._woken -= 1
+                    self._wake()
+                raise
+            finally:
+                if timer is not None:
+                    timer.cancel()
+            if woken:
+                self._woken -= 1
+                front = True
+        return True
+
+    async def apopleft(self, timeout: float | None = None) -> V:
+        """Remove and return first value, waiting for one up to timeout seconds."""
+        if not await self._ready(timeout):
+            raise _asyncio_timeout()
+        return self.popleft()
+
+    async def apopleftitem(self, timeout: float | None = None) -> tuple[K, V]:
+        """Remove and return first (key, value), waiting for one up to timeout seconds."""
+        if not await self._ready(timeout):
+            raise _asyncio_timeout()
+        return self.popleftitem()
+
+    async def apopleft_n(self, n: int, timeout: float | None = None) -> list[V]:
+        """Wait for an entry, then remove and return up to n first values; [] on timeout."""
+        n = operator.index(n)
+        if n < 0:
+            raise ValueError("n must be non-negative")
+        if n == 0 or not await self._ready(timeout):
+            return []
+        # Leave the entries owed to other woken consumers
+        return self.popleft_n(min(n, len(self) - self._woken))
+
+    def __setitem__(self, key: K, value: V) -> None:
+        super().__setitem__(key, value)
+        self._wake()
+
+    def appendleft(self, key: K, value: V) -> None:
+        super().appendleft(key, value)
+        self._wake()
+
+    def update(self, other: Mapping[K, V] | Iterable[tuple[K, V]] | None = None, **kwargs: V) -> None:
+        try:
+            super().update(other, **kwargs)
+        finally:
+            self._wake()
+
+    def insert_at(self, index: int, key: K, value: V) -> None:
+        super().insert_at(index, key, value)
+        self._wake()
+
+
+def _expire_future(fut: asyncio.Future[bool | None]) -> None:
+    if not fut.done():
+        fut.set_result(False)
+
+
+def _asyncio_timeout() -> BaseException:
+    import asyncio
+
+    return asyncio.TimeoutError()
+
+
+def _score_arg(score: object) -> float:
+    """Score as a float, like the C extension's: any real number but NaN."""
+    if isinstance(score, (str, bytes, bytearray)):  # float() would parse these
+        raise TypeError(f"must be real number, not {type(score).__name__}")
+    value = float(score)  # type: ignore[arg-type]
+    if value != value:
+        raise ValueError("score must not be NaN")
+    return value
+
+
+class PriorityDequeDict(Generic[K, V]):
+    """Dictionary ordered by a float score per key, lowest first.
+
+    Equal scores keep insertion order. The left end is the lowest score and
+    the right end the highest, with the DequeDict peek/pop methods at both.
+    ``push(key, value, score)`` inserts or replaces and ``update_score()``
+    moves a key; plain item assignment is refused, since it has no score.
+
+    The C extension threads a skip list through the entries (O(log n)
+    push, O(1) delete). This fallback keeps the (score, sequence) ranks in a
+    sorted list next to a DequeDict in the same order.
+    """
+
+    __slots__ = ("_data", "_rank", "_order", "_seq")
+    __hash__ = None  # type: ignore[assignment]
+
+    def __class_getitem__(cls, params: object) -> types.GenericAlias:
+        return types.GenericAlias(cls, params)
+
+    def __init__(self, items: Iterable[tuple[K, V, float]] | None = None) -> None:
+        self._data: DequeDict[K, V] = DequeDict()
+        self._rank: dict[K, tuple[float, int]] = {}
+        self._order: list[tuple[float, int]] = []
+        self._seq = 0
+        if items is not None:
+            for item in items:
+                if not isinstance(item, tuple) or len(item) != 3:
+                    raise ValueError("PriorityDequeDict requires sequence of (key, value, score) triples")
+                self.push(*item)
+
+    def _place(self, score: float) -> tuple[int, tuple[float, int]]:
+        """Rank for a key given score now, after its equals, and its position."""
+        rank = (score, self._seq)
+        self._seq += 1
+        return bisect.bisect_left(self._order, rank), rank
+
+    def _forget(self, key: K) -> None:
+        del self._order[bisect.bisect_left(self._order, self._rank.pop(key))]
+
+    def push(self, key: K, value: V, score: float) -> None:
+        """Insert (key, value) with score, or replace its value and score."""
+        score = _score_arg(score)
+        if key in self._rank:
+            self._data[key] = value
+            self.update_score(key, score)
+            return
+        i, rank = self._place(score)
+        self._order.insert(i, rank)
+        self._rank[key] = rank
+        self._data.insert_at(i, key, value)
+
+    def update_score(self, key: K, score: float) -> None:
+        """Move key to its place for a new score."""
+        score = _score_arg(score)
+        old = self._rank[key]
+        if score == old[0]:
+            return
+        i = bisect.bisect_left(self._order, old)
+        del self._order[i]
+        j, rank = self._place(score)
+        self._order.insert(j, rank)
+        self._rank[key] = rank
+        if j != i:
+            self._data.insert_at(j, key, self._data.pop(key))
+
+    def score_of(self, key: K) -> float:
+        return self._rank[key][0]
+
+    def __len__(self) -> int:
+        return len(self._data)
+
+    def __getitem__(self, key: K) -> V:
+        return self._data[key]
+
+    def __setitem__(self, key: K, value: V) -> None:
+        raise TypeError("PriorityDequeDict entries need a score: use push(key, value, score)")
+
+    def __delitem__(self, key: K) -> None:
+        del self._data[key]
+        self._forget(key)
+
+    def __contains__(self, key: object) -> bool:
+        return key in self._data
+
+    def __iter__(self) -> Iterator[K]:
+        return iter(self._data)
+
+    def __reversed__(self) -> Iterator[K]:
+        return reversed(self._data)
+
+    def get(self, key: K, default: V | None = None) -> V | None:
+        return self._data.get(key, default)
+
+    def keys(self) -> KeysView[K]:
+        return self._data.keys()
+
+    def values(self) -> ValuesView[V]:
+        return self._data.values()
+
+    def items(self) -> ItemsView[K, V]:
+        return self._data.items()
+
+    def peekleft(self) -> V:
+        return self._data.peekleft()
+
+    def peekleftitem(self) -> tuple[K, V]:
+        return self._data.peekleftitem()
+
+    def peekleftkey(self) -> K:
+        return self._data.peekleftkey()
+
+    def peek(self) -> V:
+        return self._data.peek()
+
+    def peekitem(self) -> tuple[K, V]:
+        return self._data.peekitem()
+
+    def popleft(self) -> V:
+        if not self._data:
+            raise IndexError("pop from an empty DequeDict")
+        return self.popleftitem()[1]
+
+    def popleftitem(self) -> tuple[K, V]:
+        item = self._data.popleftitem()
+        del self._order[0]
+        del self._rank[item[0]]
+        return item
+
+    def pop(self, *args: object) -> V:
+        """Remove and return value by key, or with the highest score if no key given."""
+        if len(args) > 2:
+            raise TypeError(f"pop expected at most 2 arguments, got {len(args)}")
+        if not args:
+            if not self._data:
+                raise IndexError("pop from an empty DequeDict")
+            return self.popitem()[1]
+        key = args[0]
+        if key not in self._rank:
+            if len(args) > 1:
+                return args[1]  # type: ignore[return-value]
+            raise KeyError(key)
+        self._forget(key)  # type: ignore[arg-type]
+        return self._data.pop(key)  # type: ignore[arg-type]
+
+    def popitem(self) -> tuple[K, V]:
+        item = self._data.popitem()
+        self._order.pop()
+        del self._rank[item[0]]
+        return item
+
+    def popleft_n(self, n: int) -> list[V]:
+        return [value for _, value in self.popleftitems_n(n)]
+
+    def pop_n(self, n: int) -> list[V]:
+        n = operator.index(n)
+        if n < 0:
+            raise ValueError("n must be non-negative")
+        return [self.popitem()[1] for _ in range(min(n, len(self)))]
+
+    def popleftitems_n(self, n: int) -> list[tuple[K, V]]:
+        n = operator.index(n)
+        if n < 0:
+            raise ValueError("n must be non-negative")
+        return [self.popleftitem() for _ in range(min(n, len(self)))]
+
+    def clear(self) -> None:
+        self._data.clear()
+        self._rank.clear()
+        self._order.clear()
+
+    def _triples(self) -> list[tuple[K, V, float]]:
+        return [(key, value, self._rank[key][0]) for key, value in self._data.items()]
+
+    def copy(self) -> PriorityDequeDict[K, V]:
+        return type(self)(self._triples())
+
+    __copy__ = copy
+
+    def __reduce__(self) -> tuple[object, ...]:
+        return (type(self), (self._triples(),))
+
+    def __eq__(self, other: object) -> bool:
+        if isinstance(other, PriorityDequeDict):
+            other = other._data
+        if not isinstance(other, (dict, DequeDict)):
+            return NotImplemented
+        return self._data == other
+
+    def __repr__(self) -> str:
+        if not self._data:
+            return "PriorityDequeDict()"
+        return f"PriorityDequeDict({self._triples()!r})"
+
+
+class ShardedDequeDict(Generic[K, V]):
+    """DequeDict hash-partitioned into independently locked shards.
+
+    Order is kept per shard. ``popleft()`` without a shard takes the
+    shards in turn, which approximates global order when keys spread
+    evenly. ``maxsize`` is split evenly over the shards.
+    """
+
+    __slots__ = ("_shards", "_locks", "_maxsize", "_cursor")
+    __hash__ = None  # type: ignore[assignment]
+
+    def __class_getitem__(cls, params: object) -> types.GenericAlias:
+        return types.GenericAlias(cls, params)
+
+    def __init__(
+        self,
+        items: Mapping[K, V] | Iterable[tuple[K, V]] | None = None,
+        *,
+        shards: int = 16,
+        maxsize: int | None = None,
+        on_evict: Callable[[list[tuple[K, V]]], object] | None = None,
+        touch: bool = False,
+    ) -> None:
+        shards = operator.index(shards)
+        if not 1 <= shards <= 65536:
+            raise ValueError("shards must be between 1 and 65536")
+        per_shard = None
+        if maxsize is not None:
+            maxsize = operator.index(maxsize)
+            if maxsize < 0:
+                raise ValueError("maxsize must be non-negative or None")
+            per_shard = -(-maxsize // shards)
+        self._maxsize = maxsize
+        self._shards: list[DequeDict[K, V]] = [
+            DequeDict(maxsize=per_shard, on_evict=on_evict, touch=touch) for _ in range(shards)
+        ]
+        self._locks = [threading.RLock() for _ in range(shards)]
+        self._cursor = 0
+        if items is not None:
+            self.update(items)
+
+    def shard_of(self, key: K) -> int:
+        h = (hash(key) * 0x9E3779B97F4A7C15) & 0xFFFFFFFFFFFFFFFF
+        return ((h >> 32) * len(self._shards)) >> 32
+
+    def shard(self, index: int) -> DequeDict[K, V]:
+        try:
+            return self._shards[operator.index(index)]
+        except IndexError:
+            raise IndexError("shard index out of range") from None
+
+    @property
+    def maxsize(self) -> int | None:
+        return self._maxsize
+
+    @property
+    def shard_count(self) -> int:
+        return len(self._shards)
+
+    def __len__(self) -> int:
+        return sum(len(shard) for shard in self._shards)
+
+    def __getitem__(self, key: K) -> V:
+        i = self.shard_of(key)
+        with self._locks[i]:
+            return self._shards[i][key]
+
+    def __setitem__(self, key: K, value: V) -> None:
+        i = self.shard_of(key)
+        with self._locks[i]:
+            self._shards[i][key] = value
+
+    def __delitem__(self, key: K) -> None:
+        i = self.shard_of(key)
+        with self._locks[i]:
+            del self._shards[i][key]
+
+    def __contains__(self, key: object) -> bool:
+        i = self.shard_of(key)  # type: ignore[arg-type]
+        with self._locks[i]:
+            return key in self._shards[i]
+
+    def __iter__(self) -> Iterator[K]:
+        return iter(self.keys())
+
+    def get(self, key: K, default: V | None = None) -> V | None:
+        i = self.shard_of(key)
+        with self._locks[i]:
+            return self._shards[i].get(key, default)
+
+    def pop(self, key: K, *default: V) -> V:
+        if len(default) > 1:
+            raise TypeError(f"pop expected at most 2 arguments, got {len(default) + 1}")
+        i = self.shard_of(key)
+        with self._locks[i]:
+            shard = self._shards[i]
+            if key in shard:
+                return shard.pop(key)
+            if default:
+                return default[0]
+            raise KeyError(key)
+
+    def setdefault(self, key: K, default: V | None = None) -> V | None:
+        i = self.shard_of(key)
+        with self._locks[i]:
+            return self._shards[i].setdefault(key, default)  # type: ignore[arg-type]
+
+    def _popleft(self, shard: int | None, items: bool) -> object:
+        if shard is not None:
+            order = [operator.index(shard)]
+            if not -len(self._shards) <= order[0] < len(self._shards):
+                raise IndexError("shard index out of range")
+            order[0] %= len(self._shards)
+        else:
+            n = len(self._shards)
+            order = [(self._cursor + t) % n for t in range(n)]
+        for i in order:
+            with self._locks[i]:
+                dd = self._shards[i]
+                if dd:
+                    if shard is None:
+                        self._cursor = (i + 1) % len(self._shards)
+                    return dd.popleftitem() if items else dd.popleft()
+        if items:
+            raise KeyError("popleftitem from an empty ShardedDequeDict")
+        raise IndexError("pop from an empty ShardedDequeDict")
+
+    def popleft(self, shard: int | None = None) -> V:
+        return self._popleft(shard, False)  # type: ignore[return-value]
+
+    def popleftitem(self, shard: int | None = None) -> tuple[K, V]:
+        return self._popleft(shard, True)  # type: ignore[return-value]
+
+    def popitem(self) -> tuple[K, V]:
+        for lock, shard in zip(reversed(self._locks), reversed(self._shards)):
+            with lock:
+                if shard:
+                    return shard.popitem()
+        raise KeyError("popitem from an empty ShardedDequeDict")
+
+    def move_to_end(self, key: K, last: bool = True) -> None:
+        i = self.shard_of(key)
+        with self._locks[i]:
+            self._shards[i].move_to_end(key, last=last)
+
+    def _options(self) -> dict[str, object]:
+        first = self._shards[0]
+        options: dict[str, object] = {"shards": len(self._shards)}
+        if self._maxsize is not None:
+            options["maxsize"] = self._maxsize
+        if first._on_evict is not None:
+            options["on_evict"] = first._on_evict
+        if first.touch:
+            options["touch"] = True
+        return options
+
+    def copy(self) -> ShardedDequeDict[K, V]:
+        """Return a shallow copy with the same shards, maxsize, on_evict and touch."""
+        clone = type(self)(**self._options())  # type: ignore[arg-type]
+        for lock, shard, target in zip(self._locks, self._shards, clone._shards):
+            with lock:
+                target._clone_from(shard)
+        return clone
+
+    __copy__ = copy
+
+    def __reduce__(self) -> tuple[object, ...]:
+        """Pickle as the items plus shards, maxsize, on_evict and touch."""
+        return (functools.partial(type(self), **self._options()), (self.items(),))
+
+    def _collect(self, kind: int) -> list:
+        result: list = []
+        for lock, shard in zip(self._locks, self._shards):
+            with lock:
+                if kind == 0:
+                    result.extend(shard.keys())
+                elif kind == 1:
+                    result.extend(shard.values())
+                else:
+                    result.extend(shard.items())
+        return result
+
+    def keys(self) -> list[K]:
+        return self._collect(0)
+
+    def values(self) -> list[V]:
+        return self._collect(1)
+
+    def items(self) -> list[tuple[K, V]]:
+        return self._collect(2)
+
+    def clear(self) -> None:
+        for lock, shard in zip(self._locks, self._shards):
+            with lock:
+                shard.clear()
+
+    def update(self, other: Mapping[K, V] | Iterable[tuple[K, V]] | None = None, **kwargs: V) -> None:
+        if other is not None:
+            pairs = other.items() if isinstance(other, (Mapping, ShardedDequeDict)) else other
+            for pair in pairs:
+                if not isinstance(pair, tuple) or len(pair) != 2:
+                    raise ValueError("ShardedDequeDict requires sequence of (key, value) pairs")
+                self[pair[0]] = pair[1]
+        for k, v in kwargs.items():
+            self[k] = v  # type: ignore[index]
+
+    def __eq__(self, other: object) -> bool:
+        if not isinstance(other, (dict, DequeDict, ShardedDequeDict)):
+            return NotImplemented
+        return dict(self.items()) == dict(other.items())
+
+    def __ne__(self, other: object) -> bool:
+        if not isinstance(other, (dict, DequeDict, ShardedDequeDict)):
+            return NotImplemented
+        return not self == other
+
+    def __repr__(self) -> str:
+        items = self.items()
+        if not items:
+            return f"ShardedDequeDict(shards={len(self._shards)})"
+        return f"ShardedDequeDict({items!r}, shards={len(self._shards)})"
+
+
+_INT64_MIN, _INT64_MAX = -(1 << 63), (1 << 63) - 1
+_ABSENT = object()  # Lookup key for values no TypedDequeDict can hold
+
+
+def _typed_checker(code: object, is_value: bool) -> tuple[str, Callable[[object], object]]:
+    """Parse a type code into its canonical name and a value checker."""
+    if code == "i8":
+
+        def check_int(obj: object) -> int:
+            if not isinstance(obj, int):
+                raise TypeError(f"{'value' if is_value else 'key'} must be int, not {type(obj).__name__}")
+            if not _INT64_MIN <= obj <= _INT64_MAX:
+                raise OverflowError(f"{'value' if is_value else 'key'} does not fit in int64")
+            return int(obj)
+
+        return "i8", check_int
+    if is_value and code == "f8":
+
+        def check_float(obj: object) -> float:
+            if isinstance(obj, (str, bytes, bytearray)):  # float() would parse these
+                raise TypeError(f"must be real number, not {type(obj).__name__}")
+            return float(obj)  # type: ignore[arg-type]
+
+        return "f8", check_float
+    if isinstance(code, str) and code[:1] == "S" and code[1:].isdigit() and code[1] != "0":
+        size = int(code[1:])
+        if size <= 1 << 20:
+
+            def check_bytes(obj: object) -> bytes:
+                kind = "value" if is_value else "key"
+                if not isinstance(obj, bytes):
+                    raise TypeError(f"{kind} must be bytes, not {type(obj).__name__}")
+                if len(obj) > size:
+                    raise ValueError(f"{kind} longer than {size} bytes")
+                return bytes(obj)
+
+            return code, check_bytes
+    if not isinstance(code, str):
+        raise TypeError("type code must be a str")
+    allowed = "'i8', 'f8'" if is_value else "'i8'"
+    raise ValueError(f"{'value' if is_value else 'key'} type must be {allowed} or 'S<n>' with 1 <= n <= 1048576, "
+                     f"not {code!r}")
+
+
+class TypedDequeDict(Generic[K, V]):
+    """DequeDict of int64 ("i8"), float64 ("f8", values only) or bytes ("S<n>") keys and values.
+
+    The C extension stores the raw values unboxed; this fallback validates
+    them the same way and keeps them in a DequeDict.
+    """
+
+    __slots__ = ("_data", "_key_type", "_value_type", "_check_key", "_check_value")
+    __hash__ = None  # type: ignore[assignment]
+
+    def __class_getitem__(cls, params: object) -> types.GenericAlias:
+        return types.GenericAlias(cls, params)
+
+    def __init__(
+        self,
+        items: Mapping[K, V] | Iterable[tuple[K, V]] | None = None,
+        *,
+        key_type: str = "i8",
+        value_type: str = "i8",
+        maxsize: int | None = None,
+    ) -> None:
+        self._key_type, self._check_key = _typed_checker(key_type, False)
+        self._value_type, self._check_value = _typed_checker(value_type, True)
+        if maxsize is not None:
+            maxsize = operator.index(maxsize)
+            if not 0 <= maxsize <= 1 << 30:
+                raise ValueError("maxsize must be between 0 and 1073741824")
+        self._data: DequeDict[K, V] = DequeDict(maxsize=maxsize)
+        if items is not None:
+            self.update(items)
+
+    def _lookup_key(self, key: object) -> object:
+        """Checked key, or a sentinel that is in no TypedDequeDict."""
+        try:
+            return self._check_key(key)
+        except (TypeError, ValueError, OverflowError):
+            return _ABSENT
+
+    @property
+    def key_type(self) -> str:
+        return self._key_type
+
+    @property
+    def value_type(self) -> str:
+        return self._value_type
+
+    @property
+    def maxsize(self) -> int | None:
+        return self._data.maxsize
+
+    def __len__(self) -> int:
+        return len(self._data)
+
     def __getitem__(self, key: K) -> V:
         try:
-            return super().__getitem__(key)
+            return self._data[self._lookup_key(key)]  # type: ignore[index]
         except KeyError:
-            return self.__missing__(key)
+            raise KeyError(key) from None
+
+    def __setitem__(self, key: K, value: V) -> None:
+        key = self._check_key(key)  # type: ignore[assignment]
+        self._data[key] = self._check_value(value)  # type: ignore[assignment]
+
+    def __delitem__(self, key: K) -> None:
+        try:
+            del self._data[self._lookup_key(key)]  # type: ignore[arg-type]
+        except KeyError:
+            raise KeyError(key) from None
+
+    def __contains__(self, key: object) -> bool:
+        return self._lookup_key(key) in self._data
+
+    def __iter__(self) -> Iterator[K]:
+        return iter(self.keys())
+
+    def get(self, key: K, default: object = None) -> object:
+        return self._data.get(self._lookup_key(key), default)  # type: ignore[arg-type]
+
+    def pop(self, key: K, *default: V) -> V:
+        if len(default) > 1:
+            raise TypeError(f"pop expected at most 2 arguments, got {len(default) + 1}")
+        checked = self._lookup_key(key)
+        if checked in self._data:
+            return self._data.pop(checked)  # type: ignore[arg-type]
+        if default:
+            return default[0]
+        raise KeyError(key)
+
+    def popleft(self) -> V:
+        if not self._data:
+            raise IndexError("pop from an empty TypedDequeDict")
+        return self._data.popleft()
+
+    def popleftitem(self) -> tuple[K, V]:
+        if not self._data:
+            raise KeyError("popleftitem from an empty TypedDequeDict")
+        return self._data.popleftitem()
+
+    def peekleft(self) -> V:
+        if not self._data:
+            raise IndexError("peek from an empty TypedDequeDict")
+        return self._data.peekleft()
+
+    def peek(self) -> V:
+        if not self._data:
+            raise IndexError("peek from an empty TypedDequeDict")
+        return self._data.peek()
+
+    def move_to_end(self, key: K, last: bool = True) -> None:
+        try:
+            self._data.move_to_end(self._lookup_key(key), last=last)  # type: ignore[arg-type]
+        except KeyError:
+            raise KeyError(key) from None
+
+    def keys(self) -> list[K]:
+        return list(self._data.keys())
+
+    def values(self) -> list[V]:
+        return list(self._data.values())
+
+    def items(self) -> list[tuple[K, V]]:
+        return list(self._data.items())
+
+    def _array(self, code: str, items: Iterable[object]) -> memoryview:
+        if code[0] != "S":
+            return _array_view(code, items)
+        # struct-style "<n>s" views cannot be built from Python, so bytes come back flat ("B")
+        size = int(code[1:])
+        return memoryview(b"".join(item.ljust(size, b"\0") for item in items))  # type: ignore[attr-defined]
+
+    def keys_array(self) -> memoryview:
+        return self._array(self._key_type, self._data.keys())
+
+    def values_array(self) -> memoryview:
+        return self._array(self._value_type, self._data.values())
+
+    def clear(self) -> None:
+        self._data.clear()
+
+    def update(self, other: Mapping[K, V] | Iterable[tuple[K, V]]) -> None:
+        pairs = other.items() if isinstance(other, Mapping) or hasattr(other, "items") else other
+        for pair in pairs:  # type: ignore[union-attr]
+            if not isinstance(pair, tuple) or len(pair) != 2:
+                raise ValueError("update requires sequence of (key, value) pairs")
+            self[pair[0]] = pair[1]
+
+    def copy(self) -> TypedDequeDict[K, V]:
+        """Return a shallow copy with the same key_type, value_type and maxsize."""
+        clone = object.__new__(type(self))
+        clone._key_type, clone._check_key = self._key_type, self._check_key
+        clone._value_type, clone._check_value = self._value_type, self._check_value
+        clone._data = self._data.copy()
+        return clone
+
+    __copy__ = copy
+
+    def __reduce__(self) -> tuple[object, ...]:
+        """Pickle as the items plus key_type, value_type and maxsize."""
+        options: dict[str, object] = {"key_type": self._key_type, "value_type": self._value_type}
+        if self.maxsize is not None:
+            options["maxsize"] = self.maxsize
+        return (functools.partial(type(self), **options), (self.items(),))
+
+    def __eq__(self, other: object) -> bool:
+        if isinstance(other, TypedDequeDict):
+            other = other._data
+        if not isinstance(other, (dict, DequeDict)):
+            return NotImplemented
+        return self._data == other
 
     def __repr__(self) -> str:
-        return f"DefaultDequeDict({self.default_factory}, {list(self.items())!r})"
+        maxsize = "" if self.maxsize is None else f", maxsize={self.maxsize}"
+        codes = f"key_type={self._key_type!r}, value_type={self._value_type!r}"
+        return f"TypedDequeDict({self.items()!r}, {codes}{maxsize})"
 
-    def copy(self) -> DefaultDequeDict[K, V]:
-        return DefaultDequeDict(self.default_factory, self.items())
 
+# True once the C extension has replaced the pure-Python classes below
+HAS_C_EXTENSION = False
 
 # Use C extension if available (disable with NOC=1 environment variable)
 if not TYPE_CHECKING and not os.getenv("NOC"):
     with suppress(ImportError):
-        from dequedict._dequedict import DequeDict
+        from dequedict._dequedict import (
+            AsyncDequeDict,
+            DefaultDequeDict,
+            DequeDict,
+            PriorityDequeDict,
+            ShardedDequeDict,
+            SharedDequeDict,
+            TypedDequeDict,
+        )
+
+        HAS_C_EXTENSION = True
+        # Shared regions hold raw fixed-width data; there is no pure-Python version
+        __all__.append("SharedDequeDict")
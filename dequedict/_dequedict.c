@@ -6,11 +6,23 @@
  * - O(1) pop/popitem/peek/peekitem (right side)
  * - O(1) appendleft (insert at front)
  * - O(1) lookup by key
- * - O(1) at(index) via incremental cache (C array of entry pointers)
+ * - O(1) at(index) via incremental cache (C array of entry numbers)
  * - Maintains insertion order
+ * - Optional maxsize: inserting past capacity evicts from the opposite
+ *   end, and touch mode turns it into an LRU cache
+ * - O(log n) index_of/insert_at/del_at/islice via a lazily built treap
+ * - popleft(timeout=...) blocks until a producer thread inserts
+ * - Optional per-entry timestamps: ttl expiry of the oldest prefix in one
+ *   loop, and lazily on lookup
  *
- * Cache stores entry pointers (not values). pop(key)/del maintains cache
- * in-place via memmove + index fixup, so at() stays O(1) always.
+ * Cache stores entry numbers (not values). Every mutation maintains it
+ * in place (memmove of the shorter side for middle removals, headroom for
+ * appendleft), so at() stays O(1) always.
+ *
+ * Entries live in one growable array per DequeDict and are linked by
+ * 32-bit entry numbers, so growing the array never fixes up links. Key
+ * lookup uses a private open-addressing hash index of entry numbers;
+ * each entry caches its key's hash.
  */
 
 #define PY_SSIZE_T_CLEAN
@@ -18,1547 +30,9602 @@
 #include <structmember.h>
 #include <stdint.h>
 #include <string.h>
-
-/* Entry in the deque-dict */
-typedef struct DequeDictEntry {
+#include "dequedict.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/* Entry number within DequeDictObject.entries, or LINK_NONE */
+typedef int32_t DequeDictLink;
+#define LINK_NONE (-1)
+
+/* Entry in the deque-dict. A free slot has key == NULL and chains the
+ * free list through next. */
+typedef struct {
     PyObject *key;
     PyObject *value;
-    struct DequeDictEntry *prev;
-    struct DequeDictEntry *next;
-    Py_ssize_t cache_idx;       /* Position in index_cache */
+    Py_hash_t hash;             /* Cached PyObject_Hash(key) */
+    DequeDictLink prev;
+    DequeDictLink next;
 } DequeDictEntry;
 
-/* Freelist for entry reuse - avoid malloc/free overhead */
-#define FREELIST_MAX 128
-static DequeDictEntry *freelist = NULL;
-static int freelist_size = 0;
+#define ENTRIES_MIN 8
+#define ENTRIES_SHRINK_MIN 256      /* Never compact below this capacity */
+#define ENTRIES_MAX ((Py_ssize_t)INT32_MAX)
 
-static inline DequeDictEntry *entry_alloc(void) {
-    if (freelist) {
-        DequeDictEntry *entry = freelist;
-        freelist = entry->next;
-        freelist_size--;
-        return entry;
-    }
-    return PyMem_Malloc(sizeof(DequeDictEntry));
-}
+/* Treap node of the order-statistic index, parallel to the entry array */
+typedef struct {
+    DequeDictLink left;
+    DequeDictLink right;
+    DequeDictLink parent;
+    uint32_t prio;
+    int32_t count;                  /* Entries in this subtree */
+} DequeDictRankNode;
+
+/* Links of an entry on one skip-list level above the entry list; the
+ * level's ends use the same struct (next = first, prev = last) */
+typedef struct {
+    DequeDictLink prev;
+    DequeDictLink next;
+} DequeDictSkipLink;
 
-static inline void entry_free(DequeDictEntry *entry) {
-    if (freelist_size < FREELIST_MAX) {
-        entry->next = freelist;
-        freelist = entry;
-        freelist_size++;
-    } else {
-        PyMem_Free(entry);
-    }
-}
+/* Score and skip-list tower of a PriorityDequeDict entry, parallel to the
+ * entry array */
+typedef struct {
+    double score;
+    int32_t height;                 /* Levels above the entry list */
+    DequeDictSkipLink *up;          /* up[l] links level l + 1, or NULL when height is 0 */
+} DequeDictScore;
+
+#define SKIP_LEVELS 16              /* Levels above the entry list: 4^16 > ENTRIES_MAX */
+
+/* Coroutines suspended in apopleft() and friends of an AsyncDequeDict,
+ * allocated on the first one that has to wait */
+typedef struct {
+    PyObject **queue;               /* Ring of awaiters, oldest at first */
+    Py_ssize_t first;
+    Py_ssize_t len;
+    Py_ssize_t cap;
+    Py_ssize_t swept;               /* len after the last sweep of finished awaiters */
+    Py_ssize_t woken;               /* Awaiters woken and not yet resumed, each owed an entry */
+    PyObject *loop;                 /* Event loop the awaiters run on, or NULL */
+    unsigned long thread;           /* Thread running loop */
+    char pending;                   /* An insert happened while awaiters were queued */
+    char scheduled;                 /* A wakeup was handed to the loop from another thread */
+} DequeDictAsync;
+
+/* Hot-path counters, allocated only for DequeDict(stats=True) so that a
+ * disabled instance pays one NULL test per counted event */
+enum {
+    STAT_HITS,                      /* Lookups by key that found it */
+    STAT_MISSES,                    /* Lookups by key that did not */
+    STAT_EVICTIONS,                 /* Entries dropped for maxsize */
+    STAT_EXPIRATIONS,               /* Entries dropped for ttl */
+    STAT_PROBES,                    /* Hash index searches */
+    STAT_COLLISIONS,                /* Slots stepped over past the first, over all searches */
+    STAT_MAX_PROBE,                 /* Longest search, in slots stepped over */
+    STAT_INDEX_RESIZES,             /* Hash index rebuilds */
+    STAT_CACHE_REBUILDS,            /* Position cache rebuilds in at() */
+    STAT_COMPACTIONS,               /* Entry array compactions */
+    STAT_FREELIST_HITS,             /* New entries placed in a recycled slot */
+    STAT_FREELIST_MISSES,           /* New entries placed past the used slots */
+    STAT_COUNT
+};
+
+static const char *const stat_names[STAT_COUNT] = {
+    "hits", "misses", "evictions", "expirations", "probes", "collisions", "max_probe",
+    "index_resizes", "cache_rebuilds", "compactions", "freelist_hits", "freelist_misses",
+};
 
 typedef struct {
     PyObject_HEAD
-    PyObject *dict;                 /* Internal dict for O(1) key lookup -> entry */
-    DequeDictEntry *head;           /* First entry (for popleft) */
-    DequeDictEntry *tail;           /* Last entry (for pop) */
+    DequeDictEntry *entries;        /* Entry array, NULL until first insert */
+    Py_ssize_t entries_alloc;       /* Allocated slots in entries */
+    Py_ssize_t entries_used;        /* Slots [0, entries_used) have been handed out */
+    DequeDictLink free_list;        /* First recycled slot */
+    DequeDictLink head;             /* First entry (for popleft) */
+    DequeDictLink tail;             /* Last entry (for pop) */
     Py_ssize_t size;
-    DequeDictEntry **index_cache;   /* C array of entry pointers, or NULL */
-    Py_ssize_t cache_size;          /* Number of entries in cache */
+    uint64_t version;               /* Bumped whenever the links change; checked by iterators */
+    int32_t *table;                 /* Hash index of entry numbers, or SLOT_EMPTY/SLOT_DUMMY */
+    Py_ssize_t table_mask;          /* Table capacity - 1 (capacity is a power of 2) */
+    Py_ssize_t table_fill;          /* Live + deleted slots */
+    DequeDictLink *index_cache;     /* C array of entry numbers, or NULL */
+    Py_ssize_t cache_size;          /* End of the live slots in index_cache */
     Py_ssize_t cache_capacity;      /* Allocated capacity of cache */
-    Py_ssize_t cache_offset;        /* Left offset into index_cache */
+    Py_ssize_t cache_offset;        /* Start of the live slots in index_cache */
+    Py_ssize_t cache_debt;          /* Slots moved by maintenance since the last at() */
+    Py_ssize_t maxsize;             /* Capacity, PY_SSIZE_T_MAX when unbounded */
+    PyObject *on_evict;             /* Callable taking a list of evicted pairs, or NULL */
+    PyObject *evicted;              /* Pairs queued for on_evict, or NULL */
+    char touch;                     /* Lookups and updates move the key to the end */
+    DequeDictRankNode *rank;        /* Order-statistic index, or NULL until needed */
+    DequeDictLink rank_root;
+    uint32_t rank_seed;             /* xorshift32 state for treap priorities */
+    PyThread_type_lock ready;       /* Released on insert while a consumer waits, or NULL */
+    int waiters;                    /* Threads blocked in popleft(timeout=...) */
+    char signalled;                 /* ready is released and not yet taken */
+    char gc_mode;                   /* GC_TRACKED, GC_LAZY or GC_NEVER */
+    char timed;                     /* Entries carry write timestamps (ttl or clock given) */
+    double *stamps;                 /* Timestamps parallel to entries, or NULL when untimed */
+    PyObject *clock;                /* Timestamp source, or NULL for time.monotonic */
+    double ttl;                     /* Lifetime in seconds for expiry, or 0 */
+    double now;                     /* Last clock reading, stamped on writes */
+    uint64_t *stats;                /* STAT_COUNT counters, or NULL unless stats=True */
+    char policy;                    /* POLICY_NONE, or the eviction policy used at maxsize */
+    uint8_t *meta;                  /* Policy bits parallel to entries, or NULL without a policy */
+    DequeDictLink seg;              /* First entry of the tail segment, or LINK_NONE */
+    Py_ssize_t seg_count;           /* Entries in the tail segment */
+    uint32_t *ghost;                /* Fingerprints of recently evicted keys (2q, s3fifo), or NULL */
+    Py_ssize_t ghost_mask;          /* Ghost table capacity - 1 */
+    char scored;                    /* Entries are kept sorted by score (PriorityDequeDict) */
+    DequeDictScore *scores;         /* Scores and towers parallel to entries, or NULL */
+    DequeDictSkipLink *skip_ends;   /* Ends of the SKIP_LEVELS upper levels, or NULL */
+    int skip_height;                /* Upper levels holding entries */
+    DequeDictAsync *aio;            /* Awaiter queue of an AsyncDequeDict, or NULL */
+    char track_values;              /* Values are indexed by hash (track_values=True) */
+    Py_hash_t *vhashes;             /* Value hashes parallel to entries, or NULL */
+    int32_t *vtable;                /* Value index of entry numbers, or NULL until needed */
+    Py_ssize_t vmask;               /* Value index capacity - 1 */
+    Py_ssize_t vfill;               /* Live + deleted value index slots */
 } DequeDictObject;
 
+/* Eviction policies (policy=...). Without one, maxsize evicts in list
+ * order and touch=True turns that into LRU. The segmented policies split
+ * the list in two at seg: [probation | protected] for slru, [main | small]
+ * for 2q and s3fifo, so moving an entry across the boundary is a pointer
+ * update rather than a relink. */
+#define POLICY_NONE 0
+#define POLICY_CLOCK 1
+#define POLICY_SLRU 2
+#define POLICY_2Q 3
+#define POLICY_S3FIFO 4
+#define POLICY_SEGMENTED(self) ((self)->policy >= POLICY_SLRU)
+
+static const char *const policy_names[] = {NULL, "clock", "slru", "2q", "s3fifo"};
+
+#define META_REF 0x3                /* Reference bit (clock) or 2-bit frequency (s3fifo) */
+#define META_TAIL 0x4               /* Entry is in the tail segment */
+
+/* Garbage-collector tracking. A plain DequeDict starts untracked (GC_LAZY)
+ * and is tracked once it stores an object that may be part of a cycle,
+ * like dict's MAINTAIN_TRACKING, so maps of str/int/float cost the
+ * collector nothing. Subtypes are always tracked (their instances have a
+ * __dict__); gc_tracking=False never tracks. */
+#define GC_TRACKED 0
+#define GC_LAZY 1
+#define GC_NEVER 2
+
 static PyTypeObject DequeDict_Type;
+static PyTypeObject DefaultDequeDict_Type;
 
-/* ========================================================================
- * Cache helpers
- * ======================================================================== */
+static PyObject *str___missing__;   /* Interned "__missing__" */
+static PyObject *str___dict__;      /* Interned "__dict__" */
+static PyObject *time_monotonic;    /* time.monotonic, the default clock */
+
+#define ENTRY(self, ix) (&(self)->entries[(ix)])
+
+/* Record a write to entry ix at the time of the last DequeDict_tick() */
+#define STAMP(self, ix) do { if ((self)->timed) (self)->stamps[(ix)] = (self)->now; } while (0)
+
+/* Add n to counter STAT_<name> if this DequeDict keeps stats */
+#define STAT_ADD(self, name, n) do { if ((self)->stats) (self)->stats[STAT_##name] += (n); } while (0)
+
+/* True if ix still names a live entry (guards walks that call into Python) */
+#define ENTRY_LIVE(self, ix) \
+    ((ix) >= 0 && (ix) < (self)->entries_used && (self)->entries[(ix)].key != NULL)
+
+/* Objects that can take part in a cycle: containers, except tuples the
+ * collector has already found to hold only atomic objects */
+static inline int
+gc_may_be_tracked(PyObject *obj)
+{
+    return PyObject_IS_GC(obj) && (!PyTuple_CheckExact(obj) || PyObject_GC_IsTracked(obj));
+}
+
+static void
+DequeDict_start_tracking(DequeDictObject *self)
+{
+    self->gc_mode = GC_TRACKED;
+    if (!PyObject_GC_IsTracked((PyObject *)self))
+        PyObject_GC_Track(self);
+}
 
+/* Track a GC_LAZY DequeDict about to hold obj if obj may form a cycle */
 static inline void
-DequeDict_invalidate_cache(DequeDictObject *self)
+DequeDict_maintain_tracking(DequeDictObject *self, PyObject *obj)
 {
-    if (self->index_cache) {
-        PyMem_Free(self->index_cache);
-        self->index_cache = NULL;
-    }
-    self->cache_size = 0;
-    self->cache_capacity = 0;
-    self->cache_offset = 0;
+    if (self->gc_mode == GC_LAZY && gc_may_be_tracked(obj))
+        DequeDict_start_tracking(self);
 }
 
+/* ========================================================================
+ * Free threading
+ *
+ * On free-threaded builds (PEP 703) each entry point runs in a critical
+ * section on the DequeDict it works on, so one instance can be shared by
+ * many threads. A critical section is suspended while its thread blocks
+ * or waits for another one, which is no different from a callback that
+ * releases the GIL: the re-entrancy guards cover both. With the GIL the
+ * macros compile to plain blocks.
+ * ======================================================================== */
+
+#ifndef Py_BEGIN_CRITICAL_SECTION
+#define Py_BEGIN_CRITICAL_SECTION(op) {
+#define Py_END_CRITICAL_SECTION() }
+#define Py_BEGIN_CRITICAL_SECTION2(a, b) {
+#define Py_END_CRITICAL_SECTION2() }
+#endif
+
+/* Define name##_locked(params), which calls name(args) in a critical
+ * section on lock. The method tables point at these wrappers. */
+#define DEQUEDICT_LOCKED(ret, name, lock, params, args) \
+    static ret \
+    name##_locked params \
+    { \
+        ret result; \
+        Py_BEGIN_CRITICAL_SECTION(lock); \
+        result = name args; \
+        Py_END_CRITICAL_SECTION(); \
+        return result; \
+    }
+
+/* Shorthands for the method signatures (METH_NOARGS shares METH_O's) */
+#define LOCKED_METH_O(name) \
+    DEQUEDICT_LOCKED(PyObject *, name, self, (DequeDictObject *self, PyObject *arg), (self, arg))
+#define LOCKED_FASTCALL(name) \
+    DEQUEDICT_LOCKED(PyObject *, name, self, \
+                     (DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs), \
+                     (self, args, nargs))
+#define LOCKED_FASTCALL_KW(name) \
+    DEQUEDICT_LOCKED(PyObject *, name, self, \
+                     (DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames), \
+                     (self, args, nargs, kwnames))
+#define LOCKED_VARARGS_KW(name) \
+    DEQUEDICT_LOCKED(PyObject *, name, self, \
+                     (DequeDictObject *self, PyObject *args, PyObject *kwds), (self, args, kwds))
+
+/* ========================================================================
+ * Entry allocator
+ *
+ * Freed slots go on a per-instance free list and are reused before the
+ * array grows. The array doubles when full, is released on clear(), and
+ * the live entries are compacted into a right-sized array, in list order,
+ * once the container shrinks to a quarter of its capacity.
+ * ======================================================================== */
+
+/* Grow the array, by doubling, to at least need slots */
 static int
-DequeDict_rebuild_cache(DequeDictObject *self)
+entries_grow(DequeDictObject *self, Py_ssize_t need)
 {
-    DequeDict_invalidate_cache(self);
-    if (self->size == 0)
-        return 0;
-
-    self->cache_capacity = self->size;
-    self->index_cache = PyMem_Malloc(sizeof(DequeDictEntry *) * self->cache_capacity);
-    if (!self->index_cache) {
+    if (need > ENTRIES_MAX) {
+        PyErr_SetString(PyExc_OverflowError, "DequeDict is full");
+        return -1;
+    }
+    Py_ssize_t new_alloc = self->entries_alloc ? self->entries_alloc * 2 : ENTRIES_MIN;
+    while (new_alloc < need)
+        new_alloc *= 2;
+    if (new_alloc > ENTRIES_MAX)
+        new_alloc = ENTRIES_MAX;
+
+    DequeDictEntry *entries = PyMem_Realloc(self->entries, sizeof(DequeDictEntry) * new_alloc);
+    if (!entries) {
         PyErr_NoMemory();
         return -1;
     }
-    self->cache_size = self->size;
-    self->cache_offset = 0;
+    self->entries = entries;
 
-    DequeDictEntry *entry = self->head;
-    Py_ssize_t i = 0;
-    while (entry) {
-        entry->cache_idx = i;
-        self->index_cache[i] = entry;
-        entry = entry->next;
-        i++;
+    if (self->rank) {
+        DequeDictRankNode *rank = PyMem_Realloc(self->rank, sizeof(DequeDictRankNode) * new_alloc);
+        if (!rank) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        self->rank = rank;
+    }
+    if (self->policy) {
+        uint8_t *meta = PyMem_Realloc(self->meta, new_alloc);
+        if (!meta) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        self->meta = meta;
+    }
+    if (self->timed) {
+        double *stamps = PyMem_Realloc(self->stamps, sizeof(double) * new_alloc);
+        if (!stamps) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        self->stamps = stamps;
     }
+    if (self->scored) {
+        DequeDictScore *scores = PyMem_Realloc(self->scores, sizeof(DequeDictScore) * new_alloc);
+        if (!scores) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        self->scores = scores;
+    }
+    if (self->track_values) {
+        Py_hash_t *vhashes = PyMem_Realloc(self->vhashes, sizeof(Py_hash_t) * new_alloc);
+        if (!vhashes) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        self->vhashes = vhashes;
+    }
+    self->entries_alloc = new_alloc;
     return 0;
 }
 
-/* Ensure cache has room for one more entry. Returns 0 on success, -1 on failure. */
-static int
-DequeDict_cache_ensure_capacity(DequeDictObject *self)
+/* Make sure entry_alloc() can hand out one more slot. Entry pointers are
+ * only stable between calls to this function. */
+static inline int
+entry_reserve(DequeDictObject *self)
 {
-    if (self->cache_size < self->cache_capacity)
+    if (self->free_list != LINK_NONE || self->entries_used < self->entries_alloc)
         return 0;
-
-    Py_ssize_t new_cap = self->cache_capacity * 2;
-    if (new_cap < 8) new_cap = 8;
-
-    DequeDictEntry **new_cache = PyMem_Realloc(self->index_cache,
-        sizeof(DequeDictEntry *) * new_cap);
-    if (!new_cache) {
-        DequeDict_invalidate_cache(self);
-        return -1;
-    }
-    self->index_cache = new_cache;
-    self->cache_capacity = new_cap;
-    return 0;
+    return entries_grow(self, self->entries_alloc + 1);
 }
 
-/* ======================================================================== */
-
-static int
-DequeDict_traverse(DequeDictObject *self, visitproc visit, void *arg)
+static inline Py_ssize_t
+entry_alloc(DequeDictObject *self)
 {
-    Py_VISIT(self->dict);
-    /* Visit all entries in the linked list */
-    DequeDictEntry *entry = self->head;
-    while (entry) {
-        Py_VISIT(entry->key);
-        Py_VISIT(entry->value);
-        entry = entry->next;
+    Py_ssize_t ix = self->free_list;
+    if (ix != LINK_NONE) {
+        STAT_ADD(self, FREELIST_HITS, 1);
+        self->free_list = self->entries[ix].next;
     }
-    return 0;
+    else {
+        STAT_ADD(self, FREELIST_MISSES, 1);
+        ix = self->entries_used++;
+    }
+    if (self->meta)
+        self->meta[ix] = 0;
+    return ix;
 }
 
-static int
-DequeDict_clear(DequeDictObject *self)
+/* Wake a thread blocked in popleft(timeout=...). Called on every insert;
+ * the waiter runs once the inserting call has returned. Queued awaiters
+ * are only flagged here, and woken by DequeDict_finish() once per call. */
+static inline void
+DequeDict_notify(DequeDictObject *self)
 {
-    /* Free all entries */
-    DequeDictEntry *entry = self->head;
-    while (entry) {
-        DequeDictEntry *next = entry->next;
-        Py_CLEAR(entry->key);
-        Py_CLEAR(entry->value);
-        entry_free(entry);
-        entry = next;
-    }
-    self->head = NULL;
-    self->tail = NULL;
-    self->size = 0;
-    Py_CLEAR(self->dict);
-    DequeDict_invalidate_cache(self);
-    return 0;
+    if (self->waiters && !self->signalled) {
+        self->signalled = 1;
+        PyThread_release_lock(self->ready);
+    }
+    if (self->aio && self->aio->len)
+        self->aio->pending = 1;
 }
 
-static void
-DequeDict_dealloc(DequeDictObject *self)
+static inline void
+entry_free(DequeDictObject *self, Py_ssize_t ix)
 {
-    PyObject_GC_UnTrack(self);
-    DequeDict_clear(self);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+    DequeDictEntry *entry = ENTRY(self, ix);
+    entry->key = NULL;
+    entry->value = NULL;
+    entry->next = self->free_list;
+    self->free_list = (DequeDictLink)ix;
+    if (self->scored) {
+        PyMem_Free(self->scores[ix].up);
+        self->scores[ix].up = NULL;
+    }
 }
 
-static int
-DequeDict_init(DequeDictObject *self, PyObject *args, PyObject *kwds)
-{
-    static char *kwlist[] = {"items", NULL};
-    PyObject *items = NULL;
-
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist, &items))
-        return -1;
-
-    /* Untrack before modifying (safe for re-init) */
-    PyObject_GC_UnTrack(self);
+/* ========================================================================
+ * Order-statistic index
+ *
+ * A treap over the live entries in list order, stored in a side array
+ * parallel to entries. It is built on the first positional call that needs
+ * it and kept up to date by the list helpers from then on, at O(log n)
+ * expected per link or unlink. clear() and compaction drop it.
+ * ======================================================================== */
 
-    /* Clear existing state */
-    DequeDictEntry *entry = self->head;
-    while (entry) {
-        DequeDictEntry *next = entry->next;
-        Py_DECREF(entry->key);
-        Py_DECREF(entry->value);
-        entry_free(entry);
-        entry = next;
-    }
-    Py_XDECREF(self->dict);
-    DequeDict_invalidate_cache(self);
+#define RANK(self, ix) (&(self)->rank[(ix)])
+#define RANK_COUNT(self, ix) ((ix) == LINK_NONE ? 0 : (self)->rank[(ix)].count)
 
-    self->dict = PyDict_New();
-    if (!self->dict) return -1;
-    self->head = NULL;
-    self->tail = NULL;
-    self->size = 0;
+static inline uint32_t
+rank_random(DequeDictObject *self)
+{
+    uint32_t x = self->rank_seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    self->rank_seed = x;
+    return x;
+}
 
-    /* Initialize from items if provided */
-    if (items) {
-        if (PyDict_Check(items)) {
-            /* Initialize from dict */
-            PyObject *key, *value;
-            Py_ssize_t pos = 0;
-            while (PyDict_Next(items, &pos, &key, &value)) {
-                /* Create entry */
-                DequeDictEntry *new_entry = entry_alloc();
-                if (!new_entry) {
-                    PyErr_NoMemory();
-                    return -1;
-                }
+static inline void
+rank_free(DequeDictObject *self)
+{
+    if (self->rank) {
+        PyMem_Free(self->rank);
+        self->rank = NULL;
+    }
+    self->rank_root = LINK_NONE;
+}
 
-                Py_INCREF(key);
-                Py_INCREF(value);
-                new_entry->key = key;
-                new_entry->value = value;
-                new_entry->prev = self->tail;
-                new_entry->next = NULL;
-                new_entry->cache_idx = -1;
-
-                if (self->tail) {
-                    self->tail->next = new_entry;
-                } else {
-                    self->head = new_entry;
-                }
-                self->tail = new_entry;
-                self->size++;
+/* Rotate x above its parent, keeping in-order and subtree counts */
+static void
+rank_rotate_up(DequeDictObject *self, Py_ssize_t x)
+{
+    DequeDictRankNode *node = RANK(self, x);
+    Py_ssize_t p = node->parent;
+    DequeDictRankNode *parent = RANK(self, p);
+    Py_ssize_t g = parent->parent;
+
+    if (parent->left == x) {
+        parent->left = node->right;
+        if (node->right != LINK_NONE)
+            RANK(self, node->right)->parent = (DequeDictLink)p;
+        node->right = (DequeDictLink)p;
+    } else {
+        parent->right = node->left;
+        if (node->left != LINK_NONE)
+            RANK(self, node->left)->parent = (DequeDictLink)p;
+        node->left = (DequeDictLink)p;
+    }
+    parent->parent = (DequeDictLink)x;
+    node->parent = (DequeDictLink)g;
+    if (g == LINK_NONE)
+        self->rank_root = (DequeDictLink)x;
+    else if (RANK(self, g)->left == p)
+        RANK(self, g)->left = (DequeDictLink)x;
+    else
+        RANK(self, g)->right = (DequeDictLink)x;
+
+    node->count = parent->count;
+    parent->count = 1 + RANK_COUNT(self, parent->left) + RANK_COUNT(self, parent->right);
+}
 
-                /* Store capsule in dict for O(1) lookup */
-                PyObject *capsule = PyLong_FromVoidPtr(new_entry);
-                if (!capsule) {
-                    entry_free(new_entry);
-                    return -1;
-                }
-                if (PyDict_SetItem(self->dict, key, capsule) < 0) {
-                    Py_DECREF(capsule);
-                    entry_free(new_entry);
-                    return -1;
-                }
-                Py_DECREF(capsule);
-            }
-        } else {
-            /* Initialize from iterable of (key, value) pairs */
-            PyObject *iter = PyObject_GetIter(items);
-            if (!iter) return -1;
-
-            PyObject *pair;
-            while ((pair = PyIter_Next(iter)) != NULL) {
-                if (!PyTuple_Check(pair) || PyTuple_GET_SIZE(pair) != 2) {
-                    Py_DECREF(pair);
-                    Py_DECREF(iter);
-                    PyErr_SetString(PyExc_ValueError,
-                        "DequeDict requires sequence of (key, value) pairs");
-                    return -1;
-                }
+/* Insert entry x between its list neighbours prev and next (either may be
+ * LINK_NONE). Attaching is O(1): prev has no right child or next has no
+ * left child. */
+static void
+rank_insert(DequeDictObject *self, Py_ssize_t x, Py_ssize_t prev, Py_ssize_t next)
+{
+    DequeDictRankNode *node = RANK(self, x);
+    node->left = LINK_NONE;
+    node->right = LINK_NONE;
+    node->parent = LINK_NONE;
+    node->count = 1;
+    node->prio = rank_random(self);
+    if (self->rank_root == LINK_NONE) {
+        self->rank_root = (DequeDictLink)x;
+        return;
+    }
 
-                PyObject *key = PyTuple_GET_ITEM(pair, 0);
-                PyObject *value = PyTuple_GET_ITEM(pair, 1);
+    Py_ssize_t p;
+    if (prev != LINK_NONE && RANK(self, prev)->right == LINK_NONE) {
+        p = prev;
+        RANK(self, p)->right = (DequeDictLink)x;
+    } else {
+        p = next;
+        RANK(self, p)->left = (DequeDictLink)x;
+    }
+    node->parent = (DequeDictLink)p;
+    for (Py_ssize_t q = p; q != LINK_NONE; q = RANK(self, q)->parent)
+        RANK(self, q)->count++;
 
-                DequeDictEntry *new_entry = entry_alloc();
-                if (!new_entry) {
-                    Py_DECREF(pair);
-                    Py_DECREF(iter);
-                    PyErr_NoMemory();
-                    return -1;
-                }
+    while (node->parent != LINK_NONE && RANK(self, node->parent)->prio < node->prio)
+        rank_rotate_up(self, x);
+}
 
-                Py_INCREF(key);
-                Py_INCREF(value);
-                new_entry->key = key;
-                new_entry->value = value;
-                new_entry->prev = self->tail;
-                new_entry->next = NULL;
-                new_entry->cache_idx = -1;
-
-                if (self->tail) {
-                    self->tail->next = new_entry;
-                } else {
-                    self->head = new_entry;
-                }
-                self->tail = new_entry;
-                self->size++;
-
-                PyObject *capsule = PyLong_FromVoidPtr(new_entry);
-                if (!capsule) {
-                    Py_DECREF(pair);
-                    Py_DECREF(iter);
-                    entry_free(new_entry);
-                    return -1;
-                }
-                if (PyDict_SetItem(self->dict, key, capsule) < 0) {
-                    Py_DECREF(capsule);
-                    Py_DECREF(pair);
-                    Py_DECREF(iter);
-                    entry_free(new_entry);
-                    return -1;
-                }
-                Py_DECREF(capsule);
-                Py_DECREF(pair);
-            }
-            Py_DECREF(iter);
-            if (PyErr_Occurred()) return -1;
-        }
+static void
+rank_remove(DequeDictObject *self, Py_ssize_t x)
+{
+    DequeDictRankNode *node = RANK(self, x);
+
+    /* Rotate x down to a leaf, lifting the higher-priority child */
+    while (node->left != LINK_NONE || node->right != LINK_NONE) {
+        Py_ssize_t child;
+        if (node->left == LINK_NONE)
+            child = node->right;
+        else if (node->right == LINK_NONE)
+            child = node->left;
+        else
+            child = RANK(self, node->left)->prio > RANK(self, node->right)->prio
+                    ? node->left : node->right;
+        rank_rotate_up(self, child);
     }
 
-    PyObject_GC_Track(self);
-    return 0;
+    Py_ssize_t p = node->parent;
+    if (p == LINK_NONE) {
+        self->rank_root = LINK_NONE;
+        return;
+    }
+    if (RANK(self, p)->left == x)
+        RANK(self, p)->left = LINK_NONE;
+    else
+        RANK(self, p)->right = LINK_NONE;
+    for (Py_ssize_t q = p; q != LINK_NONE; q = RANK(self, q)->parent)
+        RANK(self, q)->count--;
 }
 
+/* Position of entry x in list order */
 static Py_ssize_t
-DequeDict_len(DequeDictObject *self)
+rank_of(DequeDictObject *self, Py_ssize_t x)
 {
-    return self->size;
+    Py_ssize_t r = RANK_COUNT(self, RANK(self, x)->left);
+    for (Py_ssize_t p = RANK(self, x)->parent; p != LINK_NONE; x = p, p = RANK(self, p)->parent) {
+        if (RANK(self, p)->right == x)
+            r += RANK_COUNT(self, RANK(self, p)->left) + 1;
+    }
+    return r;
 }
 
-/* __getitem__ - O(1) lookup */
-static PyObject *
-DequeDict_getitem(DequeDictObject *self, PyObject *key)
+/* Entry at position k, 0 <= k < size */
+static Py_ssize_t
+rank_select(DequeDictObject *self, Py_ssize_t k)
 {
-    PyObject *capsule = PyDict_GetItem(self->dict, key);
-    if (!capsule) {
-        PyErr_SetObject(PyExc_KeyError, key);
-        return NULL;
+    Py_ssize_t x = self->rank_root;
+    for (;;) {
+        Py_ssize_t left = RANK_COUNT(self, RANK(self, x)->left);
+        if (k < left) {
+            x = RANK(self, x)->left;
+        } else if (k == left) {
+            return x;
+        } else {
+            k -= left + 1;
+            x = RANK(self, x)->right;
+        }
     }
-
-    DequeDictEntry *entry = (DequeDictEntry *)PyLong_AsVoidPtr(capsule);
-    if (!entry) return NULL;
-
-    Py_INCREF(entry->value);
-    return entry->value;
 }
 
-/* __setitem__ - O(1) if key exists, append if new */
+/* Build the treap from the list in O(n) (Cartesian tree construction) */
 static int
-DequeDict_setitem(DequeDictObject *self, PyObject *key, PyObject *value)
+rank_build(DequeDictObject *self)
 {
-    if (value == NULL) {
-        /* __delitem__ — remove from cache in-place */
-        PyObject *capsule = PyDict_GetItem(self->dict, key);
-        if (!capsule) {
-            PyErr_SetObject(PyExc_KeyError, key);
-            return -1;
-        }
-
-        DequeDictEntry *entry = (DequeDictEntry *)PyLong_AsVoidPtr(capsule);
-        if (!entry) return -1;
-
-        /* Unlink from list */
-        if (entry->prev) {
-            entry->prev->next = entry->next;
-        } else {
-            self->head = entry->next;
+    Py_ssize_t alloc = self->entries_alloc ? self->entries_alloc : 1;
+    DequeDictRankNode *rank = PyMem_Malloc(sizeof(DequeDictRankNode) * alloc);
+    DequeDictLink *stack = PyMem_Malloc(sizeof(DequeDictLink) * (self->size + 1));
+    if (!rank || !stack) {
+        PyMem_Free(rank);
+        PyMem_Free(stack);
+        PyErr_NoMemory();
+        return -1;
+    }
+    if (self->rank_seed == 0)
+        self->rank_seed = (uint32_t)((uintptr_t)self >> 4) | 1u;
+
+    /* The stack holds the right spine; nodes popped off it are complete */
+    Py_ssize_t top = 0;
+    for (Py_ssize_t ix = self->head; ix != LINK_NONE; ix = ENTRY(self, ix)->next) {
+        DequeDictRankNode *node = &rank[ix];
+        node->prio = rank_random(self);
+        node->right = LINK_NONE;
+        node->parent = LINK_NONE;
+        node->count = 1;
+
+        DequeDictLink last = LINK_NONE;
+        while (top > 0 && rank[stack[top - 1]].prio < node->prio) {
+            last = stack[--top];
+            rank[last].count = 1 + (rank[last].left == LINK_NONE ? 0 : rank[rank[last].left].count)
+                                 + (rank[last].right == LINK_NONE ? 0 : rank[rank[last].right].count);
         }
-        if (entry->next) {
-            entry->next->prev = entry->prev;
-        } else {
-            self->tail = entry->prev;
+        node->left = last;
+        if (last != LINK_NONE)
+            rank[last].parent = (DequeDictLink)ix;
+        if (top > 0) {
+            rank[stack[top - 1]].right = (DequeDictLink)ix;
+            node->parent = stack[top - 1];
         }
-
-        PyDict_DelItem(self->dict, key);
-        Py_DECREF(entry->key);
-        Py_DECREF(entry->value);
-        entry_free(entry);
-        self->size--;
-        DequeDict_invalidate_cache(self);
-        return 0;
+        stack[top++] = (DequeDictLink)ix;
     }
-
-    PyObject *capsule = PyDict_GetItem(self->dict, key);
-    if (capsule) {
-        /* Update existing entry — cache stores entry pointers, no update needed */
-        DequeDictEntry *entry = (DequeDictEntry *)PyLong_AsVoidPtr(capsule);
-        if (!entry) return -1;
-
-        PyObject *old_value = entry->value;
-        Py_INCREF(value);
-        entry->value = value;
-        Py_DECREF(old_value);
-        return 0;
+    while (top > 0) {
+        DequeDictLink last = stack[--top];
+        rank[last].count = 1 + (rank[last].left == LINK_NONE ? 0 : rank[rank[last].left].count)
+                             + (rank[last].right == LINK_NONE ? 0 : rank[rank[last].right].count);
     }
 
-    /* New key - append to end */
-    DequeDictEntry *new_entry = entry_alloc();
-    if (!new_entry) {
-        PyErr_NoMemory();
-        return -1;
-    }
+    self->rank = rank;
+    self->rank_root = self->size ? stack[0] : LINK_NONE;
+    PyMem_Free(stack);
+    return 0;
+}
 
-    Py_INCREF(key);
-    Py_INCREF(value);
-    new_entry->key = key;
-    new_entry->value = value;
-    new_entry->prev = self->tail;
-    new_entry->next = NULL;
-    new_entry->cache_idx = -1;
+static inline int
+DequeDict_rank_ensure(DequeDictObject *self)
+{
+    return self->rank ? 0 : rank_build(self);
+}
 
-    if (self->tail) {
-        self->tail->next = new_entry;
-    } else {
-        self->head = new_entry;
-    }
-    self->tail = new_entry;
-    self->size++;
+/* ========================================================================
+ * Score skip list
+ *
+ * A PriorityDequeDict keeps its entry list sorted by score, equal scores in
+ * insertion order, so the head and tail are the minimum and maximum and
+ * the DequeDict reads work unchanged. The entry list is level 0 of a skip
+ * list: each entry gets a tower of random height (a 1/4 chance per extra
+ * level) in a side array, and every level is doubly linked. Finding an
+ * entry's place costs O(log n) expected; unlinking one touches only its
+ * own tower, O(1) expected, and leaves nothing behind. A score at or past
+ * the maximum, the usual case for deadlines, needs no search.
+ * ======================================================================== */
 
-    /* Append to cache if it exists */
-    if (self->index_cache) {
-        if (DequeDict_cache_ensure_capacity(self) == 0 && self->index_cache) {
-            new_entry->cache_idx = self->cache_size;
-            self->index_cache[self->cache_size] = new_entry;
-            self->cache_size++;
-        }
-    }
+#define SCORE(self, ix) ((self)->scores[(ix)].score)
+#define SKIP(self, ix, l) (&(self)->scores[(ix)].up[(l)])
 
-    capsule = PyLong_FromVoidPtr(new_entry);
-    if (!capsule) {
-        entry_free(new_entry);
-        return -1;
-    }
-    if (PyDict_SetItem(self->dict, key, capsule) < 0) {
-        Py_DECREF(capsule);
-        entry_free(new_entry);
-        return -1;
+/* Tower height for a new entry: levels above the entry list */
+static inline int
+skip_random_height(DequeDictObject *self)
+{
+    uint32_t bits = rank_random(self);
+    int height = 0;
+    while ((bits & 3) == 0 && height < SKIP_LEVELS) {
+        height++;
+        bits >>= 2;
     }
-    Py_DECREF(capsule);
-    return 0;
+    return height;
 }
 
-/* __contains__ - O(1) */
-static int
-DequeDict_contains(DequeDictObject *self, PyObject *key)
+/* Link ix into upper level l after entry pred, or first for LINK_NONE */
+static inline void
+skip_link_after(DequeDictObject *self, Py_ssize_t ix, int l, Py_ssize_t pred)
 {
-    return PyDict_Contains(self->dict, key);
+    DequeDictSkipLink *end = &self->skip_ends[l];
+    DequeDictSkipLink *link = SKIP(self, ix, l);
+    DequeDictSkipLink *before = pred == LINK_NONE ? end : SKIP(self, pred, l);
+    link->prev = (DequeDictLink)pred;
+    link->next = before->next;
+    before->next = (DequeDictLink)ix;
+    if (link->next == LINK_NONE)
+        end->prev = (DequeDictLink)ix;
+    else
+        SKIP(self, link->next, l)->prev = (DequeDictLink)ix;
 }
 
-/* peekleft() - O(1) return first value without removing */
-static PyObject *
-DequeDict_peekleft(DequeDictObject *self, PyObject *Py_UNUSED(args))
+/* Unlink ix from its upper levels; the entry list is the caller's */
+static void
+skip_remove(DequeDictObject *self, Py_ssize_t ix)
 {
-    if (!self->head) {
-        PyErr_SetString(PyExc_IndexError, "peek from an empty DequeDict");
-        return NULL;
+    DequeDictScore *node = &self->scores[ix];
+    for (int l = 0; l < node->height; l++) {
+        DequeDictSkipLink *link = &node->up[l];
+        DequeDictSkipLink *end = &self->skip_ends[l];
+        if (link->prev == LINK_NONE)
+            end->next = link->next;
+        else
+            SKIP(self, link->prev, l)->next = link->next;
+        if (link->next == LINK_NONE)
+            end->prev = link->prev;
+        else
+            SKIP(self, link->next, l)->prev = link->prev;
     }
-    Py_INCREF(self->head->value);
-    return self->head->value;
+    while (self->skip_height > 0 && self->skip_ends[self->skip_height - 1].next == LINK_NONE)
+        self->skip_height--;
 }
 
-/* peekleftitem() - O(1) return first (key, value) without removing */
-static PyObject *
-DequeDict_peekleftitem(DequeDictObject *self, PyObject *Py_UNUSED(args))
+/* Find the place of an unlinked entry with this score: after the last
+ * entry whose score is <= score. Stores that entry's predecessor on each
+ * upper level in preds[] and returns it on the entry list, LINK_NONE
+ * meaning before the head. */
+static Py_ssize_t
+skip_find(DequeDictObject *self, double score, DequeDictLink *preds)
 {
-    if (!self->head) {
-        PyErr_SetString(PyExc_IndexError, "peek from an empty DequeDict");
-        return NULL;
+    if (self->tail == LINK_NONE || score >= SCORE(self, self->tail)) {
+        for (int l = 0; l < SKIP_LEVELS; l++)
+            preds[l] = self->skip_ends[l].prev;
+        return self->tail;
+    }
+    for (int l = self->skip_height; l < SKIP_LEVELS; l++)
+        preds[l] = LINK_NONE;
+
+    Py_ssize_t x = LINK_NONE;
+    for (int l = self->skip_height - 1; l >= 0; l--) {
+        Py_ssize_t next = x == LINK_NONE ? self->skip_ends[l].next : SKIP(self, x, l)->next;
+        while (next != LINK_NONE && SCORE(self, next) <= score) {
+            x = next;
+            next = SKIP(self, x, l)->next;
+        }
+        preds[l] = (DequeDictLink)x;
+    }
+    Py_ssize_t next = x == LINK_NONE ? self->head : ENTRY(self, x)->next;
+    while (next != LINK_NONE && SCORE(self, next) <= score) {
+        x = next;
+        next = ENTRY(self, x)->next;
     }
-    return PyTuple_Pack(2, self->head->key, self->head->value);
+    return x;
 }
 
-/* peekleftkey() - O(1) return first key without removing */
-static PyObject *
-DequeDict_peekleftkey(DequeDictObject *self, PyObject *Py_UNUSED(args))
+/* Relink every tower in list order, after compaction renumbered entries */
+static void
+skip_thread(DequeDictObject *self)
 {
-    if (!self->head) {
-        PyErr_SetString(PyExc_IndexError, "peek from an empty DequeDict");
-        return NULL;
+    for (int l = 0; l < SKIP_LEVELS; l++)
+        self->skip_ends[l].prev = self->skip_ends[l].next = LINK_NONE;
+    for (Py_ssize_t ix = self->head; ix != LINK_NONE; ix = ENTRY(self, ix)->next) {
+        for (int l = 0; l < self->scores[ix].height; l++)
+            skip_link_after(self, ix, l, self->skip_ends[l].prev);
     }
-    Py_INCREF(self->head->key);
-    return self->head->key;
 }
 
-/* peek() / peekright() - O(1) return last value without removing */
-static PyObject *
-DequeDict_peek(DequeDictObject *self, PyObject *Py_UNUSED(args))
+/* ========================================================================
+ * List helpers - entry links, the order-statistic index and the policy
+ * segments; callers maintain the hash index and cache
+ *
+ * Under a segmented policy an entry linked at the tail joins the tail
+ * segment, one linked at the head the head segment, and one linked before
+ * another entry that entry's segment (the head segment just before seg).
+ * Unlinking a scored entry also takes its tower off the skip list; linking
+ * one there is PriorityDequeDict_link()'s job.
+ * ======================================================================== */
+
+static inline void
+DequeDict_unlink(DequeDictObject *self, Py_ssize_t ix)
 {
-    if (!self->tail) {
-        PyErr_SetString(PyExc_IndexError, "peek from an empty DequeDict");
-        return NULL;
+    self->version++;
+    if (self->rank)
+        rank_remove(self, ix);
+    if (self->scored)
+        skip_remove(self, ix);
+    DequeDictEntry *entry = ENTRY(self, ix);
+    if (self->meta && (self->meta[ix] & META_TAIL)) {
+        self->seg_count--;
+        if (ix == self->seg)
+            self->seg = entry->next;
+    }
+    if (entry->prev != LINK_NONE) {
+        ENTRY(self, entry->prev)->next = entry->next;
+    } else {
+        self->head = entry->next;
+    }
+    if (entry->next != LINK_NONE) {
+        ENTRY(self, entry->next)->prev = entry->prev;
+    } else {
+        self->tail = entry->prev;
     }
-    Py_INCREF(self->tail->value);
-    return self->tail->value;
 }
 
-/* peekitem() / peekrightitem() - O(1) return last (key, value) without removing */
-static PyObject *
-DequeDict_peekitem(DequeDictObject *self, PyObject *Py_UNUSED(args))
+/* Put ix in the tail segment; it is about to be linked after its last entry */
+static inline void
+DequeDict_join_tail_segment(DequeDictObject *self, Py_ssize_t ix)
 {
-    if (!self->tail) {
-        PyErr_SetString(PyExc_IndexError, "peek from an empty DequeDict");
-        return NULL;
-    }
-    return PyTuple_Pack(2, self->tail->key, self->tail->value);
+    self->meta[ix] |= META_TAIL;
+    if (self->seg_count++ == 0)
+        self->seg = (DequeDictLink)ix;
 }
 
-/* popleft() - O(1) remove and return first value */
-static PyObject *
-DequeDict_popleft(DequeDictObject *self, PyObject *Py_UNUSED(args))
+/* Move the first entry of the tail segment into the head segment. The list
+ * order does not change. */
+static inline void
+DequeDict_advance_seg(DequeDictObject *self)
 {
-    if (!self->head) {
-        PyErr_SetString(PyExc_IndexError, "pop from an empty DequeDict");
-        return NULL;
-    }
-
-    DequeDictEntry *entry = self->head;
-    PyObject *value = entry->value;
-    Py_INCREF(value);
+    Py_ssize_t ix = self->seg;
+    self->meta[ix] &= ~META_TAIL;
+    self->seg = ENTRY(self, ix)->next;
+    self->seg_count--;
+}
 
-    /* Unlink head */
-    self->head = entry->next;
-    if (self->head) {
-        self->head->prev = NULL;
+static inline void
+DequeDict_link_tail(DequeDictObject *self, Py_ssize_t ix)
+{
+    self->version++;
+    if (self->rank)
+        rank_insert(self, ix, self->tail, LINK_NONE);
+    if (POLICY_SEGMENTED(self))
+        DequeDict_join_tail_segment(self, ix);
+    DequeDictEntry *entry = ENTRY(self, ix);
+    entry->prev = self->tail;
+    entry->next = LINK_NONE;
+    if (self->tail != LINK_NONE) {
+        ENTRY(self, self->tail)->next = (DequeDictLink)ix;
     } else {
-        self->tail = NULL;
+        self->head = (DequeDictLink)ix;
     }
+    self->tail = (DequeDictLink)ix;
+    /* However ix got here, slru caps protected at 80% of maxsize */
+    if (self->policy == POLICY_SLRU)
+        while (self->seg_count > self->maxsize - self->maxsize / 5)
+            DequeDict_advance_seg(self);
+}
 
-    PyDict_DelItem(self->dict, entry->key);
-    Py_DECREF(entry->key);
-    Py_DECREF(entry->value);
-    entry_free(entry);
-    self->size--;
-
-    /* Bump cache offset instead of invalidating */
-    if (self->index_cache) {
-        self->cache_offset++;
+static inline void
+DequeDict_link_head(DequeDictObject *self, Py_ssize_t ix)
+{
+    self->version++;
+    if (self->rank)
+        rank_insert(self, ix, LINK_NONE, self->head);
+    if (self->meta)
+        self->meta[ix] &= ~META_TAIL;
+    DequeDictEntry *entry = ENTRY(self, ix);
+    entry->prev = LINK_NONE;
+    entry->next = self->head;
+    if (self->head != LINK_NONE) {
+        ENTRY(self, self->head)->prev = (DequeDictLink)ix;
+    } else {
+        self->tail = (DequeDictLink)ix;
     }
-
-    return value;
+    self->head = (DequeDictLink)ix;
 }
 
-/* popleftitem() - O(1) remove and return first (key, value) */
-static PyObject *
-DequeDict_popleftitem(DequeDictObject *self, PyObject *Py_UNUSED(args))
+/* Link ix just before entry at; LINK_NONE links at the tail */
+static inline void
+DequeDict_link_before(DequeDictObject *self, Py_ssize_t ix, Py_ssize_t at)
 {
-    if (!self->head) {
-        PyErr_SetString(PyExc_KeyError, "popleftitem from an empty DequeDict");
-        return NULL;
+    if (at == LINK_NONE) {
+        DequeDict_link_tail(self, ix);
+        return;
     }
-
-    DequeDictEntry *entry = self->head;
-    PyObject *key = entry->key;
-    PyObject *value = entry->value;
-    Py_INCREF(key);
-    Py_INCREF(value);
-
-    /* Unlink head */
-    self->head = entry->next;
-    if (self->head) {
-        self->head->prev = NULL;
+    self->version++;
+    DequeDictEntry *entry = ENTRY(self, ix);
+    DequeDictEntry *next = ENTRY(self, at);
+    if (self->rank)
+        rank_insert(self, ix, next->prev, at);
+    if (self->meta) {
+        self->meta[ix] &= ~META_TAIL;
+        if ((self->meta[at] & META_TAIL) && at != self->seg) {
+            self->meta[ix] |= META_TAIL;
+            self->seg_count++;
+        }
+    }
+    entry->prev = next->prev;
+    entry->next = (DequeDictLink)at;
+    if (next->prev != LINK_NONE) {
+        ENTRY(self, next->prev)->next = (DequeDictLink)ix;
     } else {
-        self->tail = NULL;
+        self->head = (DequeDictLink)ix;
     }
+    next->prev = (DequeDictLink)ix;
+}
 
-    PyDict_DelItem(self->dict, key);
-    Py_DECREF(entry->key);
-    Py_DECREF(entry->value);
-    entry_free(entry);
-    self->size--;
+/* ========================================================================
+ * Cache helpers
+ *
+ * index_cache[cache_offset, cache_size) lists every live entry in order
+ * once at() has built it. Removals shift whichever side is shorter and
+ * appendleft uses left headroom, so the cache survives every mutation.
+ * When maintenance has moved more slots than a rebuild would cost since
+ * the last at(), the cache is dropped instead.
+ * ======================================================================== */
 
-    /* Bump cache offset instead of invalidating */
+#define CACHE_HEADROOM_MIN 8
+
+static inline void
+DequeDict_invalidate_cache(DequeDictObject *self)
+{
     if (self->index_cache) {
-        self->cache_offset++;
+        PyMem_Free(self->index_cache);
+        self->index_cache = NULL;
     }
-
-    PyObject *result = PyTuple_Pack(2, key, value);
-    Py_DECREF(key);
-    Py_DECREF(value);
-    return result;
+    self->cache_size = 0;
+    self->cache_capacity = 0;
+    self->cache_offset = 0;
+    self->cache_debt = 0;
 }
 
-/* pop(key=None, default=UNSET) - O(1) remove by key or from end */
-static PyObject *
-DequeDict_pop(DequeDictObject *self, PyObject *args)
+static int
+DequeDict_rebuild_cache(DequeDictObject *self)
 {
-    PyObject *key = NULL;
-    PyObject *default_val = NULL;
-
-    if (!PyArg_ParseTuple(args, "|OO", &key, &default_val))
-        return NULL;
-
-    if (key == NULL) {
-        /* Pop from right (like deque) */
-        if (!self->tail) {
-            if (default_val) {
-                Py_INCREF(default_val);
-                return default_val;
-            }
-            PyErr_SetString(PyExc_IndexError, "pop from an empty DequeDict");
-            return NULL;
-        }
-
-        DequeDictEntry *entry = self->tail;
-        PyObject *value = entry->value;
-        Py_INCREF(value);
-
-        /* Unlink tail */
-        self->tail = entry->prev;
-        if (self->tail) {
-            self->tail->next = NULL;
-        } else {
-            self->head = NULL;
-        }
-
-        PyDict_DelItem(self->dict, entry->key);
-        Py_DECREF(entry->key);
-        Py_DECREF(entry->value);
-        entry_free(entry);
-        self->size--;
-
-        /* Pop from cache right side */
-        if (self->index_cache && self->cache_size > 0) {
-            self->cache_size--;
-        }
+    STAT_ADD(self, CACHE_REBUILDS, 1);
+    DequeDict_invalidate_cache(self);
+    if (self->size == 0)
+        return 0;
 
-        return value;
+    self->cache_capacity = self->size;
+    self->index_cache = PyMem_Malloc(sizeof(DequeDictLink) * self->cache_capacity);
+    if (!self->index_cache) {
+        PyErr_NoMemory();
+        return -1;
     }
+    self->cache_size = self->size;
+    self->cache_offset = 0;
 
-    /* Pop by key — remove from cache in-place */
-    PyObject *capsule = PyDict_GetItem(self->dict, key);
-    if (!capsule) {
-        if (default_val) {
-            Py_INCREF(default_val);
-            return default_val;
-        }
-        PyErr_SetObject(PyExc_KeyError, key);
-        return NULL;
+    Py_ssize_t ix = self->head;
+    Py_ssize_t i = 0;
+    while (ix != LINK_NONE) {
+        self->index_cache[i] = (DequeDictLink)ix;
+        ix = ENTRY(self, ix)->next;
+        i++;
     }
+    return 0;
+}
 
-    DequeDictEntry *entry = (DequeDictEntry *)PyLong_AsVoidPtr(capsule);
-    if (!entry) return NULL;
-
-    PyObject *value = entry->value;
-    Py_INCREF(value);
+/* Ensure cache has room for one more entry. Returns 0 on success, -1 on failure. */
+static int
+DequeDict_cache_ensure_capacity(DequeDictObject *self)
+{
+    if (self->cache_size < self->cache_capacity)
+        return 0;
 
-    /* Unlink from list */
-    if (entry->prev) {
-        entry->prev->next = entry->next;
-    } else {
-        self->head = entry->next;
-    }
-    if (entry->next) {
-        entry->next->prev = entry->prev;
-    } else {
-        self->tail = entry->prev;
+    /* Reclaim slots left behind by popleft before growing */
+    if (self->cache_offset > 0 && self->cache_offset >= self->cache_capacity / 2) {
+        Py_ssize_t live = self->cache_size - self->cache_offset;
+        memmove(self->index_cache, self->index_cache + self->cache_offset,
+                sizeof(DequeDictLink) * live);
+        self->cache_size = live;
+        self->cache_offset = 0;
+        return 0;
     }
 
-    PyDict_DelItem(self->dict, key);
-    Py_DECREF(entry->key);
-    Py_DECREF(entry->value);
-    entry_free(entry);
-    self->size--;
-    DequeDict_invalidate_cache(self);
+    Py_ssize_t new_cap = self->cache_capacity * 2;
+    if (new_cap < 8) new_cap = 8;
 
-    return value;
+    DequeDictLink *new_cache = PyMem_Realloc(self->index_cache,
+        sizeof(DequeDictLink) * new_cap);
+    if (!new_cache) {
+        DequeDict_invalidate_cache(self);
+        return -1;
+    }
+    self->index_cache = new_cache;
+    self->cache_capacity = new_cap;
+    return 0;
 }
 
-/* popitem() - O(1) remove and return last (key, value) */
-static PyObject *
-DequeDict_popitem(DequeDictObject *self, PyObject *Py_UNUSED(args))
+/* Append entry ix to the cache, if there is one. Best effort: on
+ * allocation failure the cache is dropped and rebuilt by the next at(). */
+static inline void
+DequeDict_cache_append(DequeDictObject *self, Py_ssize_t ix)
 {
-    if (!self->tail) {
-        PyErr_SetString(PyExc_KeyError, "popitem from an empty DequeDict");
-        return NULL;
-    }
-
-    DequeDictEntry *entry = self->tail;
-    PyObject *key = entry->key;
-    PyObject *value = entry->value;
-    Py_INCREF(key);
-    Py_INCREF(value);
-
-    /* Unlink tail */
-    self->tail = entry->prev;
-    if (self->tail) {
-        self->tail->next = NULL;
-    } else {
-        self->head = NULL;
+    if (self->index_cache && DequeDict_cache_ensure_capacity(self) == 0) {
+        self->index_cache[self->cache_size] = (DequeDictLink)ix;
+        self->cache_size++;
     }
+}
 
-    PyDict_DelItem(self->dict, key);
-    Py_DECREF(entry->key);
-    Py_DECREF(entry->value);
-    entry_free(entry);
-    self->size--;
-
-    /* Pop from cache right side */
-    if (self->index_cache && self->cache_size > 0) {
-        self->cache_size--;
+/* Prepend entry ix to the cache, growing left headroom by half the live
+ * size when it runs out. Best effort, like DequeDict_cache_append(). */
+static void
+DequeDict_cache_prepend(DequeDictObject *self, Py_ssize_t ix)
+{
+    if (!self->index_cache)
+        return;
+
+    if (self->cache_offset == 0) {
+        Py_ssize_t room = self->cache_size / 2 + CACHE_HEADROOM_MIN;
+        Py_ssize_t new_cap = self->cache_capacity + room;
+        DequeDictLink *new_cache = PyMem_Malloc(sizeof(DequeDictLink) * new_cap);
+        if (!new_cache) {
+            DequeDict_invalidate_cache(self);
+            return;
+        }
+        memcpy(new_cache + room, self->index_cache, sizeof(DequeDictLink) * self->cache_size);
+        PyMem_Free(self->index_cache);
+        self->index_cache = new_cache;
+        self->cache_capacity = new_cap;
+        self->cache_offset = room;
+        self->cache_size += room;
     }
 
-    PyObject *result = PyTuple_Pack(2, key, value);
-    Py_DECREF(key);
-    Py_DECREF(value);
-    return result;
+    self->cache_offset--;
+    self->index_cache[self->cache_offset] = (DequeDictLink)ix;
 }
 
-/* appendleft(key, value) - O(1) insert at front — invalidates cache */
-static PyObject *
-DequeDict_appendleft(DequeDictObject *self, PyObject *args)
+/* Account for slots moved by maintenance; drop the cache once that has
+ * cost more than rebuilding it */
+static inline void
+DequeDict_cache_charge(DequeDictObject *self, Py_ssize_t moved)
 {
-    PyObject *key, *value;
-
-    if (!PyArg_ParseTuple(args, "OO", &key, &value))
-        return NULL;
+    self->cache_debt += moved;
+    if (self->cache_debt > self->cache_size - self->cache_offset + CACHE_HEADROOM_MIN)
+        DequeDict_invalidate_cache(self);
+}
 
-    /* Check if key exists */
-    if (PyDict_Contains(self->dict, key)) {
-        PyErr_SetString(PyExc_KeyError, "key already exists");
-        return NULL;
+/* Remove entry ix from the cache: O(1) at either end, otherwise O(distance
+ * to the nearer end) int32 moves */
+static void
+DequeDict_cache_remove(DequeDictObject *self, Py_ssize_t ix)
+{
+    DequeDictLink *cache = self->index_cache;
+    if (!cache)
+        return;
+
+    DequeDictLink target = (DequeDictLink)ix;
+    Py_ssize_t lo = self->cache_offset;
+    Py_ssize_t hi = self->cache_size - 1;
+    Py_ssize_t moved;
+
+    /* Scan inward from both ends so the cost follows the shorter side */
+    while (lo <= hi && cache[lo] != target && cache[hi] != target) {
+        lo++;
+        hi--;
     }
-
-    DequeDictEntry *new_entry = entry_alloc();
-    if (!new_entry) {
-        return PyErr_NoMemory();
+    if (lo > hi) {
+        /* Not cached - cannot happen while the invariant holds */
+        DequeDict_invalidate_cache(self);
+        return;
     }
 
-    Py_INCREF(key);
-    Py_INCREF(value);
-    new_entry->key = key;
-    new_entry->value = value;
-    new_entry->prev = NULL;
-    new_entry->next = self->head;
-    new_entry->cache_idx = -1;
-
-    if (self->head) {
-        self->head->prev = new_entry;
+    if (cache[lo] == target) {
+        moved = lo - self->cache_offset;
+        memmove(cache + self->cache_offset + 1, cache + self->cache_offset,
+                sizeof(DequeDictLink) * moved);
+        self->cache_offset++;
     } else {
-        self->tail = new_entry;
-    }
-    self->head = new_entry;
-    self->size++;
-    DequeDict_invalidate_cache(self);
-
-    PyObject *capsule = PyLong_FromVoidPtr(new_entry);
-    if (!capsule) {
-        entry_free(new_entry);
-        return NULL;
-    }
-    if (PyDict_SetItem(self->dict, key, capsule) < 0) {
-        Py_DECREF(capsule);
-        entry_free(new_entry);
-        return NULL;
+        moved = self->cache_size - 1 - hi;
+        memmove(cache + hi, cache + hi + 1, sizeof(DequeDictLink) * moved);
+        self->cache_size--;
     }
-    Py_DECREF(capsule);
 
-    Py_RETURN_NONE;
+    DequeDict_cache_charge(self, moved);
 }
 
-/* get(key, default=None) */
-static PyObject *
-DequeDict_get(DequeDictObject *self, PyObject *args)
+/* Insert entry ix at logical position pos, shifting the shorter side */
+static void
+DequeDict_cache_insert(DequeDictObject *self, Py_ssize_t pos, Py_ssize_t ix)
 {
-    PyObject *key;
-    PyObject *default_val = Py_None;
-
-    if (!PyArg_ParseTuple(args, "O|O", &key, &default_val))
-        return NULL;
+    if (!self->index_cache)
+        return;
 
-    PyObject *capsule = PyDict_GetItem(self->dict, key);
-    if (!capsule) {
-        Py_INCREF(default_val);
-        return default_val;
+    Py_ssize_t live = self->cache_size - self->cache_offset;
+    if (pos == 0) {
+        DequeDict_cache_prepend(self, ix);
+        return;
     }
-
-    DequeDictEntry *entry = (DequeDictEntry *)PyLong_AsVoidPtr(capsule);
-    if (!entry) {
-        Py_INCREF(default_val);
-        return default_val;
+    if (pos <= live / 2 && self->cache_offset > 0) {
+        DequeDictLink *base = self->index_cache + self->cache_offset;
+        memmove(base - 1, base, sizeof(DequeDictLink) * pos);
+        self->cache_offset--;
+        base[pos - 1] = (DequeDictLink)ix;
+        DequeDict_cache_charge(self, pos);
+        return;
     }
 
-    Py_INCREF(entry->value);
-    return entry->value;
+    if (DequeDict_cache_ensure_capacity(self) < 0)
+        return;
+    DequeDictLink *base = self->index_cache + self->cache_offset;
+    memmove(base + pos + 1, base + pos, sizeof(DequeDictLink) * (live - pos));
+    base[pos] = (DequeDictLink)ix;
+    self->cache_size++;
+    DequeDict_cache_charge(self, live - pos);
 }
 
 /* ========================================================================
- * Keys/Values/Items Views - O(1) creation, lazy iteration
+ * Hash index helpers
+ *
+ * Open addressing with CPython's perturbed probe sequence. Slots hold entry
+ * numbers; deleted slots are marked SLOT_DUMMY so probe chains stay intact
+ * until the next resize. Rehashing uses the cached entry hashes and never
+ * calls back into Python.
  * ======================================================================== */
 
-typedef struct {
-    PyObject_HEAD
-    DequeDictObject *dd;
-    int kind;  /* 0=keys, 1=values, 2=items */
-} DequeDictViewObject;
+#define SLOT_EMPTY (-1)
+#define SLOT_DUMMY (-2)
+#define INDEX_MINSIZE 8
+#define PERTURB_SHIFT 5
 
-static PyTypeObject DequeDictKeysView_Type;
-static PyTypeObject DequeDictValuesView_Type;
-static PyTypeObject DequeDictItemsView_Type;
+/* index_lookup() results other than a slot number */
+#define INDEX_NOTFOUND (-1)
+#define INDEX_ERROR (-2)
 
-static int
-DequeDictView_traverse(DequeDictViewObject *self, visitproc visit, void *arg)
+static inline void
+index_free(DequeDictObject *self)
 {
-    Py_VISIT(self->dd);
-    return 0;
+    if (self->table) {
+        PyMem_Free(self->table);
+        self->table = NULL;
+    }
+    self->table_mask = 0;
+    self->table_fill = 0;
+}
+
+/* Place an entry number in the first empty slot of a table without dummies. */
+static inline void
+index_insert_clean(int32_t *table, size_t mask, Py_hash_t hash, Py_ssize_t ix)
+{
+    size_t perturb = (size_t)hash;
+    size_t i = perturb & mask;
+    while (table[i] != SLOT_EMPTY) {
+        perturb >>= PERTURB_SHIFT;
+        i = (i * 5 + perturb + 1) & mask;
+    }
+    table[i] = (int32_t)ix;
 }
 
+/* Rebuild the table sized for `used` live entries (load factor <= 1/2). */
 static int
-DequeDictView_clear(DequeDictViewObject *self)
+index_resize(DequeDictObject *self, Py_ssize_t used)
 {
-    Py_CLEAR(self->dd);
+    size_t new_size = INDEX_MINSIZE;
+    while (new_size < (size_t)used * 2)
+        new_size <<= 1;
+
+    /* All-ones bytes are SLOT_EMPTY */
+    int32_t *new_table = PyMem_Malloc(new_size * sizeof(int32_t));
+    if (!new_table) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    memset(new_table, 0xff, new_size * sizeof(int32_t));
+    STAT_ADD(self, INDEX_RESIZES, 1);
+
+    /* Walk the list rather than the old table: no dummies to skip */
+    Py_ssize_t ix = self->head;
+    while (ix != LINK_NONE) {
+        DequeDictEntry *entry = ENTRY(self, ix);
+        index_insert_clean(new_table, new_size - 1, entry->hash, ix);
+        ix = entry->next;
+    }
+
+    PyMem_Free(self->table);
+    self->table = new_table;
+    self->table_mask = (Py_ssize_t)(new_size - 1);
+    self->table_fill = self->size;
     return 0;
 }
 
-static void
-DequeDictView_dealloc(DequeDictViewObject *self)
+static inline void
+index_count_probe(DequeDictObject *self, uint64_t collisions)
 {
-    PyObject_GC_UnTrack(self);
-    DequeDictView_clear(self);
-    Py_TYPE(self)->tp_free(self);
+    uint64_t *stats = self->stats;
+    stats[STAT_PROBES]++;
+    stats[STAT_COLLISIONS] += collisions;
+    if (collisions > stats[STAT_MAX_PROBE])
+        stats[STAT_MAX_PROBE] = collisions;
 }
 
+/* Find the slot holding key. Returns the slot and stores the entry number
+ * in *ix_out, or INDEX_NOTFOUND, or INDEX_ERROR with an exception set.
+ * Restarts if a key comparison mutates the DequeDict. */
 static Py_ssize_t
-DequeDictView_len(DequeDictViewObject *self)
+index_lookup(DequeDictObject *self, PyObject *key, Py_hash_t hash, Py_ssize_t *ix_out)
 {
-    return self->dd->size;
-}
+    int32_t *table;
+    Py_ssize_t ix;
+    size_t mask, perturb, i;
+    uint64_t collisions = 0;
+
+top:
+    table = self->table;
+    if (!table)
+        return INDEX_NOTFOUND;
+    mask = (size_t)self->table_mask;
+    perturb = (size_t)hash;
+    i = (size_t)hash & mask;
+    for (;;) {
+        ix = table[i];
+        if (ix == SLOT_EMPTY) {
+            if (self->stats)
+                index_count_probe(self, collisions);
+            return INDEX_NOTFOUND;
+        }
+        if (ix >= 0) {
+            DequeDictEntry *entry = ENTRY(self, ix);
+            if (entry->key == key)
+                break;
+            if (entry->hash == hash) {
+                PyObject *startkey = entry->key;
+                Py_INCREF(startkey);
+                int cmp = PyObject_RichCompareBool(startkey, key, Py_EQ);
+                Py_DECREF(startkey);
+                if (cmp < 0)
+                    return INDEX_ERROR;
+                if (table != self->table || mask != (size_t)self->table_mask
+                    || table[i] != ix || ENTRY(self, ix)->key != startkey)
+                    goto top;
+                if (cmp > 0)
+                    break;
+            }
+        }
+        collisions++;
+        perturb >>= PERTURB_SHIFT;
+        i = (i * 5 + perturb + 1) & mask;
+    }
+    if (self->stats)
+        index_count_probe(self, collisions);
+    *ix_out = ix;
+    return (Py_ssize_t)i;
+}
+
+/* Find the slot holding a known entry by number - no key comparisons. */
+static inline Py_ssize_t
+index_find_entry(DequeDictObject *self, Py_ssize_t ix)
+{
+    size_t mask = (size_t)self->table_mask;
+    size_t perturb = (size_t)ENTRY(self, ix)->hash;
+    size_t i = perturb & mask;
+    while (self->table[i] != ix) {
+        perturb >>= PERTURB_SHIFT;
+        i = (i * 5 + perturb + 1) & mask;
+    }
+    return (Py_ssize_t)i;
+}
+
+/* Make room for one more entry. Call before allocating the entry so that
+ * index_insert() cannot fail. Returns 0, or -1 with MemoryError set. */
+static inline int
+index_reserve(DequeDictObject *self)
+{
+    if (self->table && (self->table_fill + 1) * 3 < (self->table_mask + 1) * 2)
+        return 0;
+    return index_resize(self, self->size + 1);
+}
+
+/* Add a new entry whose key is known to be absent. Needs index_reserve(). */
+static inline void
+index_insert(DequeDictObject *self, Py_ssize_t ix)
+{
+    size_t mask = (size_t)self->table_mask;
+    size_t perturb = (size_t)ENTRY(self, ix)->hash;
+    size_t i = perturb & mask;
+    while (self->table[i] >= 0) {
+        perturb >>= PERTURB_SHIFT;
+        i = (i * 5 + perturb + 1) & mask;
+    }
+    if (self->table[i] == SLOT_EMPTY)
+        self->table_fill++;
+    self->table[i] = (int32_t)ix;
+}
+
+static inline void
+index_delete_slot(DequeDictObject *self, Py_ssize_t slot)
+{
+    self->table[slot] = SLOT_DUMMY;
+}
+
+/* ========================================================================
+ * Value index (track_values=True)
+ *
+ * A second open-addressing table, keyed by the hash of each entry's value
+ * and kept in vhashes when the entry takes the value, so the mutate paths
+ * only hash the incoming value and never compare. Equal values share a
+ * probe chain; lookups compare the candidates whose hash matches.
+ * ======================================================================== */
+
+static inline void
+vindex_free(DequeDictObject *self)
+{
+    PyMem_Free(self->vtable);
+    self->vtable = NULL;
+    self->vmask = 0;
+    self->vfill = 0;
+}
+
+/* Rebuild the value index sized for `used` live entries */
+static int
+vindex_resize(DequeDictObject *self, Py_ssize_t used)
+{
+    size_t new_size = INDEX_MINSIZE;
+    while (new_size < (size_t)used * 2)
+        new_size <<= 1;
+
+    int32_t *new_table = PyMem_Malloc(new_size * sizeof(int32_t));
+    if (!new_table) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    memset(new_table, 0xff, new_size * sizeof(int32_t));
+
+    Py_ssize_t ix = self->head;
+    while (ix != LINK_NONE) {
+        index_insert_clean(new_table, new_size - 1, self->vhashes[ix], ix);
+        ix = ENTRY(self, ix)->next;
+    }
+
+    PyMem_Free(self->vtable);
+    self->vtable = new_table;
+    self->vmask = (Py_ssize_t)(new_size - 1);
+    self->vfill = self->size;
+    return 0;
+}
+
+/* Make room for one more value. Call before allocating the entry. */
+static inline int
+vindex_reserve(DequeDictObject *self)
+{
+    if (self->vtable && (self->vfill + 1) * 3 < (self->vmask + 1) * 2)
+        return 0;
+    return vindex_resize(self, self->size + 1);
+}
+
+/* Index entry ix under its value hash vh. Needs vindex_reserve(). */
+static inline void
+vindex_insert(DequeDictObject *self, Py_ssize_t ix, Py_hash_t vh)
+{
+    size_t mask = (size_t)self->vmask;
+    size_t perturb = (size_t)vh;
+    size_t i = perturb & mask;
+    while (self->vtable[i] >= 0) {
+        perturb >>= PERTURB_SHIFT;
+        i = (i * 5 + perturb + 1) & mask;
+    }
+    if (self->vtable[i] == SLOT_EMPTY)
+        self->vfill++;
+    self->vtable[i] = (int32_t)ix;
+    self->vhashes[ix] = vh;
+}
+
+/* Drop entry ix from the value index - no value comparisons */
+static inline void
+vindex_delete(DequeDictObject *self, Py_ssize_t ix)
+{
+    size_t mask = (size_t)self->vmask;
+    size_t perturb = (size_t)self->vhashes[ix];
+    size_t i = perturb & mask;
+    while (self->vtable[i] != ix) {
+        perturb >>= PERTURB_SHIFT;
+        i = (i * 5 + perturb + 1) & mask;
+    }
+    self->vtable[i] = SLOT_DUMMY;
+}
+
+/* Hash of value for the value index, or 0 when values are not tracked.
+ * Unhashable values raise TypeError under track_values. */
+static inline int
+DequeDict_value_hash(DequeDictObject *self, PyObject *value, Py_hash_t *vh_out)
+{
+    *vh_out = 0;
+    if (!self->track_values)
+        return 0;
+    Py_hash_t vh = PyObject_Hash(value);
+    if (vh == -1)
+        return -1;
+    *vh_out = vh;
+    return 0;
+}
+
+/* True if the probe chain of vh passed slot before reaching it with
+ * perturb. Only the steps while perturb is non-zero can come back to a
+ * slot; after them the chain is a permutation ending at an empty slot. */
+static int
+vindex_revisit(size_t mask, Py_hash_t vh, size_t slot, size_t perturb)
+{
+    size_t p = (size_t)vh;
+    size_t i = p & mask;
+    while (p != 0 && p != perturb) {
+        if (i == slot)
+            return 1;
+        p >>= PERTURB_SHIFT;
+        i = (i * 5 + p + 1) & mask;
+    }
+    return 0;
+}
+
+/* Walk the probe chain of vh for entries whose value equals value, each
+ * reported once. Start with *slot_inout = -1; each call returning 1 stores
+ * the next match in *ix_out, 0 means no more, -1 is an error. A comparison
+ * that mutates the DequeDict raises RuntimeError, since earlier matches may
+ * be stale. */
+static int
+vindex_next(DequeDictObject *self, PyObject *value, Py_hash_t vh, Py_ssize_t *slot_inout,
+            size_t *perturb_inout, Py_ssize_t *ix_out)
+{
+    if (!self->vtable)
+        return 0;
+    size_t mask = (size_t)self->vmask;
+    size_t perturb, i;
+    if (*slot_inout < 0) {
+        perturb = (size_t)vh;
+        i = perturb & mask;
+    }
+    else {
+        perturb = *perturb_inout >> PERTURB_SHIFT;
+        i = ((size_t)*slot_inout * 5 + perturb + 1) & mask;
+    }
+    for (;;) {
+        Py_ssize_t ix = self->vtable[i];
+        if (ix == SLOT_EMPTY)
+            return 0;
+        if (ix >= 0 && self->vhashes[ix] == vh && !vindex_revisit(mask, vh, i, perturb)) {
+            PyObject *candidate = ENTRY(self, ix)->value;
+            int cmp = 1;
+            if (candidate != value) {
+                int32_t *table = self->vtable;
+                uint64_t version = self->version;
+                Py_INCREF(candidate);
+                cmp = PyObject_RichCompareBool(candidate, value, Py_EQ);
+                Py_DECREF(candidate);
+                if (cmp < 0)
+                    return -1;
+                if (table != self->vtable || version != self->version || self->vtable[i] != ix
+                    || ENTRY(self, ix)->value != candidate) {
+                    PyErr_SetString(PyExc_RuntimeError, "DequeDict mutated during value lookup");
+                    return -1;
+                }
+            }
+            if (cmp) {
+                *slot_inout = (Py_ssize_t)i;
+                *perturb_inout = perturb;
+                *ix_out = ix;
+                return 1;
+            }
+        }
+        perturb >>= PERTURB_SHIFT;
+        i = (i * 5 + perturb + 1) & mask;
+    }
+}
+
+/* Reserve an entry slot and an index slot for one insertion */
+static inline int
+DequeDict_reserve(DequeDictObject *self)
+{
+    if (entry_reserve(self) < 0)
+        return -1;
+    if (self->track_values && vindex_reserve(self) < 0)
+        return -1;
+    return index_reserve(self);
+}
+
+/* Reserve room for n more insertions (capped by maxsize) so a bulk load
+ * grows the entry array and hash index at most once */
+static int
+DequeDict_presize(DequeDictObject *self, Py_ssize_t n)
+{
+    /* Past maxsize every insert evicts, so one spare entry is enough */
+    if (n > self->maxsize - self->size)
+        n = self->maxsize - self->size + 1;
+    if (n > ENTRIES_MAX)
+        n = ENTRIES_MAX;
+    if (n <= 1)
+        return 0;
+
+    Py_ssize_t need = self->size + n;
+    if (need > self->entries_alloc && entries_grow(self, need) < 0)
+        return -1;
+    if (self->track_values && (!self->vtable || (self->vfill + n) * 3 >= (self->vmask + 1) * 2)
+        && vindex_resize(self, need) < 0)
+        return -1;
+    if (!self->table || (self->table_fill + n) * 3 >= (self->table_mask + 1) * 2)
+        return index_resize(self, need);
+    return 0;
+}
+
+/* Look up a key whose hash is known. Returns 1 if found (entry number and
+ * slot stored), 0 if absent, -1 on error. */
+static inline int
+DequeDict_lookup(DequeDictObject *self, PyObject *key, Py_hash_t hash,
+                 Py_ssize_t *ix_out, Py_ssize_t *slot_out)
+{
+    Py_ssize_t ix;
+    Py_ssize_t slot = index_lookup(self, key, hash, &ix);
+    if (slot == INDEX_ERROR)
+        return -1;
+    if (slot == INDEX_NOTFOUND)
+        return 0;
+    *ix_out = ix;
+    if (slot_out)
+        *slot_out = slot;
+    return 1;
+}
+
+/* Hash key and look it up, like DequeDict_lookup() (*hash_out is set
+ * even when the key is absent) */
+static inline int
+DequeDict_find(DequeDictObject *self, PyObject *key, Py_hash_t *hash_out,
+               Py_ssize_t *ix_out, Py_ssize_t *slot_out)
+{
+    Py_hash_t hash = PyObject_Hash(key);
+    if (hash == -1)
+        return -1;
+    if (hash_out)
+        *hash_out = hash;
+    return DequeDict_lookup(self, key, hash, ix_out, slot_out);
+}
+
+/* ========================================================================
+ * Argument parsing for METH_FASTCALL methods and vectorcall
+ * ======================================================================== */
+
+/* Check a positional argument count, with the messages of Argument Clinic */
+static inline int
+DequeDict_check_nargs(const char *name, Py_ssize_t nargs, Py_ssize_t min, Py_ssize_t max)
+{
+    if (nargs >= min && nargs <= max)
+        return 1;
+    if (min == max)
+        PyErr_Format(PyExc_TypeError, "%s expected %zd argument%s, got %zd",
+                     name, min, min == 1 ? "" : "s", nargs);
+    else if (nargs < min)
+        PyErr_Format(PyExc_TypeError, "%s expected at least %zd argument%s, got %zd",
+                     name, min, min == 1 ? "" : "s", nargs);
+    else
+        PyErr_Format(PyExc_TypeError, "%s expected at most %zd argument%s, got %zd",
+                     name, max, max == 1 ? "" : "s", nargs);
+    return 0;
+}
+
+/* Spread positional and keyword arguments over the parameters in kwlist.
+ * The first maxpos may be passed by position, the first minargs are
+ * required; out[] slots not passed are left as they are. Returns 0 or -1. */
+static int
+DequeDict_parse_args(const char *name, PyObject *const *args, Py_ssize_t nargs,
+                     PyObject *kwnames, const char *const *kwlist,
+                     Py_ssize_t maxpos, Py_ssize_t minargs, PyObject **out)
+{
+    if (nargs > maxpos) {
+        PyErr_Format(PyExc_TypeError, "%s() takes at most %zd positional argument%s (%zd given)",
+                     name, maxpos, maxpos == 1 ? "" : "s", nargs);
+        return -1;
+    }
+    for (Py_ssize_t i = 0; i < nargs; i++)
+        out[i] = args[i];
+
+    Py_ssize_t nkw = kwnames ? PyTuple_GET_SIZE(kwnames) : 0;
+    for (Py_ssize_t k = 0; k < nkw; k++) {
+        PyObject *kw = PyTuple_GET_ITEM(kwnames, k);
+        Py_ssize_t i = 0;
+        while (kwlist[i] && PyUnicode_CompareWithASCIIString(kw, kwlist[i]) != 0)
+            i++;
+        if (!kwlist[i]) {
+            PyErr_Format(PyExc_TypeError, "'%U' is an invalid keyword argument for %s()", kw, name);
+            return -1;
+        }
+        if (i < nargs) {
+            PyErr_Format(PyExc_TypeError, "argument for %s() given by name ('%s') and position (%zd)",
+                         name, kwlist[i], i + 1);
+            return -1;
+        }
+        out[i] = args[nargs + k];
+    }
+
+    for (Py_ssize_t i = 0; i < minargs; i++) {
+        if (!out[i]) {
+            PyErr_Format(PyExc_TypeError, "%s() missing required argument '%s' (pos %zd)",
+                         name, kwlist[i], i + 1);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Integer position argument, like the "n" format unit */
+static inline int
+DequeDict_index_arg(PyObject *arg, Py_ssize_t *out)
+{
+    Py_ssize_t index = PyNumber_AsSsize_t(arg, PyExc_OverflowError);
+    if (index == -1 && PyErr_Occurred())
+        return -1;
+    *out = index;
+    return 0;
+}
+
+/* ======================================================================== */
+
+static int
+DequeDict_traverse(DequeDictObject *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->on_evict);
+    Py_VISIT(self->evicted);
+    Py_VISIT(self->clock);
+    if (self->aio) {
+        DequeDictAsync *aio = self->aio;
+        for (Py_ssize_t i = 0; i < aio->len; i++)
+            Py_VISIT(aio->queue[(aio->first + i) % aio->cap]);
+        Py_VISIT(aio->loop);
+    }
+
+    /* Scan the array: sequential, and free slots have key == NULL */
+    DequeDictEntry *entry = self->entries;
+    DequeDictEntry *end = entry + self->entries_used;
+    for (; entry < end; entry++) {
+        if (entry->key) {
+            Py_VISIT(entry->key);
+            Py_VISIT(entry->value);
+        }
+    }
+    return 0;
+}
+
+static int
+DequeDict_clear(DequeDictObject *self)
+{
+    /* Detach first so decrefs that re-enter see an empty dict */
+    DequeDictEntry *entries = self->entries;
+    Py_ssize_t used = self->entries_used;
+    self->entries = NULL;
+    self->entries_alloc = 0;
+    self->entries_used = 0;
+    self->free_list = LINK_NONE;
+    self->head = LINK_NONE;
+    self->tail = LINK_NONE;
+    self->size = 0;
+    self->version++;
+    index_free(self);
+    DequeDict_invalidate_cache(self);
+    rank_free(self);
+    PyMem_Free(self->stamps);
+    self->stamps = NULL;
+    PyMem_Free(self->meta);
+    self->meta = NULL;
+    PyMem_Free(self->vhashes);
+    self->vhashes = NULL;
+    vindex_free(self);
+    self->seg = LINK_NONE;
+    self->seg_count = 0;
+    PyMem_Free(self->ghost);
+    self->ghost = NULL;
+    self->ghost_mask = 0;
+    if (self->scores) {
+        for (Py_ssize_t i = 0; i < used; i++)
+            PyMem_Free(self->scores[i].up);
+        PyMem_Free(self->scores);
+        self->scores = NULL;
+    }
+    if (self->skip_ends) {
+        for (int l = 0; l < SKIP_LEVELS; l++)
+            self->skip_ends[l].prev = self->skip_ends[l].next = LINK_NONE;
+    }
+    self->skip_height = 0;
+
+    for (Py_ssize_t i = 0; i < used; i++) {
+        if (entries[i].key) {
+            Py_CLEAR(entries[i].key);
+            Py_CLEAR(entries[i].value);
+        }
+    }
+    PyMem_Free(entries);
+    return 0;
+}
+
+/* Drop the awaiter queue. Awaiters still suspended keep waiting for
+ * their timeout or cancellation. */
+static void
+DequeDict_async_free(DequeDictObject *self)
+{
+    DequeDictAsync *aio = self->aio;
+    self->aio = NULL;
+    for (Py_ssize_t i = 0; i < aio->len; i++)
+        Py_DECREF(aio->queue[(aio->first + i) % aio->cap]);
+    Py_XDECREF(aio->loop);
+    PyMem_Free(aio->queue);
+    PyMem_Free(aio);
+}
+
+/* tp_clear - entries plus the eviction callback, its queue and awaiters */
+static int
+DequeDict_tp_clear(DequeDictObject *self)
+{
+    Py_CLEAR(self->on_evict);
+    Py_CLEAR(self->evicted);
+    Py_CLEAR(self->clock);
+    if (self->aio)
+        DequeDict_async_free(self);
+    return DequeDict_clear(self);
+}
+
+/* Free what tp_clear leaves for dealloc: the popleft(timeout=) lock, the
+ * stats counters and the skip-list ends. Shared by the subtype deallocs. */
+static void
+DequeDict_free_native(DequeDictObject *self)
+{
+    if (self->ready) {
+        PyThread_free_lock(self->ready);
+        self->ready = NULL;
+    }
+    PyMem_Free(self->stats);
+    self->stats = NULL;
+    PyMem_Free(self->skip_ends);
+    self->skip_ends = NULL;
+}
+
+static void
+DequeDict_dealloc(DequeDictObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    DequeDict_tp_clear(self);
+    DequeDict_free_native(self);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *
+DequeDict_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    DequeDictObject *self = (DequeDictObject *)type->tp_alloc(type, 0);
+    if (!self) return NULL;
+    self->free_list = LINK_NONE;
+    self->head = LINK_NONE;
+    self->tail = LINK_NONE;
+    self->maxsize = PY_SSIZE_T_MAX;
+    self->rank_root = LINK_NONE;
+    self->seg = LINK_NONE;
+    if (type == &DequeDict_Type) {
+        self->gc_mode = GC_LAZY;
+        PyObject_GC_UnTrack(self);
+    }
+    return (PyObject *)self;
+}
+
+/* Move the live entries, in list order, into a right-sized array. Called
+ * when the container has shrunk to a quarter of its capacity. Best effort:
+ * on allocation failure nothing changes. */
+static void
+DequeDict_compact(DequeDictObject *self)
+{
+    /* Entry numbers change; the treap is rebuilt on demand */
+    rank_free(self);
+    STAT_ADD(self, COMPACTIONS, 1);
+
+    if (self->size == 0) {
+        PyMem_Free(self->entries);
+        self->entries = NULL;
+        PyMem_Free(self->stamps);
+        self->stamps = NULL;
+        PyMem_Free(self->meta);
+        self->meta = NULL;
+        PyMem_Free(self->scores);
+        self->scores = NULL;
+        PyMem_Free(self->vhashes);
+        self->vhashes = NULL;
+        vindex_free(self);
+        self->entries_alloc = 0;
+        self->entries_used = 0;
+        self->free_list = LINK_NONE;
+        return;
+    }
+
+    Py_ssize_t alloc = self->size * 2;
+    DequeDictEntry *dst = PyMem_Malloc(sizeof(DequeDictEntry) * alloc);
+    double *stamps = self->timed ? PyMem_Malloc(sizeof(double) * alloc) : NULL;
+    uint8_t *meta = self->meta ? PyMem_Malloc(alloc) : NULL;
+    DequeDictScore *scores = self->scored ? PyMem_Malloc(sizeof(DequeDictScore) * alloc) : NULL;
+    Py_hash_t *vhashes = self->track_values ? PyMem_Malloc(sizeof(Py_hash_t) * alloc) : NULL;
+    if (!dst || (self->timed && !stamps) || (self->meta && !meta) || (self->scored && !scores)
+        || (self->track_values && !vhashes)) {
+        PyMem_Free(dst);
+        PyMem_Free(stamps);
+        PyMem_Free(meta);
+        PyMem_Free(scores);
+        PyMem_Free(vhashes);
+        return;
+    }
+
+    Py_ssize_t ix = self->head;
+    Py_ssize_t i = 0;
+    DequeDictLink seg = LINK_NONE;
+    while (ix != LINK_NONE) {
+        DequeDictEntry *src = ENTRY(self, ix);
+        dst[i] = *src;
+        dst[i].prev = (DequeDictLink)(i - 1);
+        dst[i].next = (DequeDictLink)(i + 1);
+        if (stamps)
+            stamps[i] = self->stamps[ix];
+        if (meta) {
+            meta[i] = self->meta[ix];
+            if (ix == self->seg)
+                seg = (DequeDictLink)i;
+        }
+        if (scores)
+            scores[i] = self->scores[ix];
+        if (vhashes)
+            vhashes[i] = self->vhashes[ix];
+        ix = src->next;
+        i++;
+    }
+    dst[i - 1].next = LINK_NONE;
+
+    PyMem_Free(self->entries);
+    self->entries = dst;
+    if (stamps) {
+        PyMem_Free(self->stamps);
+        self->stamps = stamps;
+    }
+    if (meta) {
+        PyMem_Free(self->meta);
+        self->meta = meta;
+        self->seg = seg;
+    }
+    if (scores) {
+        PyMem_Free(self->scores);
+        self->scores = scores;
+    }
+    if (vhashes) {
+        PyMem_Free(self->vhashes);
+        self->vhashes = vhashes;
+    }
+    self->entries_alloc = alloc;
+    self->entries_used = self->size;
+    self->free_list = LINK_NONE;
+    self->head = 0;
+    self->tail = (DequeDictLink)(self->size - 1);
+    self->version++;
+    if (scores)
+        skip_thread(self);
+
+    /* Entry numbers changed: rehash, shrinking the table if possible */
+    if (index_resize(self, self->size) < 0) {
+        PyErr_Clear();
+        memset(self->table, 0xff, sizeof(int32_t) * (self->table_mask + 1));
+        for (i = 0; i < self->size; i++)
+            index_insert_clean(self->table, (size_t)self->table_mask, dst[i].hash, i);
+        self->table_fill = self->size;
+    }
+    if (vhashes && vindex_resize(self, self->size) < 0) {
+        PyErr_Clear();
+        memset(self->vtable, 0xff, sizeof(int32_t) * (self->vmask + 1));
+        for (i = 0; i < self->size; i++)
+            index_insert_clean(self->vtable, (size_t)self->vmask, vhashes[i], i);
+        self->vfill = self->size;
+    }
+
+    /* The list is now in array order, so the cache is the identity map */
+    if (self->index_cache) {
+        for (i = 0; i < self->size; i++)
+            self->index_cache[i] = (DequeDictLink)i;
+        self->cache_offset = 0;
+        self->cache_size = self->size;
+    }
+}
+
+/* Copy src's entries and hash index into an empty DequeDict in one pass,
+ * reusing the cached hashes: no key is hashed or compared. A src without
+ * free slots keeps its entry numbers and its table is copied as is;
+ * otherwise the entries are packed in list order and the table rebuilt.
+ * Timestamps are kept when both use the same clock, else every entry is
+ * stamped with the last tick of self. Under a policy every entry starts in
+ * the head segment with clear reference bits. A self that tracks values
+ * needs a src that does too, for the cached value hashes. */
+static int
+DequeDict_clone(DequeDictObject *self, DequeDictObject *src)
+{
+    Py_ssize_t n = src->size;
+    if (n == 0)
+        return 0;
+    Py_ssize_t alloc = ENTRIES_MIN;
+    while (alloc < n)
+        alloc *= 2;
+    DequeDictEntry *dst = PyMem_Malloc(sizeof(DequeDictEntry) * alloc);
+    double *stamps = self->timed ? PyMem_Malloc(sizeof(double) * alloc) : NULL;
+    uint8_t *meta = self->policy ? PyMem_Calloc(alloc, 1) : NULL;
+    Py_hash_t *vhashes = self->track_values ? PyMem_Malloc(sizeof(Py_hash_t) * alloc) : NULL;
+    if (!dst || (self->timed && !stamps) || (self->policy && !meta) || (self->track_values && !vhashes)) {
+        PyMem_Free(dst);
+        PyMem_Free(stamps);
+        PyMem_Free(meta);
+        PyMem_Free(vhashes);
+        PyErr_NoMemory();
+        return -1;
+    }
+    int same_clock = stamps && src->timed && src->clock == self->clock;
+
+    int same_numbers = src->entries_used == n;
+    int32_t *table = NULL;
+    size_t table_size = (size_t)src->table_mask + 1;
+    if (same_numbers) {
+        table = PyMem_Malloc(table_size * sizeof(int32_t));
+        if (!table) {
+            PyMem_Free(dst);
+            PyMem_Free(stamps);
+            PyMem_Free(meta);
+            PyMem_Free(vhashes);
+            PyErr_NoMemory();
+            return -1;
+        }
+        memcpy(table, src->table, table_size * sizeof(int32_t));
+        memcpy(dst, src->entries, sizeof(DequeDictEntry) * n);
+        if (same_clock)
+            memcpy(stamps, src->stamps, sizeof(double) * n);
+        if (vhashes)
+            memcpy(vhashes, src->vhashes, sizeof(Py_hash_t) * n);
+    }
+    else {
+        Py_ssize_t ix = src->head;
+        for (Py_ssize_t i = 0; i < n; i++) {
+            DequeDictEntry *entry = ENTRY(src, ix);
+            dst[i] = *entry;
+            dst[i].prev = (DequeDictLink)(i - 1);
+            dst[i].next = (DequeDictLink)(i + 1);
+            if (same_clock)
+                stamps[i] = src->stamps[ix];
+            if (vhashes)
+                vhashes[i] = src->vhashes[ix];
+            ix = entry->next;
+        }
+        dst[n - 1].next = LINK_NONE;
+    }
+    if (stamps && !same_clock) {
+        for (Py_ssize_t i = 0; i < n; i++)
+            stamps[i] = self->now;
+    }
+    for (Py_ssize_t i = 0; i < n; i++) {
+        Py_INCREF(dst[i].key);
+        Py_INCREF(dst[i].value);
+    }
+    /* An untracked source holds only atomic objects */
+    if (self->gc_mode == GC_LAZY && PyObject_GC_IsTracked((PyObject *)src)) {
+        for (Py_ssize_t i = 0; i < n && self->gc_mode == GC_LAZY; i++) {
+            DequeDict_maintain_tracking(self, dst[i].key);
+            DequeDict_maintain_tracking(self, dst[i].value);
+        }
+    }
+
+    /* self is empty: its arrays hold no references */
+    PyMem_Free(self->entries);
+    PyMem_Free(self->stamps);
+    PyMem_Free(self->meta);
+    PyMem_Free(self->vhashes);
+    index_free(self);
+    vindex_free(self);
+    DequeDict_invalidate_cache(self);
+    rank_free(self);
+
+    self->entries = dst;
+    self->stamps = stamps;
+    self->meta = meta;
+    self->vhashes = vhashes;
+    self->seg = LINK_NONE;
+    self->seg_count = 0;
+    self->entries_alloc = alloc;
+    self->entries_used = n;
+    self->free_list = LINK_NONE;
+    self->size = n;
+    self->version++;
+    DequeDict_notify(self);
+    if (same_numbers) {
+        self->head = src->head;
+        self->tail = src->tail;
+        self->table = table;
+        self->table_mask = src->table_mask;
+        self->table_fill = src->table_fill;
+    }
+    else {
+        self->head = 0;
+        self->tail = (DequeDictLink)(n - 1);
+    }
+    if ((!same_numbers && index_resize(self, n) < 0) || (vhashes && vindex_resize(self, n) < 0)) {
+        /* Leave a consistent, empty DequeDict */
+        DequeDict_clear(self);
+        return -1;
+    }
+    return 0;
+}
+
+/* ========================================================================
+ * Bounded capacity
+ *
+ * Inserting past maxsize evicts from the opposite end, like a deque with
+ * maxlen. Evicted pairs are queued and handed to on_evict in one list at
+ * the end of the mutating call, once the container is consistent.
+ * ======================================================================== */
+
+static PyObject *DequeDict_detach_item(DequeDictObject *self, Py_ssize_t ix, Py_ssize_t slot,
+                                       PyObject **key_out);
+
+/* Remove one entry, queueing its pair for on_evict. Pass the index slot
+ * if known, else -1. Returns 0 or -1. */
+static int
+DequeDict_evict_entry(DequeDictObject *self, Py_ssize_t ix, Py_ssize_t slot)
+{
+    PyObject *key;
+    PyObject *value = DequeDict_detach_item(self, ix, slot, &key);
+    int r = 0;
+    if (self->on_evict) {
+        if (!self->evicted)
+            self->evicted = PyList_New(0);
+        PyObject *pair = self->evicted ? PyTuple_Pack(2, key, value) : NULL;
+        r = pair ? PyList_Append(self->evicted, pair) : -1;
+        Py_XDECREF(pair);
+    }
+    Py_DECREF(key);
+    Py_DECREF(value);
+    return r;
+}
+
+static int DequeDict_policy_evict(DequeDictObject *self);
+
+/* Evict from the head (or tail) until size <= maxsize, or let the policy
+ * pick the victims. Returns 0 or -1. */
+static int
+DequeDict_evict(DequeDictObject *self, int from_head)
+{
+    if (self->policy)
+        return DequeDict_policy_evict(self);
+    while (self->size > self->maxsize) {
+        STAT_ADD(self, EVICTIONS, 1);
+        if (DequeDict_evict_entry(self, from_head ? self->head : self->tail, -1) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* Call on_evict with the queued pairs. An exception already set is kept;
+ * a callback failure during it is reported as unraisable. */
+static int
+DequeDict_flush_evicted(DequeDictObject *self)
+{
+    PyObject *batch = self->evicted;
+    PyObject *callback = self->on_evict;
+    self->evicted = NULL;
+    if (!callback) {
+        Py_DECREF(batch);
+        return 0;
+    }
+
+    PyObject *exc_type, *exc_value, *exc_tb;
+    PyErr_Fetch(&exc_type, &exc_value, &exc_tb);
+    Py_INCREF(callback);
+    PyObject *res = PyObject_CallOneArg(callback, batch);
+    Py_DECREF(batch);
+    int r = res ? 0 : -1;
+    Py_XDECREF(res);
+    if (exc_type) {
+        if (r < 0)
+            PyErr_WriteUnraisable(callback);
+        PyErr_Restore(exc_type, exc_value, exc_tb);
+        r = -1;
+    }
+    Py_DECREF(callback);
+    return r;
+}
+
+static void DequeDict_wake_awaiters(DequeDictObject *self);
+
+/* Finish a mutating call: flush evictions, wake awaiters the call gave
+ * entries to, then return status */
+static inline int
+DequeDict_finish(DequeDictObject *self, int status)
+{
+    if (self->aio && self->aio->pending)
+        DequeDict_wake_awaiters(self);
+    if (self->evicted && DequeDict_flush_evicted(self) < 0)
+        return -1;
+    return status;
+}
+
+/* Same for calls returning an object; steals result */
+static inline PyObject *
+DequeDict_finish_object(DequeDictObject *self, PyObject *result)
+{
+    if (DequeDict_finish(self, result ? 0 : -1) < 0) {
+        Py_XDECREF(result);
+        return NULL;
+    }
+    return result;
+}
+
+/* Move an entry to the tail and restamp it (touch mode, get_and_touch,
+ * updates of a timed DequeDict) */
+static inline void
+DequeDict_touch_entry(DequeDictObject *self, Py_ssize_t ix)
+{
+    STAMP(self, ix);
+    if (ix == self->tail)
+        return;
+    DequeDict_unlink(self, ix);
+    DequeDict_link_tail(self, ix);
+    DequeDict_cache_remove(self, ix);
+    DequeDict_cache_append(self, ix);
+}
+
+/* ========================================================================
+ * Eviction policies
+ *
+ * clock:  one list; a hit sets the entry's reference bit. The victim is
+ *         the head, after referenced heads have had the bit cleared and
+ *         been moved to the tail (a second chance).
+ * slru:   new keys join probation (the head segment); a hit there promotes
+ *         to protected (the tail segment, 80% of maxsize), whose LRU end
+ *         is demoted back to the probation MRU end when it overflows. The
+ *         victim is the probation LRU end.
+ * 2q:     new keys join the small FIFO A1in (the tail segment); keys
+ *         evicted from it are remembered in a ghost table, and a ghost key
+ *         inserted again joins the main LRU queue Am (the head segment).
+ *         A1in is evicted while it holds more than a quarter of maxsize.
+ * s3fifo: like 2q with a 10% small FIFO, but hits only bump a 2-bit
+ *         frequency. The small FIFO's head moves to main if it was hit
+ *         more than once, else it is evicted into the ghost table; main's
+ *         head is reinserted at main's tail while its frequency, decreased
+ *         each time, is not zero.
+ *
+ * The ghost table is direct-mapped on the key hash and holds 32-bit
+ * fingerprints, so a ghost can be forgotten early or, rarely, mistaken.
+ * ======================================================================== */
+
+#define GHOST_MAX ((Py_ssize_t)1 << 20)
+
+/* Link ix at the end of the head segment, just before seg, and into the
+ * cache. linked is the number of entries in the list without ix. */
+static void
+DequeDict_link_head_segment(DequeDictObject *self, Py_ssize_t ix, Py_ssize_t linked)
+{
+    if (self->seg != LINK_NONE)
+        DequeDict_link_before(self, ix, self->seg);
+    else
+        DequeDict_link_tail(self, ix);
+    if (self->seg == ix) {
+        /* The tail segment was empty: link_tail just started it with ix */
+        self->meta[ix] &= ~META_TAIL;
+        self->seg = LINK_NONE;
+        self->seg_count = 0;
+    }
+    DequeDict_cache_insert(self, linked - self->seg_count, ix);
+}
+
+/* Never 0, which marks an empty or taken slot */
+static inline uint32_t
+ghost_fingerprint(Py_hash_t hash)
+{
+    uint64_t h = (uint64_t)hash;
+    uint32_t fp = (uint32_t)(h >> 32) ^ (uint32_t)h;
+    return fp ? fp : 1u;
+}
+
+/* Remember the hash of an evicted key. Best effort: without memory for
+ * the table nothing is remembered. */
+static void
+DequeDict_ghost_add(DequeDictObject *self, Py_hash_t hash)
+{
+    if (!self->ghost) {
+        Py_ssize_t size = 8;
+        while (size < self->maxsize && size < GHOST_MAX)
+            size <<= 1;
+        self->ghost = PyMem_Calloc(size, sizeof(uint32_t));
+        if (!self->ghost)
+            return;
+        self->ghost_mask = size - 1;
+    }
+    self->ghost[(size_t)hash & (size_t)self->ghost_mask] = ghost_fingerprint(hash);
+}
+
+/* True if hash was remembered; forgets it */
+static inline int
+DequeDict_ghost_take(DequeDictObject *self, Py_hash_t hash)
+{
+    if (!self->ghost)
+        return 0;
+    uint32_t *slot = &self->ghost[(size_t)hash & (size_t)self->ghost_mask];
+    if (*slot != ghost_fingerprint(hash))
+        return 0;
+    *slot = 0;
+    return 1;
+}
+
+/* Link a new entry where the policy admits it: the tail, or the end of the
+ * head segment. linked is the number of entries in the list without ix. */
+static inline void
+DequeDict_policy_link_new(DequeDictObject *self, Py_ssize_t ix, Py_ssize_t linked)
+{
+    if (self->policy == POLICY_SLRU
+        || (self->policy >= POLICY_2Q && DequeDict_ghost_take(self, ENTRY(self, ix)->hash)))
+        DequeDict_link_head_segment(self, ix, linked);
+    else {
+        DequeDict_link_tail(self, ix);
+        DequeDict_cache_append(self, ix);
+    }
+}
+
+/* Record a hit on entry ix */
+static void
+DequeDict_policy_hit(DequeDictObject *self, Py_ssize_t ix)
+{
+    uint8_t *meta = &self->meta[ix];
+    switch (self->policy) {
+    case POLICY_CLOCK:
+        *meta = 1;
+        break;
+    case POLICY_S3FIFO:
+        if ((*meta & META_REF) < META_REF)
+            (*meta)++;
+        break;
+    case POLICY_2Q:
+        /* Hits in A1in do not count; Am is LRU */
+        if (!(*meta & META_TAIL) && ENTRY(self, ix)->next != self->seg && ix != self->tail) {
+            DequeDict_unlink(self, ix);
+            DequeDict_cache_remove(self, ix);
+            DequeDict_link_head_segment(self, ix, self->size - 1);
+        }
+        break;
+    case POLICY_SLRU:
+        if (ix != self->tail)
+            DequeDict_touch_entry(self, ix);  /* link_tail applies the cap */
+        else if (!(*meta & META_TAIL))
+            DequeDict_join_tail_segment(self, ix);  /* Protected is empty: promote in place */
+        break;
+    }
+}
+
+/* Evict the policy's victims until size <= maxsize. Returns 0 or -1. */
+static int
+DequeDict_policy_evict(DequeDictObject *self)
+{
+    while (self->size > self->maxsize) {
+        Py_ssize_t victim = self->head;
+        switch (self->policy) {
+        case POLICY_CLOCK:
+            while (self->meta[victim]) {
+                self->meta[victim] = 0;
+                DequeDict_touch_entry(self, victim);
+                victim = self->head;
+            }
+            break;
+        case POLICY_2Q:
+            if (self->seg != LINK_NONE && (self->seg == self->head || self->seg_count > self->maxsize / 4)) {
+                victim = self->seg;
+                DequeDict_ghost_add(self, ENTRY(self, victim)->hash);
+            }
+            break;
+        case POLICY_S3FIFO:
+            for (;;) {
+                if (self->seg != LINK_NONE
+                    && (self->seg == self->head || self->seg_count > self->maxsize / 10)) {
+                    victim = self->seg;
+                    if ((self->meta[victim] & META_REF) > 1) {
+                        self->meta[victim] &= ~META_REF;
+                        DequeDict_advance_seg(self);
+                        continue;
+                    }
+                    DequeDict_ghost_add(self, ENTRY(self, victim)->hash);
+                    break;
+                }
+                victim = self->head;
+                if (!(self->meta[victim] & META_REF))
+                    break;
+                self->meta[victim]--;
+                DequeDict_unlink(self, victim);
+                DequeDict_cache_remove(self, victim);
+                DequeDict_link_head_segment(self, victim, self->size - 1);
+            }
+            break;
+        }
+        STAT_ADD(self, EVICTIONS, 1);
+        if (DequeDict_evict_entry(self, victim, -1) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* A lookup or update hit: the policy's bookkeeping, or a move to the end
+ * in touch mode */
+static inline void
+DequeDict_hit(DequeDictObject *self, Py_ssize_t ix)
+{
+    if (self->policy)
+        DequeDict_policy_hit(self, ix);
+    else if (self->touch)
+        DequeDict_touch_entry(self, ix);
+}
+
+/* ========================================================================
+ * Timestamps and expiry
+ *
+ * With ttl or clock set, every write stamps its entry with the clock in a
+ * side array parallel to entries. Writes also move the entry to the tail,
+ * so the list stays in stamp order and the expired entries form a prefix
+ * at the head: expire() pops it in one loop. With a ttl, lookups that hit
+ * an expired entry remove it and report the key as missing. appendleft(),
+ * insert_at() and move_to_end() can put an entry out of stamp order; it
+ * then expires when the sweep reaches it or on lookup.
+ * ======================================================================== */
+
+/* Read the clock into self->now. Called at the start of a timed write or
+ * lookup, before any entry number is taken, so a clock that runs Python
+ * code cannot leave stale entry numbers behind. */
+static int
+DequeDict_read_clock(DequeDictObject *self)
+{
+    PyObject *t = PyObject_CallNoArgs(self->clock ? self->clock : time_monotonic);
+    if (!t) return -1;
+    double now = PyFloat_AsDouble(t);
+    Py_DECREF(t);
+    if (now == -1.0 && PyErr_Occurred())
+        return -1;
+    self->now = now;
+    return 0;
+}
+
+static inline int
+DequeDict_tick(DequeDictObject *self)
+{
+    return self->timed ? DequeDict_read_clock(self) : 0;
+}
+
+/* Remove entries from the head while their stamp is < cutoff (<= cutoff if
+ * inclusive), queueing them for on_evict. Returns the count or -1. Callers
+ * flush. */
+static Py_ssize_t
+DequeDict_expire_prefix(DequeDictObject *self, double cutoff, int inclusive)
+{
+    Py_ssize_t n = 0;
+    /* Re-read each round: a decref may re-enter and clear or re-init */
+    while (self->timed && self->head != LINK_NONE) {
+        double stamp = self->stamps[self->head];
+        if (inclusive ? stamp > cutoff : stamp >= cutoff)
+            break;
+        STAT_ADD(self, EXPIRATIONS, 1);
+        if (DequeDict_evict_entry(self, self->head, -1) < 0)
+            return -1;
+        n++;
+    }
+    return n;
+}
+
+/* DequeDict_lookup() for lookups, counted as hits or misses. A timed
+ * DequeDict ticks first, and with a ttl an expired hit is removed (queued
+ * for on_evict) and reported as absent; callers flush. */
+static int
+DequeDict_lookup_live(DequeDictObject *self, PyObject *key, Py_hash_t hash,
+                      Py_ssize_t *ix_out, Py_ssize_t *slot_out)
+{
+    int found;
+    if (!self->timed)
+        found = DequeDict_lookup(self, key, hash, ix_out, slot_out);
+    else {
+        if (DequeDict_read_clock(self) < 0)
+            return -1;
+        Py_ssize_t slot;
+        found = DequeDict_lookup(self, key, hash, ix_out, &slot);
+        if (found > 0 && self->timed && self->ttl > 0 && self->stamps[*ix_out] <= self->now - self->ttl) {
+            STAT_ADD(self, EXPIRATIONS, 1);
+            found = DequeDict_evict_entry(self, *ix_out, slot) < 0 ? -1 : 0;
+        }
+        else if (slot_out)
+            *slot_out = slot;
+    }
+    if (self->stats && found >= 0)
+        self->stats[found ? STAT_HITS : STAT_MISSES]++;
+    return found;
+}
+
+/* Hash key and look it up like DequeDict_lookup_live() */
+static inline int
+DequeDict_find_live(DequeDictObject *self, PyObject *key, Py_hash_t *hash_out,
+                    Py_ssize_t *ix_out, Py_ssize_t *slot_out)
+{
+    Py_hash_t hash = PyObject_Hash(key);
+    if (hash == -1)
+        return -1;
+    if (hash_out)
+        *hash_out = hash;
+    return DequeDict_lookup_live(self, key, hash, ix_out, slot_out);
+}
+
+/* Turn timestamps on or off. Entries already present get stamp 0; callers
+ * reload the contents right after. Returns 0 or -1. */
+static int
+DequeDict_set_timed(DequeDictObject *self, int timed)
+{
+    if (timed && !self->stamps && self->entries_alloc) {
+        self->stamps = PyMem_Calloc(self->entries_alloc, sizeof(double));
+        if (!self->stamps) {
+            PyErr_NoMemory();
+            return -1;
+        }
+    }
+    else if (!timed) {
+        PyMem_Free(self->stamps);
+        self->stamps = NULL;
+    }
+    self->timed = (char)timed;
+    return 0;
+}
+
+/* Switch to policy (POLICY_NONE for none). Entries already present
+ * start in the head segment with clear bits; callers reload the contents
+ * right after. Returns 0 or -1. */
+static int
+DequeDict_set_policy(DequeDictObject *self, int policy)
+{
+    if (policy && self->entries_alloc) {
+        uint8_t *meta = PyMem_Realloc(self->meta, self->entries_alloc);
+        if (!meta) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        memset(meta, 0, self->entries_alloc);
+        self->meta = meta;
+    }
+    else if (!policy) {
+        PyMem_Free(self->meta);
+        self->meta = NULL;
+    }
+    PyMem_Free(self->ghost);
+    self->ghost = NULL;
+    self->ghost_mask = 0;
+    self->seg = LINK_NONE;
+    self->seg_count = 0;
+    self->policy = (char)policy;
+    return 0;
+}
+
+/* Parse the policy option. "fifo" is the default order and "lru" is
+ * touch=True; returns the POLICY_ code, or -1. */
+static int
+DequeDict_policy_arg(PyObject *policy, int *touch)
+{
+    if (!policy || policy == Py_None)
+        return POLICY_NONE;
+    if (!PyUnicode_Check(policy)) {
+        PyErr_SetString(PyExc_TypeError, "policy must be a str or None");
+        return -1;
+    }
+    if (PyUnicode_CompareWithASCIIString(policy, "fifo") == 0)
+        return POLICY_NONE;
+    if (PyUnicode_CompareWithASCIIString(policy, "lru") == 0) {
+        *touch = 1;
+        return POLICY_NONE;
+    }
+    for (int i = POLICY_CLOCK; i <= POLICY_S3FIFO; i++) {
+        if (PyUnicode_CompareWithASCIIString(policy, policy_names[i]) == 0)
+            return i;
+    }
+    PyErr_Format(PyExc_ValueError,
+                 "policy must be 'fifo', 'lru', 'clock', 'slru', '2q', 's3fifo' or None, not %R", policy);
+    return -1;
+}
+
+/* Turn the value index on or off. Entries already present are not
+ * indexed; callers reload the contents right after. */
+static void
+DequeDict_set_track_values(DequeDictObject *self, int track_values)
+{
+    if (!track_values) {
+        PyMem_Free(self->vhashes);
+        self->vhashes = NULL;
+        vindex_free(self);
+    }
+    self->track_values = (char)track_values;
+}
+
+/* Apply the maxsize/on_evict/touch/gc_tracking/ttl/clock/stats/policy/
+ * track_values keyword options of __init__ */
+static int
+DequeDict_configure(DequeDictObject *self, PyObject *maxsize, PyObject *on_evict, int touch, int gc_tracking,
+                    PyObject *ttl, PyObject *clock, int stats, PyObject *policy, int track_values)
+{
+    Py_ssize_t cap = PY_SSIZE_T_MAX;
+    if (maxsize && maxsize != Py_None) {
+        cap = PyNumber_AsSsize_t(maxsize, PyExc_OverflowError);
+        if (cap == -1 && PyErr_Occurred())
+            return -1;
+        if (cap < 0) {
+            PyErr_SetString(PyExc_ValueError, "maxsize must be non-negative or None");
+            return -1;
+        }
+    }
+    if (on_evict == Py_None)
+        on_evict = NULL;
+    if (on_evict && !PyCallable_Check(on_evict)) {
+        PyErr_SetString(PyExc_TypeError, "on_evict must be callable or None");
+        return -1;
+    }
+    double lifetime = 0;
+    if (ttl && ttl != Py_None) {
+        lifetime = PyFloat_AsDouble(ttl);
+        if (lifetime == -1.0 && PyErr_Occurred())
+            return -1;
+        if (!(lifetime > 0)) {
+            PyErr_SetString(PyExc_ValueError, "ttl must be positive or None");
+            return -1;
+        }
+    }
+    if (clock == Py_None)
+        clock = NULL;
+    if (clock && !PyCallable_Check(clock)) {
+        PyErr_SetString(PyExc_TypeError, "clock must be callable or None");
+        return -1;
+    }
+    int policy_code = DequeDict_policy_arg(policy, &touch);
+    if (policy_code < 0)
+        return -1;
+    if (policy_code) {
+        const char *conflict = cap == PY_SSIZE_T_MAX ? "policy needs maxsize"
+                             : touch ? "policy cannot be combined with touch=True"
+                             : lifetime > 0 || clock ? "policy cannot be combined with ttl or clock"
+                             : NULL;
+        if (conflict) {
+            PyErr_SetString(PyExc_ValueError, conflict);
+            return -1;
+        }
+    }
+    if (stats && !self->stats) {
+        self->stats = PyMem_Calloc(STAT_COUNT, sizeof(uint64_t));
+        if (!self->stats) {
+            PyErr_NoMemory();
+            return -1;
+        }
+    }
+    else if (!stats) {
+        PyMem_Free(self->stats);
+        self->stats = NULL;
+    }
+    if (DequeDict_set_timed(self, lifetime > 0 || clock) < 0 || DequeDict_set_policy(self, policy_code) < 0)
+        return -1;
+    if (clock == time_monotonic)
+        clock = NULL;
+
+    self->ttl = lifetime;
+    Py_XINCREF(clock);
+    Py_XSETREF(self->clock, clock);
+    self->maxsize = cap;
+    Py_XINCREF(on_evict);
+    Py_XSETREF(self->on_evict, on_evict);
+    self->touch = (char)touch;
+    DequeDict_set_track_values(self, track_values);
+
+    if (!gc_tracking) {
+        self->gc_mode = GC_NEVER;
+        PyObject_GC_UnTrack(self);
+    }
+    else if (self->gc_mode == GC_NEVER)
+        self->gc_mode = Py_IS_TYPE(self, &DequeDict_Type) && self->size == 0 ? GC_LAZY : GC_TRACKED;
+    if (on_evict)
+        DequeDict_maintain_tracking(self, on_evict);
+    if (clock)
+        DequeDict_maintain_tracking(self, clock);
+    return 0;
+}
+
+/* DequeDict_append_new() for a value already hashed by
+ * DequeDict_value_hash(). Runs no Python code before linking. */
+static int
+DequeDict_append_hashed(DequeDictObject *self, PyObject *key, Py_hash_t hash, PyObject *value, Py_hash_t vh)
+{
+    if (DequeDict_reserve(self) < 0)
+        return -1;
+
+    Py_ssize_t ix = entry_alloc(self);
+    DequeDictEntry *new_entry = ENTRY(self, ix);
+    Py_INCREF(key);
+    Py_INCREF(value);
+    new_entry->key = key;
+    new_entry->value = value;
+    new_entry->hash = hash;
+    STAMP(self, ix);
+    DequeDict_maintain_tracking(self, key);
+    DequeDict_maintain_tracking(self, value);
+    if (self->policy)
+        DequeDict_policy_link_new(self, ix, self->size);
+    else {
+        DequeDict_link_tail(self, ix);
+        DequeDict_cache_append(self, ix);
+    }
+    self->size++;
+    index_insert(self, ix);
+    if (self->track_values)
+        vindex_insert(self, ix, vh);
+    DequeDict_notify(self);
+
+    if (self->size > self->maxsize)
+        return DequeDict_evict(self, 1);
+    return 0;
+}
+
+/* Give entry ix a new value hashed by DequeDict_value_hash(): keeps
+ * position, or moves to the end and restamps in touch mode or when timed.
+ * Returns 0, or -1 if the value index cannot grow. */
+static int
+DequeDict_update_entry(DequeDictObject *self, Py_ssize_t ix, PyObject *value, Py_hash_t vh)
+{
+    /* The delete leaves a dummy and the reinsert may fill an empty slot,
+     * so reserve as for a new value; an unchanged hash keeps its slot */
+    int reindex = self->track_values && self->vhashes[ix] != vh;
+    if (reindex && vindex_reserve(self) < 0)
+        return -1;
+
+    /* Cache stores entry numbers, no update needed */
+    DequeDictEntry *entry = ENTRY(self, ix);
+    PyObject *old_value = entry->value;
+    Py_INCREF(value);
+    entry->value = value;
+    if (reindex) {
+        vindex_delete(self, ix);
+        vindex_insert(self, ix, vh);
+    }
+    DequeDict_maintain_tracking(self, value);
+    if (self->policy)
+        DequeDict_policy_hit(self, ix);
+    else if (self->touch || self->timed)
+        DequeDict_touch_entry(self, ix);
+    Py_DECREF(old_value);
+    return 0;
+}
+
+/* Link a new entry for an absent key at the tail, evicting from the head
+ * when over capacity. Returns 0 or -1. */
+static int
+DequeDict_append_new(DequeDictObject *self, PyObject *key, Py_hash_t hash, PyObject *value)
+{
+    Py_hash_t vh;
+    uint64_t version = self->version;
+    if (DequeDict_value_hash(self, value, &vh) < 0)
+        return -1;
+    if (self->version != version) {
+        /* The value's __hash__ changed the links: key may be present now */
+        Py_ssize_t ix;
+        int found = DequeDict_lookup(self, key, hash, &ix, NULL);
+        if (found < 0)
+            return -1;
+        if (found)
+            return DequeDict_update_entry(self, ix, value, vh);
+    }
+    return DequeDict_append_hashed(self, key, hash, value, vh);
+}
+
+/* Insert or update one pair whose hash is known: update keeps position
+ * (moves to the end and restamps in touch mode or when timed), new keys go
+ * to the end. Callers tick and flush evictions. */
+static int
+DequeDict_set_hash(DequeDictObject *self, PyObject *key, Py_hash_t hash, PyObject *value)
+{
+    Py_hash_t vh;
+    if (DequeDict_value_hash(self, value, &vh) < 0)
+        return -1;
+    Py_ssize_t ix;
+    Py_ssize_t slot = index_lookup(self, key, hash, &ix);
+    if (slot == INDEX_ERROR)
+        return -1;
+    if (slot != INDEX_NOTFOUND)
+        return DequeDict_update_entry(self, ix, value, vh);
+    return DequeDict_append_hashed(self, key, hash, value, vh);
+}
+
+static int
+DequeDict_set(DequeDictObject *self, PyObject *key, PyObject *value)
+{
+    Py_hash_t hash = PyObject_Hash(key);
+    if (hash == -1)
+        return -1;
+    return DequeDict_set_hash(self, key, hash, value);
+}
+
+/* Insert the pairs of another DequeDict in its order. An empty self that
+ * can hold them all is cloned; otherwise the cached hashes are reused. */
+static int
+DequeDict_merge_dequedict_lock_held(DequeDictObject *self, DequeDictObject *other)
+{
+    if (self->size == 0 && other->size <= self->maxsize && (other->track_values || !self->track_values))
+        return DequeDict_clone(self, other);
+    if (DequeDict_presize(self, other->size) < 0)
+        return -1;
+
+    Py_ssize_t ix = other->head;
+    while (ix != LINK_NONE) {
+        DequeDictEntry *entry = ENTRY(other, ix);
+        PyObject *key = entry->key;
+        PyObject *value = entry->value;
+        Py_INCREF(key);
+        Py_INCREF(value);
+        int r = DequeDict_set_hash(self, key, entry->hash, value);
+        Py_DECREF(key);
+        Py_DECREF(value);
+        if (r < 0)
+            return -1;
+        if (!ENTRY_LIVE(other, ix)) {       /* Mutated by __eq__ */
+            PyErr_SetString(PyExc_RuntimeError, "DequeDict mutated during update");
+            return -1;
+        }
+        ix = ENTRY(other, ix)->next;
+    }
+    return 0;
+}
+
+/* DequeDict_merge_dequedict_lock_held() with both DequeDicts locked */
+static int
+DequeDict_merge_dequedict(DequeDictObject *self, DequeDictObject *other)
+{
+    if (other == self)
+        return 0;
+    int r;
+    Py_BEGIN_CRITICAL_SECTION2(self, other);
+    r = DequeDict_merge_dequedict_lock_held(self, other);
+    Py_END_CRITICAL_SECTION2();
+    return r;
+}
+
+/* Insert the pairs of a dict using dict order. Its keys are distinct, so
+ * while self started empty and nothing can run Python code (only str and
+ * int keys, no eviction yet), new keys skip the lookup. */
+static int
+DequeDict_merge_dict_lock_held(DequeDictObject *self, PyObject *other)
+{
+    int fresh = self->size == 0;
+    PyObject *key, *value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(other, &pos, &key, &value)) {
+        Py_INCREF(key);
+        Py_INCREF(value);
+        int r;
+        if (fresh && !PyUnicode_CheckExact(key) && !PyLong_CheckExact(key))
+            fresh = 0;
+        Py_hash_t hash = PyObject_Hash(key);
+        if (hash == -1)
+            r = -1;
+        else if (fresh && self->size < self->maxsize)
+            r = DequeDict_append_new(self, key, hash, value);
+        else {
+            fresh = 0;
+            r = DequeDict_set_hash(self, key, hash, value);
+        }
+        Py_DECREF(key);
+        Py_DECREF(value);
+        if (r < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* DequeDict_merge_dict_lock_held() with the dict locked as well */
+static int
+DequeDict_merge_dict(DequeDictObject *self, PyObject *other)
+{
+    int r;
+    Py_BEGIN_CRITICAL_SECTION2(self, other);
+    r = DequeDict_merge_dict_lock_held(self, other);
+    Py_END_CRITICAL_SECTION2();
+    return r;
+}
+
+/* Insert pairs from a DequeDict, a dict or an iterable of (key, value)
+ * tuples. Dict subclasses that override __iter__ (OrderedDict) are read
+ * through their keys, in their own order. */
+static int
+DequeDict_merge(DequeDictObject *self, PyObject *other, const char *pairs_error)
+{
+    if (DequeDict_tick(self) < 0)
+        return -1;
+    if (PyObject_TypeCheck(other, &DequeDict_Type))
+        return DequeDict_merge_dequedict(self, (DequeDictObject *)other);
+
+    Py_ssize_t hint = PyObject_LengthHint(other, 0);
+    if (hint < 0 || DequeDict_presize(self, hint) < 0)
+        return -1;
+
+    int mapping = PyDict_Check(other);
+    if (mapping && Py_TYPE(other)->tp_iter == PyDict_Type.tp_iter)
+        return DequeDict_merge_dict(self, other);
+
+    PyObject *iter = PyObject_GetIter(other);
+    if (!iter) return -1;
+
+    PyObject *item;
+    while ((item = PyIter_Next(iter)) != NULL) {
+        PyObject *key, *value;
+        int r;
+        if (mapping) {
+            key = item;
+            value = PyObject_GetItem(other, key);
+            r = value ? DequeDict_set(self, key, value) : -1;
+            Py_XDECREF(value);
+        }
+        else if (!PyTuple_Check(item) || PyTuple_GET_SIZE(item) != 2) {
+            PyErr_SetString(PyExc_ValueError, pairs_error);
+            r = -1;
+        }
+        else {
+            key = PyTuple_GET_ITEM(item, 0);
+            value = PyTuple_GET_ITEM(item, 1);
+            r = DequeDict_set(self, key, value);
+        }
+        Py_DECREF(item);
+        if (r < 0) {
+            Py_DECREF(iter);
+            return -1;
+        }
+    }
+    Py_DECREF(iter);
+    if (PyErr_Occurred()) return -1;
+    return 0;
+}
+
+/* Reset to empty and load items (may be NULL) - shared by __init__ of
+ * DequeDict and its subtypes */
+static int
+DequeDict_reset(DequeDictObject *self, PyObject *items)
+{
+    /* Untrack before modifying (safe for re-init) */
+    PyObject_GC_UnTrack(self);
+
+    /* Clear existing state */
+    DequeDict_clear(self);
+
+    /* Initialize from items if provided */
+    int r = 0;
+    if (items)
+        r = DequeDict_merge(self, items, "DequeDict requires sequence of (key, value) pairs");
+
+    if (self->gc_mode == GC_TRACKED && !PyObject_GC_IsTracked((PyObject *)self))
+        PyObject_GC_Track(self);
+    return DequeDict_finish(self, r);
+}
+
+static int
+DequeDict_init(DequeDictObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"items", "maxsize", "on_evict", "touch", "gc_tracking", "ttl", "clock", "stats",
+                             "policy", "track_values", NULL};
+    PyObject *items = NULL;
+    PyObject *maxsize = Py_None;
+    PyObject *on_evict = Py_None;
+    int touch = 0;
+    int gc_tracking = 1;
+    PyObject *ttl = Py_None;
+    PyObject *clock = Py_None;
+    int stats = 0;
+    PyObject *policy = Py_None;
+    int track_values = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O$OOppOOpOp", kwlist,
+                                     &items, &maxsize, &on_evict, &touch, &gc_tracking, &ttl, &clock, &stats,
+                                     &policy, &track_values))
+        return -1;
+
+    if (DequeDict_configure(self, maxsize, on_evict, touch, gc_tracking, ttl, clock, stats, policy,
+                            track_values) < 0)
+        return -1;
+    return DequeDict_reset(self, items);
+}
+
+/* DequeDict(...) without an args tuple or kwargs dict. tp_vectorcall is
+ * not inherited, so subtypes still go through tp_new and tp_init. */
+static PyObject *
+DequeDict_vectorcall(PyObject *type, PyObject *const *args, size_t nargsf, PyObject *kwnames)
+{
+    static const char *const kwlist[] = {"items", "maxsize", "on_evict", "touch", "gc_tracking", "ttl", "clock",
+                                         "stats", "policy", "track_values", NULL};
+    PyObject *argv[10] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+    Py_ssize_t nargs = PyVectorcall_NARGS(nargsf);
+    int touch = 0;
+    int gc_tracking = 1;
+    int stats = 0;
+    int track_values = 0;
+
+    if ((nargs || kwnames)
+        && DequeDict_parse_args("DequeDict", args, nargs, kwnames, kwlist, 1, 0, argv) < 0)
+        return NULL;
+    if (argv[3] && (touch = PyObject_IsTrue(argv[3])) < 0)
+        return NULL;
+    if (argv[4] && (gc_tracking = PyObject_IsTrue(argv[4])) < 0)
+        return NULL;
+    if (argv[7] && (stats = PyObject_IsTrue(argv[7])) < 0)
+        return NULL;
+    if (argv[9] && (track_values = PyObject_IsTrue(argv[9])) < 0)
+        return NULL;
+
+    PyObject *self = DequeDict_new((PyTypeObject *)type, NULL, NULL);
+    if (!self) return NULL;
+    if (DequeDict_configure((DequeDictObject *)self, argv[1], argv[2], touch, gc_tracking, argv[5], argv[6],
+                            stats, argv[8], track_values) < 0
+        || DequeDict_reset((DequeDictObject *)self, argv[0]) < 0) {
+        Py_DECREF(self);
+        return NULL;
+    }
+    return self;
+}
+
+static Py_ssize_t
+DequeDict_len(DequeDictObject *self)
+{
+    return self->size;
+}
+
+/* Unlink entry from the list, the index and the cache and release it.
+ * Returns its value and stores its key, both as new references. Pass the
+ * index slot if known, else -1. */
+static PyObject *
+DequeDict_detach_item(DequeDictObject *self, Py_ssize_t ix, Py_ssize_t slot, PyObject **key_out)
+{
+    DequeDict_cache_remove(self, ix);
+    DequeDict_unlink(self, ix);
+    if (slot < 0)
+        slot = index_find_entry(self, ix);
+    index_delete_slot(self, slot);
+    if (self->track_values)
+        vindex_delete(self, ix);
+    self->size--;
+
+    DequeDictEntry *entry = ENTRY(self, ix);
+    PyObject *key = entry->key;
+    PyObject *value = entry->value;
+    entry_free(self, ix);
+    if (self->entries_alloc > ENTRIES_SHRINK_MIN && self->size * 4 < self->entries_alloc)
+        DequeDict_compact(self);
+    *key_out = key;
+    return value;
+}
+
+/* DequeDict_detach_item() for callers that only want the value */
+static PyObject *
+DequeDict_detach(DequeDictObject *self, Py_ssize_t ix, Py_ssize_t slot)
+{
+    PyObject *key;
+    PyObject *value = DequeDict_detach_item(self, ix, slot, &key);
+    Py_DECREF(key);
+    return value;
+}
+
+/* (key, value) tuple stealing both references */
+static inline PyObject *
+DequeDict_pack_pair(PyObject *key, PyObject *value)
+{
+    PyObject *pair = PyTuple_New(2);
+    if (!pair) {
+        Py_DECREF(key);
+        Py_DECREF(value);
+        return NULL;
+    }
+    PyTuple_SET_ITEM(pair, 0, key);
+    PyTuple_SET_ITEM(pair, 1, value);
+    return pair;
+}
+
+static PyObject *DefaultDequeDict_missing(PyObject *self, PyObject *key);
+
+/* Missing key in __getitem__: defer to __missing__ on subclasses, like dict */
+static PyObject *
+DequeDict_missing(DequeDictObject *self, PyObject *key)
+{
+    if (Py_TYPE(self) == &DefaultDequeDict_Type)
+        return DefaultDequeDict_missing((PyObject *)self, key);
+    if (Py_TYPE(self) != &DequeDict_Type
+        && _PyType_Lookup(Py_TYPE(self), str___missing__) != NULL)
+        return PyObject_CallMethodOneArg((PyObject *)self, str___missing__, key);
+    PyErr_SetObject(PyExc_KeyError, key);
+    return NULL;
+}
+
+/* __getitem__ - O(1) lookup */
+static PyObject *
+DequeDict_getitem(DequeDictObject *self, PyObject *key)
+{
+    Py_ssize_t ix;
+    int found = DequeDict_find_live(self, key, NULL, &ix, NULL);
+    if (found <= 0) {
+        if (found == 0)
+            return DequeDict_finish_object(self, DequeDict_missing(self, key));
+        return DequeDict_finish_object(self, NULL);
+    }
+
+    DequeDict_hit(self, ix);
+    PyObject *value = ENTRY(self, ix)->value;
+    Py_INCREF(value);
+    return value;
+}
+
+/* __setitem__ - O(1) if key exists, append if new */
+static int
+DequeDict_setitem(DequeDictObject *self, PyObject *key, PyObject *value)
+{
+    if (value == NULL) {
+        /* __delitem__ */
+        Py_ssize_t ix, slot;
+        int found = DequeDict_find(self, key, NULL, &ix, &slot);
+        if (found <= 0) {
+            if (found == 0)
+                PyErr_SetObject(PyExc_KeyError, key);
+            return -1;
+        }
+
+        Py_DECREF(DequeDict_detach(self, ix, slot));
+        return 0;
+    }
+
+    if (DequeDict_tick(self) < 0)
+        return -1;
+    return DequeDict_finish(self, DequeDict_set(self, key, value));
+}
+
+/* __contains__ - O(1) */
+static int
+DequeDict_contains(DequeDictObject *self, PyObject *key)
+{
+    Py_ssize_t ix;
+    int found = DequeDict_find_live(self, key, NULL, &ix, NULL);
+    return self->evicted ? DequeDict_finish(self, found) : found;
+}
+
+/* peekleft() - O(1) return first value without removing */
+static PyObject *
+DequeDict_peekleft(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    if (self->head == LINK_NONE) {
+        PyErr_SetString(PyExc_IndexError, "peek from an empty DequeDict");
+        return NULL;
+    }
+    PyObject *value = ENTRY(self, self->head)->value;
+    Py_INCREF(value);
+    return value;
+}
+
+/* peekleftitem() - O(1) return first (key, value) without removing */
+static PyObject *
+DequeDict_peekleftitem(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    if (self->head == LINK_NONE) {
+        PyErr_SetString(PyExc_IndexError, "peek from an empty DequeDict");
+        return NULL;
+    }
+    DequeDictEntry *entry = ENTRY(self, self->head);
+    return PyTuple_Pack(2, entry->key, entry->value);
+}
+
+/* peekleftkey() - O(1) return first key without removing */
+static PyObject *
+DequeDict_peekleftkey(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    if (self->head == LINK_NONE) {
+        PyErr_SetString(PyExc_IndexError, "peek from an empty DequeDict");
+        return NULL;
+    }
+    PyObject *key = ENTRY(self, self->head)->key;
+    Py_INCREF(key);
+    return key;
+}
+
+/* peek() / peekright() - O(1) return last value without removing */
+static PyObject *
+DequeDict_peek(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    if (self->tail == LINK_NONE) {
+        PyErr_SetString(PyExc_IndexError, "peek from an empty DequeDict");
+        return NULL;
+    }
+    PyObject *value = ENTRY(self, self->tail)->value;
+    Py_INCREF(value);
+    return value;
+}
+
+/* peekitem() / peekrightitem() - O(1) return last (key, value) without removing */
+static PyObject *
+DequeDict_peekitem(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    if (self->tail == LINK_NONE) {
+        PyErr_SetString(PyExc_IndexError, "peek from an empty DequeDict");
+        return NULL;
+    }
+    DequeDictEntry *entry = ENTRY(self, self->tail);
+    return PyTuple_Pack(2, entry->key, entry->value);
+}
+
+/* popleft() - O(1) remove and return first value */
+static PyObject *
+DequeDict_popleft(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    if (self->head == LINK_NONE) {
+        PyErr_SetString(PyExc_IndexError, "pop from an empty DequeDict");
+        return NULL;
+    }
+
+    return DequeDict_detach(self, self->head, -1);
+}
+
+/* popleftitem() - O(1) remove and return first (key, value) */
+static PyObject *
+DequeDict_popleftitem(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    if (self->head == LINK_NONE) {
+        PyErr_SetString(PyExc_KeyError, "popleftitem from an empty DequeDict");
+        return NULL;
+    }
+
+    PyObject *key;
+    PyObject *value = DequeDict_detach_item(self, self->head, -1, &key);
+    return DequeDict_pack_pair(key, value);
+}
+
+/* ========================================================================
+ * Blocking popleft
+ *
+ * A consumer waiting for an empty DequeDict sleeps on a lock that inserts
+ * release, so a producer/consumer pair needs no Python lock or condition
+ * variable. The wait detaches the thread state, which releases the GIL
+ * (or suspends the critical section), so the producer can run.
+ * ======================================================================== */
+
+#define WAIT_SLICE_US 1000000       /* Longest single wait; signals are checked in between */
+
+/* Monotonic clock in microseconds */
+static int64_t
+monotonic_us(void)
+{
+#ifdef _WIN32
+    return (int64_t)GetTickCount64() * 1000;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+/* Parse a timeout in seconds: NULL/None is -1 (do not wait), inf waits
+ * forever (INT64_MAX) */
+static int
+DequeDict_timeout_arg(PyObject *arg, int64_t *out_us)
+{
+    if (!arg || arg == Py_None) {
+        *out_us = -1;
+        return 0;
+    }
+    double timeout = PyFloat_AsDouble(arg);
+    if (timeout == -1.0 && PyErr_Occurred())
+        return -1;
+    if (!(timeout >= 0)) {
+        PyErr_SetString(PyExc_ValueError, "timeout must be a non-negative number or None");
+        return -1;
+    }
+    *out_us = timeout * 1e6 >= (double)INT64_MAX ? INT64_MAX : (int64_t)(timeout * 1e6);
+    return 0;
+}
+
+/* Wait up to timeout_us for an entry. Returns 0 (head may still be empty
+ * on timeout) or -1 if a signal handler raised. */
+static int
+DequeDict_wait(DequeDictObject *self, int64_t timeout_us)
+{
+    if (self->head != LINK_NONE || timeout_us <= 0)
+        return 0;
+    if (!self->ready) {
+        /* Starts held: each release by an insert lets one wait through */
+        self->ready = PyThread_allocate_lock();
+        if (!self->ready) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        PyThread_acquire_lock(self->ready, WAIT_LOCK);
+    }
+
+    int64_t deadline = timeout_us == INT64_MAX ? INT64_MAX : monotonic_us() + timeout_us;
+    while (self->head == LINK_NONE) {
+        int64_t remaining = deadline == INT64_MAX ? WAIT_SLICE_US : deadline - monotonic_us();
+        if (remaining <= 0)
+            break;
+        PyLockStatus r;
+        self->waiters++;
+        Py_BEGIN_ALLOW_THREADS
+        r = PyThread_acquire_lock_timed(self->ready, remaining < WAIT_SLICE_US ? remaining : WAIT_SLICE_US, 1);
+        Py_END_ALLOW_THREADS
+        self->waiters--;
+        if (r == PY_LOCK_ACQUIRED)
+            self->signalled = 0;
+        if (PyErr_CheckSignals() < 0)
+            return -1;
+    }
+    /* Pass the wakeup on if another consumer still waits */
+    if (self->head != LINK_NONE)
+        DequeDict_notify(self);
+    return 0;
+}
+
+/* popleft(timeout=None) / popleftitem(timeout=None) - with a timeout,
+ * wait up to that many seconds for an entry instead of raising at once */
+static PyObject *
+DequeDict_popleft_wait(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs,
+                       PyObject *kwnames, int items)
+{
+    static const char *const kwlist[] = {"timeout", NULL};
+    PyObject *timeout = NULL;
+    int64_t timeout_us = -1;
+
+    if (nargs || kwnames) {
+        if (DequeDict_parse_args(items ? "popleftitem" : "popleft", args, nargs, kwnames, kwlist, 1, 0,
+                                 &timeout) < 0
+            || DequeDict_timeout_arg(timeout, &timeout_us) < 0
+            || DequeDict_wait(self, timeout_us) < 0)
+            return NULL;
+    }
+    return items ? DequeDict_popleftitem(self, NULL) : DequeDict_popleft(self, NULL);
+}
+
+static PyObject *
+DequeDict_popleft_method(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs,
+                         PyObject *kwnames)
+{
+    return DequeDict_popleft_wait(self, args, nargs, kwnames, 0);
+}
+
+static PyObject *
+DequeDict_popleftitem_method(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs,
+                             PyObject *kwnames)
+{
+    return DequeDict_popleft_wait(self, args, nargs, kwnames, 1);
+}
+
+/* try_popleft(default=None) - first value, or default if empty */
+static PyObject *
+DequeDict_try_popleft(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    if (!DequeDict_check_nargs("try_popleft", nargs, 0, 1))
+        return NULL;
+    if (self->head == LINK_NONE) {
+        PyObject *default_val = nargs ? args[0] : Py_None;
+        Py_INCREF(default_val);
+        return default_val;
+    }
+    return DequeDict_detach(self, self->head, -1);
+}
+
+/* pop(key=None, default=UNSET) - O(1) remove by key or from end */
+static PyObject *
+DequeDict_pop(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    if (!DequeDict_check_nargs("pop", nargs, 0, 2))
+        return NULL;
+    PyObject *key = nargs > 0 ? args[0] : NULL;
+    PyObject *default_val = nargs > 1 ? args[1] : NULL;
+
+    if (key == NULL) {
+        /* Pop from right (like deque) */
+        if (self->tail == LINK_NONE) {
+            if (default_val) {
+                Py_INCREF(default_val);
+                return default_val;
+            }
+            PyErr_SetString(PyExc_IndexError, "pop from an empty DequeDict");
+            return NULL;
+        }
+
+        return DequeDict_detach(self, self->tail, -1);
+    }
+
+    /* Pop by key */
+    Py_ssize_t ix, slot;
+    int found = DequeDict_find(self, key, NULL, &ix, &slot);
+    if (found < 0)
+        return NULL;
+    if (!found) {
+        if (default_val) {
+            Py_INCREF(default_val);
+            return default_val;
+        }
+        PyErr_SetObject(PyExc_KeyError, key);
+        return NULL;
+    }
+
+    return DequeDict_detach(self, ix, slot);
+}
+
+/* popitem() - O(1) remove and return last (key, value) */
+static PyObject *
+DequeDict_popitem(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    if (self->tail == LINK_NONE) {
+        PyErr_SetString(PyExc_KeyError, "popitem from an empty DequeDict");
+        return NULL;
+    }
+
+    PyObject *key;
+    PyObject *value = DequeDict_detach_item(self, self->tail, -1, &key);
+    return DequeDict_pack_pair(key, value);
+}
+
+/* Link a new entry at the head, evicting from the tail when over capacity,
+ * like deque(maxlen=...). Raises KeyError if key exists. Callers flush
+ * evictions. */
+static int
+DequeDict_prepend_new(DequeDictObject *self, PyObject *key, PyObject *value)
+{
+    Py_hash_t hash, vh;
+    Py_ssize_t ix;
+    if (DequeDict_value_hash(self, value, &vh) < 0)
+        return -1;
+    int found = DequeDict_find(self, key, &hash, &ix, NULL);
+    if (found < 0)
+        return -1;
+    if (found) {
+        PyErr_SetString(PyExc_KeyError, "key already exists");
+        return -1;
+    }
+
+    if (DequeDict_reserve(self) < 0)
+        return -1;
+
+    ix = entry_alloc(self);
+    DequeDictEntry *new_entry = ENTRY(self, ix);
+    Py_INCREF(key);
+    Py_INCREF(value);
+    new_entry->key = key;
+    new_entry->value = value;
+    new_entry->hash = hash;
+    STAMP(self, ix);
+    DequeDict_maintain_tracking(self, key);
+    DequeDict_maintain_tracking(self, value);
+    DequeDict_link_head(self, ix);
+    self->size++;
+    index_insert(self, ix);
+    if (self->track_values)
+        vindex_insert(self, ix, vh);
+    DequeDict_cache_prepend(self, ix);
+    DequeDict_notify(self);
+
+    if (self->size > self->maxsize)
+        return DequeDict_evict(self, 0);
+    return 0;
+}
+
+/* appendleft(key, value) - O(1) insert at front, evicting from the end
+ * when over capacity */
+static PyObject *
+DequeDict_appendleft(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    if (!DequeDict_check_nargs("appendleft", nargs, 2, 2) || DequeDict_tick(self) < 0)
+        return NULL;
+
+    if (DequeDict_finish(self, DequeDict_prepend_new(self, args[0], args[1])) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+/* Bulk size argument of popleft_n() and friends */
+static Py_ssize_t
+DequeDict_count_arg(PyObject *arg)
+{
+    Py_ssize_t n = PyNumber_AsSsize_t(arg, PyExc_OverflowError);
+    if (n == -1 && PyErr_Occurred())
+        return -1;
+    if (n < 0) {
+        PyErr_SetString(PyExc_ValueError, "n must be non-negative");
+        return -1;
+    }
+    return n;
+}
+
+/* Remove up to n entries from one end in one loop. The list takes the
+ * detached references directly; a key-decref that re-enters and shrinks
+ * the DequeDict just ends the batch early. */
+static PyObject *
+DequeDict_pop_count(DequeDictObject *self, Py_ssize_t n, int from_head, int items)
+{
+    if (n > self->size)
+        n = self->size;
+
+    PyObject *list = PyList_New(n);
+    if (!list) return NULL;
+
+    Py_ssize_t i;
+    for (i = 0; i < n && self->size > 0; i++) {
+        Py_ssize_t ix = from_head ? self->head : self->tail;
+        PyObject *key;
+        PyObject *value = DequeDict_detach_item(self, ix, -1, &key);
+        if (items) {
+            value = DequeDict_pack_pair(key, value);
+            if (!value) {
+                Py_SET_SIZE(list, i);
+                Py_DECREF(list);
+                return NULL;
+            }
+        } else {
+            Py_DECREF(key);
+        }
+        PyList_SET_ITEM(list, i, value);
+    }
+    Py_SET_SIZE(list, i);
+    return list;
+}
+
+static PyObject *
+DequeDict_pop_many(DequeDictObject *self, PyObject *arg, int from_head, int items)
+{
+    Py_ssize_t n = DequeDict_count_arg(arg);
+    if (n < 0)
+        return NULL;
+    return DequeDict_pop_count(self, n, from_head, items);
+}
+
+/* popleft_n(n) - remove and return up to n first values */
+static PyObject *
+DequeDict_popleft_n(DequeDictObject *self, PyObject *arg)
+{
+    return DequeDict_pop_many(self, arg, 1, 0);
+}
+
+/* pop_n(n) - remove and return up to n last values, last first */
+static PyObject *
+DequeDict_pop_n(DequeDictObject *self, PyObject *arg)
+{
+    return DequeDict_pop_many(self, arg, 0, 0);
+}
+
+/* popleftitems_n(n) - remove and return up to n first (key, value) pairs */
+static PyObject *
+DequeDict_popleftitems_n(DequeDictObject *self, PyObject *arg)
+{
+    return DequeDict_pop_many(self, arg, 1, 1);
+}
+
+/* extend(pairs) - set each pair like update(), presizing once */
+static PyObject *
+DequeDict_extend(DequeDictObject *self, PyObject *pairs)
+{
+    int r = DequeDict_merge(self, pairs, "extend requires sequence of (key, value) pairs");
+    if (DequeDict_finish(self, r) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+/* extendleft(pairs) - appendleft() each new pair, so they end up in
+ * reverse order like deque.extendleft() */
+static PyObject *
+DequeDict_extendleft(DequeDictObject *self, PyObject *pairs)
+{
+    Py_ssize_t hint = PyObject_LengthHint(pairs, 0);
+    if (hint < 0 || DequeDict_presize(self, hint) < 0 || DequeDict_tick(self) < 0)
+        return NULL;
+
+    /* Mappings as their items(), in their own order */
+    PyObject *items = pairs;
+    if (PyDict_CheckExact(pairs))
+        items = PyDict_Items(pairs);
+    else if (PyDict_Check(pairs) || PyObject_TypeCheck(pairs, &DequeDict_Type))
+        items = PyMapping_Items(pairs);
+    else
+        Py_INCREF(items);
+    if (!items) return NULL;
+    PyObject *iter = PyObject_GetIter(items);
+    Py_DECREF(items);
+    if (!iter) return NULL;
+
+    int r = 0;
+    PyObject *pair;
+    while ((pair = PyIter_Next(iter)) != NULL) {
+        if (!PyTuple_Check(pair) || PyTuple_GET_SIZE(pair) != 2) {
+            Py_DECREF(pair);
+            PyErr_SetString(PyExc_ValueError, "extendleft requires sequence of (key, value) pairs");
+            r = -1;
+            break;
+        }
+        r = DequeDict_prepend_new(self, PyTuple_GET_ITEM(pair, 0), PyTuple_GET_ITEM(pair, 1));
+        Py_DECREF(pair);
+        if (r < 0)
+            break;
+    }
+    Py_DECREF(iter);
+    if (r == 0 && PyErr_Occurred())
+        r = -1;
+
+    if (DequeDict_finish(self, r) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+/* presize(n) - reserve room for n more items */
+static PyObject *
+DequeDict_presize_method(DequeDictObject *self, PyObject *arg)
+{
+    Py_ssize_t n = DequeDict_count_arg(arg);
+    if (n < 0 || DequeDict_presize(self, n) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+/* get(key, default=None) */
+static PyObject *
+DequeDict_get(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    if (!DequeDict_check_nargs("get", nargs, 1, 2))
+        return NULL;
+    PyObject *key = args[0];
+    PyObject *default_val = nargs > 1 ? args[1] : Py_None;
+
+    Py_ssize_t ix;
+    int found = DequeDict_find_live(self, key, NULL, &ix, NULL);
+    if (found <= 0) {
+        if (found == 0)
+            Py_INCREF(default_val);
+        return DequeDict_finish_object(self, found < 0 ? NULL : default_val);
+    }
+
+    if (self->policy)
+        DequeDict_policy_hit(self, ix);
+    PyObject *value = ENTRY(self, ix)->value;
+    Py_INCREF(value);
+    return value;
+}
+
+/* get_and_touch(key, default=None) - get() that moves a hit to the end,
+ * or under a policy records it like any other hit */
+static PyObject *
+DequeDict_get_and_touch(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    if (!DequeDict_check_nargs("get_and_touch", nargs, 1, 2))
+        return NULL;
+    PyObject *key = args[0];
+    PyObject *default_val = nargs > 1 ? args[1] : Py_None;
+
+    Py_ssize_t ix;
+    int found = DequeDict_find_live(self, key, NULL, &ix, NULL);
+    if (found <= 0) {
+        if (found == 0)
+            Py_INCREF(default_val);
+        return DequeDict_finish_object(self, found < 0 ? NULL : default_val);
+    }
+
+    if (self->policy)
+        DequeDict_policy_hit(self, ix);
+    else
+        DequeDict_touch_entry(self, ix);
+    PyObject *value = ENTRY(self, ix)->value;
+    Py_INCREF(value);
+    return value;
+}
+
+/* Known-hash operations, for callers that look the same key up in several
+ * containers and hash it once. hash must be PyObject_Hash(key); they back
+ * the *_with_hash() methods and the C API. */
+
+/* get(): 1 with a new reference in *result, 0 if absent, -1 on error */
+static int
+DequeDict_get_known_hash(DequeDictObject *self, PyObject *key, Py_hash_t hash, PyObject **result)
+{
+    Py_ssize_t ix;
+    *result = NULL;
+    int found = DequeDict_lookup_live(self, key, hash, &ix, NULL);
+    if (found <= 0)
+        return DequeDict_finish(self, found);
+
+    if (self->policy)
+        DequeDict_policy_hit(self, ix);
+    *result = ENTRY(self, ix)->value;
+    Py_INCREF(*result);
+    return 1;
+}
+
+/* self[key] = value: 0, or -1 on error */
+static int
+DequeDict_set_known_hash(DequeDictObject *self, PyObject *key, Py_hash_t hash, PyObject *value)
+{
+    if (DequeDict_tick(self) < 0)
+        return -1;
+    return DequeDict_finish(self, DequeDict_set_hash(self, key, hash, value));
+}
+
+/* pop(key): 1 with the value in *result, 0 if absent, -1 on error */
+static int
+DequeDict_pop_known_hash(DequeDictObject *self, PyObject *key, Py_hash_t hash, PyObject **result)
+{
+    Py_ssize_t ix, slot;
+    *result = NULL;
+    int found = DequeDict_lookup(self, key, hash, &ix, &slot);
+    if (found <= 0)
+        return found;
+    *result = DequeDict_detach(self, ix, slot);
+    return *result ? 1 : -1;
+}
+
+/* The h argument of the *_with_hash() methods */
+static inline Py_hash_t
+DequeDict_hash_arg(PyObject *arg)
+{
+    Py_hash_t hash = PyLong_AsSsize_t(arg);
+    if (hash == -1 && !PyErr_Occurred())
+        PyErr_SetString(PyExc_ValueError, "-1 is never a valid hash");
+    return hash;
+}
+
+/* get_with_hash(key, h, default=None) - get() with h == hash(key) */
+static PyObject *
+DequeDict_get_with_hash(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    if (!DequeDict_check_nargs("get_with_hash", nargs, 2, 3))
+        return NULL;
+    Py_hash_t hash = DequeDict_hash_arg(args[1]);
+    if (hash == -1)
+        return NULL;
+
+    PyObject *value;
+    int found = DequeDict_get_known_hash(self, args[0], hash, &value);
+    if (found == 0) {
+        value = nargs > 2 ? args[2] : Py_None;
+        Py_INCREF(value);
+    }
+    return value;
+}
+
+/* set_with_hash(key, h, value) - self[key] = value with h == hash(key) */
+static PyObject *
+DequeDict_set_with_hash(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    if (!DequeDict_check_nargs("set_with_hash", nargs, 3, 3))
+        return NULL;
+    Py_hash_t hash = DequeDict_hash_arg(args[1]);
+    if (hash == -1 || DequeDict_set_known_hash(self, args[0], hash, args[2]) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+/* pop_with_hash(key, h[, default]) - pop(key) with h == hash(key) */
+static PyObject *
+DequeDict_pop_with_hash(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    if (!DequeDict_check_nargs("pop_with_hash", nargs, 2, 3))
+        return NULL;
+    Py_hash_t hash = DequeDict_hash_arg(args[1]);
+    if (hash == -1)
+        return NULL;
+
+    PyObject *value;
+    int found = DequeDict_pop_known_hash(self, args[0], hash, &value);
+    if (found == 0) {
+        if (nargs > 2) {
+            Py_INCREF(args[2]);
+            return args[2];
+        }
+        PyErr_SetObject(PyExc_KeyError, args[0]);
+    }
+    return value;
+}
+
+/* expire_before(ts) - remove the prefix of entries stamped before ts */
+static PyObject *
+DequeDict_expire_before(DequeDictObject *self, PyObject *arg)
+{
+    double ts = PyFloat_AsDouble(arg);
+    if (ts == -1.0 && PyErr_Occurred())
+        return NULL;
+    if (!self->timed) {
+        PyErr_SetString(PyExc_ValueError, "expire_before() needs a DequeDict created with ttl or clock");
+        return NULL;
+    }
+    Py_ssize_t n = DequeDict_expire_prefix(self, ts, 0);
+    return DequeDict_finish_object(self, n < 0 ? NULL : PyLong_FromSsize_t(n));
+}
+
+/* expire(now=None) - remove the prefix of entries older than ttl at now,
+ * reading the clock if now is None */
+static PyObject *
+DequeDict_expire(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    static const char *const kwlist[] = {"now", NULL};
+    PyObject *now_arg = NULL;
+
+    if ((nargs || kwnames)
+        && DequeDict_parse_args("expire", args, nargs, kwnames, kwlist, 1, 0, &now_arg) < 0)
+        return NULL;
+    if (self->ttl == 0) {
+        PyErr_SetString(PyExc_ValueError, "expire() needs a DequeDict created with ttl");
+        return NULL;
+    }
+    double now;
+    if (now_arg && now_arg != Py_None) {
+        now = PyFloat_AsDouble(now_arg);
+        if (now == -1.0 && PyErr_Occurred())
+            return NULL;
+    }
+    else {
+        if (DequeDict_read_clock(self) < 0)
+            return NULL;
+        now = self->now;
+    }
+    Py_ssize_t n = DequeDict_expire_prefix(self, now - self->ttl, 1);
+    return DequeDict_finish_object(self, n < 0 ? NULL : PyLong_FromSsize_t(n));
+}
+
+static int
+DequeDict_check_stats(DequeDictObject *self, const char *name)
+{
+    if (self->stats)
+        return 0;
+    PyErr_Format(PyExc_ValueError, "%s() needs a DequeDict created with stats=True", name);
+    return -1;
+}
+
+/* stats() - the hot-path counters as a dict of name -> int */
+static PyObject *
+DequeDict_stats(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    if (DequeDict_check_stats(self, "stats") < 0)
+        return NULL;
+    PyObject *result = PyDict_New();
+    if (!result) return NULL;
+    for (int i = 0; i < STAT_COUNT; i++) {
+        PyObject *count = PyLong_FromUnsignedLongLong(self->stats[i]);
+        if (!count || PyDict_SetItemString(result, stat_names[i], count) < 0) {
+            Py_XDECREF(count);
+            Py_DECREF(result);
+            return NULL;
+        }
+        Py_DECREF(count);
+    }
+    return result;
+}
+
+/* reset_stats() - zero the counters */
+static PyObject *
+DequeDict_reset_stats(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    if (DequeDict_check_stats(self, "reset_stats") < 0)
+        return NULL;
+    memset(self->stats, 0, STAT_COUNT * sizeof(uint64_t));
+    Py_RETURN_NONE;
+}
+
+/* ========================================================================
+ * Keys/Values/Items Views - O(1) creation, lazy iteration
+ * ======================================================================== */
+
+typedef struct {
+    PyObject_HEAD
+    DequeDictObject *dd;
+    int kind;  /* 0=keys, 1=values, 2=items */
+} DequeDictViewObject;
+
+static PyTypeObject DequeDictKeysView_Type;
+static PyTypeObject DequeDictValuesView_Type;
+static PyTypeObject DequeDictItemsView_Type;
+
+static int
+DequeDictView_traverse(DequeDictViewObject *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->dd);
+    return 0;
+}
+
+static int
+DequeDictView_clear(DequeDictViewObject *self)
+{
+    Py_CLEAR(self->dd);
+    return 0;
+}
+
+static void
+DequeDictView_dealloc(DequeDictViewObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    DequeDictView_clear(self);
+    Py_TYPE(self)->tp_free(self);
+}
+
+static Py_ssize_t
+DequeDictView_len(DequeDictViewObject *self)
+{
+    return self->dd->size;
+}
+
+/* Raised by an iterator whose DequeDict was reordered, grown or shrunk
+ * since the iterator was created */
+static PyObject *
+DequeDict_mutated_error(void)
+{
+    PyErr_SetString(PyExc_RuntimeError, "DequeDict mutated during iteration");
+    return NULL;
+}
+
+/* View iterator */
+typedef struct {
+    PyObject_HEAD
+    DequeDictObject *dd;
+    Py_ssize_t current;     /* Next entry number, or LINK_NONE */
+    uint64_t version;       /* dd->version when created */
+    int kind;
+    int reverse;  /* 0=forward (->next), 1=reverse (->prev) */
+} DequeDictViewIterObject;
+
+static PyTypeObject DequeDictViewIter_Type;
+
+static int
+DequeDictViewIter_traverse(DequeDictViewIterObject *it, visitproc visit, void *arg)
+{
+    Py_VISIT(it->dd);
+    return 0;
+}
+
+static int
+DequeDictViewIter_clear(DequeDictViewIterObject *it)
+{
+    Py_CLEAR(it->dd);
+    return 0;
+}
+
+static void
+DequeDictViewIter_dealloc(DequeDictViewIterObject *it)
+{
+    PyObject_GC_UnTrack(it);
+    DequeDictViewIter_clear(it);
+    Py_TYPE(it)->tp_free(it);
+}
+
+static PyObject *
+DequeDictViewIter_next(DequeDictViewIterObject *it)
+{
+    if (it->current == LINK_NONE) return NULL;
+    if (it->version != it->dd->version)
+        return DequeDict_mutated_error();
+
+    DequeDictEntry *entry = ENTRY(it->dd, it->current);
+    PyObject *result;
+    if (it->kind == 0) {
+        result = entry->key;
+        Py_INCREF(result);
+    } else if (it->kind == 1) {
+        result = entry->value;
+        Py_INCREF(result);
+    } else {
+        result = PyTuple_Pack(2, entry->key, entry->value);
+    }
+
+    it->current = it->reverse ? entry->prev : entry->next;
+    return result;
+}
+
+static PyObject *
+DequeDictView_iter(DequeDictViewObject *self)
+{
+    DequeDictViewIterObject *it = PyObject_GC_New(DequeDictViewIterObject, &DequeDictViewIter_Type);
+    if (!it) return NULL;
+
+    Py_INCREF(self->dd);
+    it->dd = self->dd;
+    it->current = self->dd->head;
+    it->version = self->dd->version;
+    it->kind = self->kind;
+    it->reverse = 0;
+    PyObject_GC_Track(it);
+    return (PyObject *)it;
+}
+
+static PyObject *
+DequeDictView_reversed(DequeDictViewObject *self)
+{
+    DequeDictViewIterObject *it = PyObject_GC_New(DequeDictViewIterObject, &DequeDictViewIter_Type);
+    if (!it) return NULL;
+
+    Py_INCREF(self->dd);
+    it->dd = self->dd;
+    it->current = self->dd->tail;
+    it->version = self->dd->version;
+    it->kind = self->kind;
+    it->reverse = 1;
+    PyObject_GC_Track(it);
+    return (PyObject *)it;
+}
+
+static int
+DequeDictKeysView_contains(DequeDictViewObject *self, PyObject *key)
+{
+    return DequeDict_contains(self->dd, key);
+}
+
+static int
+DequeDictValuesView_contains(DequeDictViewObject *self, PyObject *value)
+{
+    DequeDictObject *dd = self->dd;
+    if (dd->track_values) {
+        Py_hash_t vh = PyObject_Hash(value);
+        if (vh == -1) {
+            /* Tracked values are all hashable */
+            if (!PyErr_ExceptionMatches(PyExc_TypeError))
+                return -1;
+            PyErr_Clear();
+            return 0;
+        }
+        Py_ssize_t slot = -1, ix;
+        size_t perturb = 0;
+        return vindex_next(dd, value, vh, &slot, &perturb, &ix);
+    }
+    Py_ssize_t ix = dd->head;
+    while (ix != LINK_NONE) {
+        PyObject *entry_value = ENTRY(dd, ix)->value;
+        Py_INCREF(entry_value);
+        int cmp = PyObject_RichCompareBool(entry_value, value, Py_EQ);
+        Py_DECREF(entry_value);
+        if (cmp != 0) return cmp;
+        if (!ENTRY_LIVE(dd, ix)) break;     /* Mutated by __eq__ */
+        ix = ENTRY(dd, ix)->next;
+    }
+    return 0;
+}
+
+static int
+DequeDictItemsView_contains(DequeDictViewObject *self, PyObject *item)
+{
+    if (!PyTuple_Check(item) || PyTuple_GET_SIZE(item) != 2)
+        return 0;
+
+    PyObject *key = PyTuple_GET_ITEM(item, 0);
+    PyObject *value = PyTuple_GET_ITEM(item, 1);
+
+    Py_ssize_t ix;
+    int found = DequeDict_find(self->dd, key, NULL, &ix, NULL);
+    if (found <= 0) return found;
+
+    PyObject *entry_value = ENTRY(self->dd, ix)->value;
+    Py_INCREF(entry_value);
+    int cmp = PyObject_RichCompareBool(entry_value, value, Py_EQ);
+    Py_DECREF(entry_value);
+    return cmp;
+}
+
+DEQUEDICT_LOCKED(Py_ssize_t, DequeDictView_len, self->dd, (DequeDictViewObject *self), (self))
+DEQUEDICT_LOCKED(int, DequeDictKeysView_contains, self->dd,
+                 (DequeDictViewObject *self, PyObject *key), (self, key))
+DEQUEDICT_LOCKED(int, DequeDictValuesView_contains, self->dd,
+                 (DequeDictViewObject *self, PyObject *value), (self, value))
+DEQUEDICT_LOCKED(int, DequeDictItemsView_contains, self->dd,
+                 (DequeDictViewObject *self, PyObject *item), (self, item))
+DEQUEDICT_LOCKED(PyObject *, DequeDictView_iter, self->dd, (DequeDictViewObject *self), (self))
+DEQUEDICT_LOCKED(PyObject *, DequeDictView_reversed, self->dd,
+                 (DequeDictViewObject *self, PyObject *Py_UNUSED(args)), (self))
+DEQUEDICT_LOCKED(PyObject *, DequeDictViewIter_next, it->dd, (DequeDictViewIterObject *it), (it))
+
+static PySequenceMethods DequeDictKeysView_as_seq = {
+    .sq_length = (lenfunc)DequeDictView_len_locked,
+    .sq_contains = (objobjproc)DequeDictKeysView_contains_locked,
+};
+
+static PySequenceMethods DequeDictValuesView_as_seq = {
+    .sq_length = (lenfunc)DequeDictView_len_locked,
+    .sq_contains = (objobjproc)DequeDictValuesView_contains_locked,
+};
+
+static PySequenceMethods DequeDictItemsView_as_seq = {
+    .sq_length = (lenfunc)DequeDictView_len_locked,
+    .sq_contains = (objobjproc)DequeDictItemsView_contains_locked,
+};
+
+static PyMethodDef DequeDictKeysView_methods[] = {
+    {"__reversed__", (PyCFunction)DequeDictView_reversed_locked, METH_NOARGS, NULL},
+    {NULL}
+};
+
+static PyMethodDef DequeDictValuesView_methods[] = {
+    {"__reversed__", (PyCFunction)DequeDictView_reversed_locked, METH_NOARGS, NULL},
+    {NULL}
+};
+
+static PyMethodDef DequeDictItemsView_methods[] = {
+    {"__reversed__", (PyCFunction)DequeDictView_reversed_locked, METH_NOARGS, NULL},
+    {NULL}
+};
+
+/* Set operations on keys and items views. Like dict views they return a
+ * plain set, so the walk order is not kept; dd | other is the ordered
+ * merge. Between two views of the same kind they walk one entry list and
+ * probe the other DequeDict's index with the cached hashes, so keys are
+ * not hashed again and no intermediate set is built; & walks the smaller
+ * side. Other operands go through iteration and `in`, like dict views. */
+
+static inline int
+DequeDictView_set_check(PyObject *op)
+{
+    return Py_IS_TYPE(op, &DequeDictKeysView_Type) || Py_IS_TYPE(op, &DequeDictItemsView_Type);
+}
+
+/* Add to result each key (or item) of dd whose presence in other is keep */
+static int
+DequeDictView_walk_lock_held(DequeDictObject *dd, DequeDictObject *other, int items, int keep,
+                             PyObject *result)
+{
+    uint64_t version = dd->version;
+    Py_ssize_t ix = dd->head;
+    while (ix != LINK_NONE) {
+        DequeDictEntry *entry = ENTRY(dd, ix);
+        PyObject *key = entry->key;
+        PyObject *value = entry->value;
+        Py_INCREF(key);
+        Py_INCREF(value);
+
+        Py_ssize_t oix;
+        int r = DequeDict_lookup(other, key, entry->hash, &oix, NULL);
+        if (r > 0 && items) {
+            PyObject *other_value = ENTRY(other, oix)->value;
+            Py_INCREF(other_value);
+            r = PyObject_RichCompareBool(other_value, value, Py_EQ);
+            Py_DECREF(other_value);
+        }
+        if (r >= 0 && r == keep) {
+            if (items) {
+                PyObject *item = PyTuple_Pack(2, key, value);
+                r = item ? PySet_Add(result, item) : -1;
+                Py_XDECREF(item);
+            }
+            else
+                r = PySet_Add(result, key);
+        }
+        Py_DECREF(key);
+        Py_DECREF(value);
+        if (r < 0)
+            return -1;
+        /* __eq__ and __hash__ may have run */
+        if (dd->version != version) {
+            DequeDict_mutated_error();
+            return -1;
+        }
+        ix = ENTRY(dd, ix)->next;
+    }
+    return 0;
+}
+
+static int
+DequeDictView_walk(DequeDictViewObject *self, DequeDictViewObject *other, int keep, PyObject *result)
+{
+    int r;
+    Py_BEGIN_CRITICAL_SECTION2(self->dd, other->dd);
+    r = DequeDictView_walk_lock_held(self->dd, other->dd, self->kind == 2, keep, result);
+    Py_END_CRITICAL_SECTION2();
+    return r;
+}
+
+/* Both operands are views of the same kind (keys or items) */
+static inline int
+DequeDictView_same_kind(PyObject *a, PyObject *b)
+{
+    return DequeDictView_set_check(a) && Py_IS_TYPE(b, Py_TYPE(a));
+}
+
+/* Add each item of iterable whose presence in container is keep; with
+ * container NULL, add every item */
+static int
+DequeDictView_add_iter(PyObject *result, PyObject *iterable, PyObject *container, int keep)
+{
+    PyObject *iter = PyObject_GetIter(iterable);
+    if (!iter) return -1;
+    PyObject *item;
+    int r = 0;
+    while (r >= 0 && (item = PyIter_Next(iter)) != NULL) {
+        r = container ? PySequence_Contains(container, item) : keep;
+        if (r >= 0 && r == keep)
+            r = PySet_Add(result, item);
+        Py_DECREF(item);
+    }
+    Py_DECREF(iter);
+    return r < 0 || PyErr_Occurred() ? -1 : 0;
+}
+
+static PyObject *
+DequeDictView_set_result(PyObject *result, int r)
+{
+    if (r < 0) {
+        Py_DECREF(result);
+        return NULL;
+    }
+    return result;
+}
+
+/* view & other */
+static PyObject *
+DequeDictView_and(PyObject *a, PyObject *b)
+{
+    PyObject *result = PySet_New(NULL);
+    if (!result) return NULL;
+    int r;
+    if (DequeDictView_same_kind(a, b)) {
+        DequeDictViewObject *small = (DequeDictViewObject *)a, *large = (DequeDictViewObject *)b;
+        if (small->dd->size > large->dd->size) {
+            small = (DequeDictViewObject *)b;
+            large = (DequeDictViewObject *)a;
+        }
+        r = DequeDictView_walk(small, large, 1, result);
+    }
+    else if (DequeDictView_set_check(a))
+        r = DequeDictView_add_iter(result, b, a, 1);
+    else
+        r = DequeDictView_add_iter(result, a, b, 1);
+    return DequeDictView_set_result(result, r);
+}
+
+/* view | other */
+static PyObject *
+DequeDictView_or(PyObject *a, PyObject *b)
+{
+    PyObject *result = PySet_New(a);
+    if (!result) return NULL;
+    return DequeDictView_set_result(result, DequeDictView_add_iter(result, b, NULL, 1));
+}
+
+/* view - other, and other - view */
+static PyObject *
+DequeDictView_sub(PyObject *a, PyObject *b)
+{
+    PyObject *result;
+    int r;
+    if (DequeDictView_same_kind(a, b)) {
+        if (!(result = PySet_New(NULL))) return NULL;
+        r = DequeDictView_walk((DequeDictViewObject *)a, (DequeDictViewObject *)b, 0, result);
+    }
+    else if (DequeDictView_set_check(b) || PyAnySet_Check(b)) {
+        if (!(result = PySet_New(NULL))) return NULL;
+        r = DequeDictView_add_iter(result, a, b, 0);
+    }
+    else {
+        /* b may be a one-shot iterator: discard its items instead */
+        if (!(result = PySet_New(a))) return NULL;
+        PyObject *iter = PyObject_GetIter(b);
+        if (!iter)
+            return DequeDictView_set_result(result, -1);
+        PyObject *item;
+        r = 0;
+        while (r >= 0 && (item = PyIter_Next(iter)) != NULL) {
+            r = PySet_Discard(result, item);
+            Py_DECREF(item);
+        }
+        Py_DECREF(iter);
+        if (PyErr_Occurred())
+            r = -1;
+    }
+    return DequeDictView_set_result(result, r);
+}
+
+/* view ^ other */
+static PyObject *
+DequeDictView_xor(PyObject *a, PyObject *b)
+{
+    PyObject *result = PySet_New(NULL);
+    if (!result) return NULL;
+    int r;
+    if (DequeDictView_same_kind(a, b)) {
+        r = DequeDictView_walk((DequeDictViewObject *)a, (DequeDictViewObject *)b, 0, result);
+        if (r == 0)
+            r = DequeDictView_walk((DequeDictViewObject *)b, (DequeDictViewObject *)a, 0, result);
+        return DequeDictView_set_result(result, r);
+    }
+
+    /* A set of the other side, probed both ways */
+    PyObject *view = a, *other = b;
+    if (!DequeDictView_set_check(a)) {
+        view = b;
+        other = a;
+    }
+    if (PyAnySet_Check(other))
+        Py_INCREF(other);
+    else if (!(other = PySet_New(other)))
+        return DequeDictView_set_result(result, -1);
+    r = DequeDictView_add_iter(result, view, other, 0);
+    if (r == 0)
+        r = DequeDictView_add_iter(result, other, view, 0);
+    Py_DECREF(other);
+    return DequeDictView_set_result(result, r);
+}
+
+static PyNumberMethods DequeDictView_as_number = {
+    .nb_subtract = DequeDictView_sub,
+    .nb_and = DequeDictView_and,
+    .nb_xor = DequeDictView_xor,
+    .nb_or = DequeDictView_or,
+};
+
+static PyTypeObject DequeDictViewIter_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "dequedict.DequeDictViewIter",
+    .tp_basicsize = sizeof(DequeDictViewIterObject),
+    .tp_dealloc = (destructor)DequeDictViewIter_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_traverse = (traverseproc)DequeDictViewIter_traverse,
+    .tp_clear = (inquiry)DequeDictViewIter_clear,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc)DequeDictViewIter_next_locked,
+};
+
+static PyTypeObject DequeDictKeysView_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "dequedict.DequeDictKeys",
+    .tp_basicsize = sizeof(DequeDictViewObject),
+    .tp_dealloc = (destructor)DequeDictView_dealloc,
+    .tp_as_number = &DequeDictView_as_number,
+    .tp_as_sequence = &DequeDictKeysView_as_seq,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_traverse = (traverseproc)DequeDictView_traverse,
+    .tp_clear = (inquiry)DequeDictView_clear,
+    .tp_iter = (getiterfunc)DequeDictView_iter_locked,
+    .tp_methods = DequeDictKeysView_methods,
+};
+
+static PyTypeObject DequeDictValuesView_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "dequedict.DequeDictValues",
+    .tp_basicsize = sizeof(DequeDictViewObject),
+    .tp_dealloc = (destructor)DequeDictView_dealloc,
+    .tp_as_sequence = &DequeDictValuesView_as_seq,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_traverse = (traverseproc)DequeDictView_traverse,
+    .tp_clear = (inquiry)DequeDictView_clear,
+    .tp_iter = (getiterfunc)DequeDictView_iter_locked,
+    .tp_methods = DequeDictValuesView_methods,
+};
+
+static PyTypeObject DequeDictItemsView_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "dequedict.DequeDictItems",
+    .tp_basicsize = sizeof(DequeDictViewObject),
+    .tp_dealloc = (destructor)DequeDictView_dealloc,
+    .tp_as_number = &DequeDictView_as_number,
+    .tp_as_sequence = &DequeDictItemsView_as_seq,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_traverse = (traverseproc)DequeDictView_traverse,
+    .tp_clear = (inquiry)DequeDictView_clear,
+    .tp_iter = (getiterfunc)DequeDictView_iter_locked,
+    .tp_methods = DequeDictItemsView_methods,
+};
+
+/* keys() - O(1) returns view */
+static PyObject *
+DequeDict_keys(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    DequeDictViewObject *view = PyObject_GC_New(DequeDictViewObject, &DequeDictKeysView_Type);
+    if (!view) return NULL;
+    Py_INCREF(self);
+    view->dd = self;
+    view->kind = 0;
+    PyObject_GC_Track(view);
+    return (PyObject *)view;
+}
+
+/* values() - O(1) returns view */
+static PyObject *
+DequeDict_values(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    DequeDictViewObject *view = PyObject_GC_New(DequeDictViewObject, &DequeDictValuesView_Type);
+    if (!view) return NULL;
+    Py_INCREF(self);
+    view->dd = self;
+    view->kind = 1;
+    PyObject_GC_Track(view);
+    return (PyObject *)view;
+}
+
+/* items() - O(1) returns view */
+static PyObject *
+DequeDict_items(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    DequeDictViewObject *view = PyObject_GC_New(DequeDictViewObject, &DequeDictItemsView_Type);
+    if (!view) return NULL;
+    Py_INCREF(self);
+    view->dd = self;
+    view->kind = 2;
+    PyObject_GC_Track(view);
+    return (PyObject *)view;
+}
+
+/* clear() - Python method */
+static PyObject *
+DequeDict_clear_method(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    DequeDict_clear(self);
+    Py_RETURN_NONE;
+}
+
+/* maxsize/on_evict/touch/gc_tracking/ttl/clock/stats/policy/track_values as constructor keywords,
+ * for copy() */
+static PyObject *
+DequeDict_options(DequeDictObject *self)
+{
+    PyObject *kwds = PyDict_New();
+    if (!kwds) return NULL;
+    if (self->maxsize != PY_SSIZE_T_MAX) {
+        PyObject *maxsize = PyLong_FromSsize_t(self->maxsize);
+        if (!maxsize || PyDict_SetItemString(kwds, "maxsize", maxsize) < 0) {
+            Py_XDECREF(maxsize);
+            Py_DECREF(kwds);
+            return NULL;
+        }
+        Py_DECREF(maxsize);
+    }
+    if (self->on_evict && PyDict_SetItemString(kwds, "on_evict", self->on_evict) < 0) {
+        Py_DECREF(kwds);
+        return NULL;
+    }
+    if (self->touch && PyDict_SetItemString(kwds, "touch", Py_True) < 0) {
+        Py_DECREF(kwds);
+        return NULL;
+    }
+    if (self->gc_mode == GC_NEVER && PyDict_SetItemString(kwds, "gc_tracking", Py_False) < 0) {
+        Py_DECREF(kwds);
+        return NULL;
+    }
+    if (self->ttl > 0) {
+        PyObject *ttl = PyFloat_FromDouble(self->ttl);
+        if (!ttl || PyDict_SetItemString(kwds, "ttl", ttl) < 0) {
+            Py_XDECREF(ttl);
+            Py_DECREF(kwds);
+            return NULL;
+        }
+        Py_DECREF(ttl);
+    }
+    if ((self->clock || (self->timed && self->ttl == 0))
+        && PyDict_SetItemString(kwds, "clock", self->clock ? self->clock : time_monotonic) < 0) {
+        Py_DECREF(kwds);
+        return NULL;
+    }
+    if (self->stats && PyDict_SetItemString(kwds, "stats", Py_True) < 0) {
+        Py_DECREF(kwds);
+        return NULL;
+    }
+    if (self->track_values && PyDict_SetItemString(kwds, "track_values", Py_True) < 0) {
+        Py_DECREF(kwds);
+        return NULL;
+    }
+    if (self->policy) {
+        PyObject *policy = PyUnicode_FromString(policy_names[(int)self->policy]);
+        if (!policy || PyDict_SetItemString(kwds, "policy", policy) < 0) {
+            Py_XDECREF(policy);
+            Py_DECREF(kwds);
+            return NULL;
+        }
+        Py_DECREF(policy);
+    }
+    return kwds;
+}
+
+/* Empty type(*args, **options) with the options of self; steals args */
+static PyObject *
+DequeDict_new_like(DequeDictObject *self, PyObject *type, PyObject *args)
+{
+    if (!args) return NULL;
+    PyObject *kwds = DequeDict_options(self);
+    if (!kwds) {
+        Py_DECREF(args);
+        return NULL;
+    }
+    PyObject *result = PyObject_Call(type, args, kwds);
+    Py_DECREF(args);
+    Py_DECREF(kwds);
+    if (!result) return NULL;
+    if (!PyObject_TypeCheck(result, &DequeDict_Type)) {
+        PyErr_Format(PyExc_TypeError, "copy() expected a DequeDict, got %.200s",
+                     Py_TYPE(result)->tp_name);
+        Py_DECREF(result);
+        return NULL;
+    }
+    return result;
+}
+
+/* type(*args, **options) loaded with a clone of self - copy() of DequeDict
+ * and subtypes; steals args */
+static PyObject *
+DequeDict_copy_as(DequeDictObject *self, PyObject *type, PyObject *args)
+{
+    PyObject *result = DequeDict_new_like(self, type, args);
+    if (!result) return NULL;
+
+    DequeDictObject *copy = (DequeDictObject *)result;
+    int r = DequeDict_tick(copy);
+    if (r == 0)
+        r = DequeDict_merge_dequedict(copy, self);
+    if (DequeDict_finish(copy, r) < 0) {
+        Py_DECREF(result);
+        return NULL;
+    }
+    return result;
+}
+
+/* copy() - keeps maxsize, on_evict and touch */
+static PyObject *
+DequeDict_copy(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    return DequeDict_copy_as(self, (PyObject *)&DequeDict_Type, PyTuple_New(0));
+}
+
+/* update(other) */
+static PyObject *
+DequeDict_update(DequeDictObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *other = NULL;
+
+    if (!PyArg_ParseTuple(args, "|O", &other) || DequeDict_tick(self) < 0)
+        return NULL;
+
+    int r = 0;
+    if (other)
+        r = DequeDict_merge(self, other, "update requires sequence of (key, value) pairs");
+
+    /* Process keyword arguments */
+    if (r == 0 && kwds) {
+        PyObject *key, *value;
+        Py_ssize_t pos = 0;
+        while (PyDict_Next(kwds, &pos, &key, &value)) {
+            if ((r = DequeDict_set(self, key, value)) < 0)
+                break;
+        }
+    }
+
+    if (DequeDict_finish(self, r) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+/* Merge other into a copy for |, returning the copy */
+static PyObject *
+DequeDict_merged(PyObject *copy, PyObject *other)
+{
+    if (!copy) return NULL;
+    DequeDictObject *result = (DequeDictObject *)copy;
+    if (DequeDict_finish(result, DequeDict_merge(result, other, "| requires a mapping")) < 0) {
+        Py_DECREF(copy);
+        return NULL;
+    }
+    return copy;
+}
+
+static PyObject *DequeDict_ctor_args(DequeDictObject *self);
+
+/* type(self)(*ctor_args, **options) for | - a clone of self, or empty */
+static PyObject *
+DequeDict_or_base(DequeDictObject *self, int clone)
+{
+    PyObject *type = (PyObject *)Py_TYPE(self);
+    PyObject *args = DequeDict_ctor_args(self);
+    return clone ? DequeDict_copy_as(self, type, args) : DequeDict_new_like(self, type, args);
+}
+DEQUEDICT_LOCKED(PyObject *, DequeDict_or_base, self, (DequeDictObject *self, int clone), (self, clone))
+
+/* self | other - clone of self (keeping type and options) updated with a
+ * dict or DequeDict; dict | self loads the dict, then self, into an empty
+ * instance of self's type and options, like OrderedDict. Goes through the
+ * C copy path, not an overridable copy(). */
+static PyObject *
+DequeDict_or(PyObject *a, PyObject *b)
+{
+    int a_dd = PyObject_TypeCheck(a, &DequeDict_Type);
+    PyObject *other = a_dd ? b : a;
+    if (!PyObject_TypeCheck(other, &DequeDict_Type) && !PyDict_Check(other))
+        Py_RETURN_NOTIMPLEMENTED;
+
+    if (a_dd)
+        return DequeDict_merged(DequeDict_or_base_locked((DequeDictObject *)a, 1), b);
+    return DequeDict_merged(DequeDict_merged(DequeDict_or_base_locked((DequeDictObject *)b, 0), a), b);
+}
+
+/* self |= other - update() from a mapping or iterable of pairs */
+static PyObject *
+DequeDict_ior(DequeDictObject *self, PyObject *other)
+{
+    int r = DequeDict_merge(self, other, "|= requires sequence of (key, value) pairs");
+    if (DequeDict_finish(self, r) < 0)
+        return NULL;
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+/* setdefault(key, default=None) */
+static PyObject *
+DequeDict_setdefault(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    if (!DequeDict_check_nargs("setdefault", nargs, 1, 2))
+        return NULL;
+    PyObject *key = args[0];
+    PyObject *default_val = nargs > 1 ? args[1] : Py_None;
+
+    Py_hash_t hash;
+    Py_ssize_t ix;
+    int found = DequeDict_find_live(self, key, &hash, &ix, NULL);
+    if (found < 0)
+        return DequeDict_finish_object(self, NULL);
+    if (found) {
+        if (self->policy)
+            DequeDict_policy_hit(self, ix);
+        PyObject *value = ENTRY(self, ix)->value;
+        Py_INCREF(value);
+        return value;
+    }
+
+    /* Key doesn't exist - add it */
+    if (DequeDict_finish(self, DequeDict_append_new(self, key, hash, default_val)) < 0)
+        return NULL;
+
+    Py_INCREF(default_val);
+    return default_val;
+}
+
+/* keys_for(value) - list of the keys mapped to value: O(matches) from the
+ * value index under track_values, in no particular order, else a scan in
+ * list order */
+static PyObject *
+DequeDict_keys_for(DequeDictObject *self, PyObject *value)
+{
+    PyObject *keys = PyList_New(0);
+    if (!keys) return NULL;
+
+    if (self->track_values) {
+        Py_hash_t vh = PyObject_Hash(value);
+        if (vh == -1) {
+            if (!PyErr_ExceptionMatches(PyExc_TypeError)) {
+                Py_DECREF(keys);
+                return NULL;
+            }
+            PyErr_Clear();
+            return keys;
+        }
+        Py_ssize_t slot = -1, ix;
+        size_t perturb = 0;
+        int r;
+        while ((r = vindex_next(self, value, vh, &slot, &perturb, &ix)) > 0) {
+            if (PyList_Append(keys, ENTRY(self, ix)->key) < 0) {
+                r = -1;
+                break;
+            }
+        }
+        if (r < 0) {
+            Py_DECREF(keys);
+            return NULL;
+        }
+        return keys;
+    }
+
+    uint64_t version = self->version;
+    Py_ssize_t ix = self->head;
+    while (ix != LINK_NONE) {
+        DequeDictEntry *entry = ENTRY(self, ix);
+        PyObject *entry_value = entry->value;
+        int cmp = 1;
+        if (entry_value != value) {
+            Py_INCREF(entry_value);
+            cmp = PyObject_RichCompareBool(entry_value, value, Py_EQ);
+            Py_DECREF(entry_value);
+            if (cmp < 0) {
+                Py_DECREF(keys);
+                return NULL;
+            }
+            if (self->version != version) {
+                Py_DECREF(keys);
+                return DequeDict_mutated_error();
+            }
+            entry = ENTRY(self, ix);
+        }
+        if (cmp && PyList_Append(keys, entry->key) < 0) {
+            Py_DECREF(keys);
+            return NULL;
+        }
+        ix = entry->next;
+    }
+    return keys;
+}
+
+/* remove_value(value) - delete every key mapped to value, return how many */
+static PyObject *
+DequeDict_remove_value(DequeDictObject *self, PyObject *value)
+{
+    PyObject *keys = DequeDict_keys_for(self, value);
+    if (!keys) return NULL;
+
+    /* Look each key up again: dropping a value may run arbitrary code */
+    Py_ssize_t removed = 0;
+    for (Py_ssize_t i = 0; i < PyList_GET_SIZE(keys); i++) {
+        Py_ssize_t ix, slot;
+        int found = DequeDict_find(self, PyList_GET_ITEM(keys, i), NULL, &ix, &slot);
+        if (found < 0) {
+            Py_DECREF(keys);
+            return NULL;
+        }
+        if (found) {
+            Py_DECREF(DequeDict_detach(self, ix, slot));
+            removed++;
+        }
+    }
+    Py_DECREF(keys);
+    return PyLong_FromSsize_t(removed);
+}
+
+/* __sizeof__() - object plus its entry array, hash index, cache, treap and
+ * side arrays (skip-list towers are left out) */
+static PyObject *
+DequeDict_sizeof(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    Py_ssize_t res = Py_TYPE(self)->tp_basicsize;
+    res += self->entries_alloc * sizeof(DequeDictEntry);
+    if (self->table)
+        res += (self->table_mask + 1) * sizeof(int32_t);
+    res += self->cache_capacity * sizeof(DequeDictLink);
+    if (self->rank)
+        res += self->entries_alloc * sizeof(DequeDictRankNode);
+    if (self->stamps)
+        res += self->entries_alloc * sizeof(double);
+    if (self->stats)
+        res += STAT_COUNT * sizeof(uint64_t);
+    if (self->meta)
+        res += self->entries_alloc;
+    if (self->ghost)
+        res += (self->ghost_mask + 1) * sizeof(uint32_t);
+    if (self->vhashes)
+        res += self->entries_alloc * sizeof(Py_hash_t);
+    if (self->vtable)
+        res += (self->vmask + 1) * sizeof(int32_t);
+    if (self->skip_ends)
+        res += SKIP_LEVELS * sizeof(DequeDictSkipLink) + self->entries_alloc * sizeof(DequeDictScore);
+    return PyLong_FromSsize_t(res);
+}
+
+/* __class_getitem__(params) - support generic subscript syntax e.g. DequeDict[str, int] */
+static PyObject *
+DequeDict_class_getitem(PyObject *cls, PyObject *args)
+{
+    return Py_GenericAlias(cls, args);
+}
+
+/* Value at position index (negative counts from the end), new reference */
+static PyObject *
+DequeDict_at_index(DequeDictObject *self, Py_ssize_t index)
+{
+    /* Build cache if needed */
+    if (!self->index_cache) {
+        if (DequeDict_rebuild_cache(self) < 0)
+            return NULL;
+        if (!self->index_cache) {
+            /* Empty dict, size==0, no cache allocated */
+            PyErr_SetString(PyExc_IndexError, "index out of range");
+            return NULL;
+        }
+    }
+
+    self->cache_debt = 0;
+    Py_ssize_t logical_size = self->cache_size - self->cache_offset;
+
+    if (index < 0)
+        index += logical_size;
+
+    if (index < 0 || index >= logical_size) {
+        PyErr_SetString(PyExc_IndexError, "index out of range");
+        return NULL;
+    }
+
+    PyObject *value = ENTRY(self, self->index_cache[self->cache_offset + index])->value;
+    Py_INCREF(value);
+    return value;
+}
+
+/* at(index) - O(1) via entry number cache */
+static PyObject *
+DequeDict_at(DequeDictObject *self, PyObject *arg)
+{
+    Py_ssize_t index;
+
+    if (DequeDict_index_arg(arg, &index) < 0)
+        return NULL;
+    return DequeDict_at_index(self, index);
+}
+
+/* Move key to the back (last) or the front: 0, or -1 with KeyError if absent */
+static int
+DequeDict_move_key(DequeDictObject *self, PyObject *key, int last)
+{
+    Py_ssize_t ix;
+    int found = DequeDict_find(self, key, NULL, &ix, NULL);
+    if (found <= 0) {
+        if (found == 0)
+            PyErr_SetObject(PyExc_KeyError, key);
+        return -1;
+    }
+
+    /* Already at the right position? */
+    if ((last && ix == self->tail) || (!last && ix == self->head))
+        return 0;
+
+    DequeDict_unlink(self, ix);
+    DequeDict_cache_remove(self, ix);
+
+    if (last) {
+        DequeDict_link_tail(self, ix);
+        DequeDict_cache_append(self, ix);
+    } else {
+        DequeDict_link_head(self, ix);
+        DequeDict_cache_prepend(self, ix);
+    }
+
+    return 0;
+}
+
+/* move_to_end(key, last=True) - O(1) move key to front or back */
+static PyObject *
+DequeDict_move_to_end(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs,
+                      PyObject *kwnames)
+{
+    static const char *const kwlist[] = {"key", "last", NULL};
+    PyObject *argv[2] = {NULL, NULL};
+    int last = 1;
+
+    if (nargs == 1 && !kwnames)
+        argv[0] = args[0];
+    else if (DequeDict_parse_args("move_to_end", args, nargs, kwnames, kwlist, 2, 1, argv) < 0)
+        return NULL;
+    if (argv[1] && (last = PyObject_IsTrue(argv[1])) < 0)
+        return NULL;
+    if (DequeDict_move_key(self, argv[0], last) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+/* index_of(key) - O(log n) position of key */
+static PyObject *
+DequeDict_index_of(DequeDictObject *self, PyObject *key)
+{
+    Py_ssize_t ix;
+    int found = DequeDict_find(self, key, NULL, &ix, NULL);
+    if (found <= 0) {
+        if (found == 0)
+            PyErr_SetObject(PyExc_KeyError, key);
+        return NULL;
+    }
+
+    if (ix == self->head)
+        return PyLong_FromSsize_t(0);
+    if (ix == self->tail)
+        return PyLong_FromSsize_t(self->size - 1);
+    if (DequeDict_rank_ensure(self) < 0)
+        return NULL;
+    return PyLong_FromSsize_t(rank_of(self, ix));
+}
+
+/* insert_at(index, key, value) - O(log n) insert a new key before position
+ * index, clamped like list.insert(). Over capacity, evicts from the head,
+ * or from the tail when inserting at the front like appendleft(). */
+static PyObject *
+DequeDict_insert_at(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    Py_ssize_t index;
+
+    if (!DequeDict_check_nargs("insert_at", nargs, 3, 3) || DequeDict_index_arg(args[0], &index) < 0)
+        return NULL;
+    PyObject *key = args[1];
+    PyObject *value = args[2];
+    if (DequeDict_tick(self) < 0)
+        return NULL;
+
+    Py_hash_t hash, vh;
+    Py_ssize_t ix;
+    if (DequeDict_value_hash(self, value, &vh) < 0)
+        return NULL;
+    int found = DequeDict_find(self, key, &hash, &ix, NULL);
+    if (found < 0)
+        return NULL;
+    if (found) {
+        PyErr_SetString(PyExc_KeyError, "key already exists");
+        return NULL;
+    }
+
+    if (index < 0) {
+        index += self->size;
+        if (index < 0)
+            index = 0;
+    }
+    if (index > self->size)
+        index = self->size;
+
+    /* Only a middle insert needs the treap to find its neighbour */
+    if (index > 0 && index < self->size && DequeDict_rank_ensure(self) < 0)
+        return NULL;
+    if (DequeDict_reserve(self) < 0)
+        return NULL;
+
+    Py_ssize_t at;
+    if (index == self->size)
+        at = LINK_NONE;
+    else if (index == 0)
+        at = self->head;
+    else
+        at = rank_select(self, index);
+
+    ix = entry_alloc(self);
+    DequeDictEntry *new_entry = ENTRY(self, ix);
+    Py_INCREF(key);
+    Py_INCREF(value);
+    new_entry->key = key;
+    new_entry->value = value;
+    new_entry->hash = hash;
+    STAMP(self, ix);
+    DequeDict_maintain_tracking(self, key);
+    DequeDict_maintain_tracking(self, value);
+    /* At the end a new key is admitted as by d[key] = value */
+    if (at == LINK_NONE && self->policy)
+        DequeDict_policy_link_new(self, ix, self->size);
+    else {
+        DequeDict_link_before(self, ix, at);
+        DequeDict_cache_insert(self, index, ix);
+    }
+    self->size++;
+    index_insert(self, ix);
+    if (self->track_values)
+        vindex_insert(self, ix, vh);
+    DequeDict_notify(self);
+
+    int r = self->size > self->maxsize ? DequeDict_evict(self, index != 0) : 0;
+    if (DequeDict_finish(self, r) < 0)
+        return NULL;
+
+    Py_RETURN_NONE;
+}
+
+/* del_at(index) - O(log n) remove and return the (key, value) at index */
+static PyObject *
+DequeDict_del_at(DequeDictObject *self, PyObject *arg)
+{
+    Py_ssize_t index;
+
+    if (DequeDict_index_arg(arg, &index) < 0)
+        return NULL;
+
+    if (index < 0)
+        index += self->size;
+    if (index < 0 || index >= self->size) {
+        PyErr_SetString(PyExc_IndexError, "index out of range");
+        return NULL;
+    }
+
+    Py_ssize_t ix;
+    if (index == 0) {
+        ix = self->head;
+    } else if (index == self->size - 1) {
+        ix = self->tail;
+    } else {
+        if (DequeDict_rank_ensure(self) < 0)
+            return NULL;
+        ix = rank_select(self, index);
+    }
+
+    PyObject *key;
+    PyObject *value = DequeDict_detach_item(self, ix, -1, &key);
+    return DequeDict_pack_pair(key, value);
+}
+
+/* islice(start=None, stop=None) - O(log n + k) list of (key, value) pairs
+ * in positions [start, stop), with slice semantics for None and negatives */
+static PyObject *
+DequeDict_islice(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    if (!DequeDict_check_nargs("islice", nargs, 0, 2))
+        return NULL;
+    PyObject *start_obj = nargs > 0 ? args[0] : Py_None;
+    PyObject *stop_obj = nargs > 1 ? args[1] : Py_None;
+
+    PyObject *slice = PySlice_New(start_obj, stop_obj, NULL);
+    if (!slice) return NULL;
+    Py_ssize_t start, stop, step;
+    int r = PySlice_Unpack(slice, &start, &stop, &step);
+    Py_DECREF(slice);
+    if (r < 0)
+        return NULL;
+    Py_ssize_t count = PySlice_AdjustIndices(self->size, &start, &stop, step);
+
+    PyObject *list = PyList_New(count);
+    if (!list || count == 0)
+        return list;
+
+    Py_ssize_t ix;
+    if (start == 0) {
+        ix = self->head;
+    } else if (start == self->size - 1) {
+        ix = self->tail;
+    } else {
+        if (DequeDict_rank_ensure(self) < 0) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        ix = rank_select(self, start);
+    }
+
+    for (Py_ssize_t i = 0; i < count; i++) {
+        DequeDictEntry *entry = ENTRY(self, ix);
+        PyObject *pair = PyTuple_Pack(2, entry->key, entry->value);
+        if (!pair) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, pair);
+        ix = entry->next;
+    }
+    return list;
+}
+
+/* Iterator */
+typedef struct {
+    PyObject_HEAD
+    DequeDictObject *dequedict;
+    Py_ssize_t current;     /* Next entry number, or LINK_NONE */
+    uint64_t version;       /* dequedict->version when created */
+} DequeDictIterObject;
+
+static PyTypeObject DequeDictIter_Type;
+
+static int
+DequeDictIter_traverse(DequeDictIterObject *it, visitproc visit, void *arg)
+{
+    Py_VISIT(it->dequedict);
+    return 0;
+}
+
+static int
+DequeDictIter_clear(DequeDictIterObject *it)
+{
+    Py_CLEAR(it->dequedict);
+    return 0;
+}
+
+static void
+DequeDictIter_dealloc(DequeDictIterObject *it)
+{
+    PyObject_GC_UnTrack(it);
+    DequeDictIter_clear(it);
+    Py_TYPE(it)->tp_free(it);
+}
+
+static PyObject *
+DequeDictIter_next(DequeDictIterObject *it)
+{
+    if (it->current == LINK_NONE) return NULL;
+    if (it->version != it->dequedict->version)
+        return DequeDict_mutated_error();
+
+    DequeDictEntry *entry = ENTRY(it->dequedict, it->current);
+    Py_INCREF(entry->key);
+    it->current = entry->next;
+    return entry->key;
+}
+
+static PyObject *
+DequeDict_iter(DequeDictObject *self)
+{
+    DequeDictIterObject *it = PyObject_GC_New(DequeDictIterObject, &DequeDictIter_Type);
+    if (!it) return NULL;
+
+    Py_INCREF(self);
+    it->dequedict = self;
+    it->current = self->head;
+    it->version = self->version;
+    PyObject_GC_Track(it);
+    return (PyObject *)it;
+}
+
+/* Reverse iterator */
+typedef struct {
+    PyObject_HEAD
+    DequeDictObject *dequedict;
+    Py_ssize_t current;     /* Next entry number, or LINK_NONE */
+    uint64_t version;       /* dequedict->version when created */
+} DequeDictRevIterObject;
+
+static PyTypeObject DequeDictRevIter_Type;
+
+static int
+DequeDictRevIter_traverse(DequeDictRevIterObject *it, visitproc visit, void *arg)
+{
+    Py_VISIT(it->dequedict);
+    return 0;
+}
+
+static int
+DequeDictRevIter_clear(DequeDictRevIterObject *it)
+{
+    Py_CLEAR(it->dequedict);
+    return 0;
+}
+
+static void
+DequeDictRevIter_dealloc(DequeDictRevIterObject *it)
+{
+    PyObject_GC_UnTrack(it);
+    DequeDictRevIter_clear(it);
+    Py_TYPE(it)->tp_free(it);
+}
+
+static PyObject *
+DequeDictRevIter_next(DequeDictRevIterObject *it)
+{
+    if (it->current == LINK_NONE) return NULL;
+    if (it->version != it->dequedict->version)
+        return DequeDict_mutated_error();
+
+    DequeDictEntry *entry = ENTRY(it->dequedict, it->current);
+    Py_INCREF(entry->key);
+    it->current = entry->prev;
+    return entry->key;
+}
+
+static PyObject *
+DequeDict_reversed(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    DequeDictRevIterObject *it = PyObject_GC_New(DequeDictRevIterObject, &DequeDictRevIter_Type);
+    if (!it) return NULL;
+
+    Py_INCREF(self);
+    it->dequedict = self;
+    it->current = self->tail;
+    it->version = self->version;
+    PyObject_GC_Track(it);
+    return (PyObject *)it;
+}
+
+/* __eq__ */
+static PyObject *
+DequeDict_richcompare(DequeDictObject *self, PyObject *other, int op)
+{
+    if (op != Py_EQ && op != Py_NE) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+
+    if (!PyMapping_Check(other)) {
+        if (op == Py_EQ) Py_RETURN_FALSE;
+        Py_RETURN_TRUE;
+    }
+
+    Py_ssize_t other_len = PyMapping_Size(other);
+    if (other_len == -1) {
+        PyErr_Clear();
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+
+    if (self->size != other_len) {
+        if (op == Py_EQ) Py_RETURN_FALSE;
+        Py_RETURN_TRUE;
+    }
+
+    /* Compare each key-value pair */
+    Py_ssize_t ix = self->head;
+    while (ix != LINK_NONE) {
+        DequeDictEntry *entry = ENTRY(self, ix);
+        PyObject *key = entry->key;
+        PyObject *value = entry->value;
+        Py_INCREF(key);
+        Py_INCREF(value);
+        PyObject *other_val = PyObject_GetItem(other, key);
+        Py_DECREF(key);
+        if (!other_val) {
+            Py_DECREF(value);
+            if (PyErr_ExceptionMatches(PyExc_KeyError)) {
+                PyErr_Clear();
+                if (op == Py_EQ) Py_RETURN_FALSE;
+                Py_RETURN_TRUE;
+            }
+            return NULL;
+        }
+
+        int cmp = PyObject_RichCompareBool(value, other_val, Py_EQ);
+        Py_DECREF(value);
+        Py_DECREF(other_val);
+
+        if (cmp < 0) return NULL;
+        if (!cmp) {
+            if (op == Py_EQ) Py_RETURN_FALSE;
+            Py_RETURN_TRUE;
+        }
+
+        if (!ENTRY_LIVE(self, ix)) {
+            PyErr_SetString(PyExc_RuntimeError, "DequeDict mutated during comparison");
+            return NULL;
+        }
+        ix = ENTRY(self, ix)->next;
+    }
+
+    if (op == Py_EQ) Py_RETURN_TRUE;
+    Py_RETURN_FALSE;
+}
+
+/* List of (key, value) tuples in order, for repr() and friends */
+static PyObject *
+DequeDict_items_list(DequeDictObject *self)
+{
+    PyObject *list = PyList_New(self->size);
+    if (!list) return NULL;
+
+    Py_ssize_t ix = self->head;
+    Py_ssize_t i = 0;
+    while (ix != LINK_NONE) {
+        DequeDictEntry *entry = ENTRY(self, ix);
+        PyObject *pair = PyTuple_Pack(2, entry->key, entry->value);
+        if (!pair) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, pair);
+        ix = entry->next;
+        i++;
+    }
+    return list;
+}
+
+static PyObject *
+DequeDict_repr(DequeDictObject *self)
+{
+    if (self->size == 0) {
+        return PyUnicode_FromString("DequeDict()");
+    }
+
+    int status = Py_ReprEnter((PyObject *)self);
+    if (status != 0)
+        return status > 0 ? PyUnicode_FromString("...") : NULL;
+
+    PyObject *repr = NULL;
+    PyObject *items = DequeDict_items_list(self);
+    if (items) {
+        repr = PyUnicode_FromFormat("DequeDict(%R)", items);
+        Py_DECREF(items);
+    }
+    Py_ReprLeave((PyObject *)self);
+    return repr;
+}
+
+/* ========================================================================
+ * Array export
+ *
+ * keys_array()/values_array() copy keys or values, in order, into one
+ * contiguous block in a single C pass and return a read-only memoryview
+ * of it: format "q" (int64), "d" (float64) or "<n>s" (bytes padded with
+ * NULs to n, like NumPy's S<n> dtype). numpy.asarray() wraps the view
+ * without another copy.
+ * ======================================================================== */
+
+typedef struct {
+    PyObject_HEAD
+    char *data;
+    Py_ssize_t shape;
+    Py_ssize_t itemsize;
+    char format[16];
+} DequeDictArrayObject;
+
+static void
+DequeDictArray_dealloc(DequeDictArrayObject *self)
+{
+    PyMem_Free(self->data);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int
+DequeDictArray_getbuffer(DequeDictArrayObject *self, Py_buffer *view, int flags)
+{
+    if (PyBuffer_FillInfo(view, (PyObject *)self, self->data, self->shape * self->itemsize, 1, flags) < 0)
+        return -1;
+    view->itemsize = self->itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? self->format : NULL;
+    view->shape = (flags & PyBUF_ND) ? &self->shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) ? &self->itemsize : NULL;
+    return 0;
+}
+
+static PyBufferProcs DequeDictArray_as_buffer = {
+    .bf_getbuffer = (getbufferproc)DequeDictArray_getbuffer,
+};
+
+static PyTypeObject DequeDictArray_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "dequedict.DequeDictArray",
+    .tp_basicsize = sizeof(DequeDictArrayObject),
+    .tp_dealloc = (destructor)DequeDictArray_dealloc,
+    .tp_as_buffer = &DequeDictArray_as_buffer,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "Contiguous block exported by keys_array()/values_array()",
+};
+
+/* New exporter for n items of itemsize bytes, zero-filled */
+static DequeDictArrayObject *
+DequeDictArray_new(Py_ssize_t n, Py_ssize_t itemsize, const char *format)
+{
+    if (n > PY_SSIZE_T_MAX / itemsize) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    DequeDictArrayObject *self = PyObject_New(DequeDictArrayObject, &DequeDictArray_Type);
+    if (!self) return NULL;
+    self->shape = n;
+    self->itemsize = itemsize;
+    snprintf(self->format, sizeof(self->format), "%s", format);
+    self->data = PyMem_Calloc(n ? n : 1, itemsize);
+    if (!self->data) {
+        Py_DECREF(self);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    return self;
+}
+
+/* memoryview of an exporter; steals the reference */
+static PyObject *
+DequeDictArray_view(DequeDictArrayObject *array)
+{
+    if (!array) return NULL;
+    PyObject *view = PyMemoryView_FromObject((PyObject *)array);
+    Py_DECREF(array);
+    return view;
+}
+
+/* keys_array(type_code="i8") / values_array(type_code="f8") for generic
+ * DequeDicts: converts each object with __index__ or __float__ */
+static PyObject *
+DequeDict_array(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs, int values)
+{
+    const char *name = values ? "values_array" : "keys_array";
+    if (!DequeDict_check_nargs(name, nargs, 0, 1))
+        return NULL;
+    const char *code = values ? "f8" : "i8";
+    if (nargs) {
+        if (!PyUnicode_Check(args[0])) {
+            PyErr_SetString(PyExc_TypeError, "type code must be a str");
+            return NULL;
+        }
+        if (!(code = PyUnicode_AsUTF8(args[0])))
+            return NULL;
+    }
+    int is_float = strcmp(code, "f8") == 0;
+    if (!is_float && strcmp(code, "i8") != 0)
+        return PyErr_Format(PyExc_ValueError, "type code must be 'i8' or 'f8', not %R", args[0]);
+
+    DequeDictArrayObject *array = DequeDictArray_new(self->size, 8, is_float ? "d" : "q");
+    if (!array) return NULL;
+    uint64_t version = self->version;
+    char *out = array->data;
+    for (Py_ssize_t ix = self->head; ix != LINK_NONE; out += 8) {
+        DequeDictEntry *entry = ENTRY(self, ix);
+        PyObject *obj = values ? entry->value : entry->key;
+        int exact = is_float ? PyFloat_CheckExact(obj) : PyLong_CheckExact(obj);
+        Py_INCREF(obj);
+        if (is_float) {
+            double d = PyFloat_AsDouble(obj);
+            memcpy(out, &d, 8);
+        } else {
+            long long i = PyLong_AsLongLong(obj);
+            memcpy(out, &i, 8);
+        }
+        Py_DECREF(obj);
+        if (PyErr_Occurred()) {
+            Py_DECREF(array);
+            return NULL;
+        }
+        /* __index__/__float__ may have changed the DequeDict */
+        if (!exact && self->version != version) {
+            Py_DECREF(array);
+            return DequeDict_mutated_error();
+        }
+        ix = entry->next;
+    }
+    return DequeDictArray_view(array);
+}
+
+static PyObject *
+DequeDict_keys_array(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    return DequeDict_array(self, args, nargs, 0);
+}
+
+static PyObject *
+DequeDict_values_array(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    return DequeDict_array(self, args, nargs, 1);
+}
+
+/* ========================================================================
+ * Pickle and copy
+ *
+ * The pickled state is (keys, values, options[, __dict__]): two flat
+ * lists in order plus the constructor keywords of copy(). Flat lists
+ * pickle smaller than a list of pairs and load without a tuple per item;
+ * __setstate__ presizes once and bulk-inserts.
+ * ======================================================================== */
+
+/* (type(self), args, state) for __reduce__; steals args */
+static PyObject *
+DequeDict_reduce_as(DequeDictObject *self, PyObject *args)
+{
+    if (!args) return NULL;
+    PyObject *keys = PyList_New(self->size);
+    PyObject *values = PyList_New(self->size);
+    PyObject *options = DequeDict_options(self);
+    PyObject *state = NULL;
+    if (!keys || !values || !options)
+        goto done;
+
+    Py_ssize_t i = 0;
+    for (Py_ssize_t ix = self->head; ix != LINK_NONE; ix = ENTRY(self, ix)->next, i++) {
+        DequeDictEntry *entry = ENTRY(self, ix);
+        Py_INCREF(entry->key);
+        Py_INCREF(entry->value);
+        PyList_SET_ITEM(keys, i, entry->key);
+        PyList_SET_ITEM(values, i, entry->value);
+    }
+
+    /* Subclass instance attributes */
+    PyObject *dict = PyObject_GetAttr((PyObject *)self, str___dict__);
+    if (!dict) {
+        if (!PyErr_ExceptionMatches(PyExc_AttributeError))
+            goto done;
+        PyErr_Clear();
+    }
+    if (dict && PyDict_Check(dict) && PyDict_GET_SIZE(dict))
+        state = PyTuple_Pack(4, keys, values, options, dict);
+    else
+        state = PyTuple_Pack(3, keys, values, options);
+    Py_XDECREF(dict);
+
+done:
+    Py_XDECREF(keys);
+    Py_XDECREF(values);
+    Py_XDECREF(options);
+    if (!state) {
+        Py_DECREF(args);
+        return NULL;
+    }
+    PyObject *result = PyTuple_Pack(3, (PyObject *)Py_TYPE(self), args, state);
+    Py_DECREF(args);
+    Py_DECREF(state);
+    return result;
+}
+
+static PyObject *
+DequeDict_reduce(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    return DequeDict_reduce_as(self, PyTuple_New(0));
+}
+
+/* __setstate__((keys, values, options[, __dict__])) - replace the contents */
+static PyObject *
+DequeDict_setstate(DequeDictObject *self, PyObject *state)
+{
+    PyObject *keys, *values, *options, *dict = NULL;
+    if (!PyTuple_Check(state) || !PyArg_ParseTuple(state, "O!O!O!|O!:__setstate__",
+                                                     &PyList_Type, &keys, &PyList_Type, &values,
+                                                     &PyDict_Type, &options, &PyDict_Type, &dict)) {
+        if (!PyErr_Occurred())
+            PyErr_SetString(PyExc_TypeError, "__setstate__ expects a tuple");
+        return NULL;
+    }
+    Py_ssize_t n = PyList_GET_SIZE(keys);
+    if (PyList_GET_SIZE(values) != n) {
+        PyErr_SetString(PyExc_ValueError, "__setstate__ expects as many keys as values");
+        return NULL;
+    }
+
+    PyObject *touch_obj = PyDict_GetItemString(options, "touch");
+    PyObject *gc_obj = PyDict_GetItemString(options, "gc_tracking");
+    int touch = touch_obj ? PyObject_IsTrue(touch_obj) : 0;
+    PyObject *stats_obj = PyDict_GetItemString(options, "stats");
+    int gc_tracking = gc_obj ? PyObject_IsTrue(gc_obj) : 1;
+    int stats = stats_obj ? PyObject_IsTrue(stats_obj) : 0;
+    PyObject *track_obj = PyDict_GetItemString(options, "track_values");
+    int track_values = track_obj ? PyObject_IsTrue(track_obj) : 0;
+    if (touch < 0 || gc_tracking < 0 || stats < 0 || track_values < 0
+        || DequeDict_configure(self, PyDict_GetItemString(options, "maxsize"),
+                               PyDict_GetItemString(options, "on_evict"), touch, gc_tracking,
+                               PyDict_GetItemString(options, "ttl"), PyDict_GetItemString(options, "clock"),
+                               stats, PyDict_GetItemString(options, "policy"), track_values) < 0)
+        return NULL;
+
+    DequeDict_clear(self);
+    if (DequeDict_presize(self, n) < 0 || DequeDict_tick(self) < 0)
+        return NULL;
+
+    /* Keys and values stay referenced in case __eq__ mutates the lists */
+    int r = 0;
+    for (Py_ssize_t i = 0; r == 0 && i < n; i++) {
+        if (i >= PyList_GET_SIZE(keys) || i >= PyList_GET_SIZE(values)) {
+            PyErr_SetString(PyExc_RuntimeError, "state mutated during __setstate__");
+            r = -1;
+            break;
+        }
+        PyObject *key = PyList_GET_ITEM(keys, i);
+        PyObject *value = PyList_GET_ITEM(values, i);
+        Py_INCREF(key);
+        Py_INCREF(value);
+        r = DequeDict_set(self, key, value);
+        Py_DECREF(key);
+        Py_DECREF(value);
+    }
+    if (DequeDict_finish(self, r) < 0)
+        return NULL;
+
+    if (dict) {
+        PyObject *self_dict = PyObject_GetAttr((PyObject *)self, str___dict__);
+        if (!self_dict) return NULL;
+        r = PyDict_Update(self_dict, dict);
+        Py_DECREF(self_dict);
+        if (r < 0) return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+DequeDict_copy_method(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    return DequeDict_copy_as(self, (PyObject *)Py_TYPE(self), PyTuple_New(0));
+}
+
+/* __deepcopy__(memo) of type(*args, **options); steals args. The copy is
+ * entered in memo before its items, so self-references resolve to it. */
+static PyObject *
+DequeDict_deepcopy_as(DequeDictObject *self, PyObject *args, PyObject *memo)
+{
+    PyObject *items = DequeDict_items_list(self);
+    if (!items) {
+        Py_XDECREF(args);
+        return NULL;
+    }
+    PyObject *result = DequeDict_new_like(self, (PyObject *)Py_TYPE(self), args);
+    PyObject *deepcopy = NULL, *id = NULL;
+    if (!result)
+        goto error;
+
+    PyObject *copy_module = PyImport_ImportModule("copy");
+    if (!copy_module)
+        goto error;
+    deepcopy = PyObject_GetAttrString(copy_module, "deepcopy");
+    Py_DECREF(copy_module);
+    id = PyLong_FromVoidPtr(self);
+    if (!deepcopy || !id || PyObject_SetItem(memo, id, result) < 0)
+        goto error;
+
+    for (Py_ssize_t i = 0; i < PyList_GET_SIZE(items); i++) {
+        PyObject *pair = PyList_GET_ITEM(items, i);
+        PyObject *key = PyObject_CallFunctionObjArgs(deepcopy, PyTuple_GET_ITEM(pair, 0), memo, NULL);
+        PyObject *value = key ? PyObject_CallFunctionObjArgs(deepcopy, PyTuple_GET_ITEM(pair, 1), memo, NULL)
+                              : NULL;
+        int r = value ? PyObject_SetItem(result, key, value) : -1;
+        Py_XDECREF(key);
+        Py_XDECREF(value);
+        if (r < 0)
+            goto error;
+    }
+    Py_DECREF(items);
+    Py_DECREF(deepcopy);
+    Py_DECREF(id);
+    return result;
+
+error:
+    Py_DECREF(items);
+    Py_XDECREF(result);
+    Py_XDECREF(deepcopy);
+    Py_XDECREF(id);
+    return NULL;
+}
+
+static PyObject *
+DequeDict_deepcopy(DequeDictObject *self, PyObject *memo)
+{
+    return DequeDict_deepcopy_as(self, PyTuple_New(0), memo);
+}
+
+/* ========================================================================
+ * Locked entry points - see "Free threading" above
+ * ======================================================================== */
+
+LOCKED_METH_O(DequeDict_peekleft)
+LOCKED_METH_O(DequeDict_peekleftitem)
+LOCKED_METH_O(DequeDict_peekleftkey)
+LOCKED_METH_O(DequeDict_peek)
+LOCKED_METH_O(DequeDict_peekitem)
+LOCKED_FASTCALL_KW(DequeDict_popleft_method)
+LOCKED_FASTCALL_KW(DequeDict_popleftitem_method)
+LOCKED_METH_O(DequeDict_popleft)
+LOCKED_METH_O(DequeDict_popleftitem)
+LOCKED_FASTCALL(DequeDict_try_popleft)
+LOCKED_FASTCALL(DequeDict_pop)
+LOCKED_METH_O(DequeDict_popitem)
+LOCKED_FASTCALL(DequeDict_appendleft)
+LOCKED_METH_O(DequeDict_popleft_n)
+LOCKED_METH_O(DequeDict_pop_n)
+LOCKED_METH_O(DequeDict_popleftitems_n)
+LOCKED_METH_O(DequeDict_extend)
+LOCKED_METH_O(DequeDict_extendleft)
+LOCKED_METH_O(DequeDict_presize_method)
+LOCKED_FASTCALL_KW(DequeDict_move_to_end)
+LOCKED_FASTCALL(DequeDict_get)
+LOCKED_FASTCALL(DequeDict_get_and_touch)
+LOCKED_FASTCALL(DequeDict_get_with_hash)
+LOCKED_FASTCALL(DequeDict_set_with_hash)
+LOCKED_FASTCALL(DequeDict_pop_with_hash)
+LOCKED_METH_O(DequeDict_expire_before)
+LOCKED_FASTCALL_KW(DequeDict_expire)
+LOCKED_METH_O(DequeDict_stats)
+LOCKED_METH_O(DequeDict_reset_stats)
+LOCKED_METH_O(DequeDict_clear_method)
+LOCKED_METH_O(DequeDict_copy)
+LOCKED_METH_O(DequeDict_copy_method)
+LOCKED_METH_O(DequeDict_deepcopy)
+LOCKED_METH_O(DequeDict_reduce)
+LOCKED_METH_O(DequeDict_setstate)
+LOCKED_VARARGS_KW(DequeDict_update)
+LOCKED_FASTCALL(DequeDict_setdefault)
+LOCKED_METH_O(DequeDict_keys_for)
+LOCKED_METH_O(DequeDict_remove_value)
+LOCKED_METH_O(DequeDict_at)
+LOCKED_METH_O(DequeDict_index_of)
+LOCKED_FASTCALL(DequeDict_insert_at)
+LOCKED_METH_O(DequeDict_del_at)
+LOCKED_FASTCALL(DequeDict_islice)
+LOCKED_METH_O(DequeDict_reversed)
+LOCKED_METH_O(DequeDict_sizeof)
+LOCKED_FASTCALL(DequeDict_keys_array)
+LOCKED_FASTCALL(DequeDict_values_array)
+
+DEQUEDICT_LOCKED(Py_ssize_t, DequeDict_len, self, (DequeDictObject *self), (self))
+DEQUEDICT_LOCKED(PyObject *, DequeDict_ior, self, (DequeDictObject *self, PyObject *other), (self, other))
+DEQUEDICT_LOCKED(int, DequeDict_contains, self, (DequeDictObject *self, PyObject *key), (self, key))
+LOCKED_METH_O(DequeDict_getitem)
+DEQUEDICT_LOCKED(int, DequeDict_setitem, self,
+                 (DequeDictObject *self, PyObject *key, PyObject *value), (self, key, value))
+DEQUEDICT_LOCKED(PyObject *, DequeDict_iter, self, (DequeDictObject *self), (self))
+DEQUEDICT_LOCKED(PyObject *, DequeDict_repr, self, (DequeDictObject *self), (self))
+DEQUEDICT_LOCKED(PyObject *, DequeDict_richcompare, self,
+                 (DequeDictObject *self, PyObject *other, int op), (self, other, op))
+DEQUEDICT_LOCKED(int, DequeDict_init, self,
+                 (DequeDictObject *self, PyObject *args, PyObject *kwds), (self, args, kwds))
+DEQUEDICT_LOCKED(PyObject *, DequeDictIter_next, it->dequedict, (DequeDictIterObject *it), (it))
+DEQUEDICT_LOCKED(PyObject *, DequeDictRevIter_next, it->dequedict, (DequeDictRevIterObject *it), (it))
+
+static PyMethodDef DequeDict_methods[] = {
+    /* Deque-like operations - O(1) */
+    {"peekleft", (PyCFunction)DequeDict_peekleft_locked, METH_NOARGS,
+     "Return first value without removing - O(1)"},
+    {"peekleftitem", (PyCFunction)DequeDict_peekleftitem_locked, METH_NOARGS,
+     "Return first (key, value) without removing - O(1)"},
+    {"peekleftkey", (PyCFunction)DequeDict_peekleftkey_locked, METH_NOARGS,
+     "Return first key without removing - O(1)"},
+    {"peek", (PyCFunction)DequeDict_peek_locked, METH_NOARGS,
+     "Return last value without removing - O(1)"},
+    {"peekitem", (PyCFunction)DequeDict_peekitem_locked, METH_NOARGS,
+     "Return last (key, value) without removing - O(1)"},
+    {"popleft", (PyCFunction)(void(*)(void))DequeDict_popleft_method_locked, METH_FASTCALL | METH_KEYWORDS,
+     "Remove and return first value, waiting up to timeout seconds if empty - O(1)"},
+    {"popleftitem", (PyCFunction)(void(*)(void))DequeDict_popleftitem_method_locked,
+     METH_FASTCALL | METH_KEYWORDS,
+     "Remove and return first (key, value), waiting up to timeout seconds if empty - O(1)"},
+    {"try_popleft", (PyCFunction)(void(*)(void))DequeDict_try_popleft_locked, METH_FASTCALL,
+     "Remove and return first value, or default if empty - O(1)"},
+    {"pop", (PyCFunction)(void(*)(void))DequeDict_pop_locked, METH_FASTCALL,
+     "Remove and return value by key or from end - O(1)"},
+    {"popitem", (PyCFunction)DequeDict_popitem_locked, METH_NOARGS,
+     "Remove and return last (key, value) - O(1)"},
+    {"appendleft", (PyCFunction)(void(*)(void))DequeDict_appendleft_locked, METH_FASTCALL,
+     "Insert (key, value) at front - O(1)"},
+    {"popleft_n", (PyCFunction)DequeDict_popleft_n_locked, METH_O,
+     "Remove and return up to n first values - O(n)"},
+    {"pop_n", (PyCFunction)DequeDict_pop_n_locked, METH_O,
+     "Remove and return up to n last values, last first - O(n)"},
+    {"popleftitems_n", (PyCFunction)DequeDict_popleftitems_n_locked, METH_O,
+     "Remove and return up to n first (key, value) pairs - O(n)"},
+    {"extend", (PyCFunction)DequeDict_extend_locked, METH_O,
+     "Set each (key, value) pair, appending new keys - O(n)"},
+    {"extendleft", (PyCFunction)DequeDict_extendleft_locked, METH_O,
+     "appendleft() each (key, value) pair - O(n)"},
+    {"presize", (PyCFunction)DequeDict_presize_method_locked, METH_O,
+     "Reserve room for n more items so a bulk load does not rehash"},
+    {"move_to_end", (PyCFunction)(void(*)(void))DequeDict_move_to_end_locked, METH_FASTCALL | METH_KEYWORDS,
+     "Move key to front (last=False) or back (last=True) - O(1)"},
+
+    /* Dict-like operations */
+    {"get", (PyCFunction)(void(*)(void))DequeDict_get_locked, METH_FASTCALL, "D.get(k[,d]) -> D[k] if k in D, else d"},
+    {"get_and_touch", (PyCFunction)(void(*)(void))DequeDict_get_and_touch_locked, METH_FASTCALL,
+     "D.get_and_touch(k[,d]) -> D[k], moving k to the end, if k in D, else d"},
+    {"get_with_hash", (PyCFunction)(void(*)(void))DequeDict_get_with_hash_locked, METH_FASTCALL,
+     "D.get_with_hash(k, h[,d]) -> D.get(k[,d]), reusing h == hash(k)"},
+    {"set_with_hash", (PyCFunction)(void(*)(void))DequeDict_set_with_hash_locked, METH_FASTCALL,
+     "D.set_with_hash(k, h, v) - D[k] = v, reusing h == hash(k)"},
+    {"pop_with_hash", (PyCFunction)(void(*)(void))DequeDict_pop_with_hash_locked, METH_FASTCALL,
+     "D.pop_with_hash(k, h[,d]) -> D.pop(k[,d]), reusing h == hash(k)"},
+    {"expire", (PyCFunction)(void(*)(void))DequeDict_expire_locked, METH_FASTCALL | METH_KEYWORDS,
+     "D.expire(now=None) -> number of entries older than ttl removed from the head"},
+    {"expire_before", (PyCFunction)DequeDict_expire_before_locked, METH_O,
+     "D.expire_before(ts) -> number of entries stamped before ts removed from the head"},
+    {"stats", (PyCFunction)DequeDict_stats_locked, METH_NOARGS,
+     "D.stats() -> dict of hit, miss, eviction, probe, rebuild and freelist counters"},
+    {"reset_stats", (PyCFunction)DequeDict_reset_stats_locked, METH_NOARGS, "D.reset_stats() - zero the counters"},
+    {"keys", (PyCFunction)DequeDict_keys, METH_NOARGS, "D.keys() -> list of keys in order"},
+    {"values", (PyCFunction)DequeDict_values, METH_NOARGS, "D.values() -> list of values in order"},
+    {"items", (PyCFunction)DequeDict_items, METH_NOARGS, "D.items() -> list of (key, value) in order"},
+    {"keys_array", (PyCFunction)(void(*)(void))DequeDict_keys_array_locked, METH_FASTCALL,
+     "D.keys_array(type_code='i8') -> read-only memoryview of the keys in order"},
+    {"values_array", (PyCFunction)(void(*)(void))DequeDict_values_array_locked, METH_FASTCALL,
+     "D.values_array(type_code='f8') -> read-only memoryview of the values in order"},
+    {"clear", (PyCFunction)DequeDict_clear_method_locked, METH_NOARGS, "D.clear() -- remove all items"},
+    {"copy", (PyCFunction)DequeDict_copy_locked, METH_NOARGS, "D.copy() -> a shallow copy"},
+    {"__copy__", (PyCFunction)DequeDict_copy_method_locked, METH_NOARGS,
+     "Shallow copy of the same type"},
+    {"__deepcopy__", (PyCFunction)DequeDict_deepcopy_locked, METH_O, "Deep copy, for copy.deepcopy()"},
+    {"__reduce__", (PyCFunction)DequeDict_reduce_locked, METH_NOARGS,
+     "Pickle as flat key and value lists"},
+    {"__setstate__", (PyCFunction)DequeDict_setstate_locked, METH_O,
+     "Restore from the state made by __reduce__"},
+    {"update", (PyCFunction)DequeDict_update_locked, METH_VARARGS | METH_KEYWORDS, "D.update([E, ]**F)"},
+    {"setdefault", (PyCFunction)(void(*)(void))DequeDict_setdefault_locked, METH_FASTCALL, "D.setdefault(k[,d])"},
+    {"keys_for", (PyCFunction)DequeDict_keys_for_locked, METH_O,
+     "D.keys_for(v) -> list of the keys whose value equals v"},
+    {"remove_value", (PyCFunction)DequeDict_remove_value_locked, METH_O,
+     "D.remove_value(v) -> remove every key whose value equals v, return the count"},
+    {"at", (PyCFunction)DequeDict_at_locked, METH_O,
+     "Return value at index position. O(1) via entry number cache."},
+    {"index_of", (PyCFunction)DequeDict_index_of_locked, METH_O,
+     "Return the position of key - O(log n)"},
+    {"insert_at", (PyCFunction)(void(*)(void))DequeDict_insert_at_locked, METH_FASTCALL,
+     "Insert (key, value) before position index - O(log n)"},
+    {"del_at", (PyCFunction)DequeDict_del_at_locked, METH_O,
+     "Remove and return the (key, value) at position index - O(log n)"},
+    {"islice", (PyCFunction)(void(*)(void))DequeDict_islice_locked, METH_FASTCALL,
+     "Return the (key, value) pairs in positions [start, stop) - O(log n + k)"},
+    {"__reversed__", (PyCFunction)DequeDict_reversed_locked, METH_NOARGS, "D.__reversed__() -- return reverse iterator"},
+    {"__sizeof__", (PyCFunction)DequeDict_sizeof_locked, METH_NOARGS, "D.__sizeof__() -> size of D in memory, in bytes"},
+    {"__class_getitem__", (PyCFunction)DequeDict_class_getitem, METH_O | METH_CLASS,
+     "See PEP 585"},
+    {NULL}
+};
+
+static PyObject *
+DequeDict_get_maxsize(DequeDictObject *self, void *Py_UNUSED(closure))
+{
+    if (self->maxsize == PY_SSIZE_T_MAX)
+        Py_RETURN_NONE;
+    return PyLong_FromSsize_t(self->maxsize);
+}
+
+static PyObject *
+DequeDict_get_policy(DequeDictObject *self, void *Py_UNUSED(closure))
+{
+    if (self->policy)
+        return PyUnicode_FromString(policy_names[(int)self->policy]);
+    return PyUnicode_FromString(self->touch ? "lru" : "fifo");
+}
+
+static PyObject *
+DequeDict_get_ttl(DequeDictObject *self, void *Py_UNUSED(closure))
+{
+    if (self->ttl == 0)
+        Py_RETURN_NONE;
+    return PyFloat_FromDouble(self->ttl);
+}
+
+static PyObject *
+DequeDict_get_on_evict(DequeDictObject *self, void *Py_UNUSED(closure))
+{
+    PyObject *callback = self->on_evict ? self->on_evict : Py_None;
+    Py_INCREF(callback);
+    return callback;
+}
+
+static int
+DequeDict_set_on_evict(DequeDictObject *self, PyObject *value, void *Py_UNUSED(closure))
+{
+    if (value == NULL || value == Py_None) {
+        Py_CLEAR(self->on_evict);
+        return 0;
+    }
+    if (!PyCallable_Check(value)) {
+        PyErr_SetString(PyExc_TypeError, "on_evict must be callable or None");
+        return -1;
+    }
+    Py_INCREF(value);
+    Py_XSETREF(self->on_evict, value);
+    DequeDict_maintain_tracking(self, value);
+    return 0;
+}
+
+DEQUEDICT_LOCKED(PyObject *, DequeDict_get_maxsize, self,
+                 (DequeDictObject *self, void *closure), (self, closure))
+DEQUEDICT_LOCKED(PyObject *, DequeDict_get_policy, self,
+                 (DequeDictObject *self, void *closure), (self, closure))
+DEQUEDICT_LOCKED(PyObject *, DequeDict_get_ttl, self,
+                 (DequeDictObject *self, void *closure), (self, closure))
+DEQUEDICT_LOCKED(PyObject *, DequeDict_get_on_evict, self,
+                 (DequeDictObject *self, void *closure), (self, closure))
+DEQUEDICT_LOCKED(int, DequeDict_set_on_evict, self,
+                 (DequeDictObject *self, PyObject *value, void *closure), (self, value, closure))
+
+static PyGetSetDef DequeDict_getset[] = {
+    {"maxsize", (getter)DequeDict_get_maxsize_locked, NULL,
+     "Capacity, or None if unbounded", NULL},
+    {"ttl", (getter)DequeDict_get_ttl_locked, NULL,
+     "Entry lifetime in seconds, or None", NULL},
+    {"policy", (getter)DequeDict_get_policy_locked, NULL,
+     "Eviction policy: 'fifo', 'lru', 'clock', 'slru', '2q' or 's3fifo'", NULL},
+    {"on_evict", (getter)DequeDict_get_on_evict_locked, (setter)DequeDict_set_on_evict_locked,
+     "Called with a list of evicted (key, value) pairs, or None", NULL},
+    {NULL}
+};
+
+static PyMemberDef DequeDict_members[] = {
+    {"touch", T_BOOL, offsetof(DequeDictObject, touch), 0,
+     "If true, lookups and updates move the key to the end"},
+    {"track_values", T_BOOL, offsetof(DequeDictObject, track_values), READONLY,
+     "If true, values are indexed for keys_for(), remove_value() and value membership"},
+    {NULL}
+};
+
+static PySequenceMethods DequeDict_as_sequence = {
+    .sq_contains = (objobjproc)DequeDict_contains_locked,
+};
+
+static PyMappingMethods DequeDict_as_mapping = {
+    .mp_length = (lenfunc)DequeDict_len_locked,
+    .mp_subscript = (binaryfunc)DequeDict_getitem_locked,
+    .mp_ass_subscript = (objobjargproc)DequeDict_setitem_locked,
+};
+
+static PyTypeObject DequeDictIter_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "dequedict.DequeDictIter",
+    .tp_basicsize = sizeof(DequeDictIterObject),
+    .tp_dealloc = (destructor)DequeDictIter_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_traverse = (traverseproc)DequeDictIter_traverse,
+    .tp_clear = (inquiry)DequeDictIter_clear,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc)DequeDictIter_next_locked,
+};
+
+static PyTypeObject DequeDictRevIter_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "dequedict.DequeDictRevIter",
+    .tp_basicsize = sizeof(DequeDictRevIterObject),
+    .tp_dealloc = (destructor)DequeDictRevIter_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_traverse = (traverseproc)DequeDictRevIter_traverse,
+    .tp_clear = (inquiry)DequeDictRevIter_clear,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc)DequeDictRevIter_next_locked,
+};
+
+static PyNumberMethods DequeDict_as_number = {
+    .nb_or = DequeDict_or,
+    .nb_inplace_or = (binaryfunc)DequeDict_ior_locked,
+};
+
+static PyTypeObject DequeDict_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "dequedict.DequeDict",
+    .tp_basicsize = sizeof(DequeDictObject),
+    .tp_dealloc = (destructor)DequeDict_dealloc,
+    .tp_hash = PyObject_HashNotImplemented,
+    .tp_repr = (reprfunc)DequeDict_repr_locked,
+    .tp_as_number = &DequeDict_as_number,
+    .tp_as_sequence = &DequeDict_as_sequence,
+    .tp_as_mapping = &DequeDict_as_mapping,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,
+    .tp_doc = "Ordered dictionary with O(1) deque operations at both ends.\n\n"
+              "Provides dict-like key lookup plus efficient popleft/peekleft operations.\n"
+              "Similar to collections.OrderedDict but with deque-like operations.",
+    .tp_traverse = (traverseproc)DequeDict_traverse,
+    .tp_clear = (inquiry)DequeDict_tp_clear,
+    .tp_richcompare = (richcmpfunc)DequeDict_richcompare_locked,
+    .tp_iter = (getiterfunc)DequeDict_iter_locked,
+    .tp_methods = DequeDict_methods,
+    .tp_members = DequeDict_members,
+    .tp_getset = DequeDict_getset,
+    .tp_init = (initproc)DequeDict_init_locked,
+    .tp_new = DequeDict_new,
+    .tp_vectorcall = DequeDict_vectorcall,
+};
+
+/* ========================================================================
+ * DefaultDequeDict - DequeDict with default_factory, like defaultdict
+ * ======================================================================== */
+
+typedef struct {
+    DequeDictObject base;
+    PyObject *default_factory;      /* Callable or NULL */
+} DefaultDequeDictObject;
+
+/* Positional constructor args of type(self): (default_factory,) for a
+ * DefaultDequeDict, () otherwise */
+static PyObject *
+DequeDict_ctor_args(DequeDictObject *self)
+{
+    if (!PyObject_TypeCheck(self, &DefaultDequeDict_Type))
+        return PyTuple_New(0);
+    PyObject *factory = ((DefaultDequeDictObject *)self)->default_factory;
+    return PyTuple_Pack(1, factory ? factory : Py_None);
+}
+
+static int
+DefaultDequeDict_traverse(DefaultDequeDictObject *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->default_factory);
+    return DequeDict_traverse(&self->base, visit, arg);
+}
+
+static int
+DefaultDequeDict_tp_clear(DefaultDequeDictObject *self)
+{
+    Py_CLEAR(self->default_factory);
+    return DequeDict_tp_clear(&self->base);
+}
+
+static void
+DefaultDequeDict_dealloc(DefaultDequeDictObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    DefaultDequeDict_tp_clear(self);
+    DequeDict_free_native(&self->base);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int
+DefaultDequeDict_init(DefaultDequeDictObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"default_factory", "items", "maxsize", "on_evict", "touch", "gc_tracking",
+                             "ttl", "clock", "stats", "policy", "track_values", NULL};
+    PyObject *factory = Py_None;
+    PyObject *items = NULL;
+    PyObject *maxsize = Py_None;
+    PyObject *on_evict = Py_None;
+    int touch = 0;
+    int gc_tracking = 1;
+    PyObject *ttl = Py_None;
+    PyObject *clock = Py_None;
+    int stats = 0;
+    PyObject *policy = Py_None;
+    int track_values = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OO$OOppOOpOp", kwlist,
+                                     &factory, &items, &maxsize, &on_evict, &touch, &gc_tracking,
+                                     &ttl, &clock, &stats, &policy, &track_values))
+        return -1;
+
+    if (factory != Py_None && !PyCallable_Check(factory)) {
+        PyErr_SetString(PyExc_TypeError, "first argument must be callable or None");
+        return -1;
+    }
+
+    PyObject *old = self->default_factory;
+    if (factory == Py_None) {
+        self->default_factory = NULL;
+    } else {
+        Py_INCREF(factory);
+        self->default_factory = factory;
+    }
+    Py_XDECREF(old);
+
+    if (DequeDict_configure(&self->base, maxsize, on_evict, touch, gc_tracking, ttl, clock, stats, policy,
+                            track_values) < 0)
+        return -1;
+    return DequeDict_reset(&self->base, items);
+}
+
+/* __missing__(key) - insert and return default_factory() */
+static PyObject *
+DefaultDequeDict_missing(PyObject *op, PyObject *key)
+{
+    DefaultDequeDictObject *self = (DefaultDequeDictObject *)op;
+    PyObject *factory = self->default_factory;
+    if (factory == NULL || factory == Py_None) {
+        PyErr_SetObject(PyExc_KeyError, key);
+        return NULL;
+    }
+
+    /* Keep the factory alive if another thread replaces it meanwhile */
+    Py_INCREF(factory);
+    PyObject *value = PyObject_CallNoArgs(factory);
+    Py_DECREF(factory);
+    if (!value) return NULL;
+    if (DequeDict_set(&self->base, key, value) < 0) {
+        Py_DECREF(value);
+        value = NULL;
+    }
+    return DequeDict_finish_object(&self->base, value);
+}
+
+/* copy() - keeps default_factory and the DequeDict options */
+static PyObject *
+DefaultDequeDict_copy(DefaultDequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    PyObject *factory = self->default_factory ? self->default_factory : Py_None;
+    return DequeDict_copy_as(&self->base, (PyObject *)Py_TYPE(self), PyTuple_Pack(1, factory));
+}
+
+/* __reduce__ / __deepcopy__ - pass default_factory to the constructor */
+static PyObject *
+DefaultDequeDict_reduce(DefaultDequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    PyObject *factory = self->default_factory ? self->default_factory : Py_None;
+    return DequeDict_reduce_as(&self->base, PyTuple_Pack(1, factory));
+}
+
+static PyObject *
+DefaultDequeDict_deepcopy(DefaultDequeDictObject *self, PyObject *memo)
+{
+    PyObject *factory = self->default_factory ? self->default_factory : Py_None;
+    return DequeDict_deepcopy_as(&self->base, PyTuple_Pack(1, factory), memo);
+}
+
+static PyObject *
+DefaultDequeDict_repr(DefaultDequeDictObject *self)
+{
+    PyObject *factory = self->default_factory ? self->default_factory : Py_None;
+
+    int status = Py_ReprEnter((PyObject *)self);
+    if (status != 0)
+        return status > 0 ? PyUnicode_FromString("...") : NULL;
+
+    PyObject *repr = NULL;
+    PyObject *items = DequeDict_items_list(&self->base);
+    if (items) {
+        repr = PyUnicode_FromFormat("DefaultDequeDict(%S, %R)", factory, items);
+        Py_DECREF(items);
+    }
+    Py_ReprLeave((PyObject *)self);
+    return repr;
+}
+
+DEQUEDICT_LOCKED(PyObject *, DefaultDequeDict_missing, op, (PyObject *op, PyObject *key), (op, key))
+DEQUEDICT_LOCKED(PyObject *, DefaultDequeDict_copy, self,
+                 (DefaultDequeDictObject *self, PyObject *args), (self, args))
+DEQUEDICT_LOCKED(PyObject *, DefaultDequeDict_reduce, self,
+                 (DefaultDequeDictObject *self, PyObject *args), (self, args))
+DEQUEDICT_LOCKED(PyObject *, DefaultDequeDict_deepcopy, self,
+                 (DefaultDequeDictObject *self, PyObject *memo), (self, memo))
+DEQUEDICT_LOCKED(PyObject *, DefaultDequeDict_repr, self, (DefaultDequeDictObject *self), (self))
+DEQUEDICT_LOCKED(int, DefaultDequeDict_init, self,
+                 (DefaultDequeDictObject *self, PyObject *args, PyObject *kwds), (self, args, kwds))
+
+static PyMethodDef DefaultDequeDict_methods[] = {
+    {"__missing__", (PyCFunction)DefaultDequeDict_missing_locked, METH_O,
+     "D.__missing__(key) -> D[key] = default_factory() and return it"},
+    {"copy", (PyCFunction)DefaultDequeDict_copy_locked, METH_NOARGS, "D.copy() -> a shallow copy"},
+    {"__copy__", (PyCFunction)DefaultDequeDict_copy_locked, METH_NOARGS, "Shallow copy of the same type"},
+    {"__deepcopy__", (PyCFunction)DefaultDequeDict_deepcopy_locked, METH_O,
+     "Deep copy, for copy.deepcopy()"},
+    {"__reduce__", (PyCFunction)DefaultDequeDict_reduce_locked, METH_NOARGS,
+     "Pickle as default_factory plus flat key and value lists"},
+    {NULL}
+};
+
+static PyMemberDef DefaultDequeDict_members[] = {
+    {"default_factory", T_OBJECT, offsetof(DefaultDequeDictObject, default_factory), 0,
+     "Factory for missing keys, or None"},
+    {NULL}
+};
+
+static PyTypeObject DefaultDequeDict_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "dequedict.DefaultDequeDict",
+    .tp_basicsize = sizeof(DefaultDequeDictObject),
+    .tp_dealloc = (destructor)DefaultDequeDict_dealloc,
+    .tp_repr = (reprfunc)DefaultDequeDict_repr_locked,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,
+    .tp_doc = "DequeDict with default_factory for missing keys, like collections.defaultdict.",
+    .tp_traverse = (traverseproc)DefaultDequeDict_traverse,
+    .tp_clear = (inquiry)DefaultDequeDict_tp_clear,
+    .tp_methods = DefaultDequeDict_methods,
+    .tp_members = DefaultDequeDict_members,
+    .tp_init = (initproc)DefaultDequeDict_init_locked,
+};
+
+/* ========================================================================
+ * AsyncDequeDict - DequeDict with awaitable pops for asyncio consumers
+ *
+ * apopleft() and friends return an awaiter that takes an entry at once if
+ * one is free. Otherwise it queues itself on the DequeDict and suspends
+ * on a fresh Future. The insert path only flags the queue; at the end of
+ * the inserting call DequeDict_finish() resolves one Future per new
+ * entry, so an extend() of many pairs wakes its consumers in one pass.
+ * A woken awaiter is owed an entry (aio->woken) and takes it when its
+ * task resumes, queueing again at the front if a synchronous pop got
+ * there first. Futures are not thread-safe, so a producer on another
+ * thread hands the wakeup to the loop with call_soon_threadsafe().
+ * ======================================================================== */
+
+static PyTypeObject AsyncDequeDict_Type;
+static PyTypeObject DequeDictAwaiter_Type;
+
+static PyObject *asyncio_get_running_loop;  /* Imported on first wait */
+static PyObject *asyncio_timeout_error;
+
+static PyObject *str_done;
+static PyObject *str_result;
+static PyObject *str_set_result;
+static PyObject *str_create_future;
+static PyObject *str_call_later;
+static PyObject *str_call_soon_threadsafe;
+static PyObject *str_cancel;
+static PyObject *str__asyncio_future_blocking;
+
+typedef struct {
+    PyObject_HEAD
+    DequeDictObject *dd;
+    PyObject *future;               /* Future the awaiter is suspended on, or NULL */
+    PyObject *timer;                /* TimerHandle of the timeout, or NULL */
+    double timeout;                 /* Seconds, or -1 to wait forever */
+    Py_ssize_t n;                   /* Batch size of apopleft_n(), or -1 */
+    char items;                     /* Return (key, value) pairs */
+    char woken;                     /* Woken by an insert and owed an entry */
+    char timed_out;
+    char finished;                  /* Result delivered or wait abandoned */
+} DequeDictAwaiter;
+
+static int
+asyncio_import(void)
+{
+    if (asyncio_timeout_error)
+        return 0;
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (!asyncio) return -1;
+    PyObject *get_running_loop = PyObject_GetAttrString(asyncio, "get_running_loop");
+    PyObject *timeout_error = get_running_loop ? PyObject_GetAttrString(asyncio, "TimeoutError") : NULL;
+    Py_DECREF(asyncio);
+    if (!timeout_error) {
+        Py_XDECREF(get_running_loop);
+        return -1;
+    }
+    asyncio_get_running_loop = get_running_loop;
+    asyncio_timeout_error = timeout_error;
+    return 0;
+}
+
+/* Sweep out awaiters that are no longer suspended (timed out or
+ * cancelled while queued), keeping the order of the rest */
+static void
+DequeDict_async_sweep(DequeDictAsync *aio)
+{
+    Py_ssize_t kept = 0;
+    for (Py_ssize_t i = 0; i < aio->len; i++) {
+        DequeDictAwaiter *aw = (DequeDictAwaiter *)aio->queue[(aio->first + i) % aio->cap];
+        if (aw->future && !aw->finished)
+            aio->queue[(aio->first + kept++) % aio->cap] = (PyObject *)aw;
+        else
+            Py_DECREF(aw);
+    }
+    aio->len = aio->swept = kept;
+}
+
+/* Queue aw at the back, or at the front after a lost wakeup. Sweeps the
+ * queue whenever it has doubled since the last sweep, so abandoned waits
+ * cannot pile up while nothing is inserted. Returns 0 or -1. */
+static int
+DequeDict_async_push(DequeDictObject *self, DequeDictAwaiter *aw, int front)
+{
+    DequeDictAsync *aio = self->aio;
+    if (aio->len >= 2 * aio->swept + 8)
+        DequeDict_async_sweep(aio);
+    if (aio->len == aio->cap) {
+        Py_ssize_t cap = aio->cap ? 2 * aio->cap : 8;
+        PyObject **queue = PyMem_Malloc(sizeof(PyObject *) * cap);
+        if (!queue) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        for (Py_ssize_t i = 0; i < aio->len; i++)
+            queue[i] = aio->queue[(aio->first + i) % aio->cap];
+        PyMem_Free(aio->queue);
+        aio->queue = queue;
+        aio->cap = cap;
+        aio->first = 0;
+    }
+    Py_INCREF(aw);
+    if (front) {
+        aio->first = (aio->first + aio->cap - 1) % aio->cap;
+        aio->queue[aio->first] = (PyObject *)aw;
+    }
+    else {
+        aio->queue[(aio->first + aio->len) % aio->cap] = (PyObject *)aw;
+    }
+    aio->len++;
+    return 0;
+}
+
+static PyObject *DequeDict_wake_callback_locked(DequeDictObject *self, PyObject *arg);
+
+static PyMethodDef DequeDict_wake_def = {
+    "_wake_awaiters", (PyCFunction)DequeDict_wake_callback_locked, METH_NOARGS, NULL
+};
+
+/* Resolve the Futures of queued awaiters while the entries outnumber the
+ * awaiters already owed one. Failures are reported as unraisable, since
+ * the insert that got here has succeeded; an exception already set is
+ * kept. */
+static void
+DequeDict_wake_awaiters(DequeDictObject *self)
+{
+    DequeDictAsync *aio = self->aio;
+    aio->pending = 0;
+    if (!aio->loop)
+        return;
+
+    PyObject *exc_type, *exc_value, *exc_tb;
+    PyErr_Fetch(&exc_type, &exc_value, &exc_tb);
+    if (PyThread_get_thread_ident() != aio->thread) {
+        if (!aio->scheduled) {
+            PyObject *wake = PyCFunction_New(&DequeDict_wake_def, (PyObject *)self);
+            PyObject *r = wake ? PyObject_CallMethodOneArg(aio->loop, str_call_soon_threadsafe, wake) : NULL;
+            Py_XDECREF(wake);
+            if (r && self->aio)
+                self->aio->scheduled = 1;
+            else if (!r)
+                PyErr_WriteUnraisable((PyObject *)self);
+            Py_XDECREF(r);
+        }
+    }
+    else {
+        /* Futures run no callbacks synchronously, but re-read the queue
+         * after every call in case one re-entered */
+        while ((aio = self->aio) && aio->len && self->size > aio->woken) {
+            DequeDictAwaiter *aw = (DequeDictAwaiter *)aio->queue[aio->first];
+            aio->first = (aio->first + 1) % aio->cap;
+            aio->len--;
+            if (aw->future && !aw->finished && !aw->woken) {
+                PyObject *done = PyObject_CallMethodNoArgs(aw->future, str_done);
+                int is_done = done ? PyObject_IsTrue(done) : -1;
+                Py_XDECREF(done);
+                PyObject *r = is_done == 0 ? PyObject_CallMethodOneArg(aw->future, str_set_result, Py_None) : NULL;
+                if (r && self->aio) {
+                    aw->woken = 1;
+                    self->aio->woken++;
+                }
+                if (is_done < 0 || (is_done == 0 && !r))
+                    PyErr_WriteUnraisable(aw->future);
+                Py_XDECREF(r);
+            }
+            Py_DECREF(aw);
+        }
+    }
+    PyErr_Restore(exc_type, exc_value, exc_tb);
+}
+
+/* Run on the loop for a wakeup from another thread */
+static PyObject *
+DequeDict_wake_callback(DequeDictObject *self, PyObject *Py_UNUSED(arg))
+{
+    if (self->aio) {
+        self->aio->scheduled = 0;
+        DequeDict_wake_awaiters(self);
+    }
+    Py_RETURN_NONE;
+}
+
+LOCKED_METH_O(DequeDict_wake_callback)
+
+/* Stop waiting: give up an owed entry to the next awaiter and cancel the
+ * timeout. An exception already set is kept. */
+static void
+DequeDictAwaiter_retire(DequeDictAwaiter *aw, DequeDictObject *dd)
+{
+    aw->finished = 1;
+    Py_CLEAR(aw->future);
+    if (aw->woken) {
+        aw->woken = 0;
+        if (dd->aio) {
+            dd->aio->woken--;
+            if (dd->aio->len)
+                DequeDict_wake_awaiters(dd);
+        }
+    }
+    if (aw->timer) {
+        PyObject *exc_type, *exc_value, *exc_tb;
+        PyObject *timer = aw->timer;
+        aw->timer = NULL;
+        PyErr_Fetch(&exc_type, &exc_value, &exc_tb);
+        PyObject *r = PyObject_CallMethodNoArgs(timer, str_cancel);
+        if (!r)
+            PyErr_WriteUnraisable(timer);
+        Py_XDECREF(r);
+        PyErr_Restore(exc_type, exc_value, exc_tb);
+        Py_DECREF(timer);
+    }
+}
+
+/* Retire aw and deliver result (a new reference, or NULL with an
+ * exception set) as the StopIteration of its coroutine protocol */
+static PyObject *
+DequeDictAwaiter_finish(DequeDictAwaiter *aw, DequeDictObject *dd, PyObject *result)
+{
+    DequeDictAwaiter_retire(aw, dd);
+    if (!result)
+        return NULL;
+    /* PyErr_SetObject() would unpack a tuple result into arguments */
+    PyObject *stop = PyObject_CallOneArg(PyExc_StopIteration, result);
+    Py_DECREF(result);
+    if (stop) {
+        PyErr_SetObject(PyExc_StopIteration, stop);
+        Py_DECREF(stop);
+    }
+    return NULL;
+}
+
+/* Queue aw and return a Future for its task to suspend on */
+static PyObject *
+DequeDictAwaiter_suspend(DequeDictAwaiter *aw, DequeDictObject *dd, int front)
+{
+    PyObject *loop = PyObject_CallNoArgs(asyncio_get_running_loop);
+    if (!loop)
+        return DequeDictAwaiter_finish(aw, dd, NULL);
+    if (!dd->aio) {
+        dd->aio = PyMem_Calloc(1, sizeof(DequeDictAsync));
+        if (!dd->aio) {
+            Py_DECREF(loop);
+            PyErr_NoMemory();
+            return DequeDictAwaiter_finish(aw, dd, NULL);
+        }
+    }
+    DequeDictAsync *aio = dd->aio;
+    if (aio->loop != loop) {
+        DequeDict_async_sweep(aio);
+        if (aio->len || aio->woken) {
+            Py_DECREF(loop);
+            PyErr_SetString(PyExc_RuntimeError, "AsyncDequeDict is already awaited on another event loop");
+            return DequeDictAwaiter_finish(aw, dd, NULL);
+        }
+        Py_XDECREF(aio->loop);
+        aio->loop = loop;
+        aio->thread = PyThread_get_thread_ident();
+    }
+    else {
+        Py_DECREF(loop);
+    }
+
+    PyObject *fut = PyObject_CallMethodNoArgs(aio->loop, str_create_future);
+    if (!fut)
+        return DequeDictAwaiter_finish(aw, dd, NULL);
+    if (aw->timeout > 0 && !aw->timer && dd->aio) {
+        PyObject *delay = PyFloat_FromDouble(aw->timeout);
+        aw->timer = delay ? PyObject_CallMethodObjArgs(dd->aio->loop, str_call_later, delay, (PyObject *)aw, NULL)
+                          : NULL;
+        Py_XDECREF(delay);
+        if (!aw->timer) {
+            Py_DECREF(fut);
+            return DequeDictAwaiter_finish(aw, dd, NULL);
+        }
+    }
+    if (PyObject_SetAttr(fut, str__asyncio_future_blocking, Py_True) < 0
+        || !dd->aio || DequeDict_async_push(dd, aw, front) < 0) {
+        if (!PyErr_Occurred())
+            PyErr_SetString(PyExc_RuntimeError, "AsyncDequeDict cleared while awaited");
+        Py_DECREF(fut);
+        return DequeDictAwaiter_finish(aw, dd, NULL);
+    }
+    Py_INCREF(fut);
+    aw->future = fut;
+    return fut;
+}
+
+/* One step of the coroutine protocol: the result as StopIteration, a
+ * Future to suspend on, or an exception */
+static PyObject *
+DequeDictAwaiter_step(DequeDictAwaiter *aw, DequeDictObject *dd)
+{
+    if (aw->finished)
+        return NULL;
+    int front = 0;
+    if (aw->future) {
+        /* Resumed: woken by an insert, timed out or cancelled */
+        PyObject *fut = aw->future;
+        aw->future = NULL;
+        if (aw->woken) {
+            aw->woken = 0;
+            front = 1;
+            if (dd->aio)
+                dd->aio->woken--;
+        }
+        else if (!aw->timed_out) {
+            /* Raises the CancelledError of a cancelled Future */
+            PyObject *r = PyObject_CallMethodNoArgs(fut, str_result);
+            if (!r) {
+                Py_DECREF(fut);
+                return DequeDictAwaiter_finish(aw, dd, NULL);
+            }
+            Py_DECREF(r);
+        }
+        Py_DECREF(fut);
+    }
+
+    /* Entries beyond those owed to other woken awaiters are free to take */
+    Py_ssize_t spare = dd->size - (dd->aio ? dd->aio->woken : 0);
+    if (spare < 0)
+        spare = 0;
+    if (spare > 0 || aw->n == 0) {
+        PyObject *result = aw->n >= 0 ? DequeDict_pop_count(dd, aw->n < spare ? aw->n : spare, 1, aw->items)
+                         : aw->items ? DequeDict_popleftitem(dd, NULL)
+                         : DequeDict_popleft(dd, NULL);
+        return DequeDictAwaiter_finish(aw, dd, result);
+    }
+    if (asyncio_import() < 0)
+        return DequeDictAwaiter_finish(aw, dd, NULL);
+    if (aw->timed_out || aw->timeout == 0) {
+        if (aw->n >= 0)
+            return DequeDictAwaiter_finish(aw, dd, PyList_New(0));
+        PyErr_SetNone(asyncio_timeout_error);
+        return DequeDictAwaiter_finish(aw, dd, NULL);
+    }
+    return DequeDictAwaiter_suspend(aw, dd, front);
+}
+
+/* Called by the loop when the timeout expires */
+static PyObject *
+DequeDictAwaiter_expire(DequeDictAwaiter *aw, DequeDictObject *dd)
+{
+    (void)dd;
+    Py_CLEAR(aw->timer);
+    aw->timed_out = 1;
+    if (aw->future && !aw->woken && !aw->finished) {
+        PyObject *done = PyObject_CallMethodNoArgs(aw->future, str_done);
+        int is_done = done ? PyObject_IsTrue(done) : -1;
+        Py_XDECREF(done);
+        if (is_done < 0)
+            return NULL;
+        if (!is_done)
+            return PyObject_CallMethodOneArg(aw->future, str_set_result, Py_None);
+    }
+    Py_RETURN_NONE;
+}
+
+/* throw() from a cancelled task, or a caller's own exception */
+static PyObject *
+DequeDictAwaiter_abandon(DequeDictAwaiter *aw, DequeDictObject *dd)
+{
+    if (!aw->finished)
+        DequeDictAwaiter_retire(aw, dd);
+    return NULL;
+}
+
+DEQUEDICT_LOCKED(PyObject *, DequeDictAwaiter_step, dd, (DequeDictAwaiter *aw, DequeDictObject *dd), (aw, dd))
+DEQUEDICT_LOCKED(PyObject *, DequeDictAwaiter_expire, dd, (DequeDictAwaiter *aw, DequeDictObject *dd), (aw, dd))
+DEQUEDICT_LOCKED(PyObject *, DequeDictAwaiter_abandon, dd, (DequeDictAwaiter *aw, DequeDictObject *dd), (aw, dd))
+
+static PyObject *
+DequeDictAwaiter_next(DequeDictAwaiter *aw)
+{
+    return DequeDictAwaiter_step_locked(aw, aw->dd);
+}
+
+static PyObject *
+DequeDictAwaiter_send(DequeDictAwaiter *aw, PyObject *Py_UNUSED(value))
+{
+    PyObject *r = DequeDictAwaiter_step_locked(aw, aw->dd);
+    if (!r && !PyErr_Occurred())
+        PyErr_SetNone(PyExc_StopIteration);
+    return r;
+}
+
+static PyObject *
+DequeDictAwaiter_throw(DequeDictAwaiter *aw, PyObject *args)
+{
+    PyObject *type, *value = NULL, *tb = NULL;
+    if (!PyArg_UnpackTuple(args, "throw", 1, 3, &type, &value, &tb))
+        return NULL;
+    if (PyExceptionInstance_Check(type)) {
+        value = type;
+        type = (PyObject *)Py_TYPE(type);
+    }
+    else if (!PyExceptionClass_Check(type)) {
+        PyErr_SetString(PyExc_TypeError, "exceptions must derive from BaseException");
+        return NULL;
+    }
+    DequeDictAwaiter_abandon_locked(aw, aw->dd);
+    if (value)
+        PyErr_SetObject(type, value);
+    else
+        PyErr_SetNone(type);
+    return NULL;
+}
+
+static PyObject *
+DequeDictAwaiter_close(DequeDictAwaiter *aw, PyObject *Py_UNUSED(args))
+{
+    DequeDictAwaiter_abandon_locked(aw, aw->dd);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+DequeDictAwaiter_call(DequeDictAwaiter *aw, PyObject *Py_UNUSED(args), PyObject *Py_UNUSED(kwds))
+{
+    return DequeDictAwaiter_expire_locked(aw, aw->dd);
+}
+
+static PyObject *
+DequeDictAwaiter_await(DequeDictAwaiter *aw)
+{
+    Py_INCREF(aw);
+    return (PyObject *)aw;
+}
+
+static int
+DequeDictAwaiter_traverse(DequeDictAwaiter *aw, visitproc visit, void *arg)
+{
+    Py_VISIT(aw->dd);
+    Py_VISIT(aw->future);
+    Py_VISIT(aw->timer);
+    return 0;
+}
+
+static int
+DequeDictAwaiter_tp_clear(DequeDictAwaiter *aw)
+{
+    Py_CLEAR(aw->future);
+    Py_CLEAR(aw->timer);
+    Py_CLEAR(aw->dd);
+    return 0;
+}
+
+static void
+DequeDictAwaiter_dealloc(DequeDictAwaiter *aw)
+{
+    PyObject_GC_UnTrack(aw);
+    /* Dropped after a wakeup, say with its task: pass the entry on */
+    if (aw->dd && aw->woken)
+        DequeDictAwaiter_abandon_locked(aw, aw->dd);
+    DequeDictAwaiter_tp_clear(aw);
+    PyObject_GC_Del(aw);
+}
+
+static PyMethodDef DequeDictAwaiter_methods[] = {
+    {"send", (PyCFunction)DequeDictAwaiter_send, METH_O, "Resume the wait; the value is ignored"},
+    {"throw", (PyCFunction)DequeDictAwaiter_throw, METH_VARARGS, "Abandon the wait and raise the exception"},
+    {"close", (PyCFunction)DequeDictAwaiter_close, METH_NOARGS, "Abandon the wait"},
+    {NULL}
+};
+
+static PyAsyncMethods DequeDictAwaiter_as_async = {
+    .am_await = (unaryfunc)DequeDictAwaiter_await,
+};
+
+static PyTypeObject DequeDictAwaiter_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "dequedict.DequeDictAwaiter",
+    .tp_basicsize = sizeof(DequeDictAwaiter),
+    .tp_dealloc = (destructor)DequeDictAwaiter_dealloc,
+    .tp_as_async = &DequeDictAwaiter_as_async,
+    .tp_call = (ternaryfunc)DequeDictAwaiter_call,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_doc = "Awaitable result of AsyncDequeDict.apopleft() and friends.",
+    .tp_traverse = (traverseproc)DequeDictAwaiter_traverse,
+    .tp_clear = (inquiry)DequeDictAwaiter_tp_clear,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc)DequeDictAwaiter_next,
+    .tp_methods = DequeDictAwaiter_methods,
+};
+
+static PyObject *
+AsyncDequeDict_awaiter(DequeDictObject *self, PyObject *timeout, Py_ssize_t n, int items)
+{
+    int64_t timeout_us;
+    if (DequeDict_timeout_arg(timeout, &timeout_us) < 0)
+        return NULL;
+    DequeDictAwaiter *aw = PyObject_GC_New(DequeDictAwaiter, &DequeDictAwaiter_Type);
+    if (!aw) return NULL;
+    Py_INCREF(self);
+    aw->dd = self;
+    aw->future = NULL;
+    aw->timer = NULL;
+    /* None is -1 here too, but means no timeout rather than no wait */
+    aw->timeout = timeout_us < 0 || timeout_us == INT64_MAX ? -1 : timeout_us / 1e6;
+    aw->n = n;
+    aw->items = (char)items;
+    aw->woken = 0;
+    aw->timed_out = 0;
+    aw->finished = 0;
+    PyObject_GC_Track(aw);
+    return (PyObject *)aw;
+}
+
+/* apopleft(timeout=None) / apopleftitem(timeout=None) - awaitable
+ * popleft(), raising asyncio.TimeoutError after timeout seconds */
+static PyObject *
+AsyncDequeDict_apopleft_wait(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs,
+                             PyObject *kwnames, int items)
+{
+    static const char *const kwlist[] = {"timeout", NULL};
+    PyObject *timeout = NULL;
+    if ((nargs || kwnames)
+        && DequeDict_parse_args(items ? "apopleftitem" : "apopleft", args, nargs, kwnames, kwlist, 1, 0,
+                                &timeout) < 0)
+        return NULL;
+    return AsyncDequeDict_awaiter(self, timeout, -1, items);
+}
+
+static PyObject *
+AsyncDequeDict_apopleft(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    return AsyncDequeDict_apopleft_wait(self, args, nargs, kwnames, 0);
+}
+
+static PyObject *
+AsyncDequeDict_apopleftitem(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    return AsyncDequeDict_apopleft_wait(self, args, nargs, kwnames, 1);
+}
+
+/* apopleft_n(n, timeout=None) - wait for an entry, then pop up to n first
+ * values at once; [] after timeout seconds */
+static PyObject *
+AsyncDequeDict_apopleft_n(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    static const char *const kwlist[] = {"n", "timeout", NULL};
+    PyObject *argv[2] = {NULL, NULL};
+    if (DequeDict_parse_args("apopleft_n", args, nargs, kwnames, kwlist, 2, 1, argv) < 0)
+        return NULL;
+    Py_ssize_t n = DequeDict_count_arg(argv[0]);
+    if (n < 0)
+        return NULL;
+    return AsyncDequeDict_awaiter(self, argv[1], n, 0);
+}
+
+static PyMethodDef AsyncDequeDict_methods[] = {
+    {"apopleft", (PyCFunction)(void(*)(void))AsyncDequeDict_apopleft, METH_FASTCALL | METH_KEYWORDS,
+     "Awaitable popleft(): waits for an entry, up to timeout seconds"},
+    {"apopleftitem", (PyCFunction)(void(*)(void))AsyncDequeDict_apopleftitem, METH_FASTCALL | METH_KEYWORDS,
+     "Awaitable popleftitem(): waits for an entry, up to timeout seconds"},
+    {"apopleft_n", (PyCFunction)(void(*)(void))AsyncDequeDict_apopleft_n, METH_FASTCALL | METH_KEYWORDS,
+     "Wait for an entry, then remove and return up to n first values; [] on timeout"},
+    {NULL}
+};
+
+static PyTypeObject AsyncDequeDict_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "dequedict.AsyncDequeDict",
+    .tp_basicsize = sizeof(DequeDictObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,
+    .tp_doc = "DequeDict whose consumers can await apopleft() and apopleft_n() on an asyncio loop.",
+    .tp_traverse = (traverseproc)DequeDict_traverse,
+    .tp_clear = (inquiry)DequeDict_tp_clear,
+    .tp_methods = AsyncDequeDict_methods,
+};
+
+/* ========================================================================
+ * PriorityDequeDict - DequeDict ordered by a score per entry
+ *
+ * Shares DequeDict's object layout and storage, with the entry list kept
+ * sorted by score over the skip list above, so lookups, deletes, views and
+ * both ends reuse the DequeDict functions. Only push(), update_score()
+ * and construction place entries; the methods that choose a position
+ * themselves (appendleft, move_to_end, insert_at, ...) are left out.
+ * ======================================================================== */
+
+static PyTypeObject PriorityDequeDict_Type;
+
+static PyObject *
+PriorityDequeDict_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    DequeDictObject *self = (DequeDictObject *)DequeDict_new(type, args, kwds);
+    if (!self) return NULL;
+    self->skip_ends = PyMem_Malloc(sizeof(DequeDictSkipLink) * SKIP_LEVELS);
+    if (!self->skip_ends) {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    for (int l = 0; l < SKIP_LEVELS; l++)
+        self->skip_ends[l].prev = self->skip_ends[l].next = LINK_NONE;
+    self->scored = 1;
+    self->rank_seed = (uint32_t)((uintptr_t)self >> 4) | 1u;
+    self->gc_mode = GC_LAZY;
+    PyObject_GC_UnTrack(self);
+    return (PyObject *)self;
+}
+
+/* Score argument: any real number but NaN, which would break the order */
+static int
+PriorityDequeDict_score_arg(PyObject *arg, double *out)
+{
+    double score = PyFloat_AsDouble(arg);
+    if (score == -1.0 && PyErr_Occurred())
+        return -1;
+    if (score != score) {
+        PyErr_SetString(PyExc_ValueError, "score must not be NaN");
+        return -1;
+    }
+    *out = score;
+    return 0;
+}
+
+/* Link entry ix, whose score and tower are set, after the last entry
+ * with a score <= its own */
+static void
+PriorityDequeDict_link(DequeDictObject *self, Py_ssize_t ix)
+{
+    DequeDictLink preds[SKIP_LEVELS];
+    DequeDictScore *node = &self->scores[ix];
+    Py_ssize_t pred = skip_find(self, node->score, preds);
+    DequeDict_link_before(self, ix, pred == LINK_NONE ? self->head : ENTRY(self, pred)->next);
+    for (int l = 0; l < node->height; l++)
+        skip_link_after(self, ix, l, preds[l]);
+    if (node->height > self->skip_height)
+        self->skip_height = node->height;
+}
+
+/* Give entry ix a new score. It moves after the entries it now ties,
+ * like a new push, unless it still sits between its neighbours. */
+static void
+PriorityDequeDict_rescore(DequeDictObject *self, Py_ssize_t ix, double score)
+{
+    DequeDictEntry *entry = ENTRY(self, ix);
+    if (score == SCORE(self, ix))
+        return;
+    if ((entry->prev == LINK_NONE || SCORE(self, entry->prev) <= score)
+        && (entry->next == LINK_NONE || score < SCORE(self, entry->next))) {
+        SCORE(self, ix) = score;
+        return;
+    }
+    DequeDict_unlink(self, ix);
+    SCORE(self, ix) = score;
+    PriorityDequeDict_link(self, ix);
+}
+
+/* Add an entry for a key known to be absent. Runs no Python code, so
+ * copy() can feed it from another PriorityDequeDict's list. */
+static int
+PriorityDequeDict_insert_new(DequeDictObject *self, PyObject *key, Py_hash_t hash, PyObject *value,
+                             double score)
+{
+    int height = skip_random_height(self);
+    DequeDictSkipLink *up = NULL;
+    if (height && !(up = PyMem_Malloc(sizeof(DequeDictSkipLink) * height))) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    if (DequeDict_reserve(self) < 0) {
+        PyMem_Free(up);
+        return -1;
+    }
+
+    Py_ssize_t ix = entry_alloc(self);
+    DequeDictEntry *new_entry = ENTRY(self, ix);
+    Py_INCREF(key);
+    Py_INCREF(value);
+    new_entry->key = key;
+    new_entry->value = value;
+    new_entry->hash = hash;
+    DequeDict_maintain_tracking(self, key);
+    DequeDict_maintain_tracking(self, value);
+    self->scores[ix].score = score;
+    self->scores[ix].height = height;
+    self->scores[ix].up = up;
+    PriorityDequeDict_link(self, ix);
+    self->size++;
+    index_insert(self, ix);
+    return 0;
+}
+
+/* Insert key with a score, or give an existing key the value and score */
+static int
+PriorityDequeDict_push_score(DequeDictObject *self, PyObject *key, PyObject *value, PyObject *score_arg)
+{
+    double score;
+    if (PriorityDequeDict_score_arg(score_arg, &score) < 0)
+        return -1;
+    Py_hash_t hash;
+    Py_ssize_t ix;
+    int found = DequeDict_find(self, key, &hash, &ix, NULL);
+    if (found < 0)
+        return -1;
+    if (!found)
+        return PriorityDequeDict_insert_new(self, key, hash, value, score);
+
+    DequeDictEntry *entry = ENTRY(self, ix);
+    PyObject *old_value = entry->value;
+    Py_INCREF(value);
+    entry->value = value;
+    DequeDict_maintain_tracking(self, value);
+    PriorityDequeDict_rescore(self, ix, score);
+    Py_DECREF(old_value);
+    return 0;
+}
+
+/* push() every (key, value, score) triple of an iterable */
+static int
+PriorityDequeDict_merge(DequeDictObject *self, PyObject *items)
+{
+    Py_ssize_t hint = PyObject_LengthHint(items, 0);
+    if (hint < 0 || DequeDict_presize(self, hint) < 0)
+        return -1;
+    PyObject *iter = PyObject_GetIter(items);
+    if (!iter) return -1;
+
+    PyObject *item;
+    int r = 0;
+    while (r == 0 && (item = PyIter_Next(iter)) != NULL) {
+        if (!PyTuple_Check(item) || PyTuple_GET_SIZE(item) != 3) {
+            PyErr_SetString(PyExc_ValueError, "PriorityDequeDict requires sequence of (key, value, score) triples");
+            r = -1;
+        }
+        else {
+            r = PriorityDequeDict_push_score(self, PyTuple_GET_ITEM(item, 0), PyTuple_GET_ITEM(item, 1),
+                                             PyTuple_GET_ITEM(item, 2));
+        }
+        Py_DECREF(item);
+    }
+    Py_DECREF(iter);
+    if (r == 0 && PyErr_Occurred())
+        r = -1;
+    return r;
+}
+
+static int
+PriorityDequeDict_init(DequeDictObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"items", NULL};
+    PyObject *items = NULL;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O:PriorityDequeDict", kwlist, &items))
+        return -1;
+
+    PyObject_GC_UnTrack(self);
+    DequeDict_clear(self);
+    int r = items ? PriorityDequeDict_merge(self, items) : 0;
+    if (self->gc_mode == GC_TRACKED && !PyObject_GC_IsTracked((PyObject *)self))
+        PyObject_GC_Track(self);
+    return r;
+}
+
+/* __setitem__ needs a score; __delitem__ is DequeDict's */
+static int
+PriorityDequeDict_setitem(DequeDictObject *self, PyObject *key, PyObject *value)
+{
+    if (value != NULL) {
+        PyErr_SetString(PyExc_TypeError, "PriorityDequeDict entries need a score: use push(key, value, score)");
+        return -1;
+    }
+    return DequeDict_setitem(self, key, NULL);
+}
+
+/* push(key, value, score) - O(log n), O(1) at or past the maximum score */
+static PyObject *
+PriorityDequeDict_push(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    if (!DequeDict_check_nargs("push", nargs, 3, 3))
+        return NULL;
+    if (PriorityDequeDict_push_score(self, args[0], args[1], args[2]) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+/* update_score(key, score) - O(log n) move, O(1) if the order holds */
+static PyObject *
+PriorityDequeDict_update_score(DequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    if (!DequeDict_check_nargs("update_score", nargs, 2, 2))
+        return NULL;
+    double score;
+    if (PriorityDequeDict_score_arg(args[1], &score) < 0)
+        return NULL;
+    Py_ssize_t ix;
+    int found = DequeDict_find(self, args[0], NULL, &ix, NULL);
+    if (found <= 0) {
+        if (found == 0)
+            PyErr_SetObject(PyExc_KeyError, args[0]);
+        return NULL;
+    }
+    PriorityDequeDict_rescore(self, ix, score);
+    Py_RETURN_NONE;
+}
+
+/* score_of(key) - O(1) */
+static PyObject *
+PriorityDequeDict_score_of(DequeDictObject *self, PyObject *key)
+{
+    Py_ssize_t ix;
+    int found = DequeDict_find(self, key, NULL, &ix, NULL);
+    if (found <= 0) {
+        if (found == 0)
+            PyErr_SetObject(PyExc_KeyError, key);
+        return NULL;
+    }
+    return PyFloat_FromDouble(SCORE(self, ix));
+}
+
+/* List of (key, value, score) triples in order, for repr() and pickling */
+static PyObject *
+PriorityDequeDict_triples(DequeDictObject *self)
+{
+    PyObject *list = PyList_New(self->size);
+    if (!list) return NULL;
+
+    Py_ssize_t i = 0;
+    for (Py_ssize_t ix = self->head; ix != LINK_NONE; ix = ENTRY(self, ix)->next, i++) {
+        DequeDictEntry *entry = ENTRY(self, ix);
+        PyObject *score = PyFloat_FromDouble(SCORE(self, ix));
+        PyObject *triple = score ? PyTuple_Pack(3, entry->key, entry->value, score) : NULL;
+        Py_XDECREF(score);
+        if (!triple) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, triple);
+    }
+    return list;
+}
+
+/* copy() / __copy__() - same entries, scores and order; nothing is rehashed
+ * and every entry lands at the tail */
+static PyObject *
+PriorityDequeDict_copy(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    DequeDictObject *copy = (DequeDictObject *)PriorityDequeDict_new(Py_TYPE(self), NULL, NULL);
+    if (!copy) return NULL;
+    if (DequeDict_presize(copy, self->size) < 0) {
+        Py_DECREF(copy);
+        return NULL;
+    }
+    for (Py_ssize_t ix = self->head; ix != LINK_NONE; ix = ENTRY(self, ix)->next) {
+        DequeDictEntry *entry = ENTRY(self, ix);
+        if (PriorityDequeDict_insert_new(copy, entry->key, entry->hash, entry->value, SCORE(self, ix)) < 0) {
+            Py_DECREF(copy);
+            return NULL;
+        }
+    }
+    return (PyObject *)copy;
+}
+
+/* __reduce__ - PriorityDequeDict(triples) */
+static PyObject *
+PriorityDequeDict_reduce(DequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    PyObject *triples = PriorityDequeDict_triples(self);
+    if (!triples) return NULL;
+    return Py_BuildValue("O(N)", (PyObject *)Py_TYPE(self), triples);
+}
+
+static PyObject *
+PriorityDequeDict_repr(DequeDictObject *self)
+{
+    if (self->size == 0)
+        return PyUnicode_FromString("PriorityDequeDict()");
+
+    int status = Py_ReprEnter((PyObject *)self);
+    if (status != 0)
+        return status > 0 ? PyUnicode_FromString("...") : NULL;
+
+    PyObject *repr = NULL;
+    PyObject *triples = PriorityDequeDict_triples(self);
+    if (triples) {
+        repr = PyUnicode_FromFormat("PriorityDequeDict(%R)", triples);
+        Py_DECREF(triples);
+    }
+    Py_ReprLeave((PyObject *)self);
+    return repr;
+}
+
+LOCKED_FASTCALL(PriorityDequeDict_push)
+LOCKED_FASTCALL(PriorityDequeDict_update_score)
+LOCKED_METH_O(PriorityDequeDict_score_of)
+LOCKED_METH_O(PriorityDequeDict_copy)
+LOCKED_METH_O(PriorityDequeDict_reduce)
+DEQUEDICT_LOCKED(PyObject *, PriorityDequeDict_repr, self, (DequeDictObject *self), (self))
+DEQUEDICT_LOCKED(int, PriorityDequeDict_setitem, self,
+                 (DequeDictObject *self, PyObject *key, PyObject *value), (self, key, value))
+DEQUEDICT_LOCKED(int, PriorityDequeDict_init, self,
+                 (DequeDictObject *self, PyObject *args, PyObject *kwds), (self, args, kwds))
+
+static PyMethodDef PriorityDequeDict_methods[] = {
+    /* Both ends - O(1) */
+    {"peekleft", (PyCFunction)DequeDict_peekleft_locked, METH_NOARGS,
+     "Return the value with the lowest score without removing - O(1)"},
+    {"peekleftitem", (PyCFunction)DequeDict_peekleftitem_locked, METH_NOARGS,
+     "Return the (key, value) with the lowest score without removing - O(1)"},
+    {"peekleftkey", (PyCFunction)DequeDict_peekleftkey_locked, METH_NOARGS,
+     "Return the key with the lowest score without removing - O(1)"},
+    {"peek", (PyCFunction)DequeDict_peek_locked, METH_NOARGS,
+     "Return the value with the highest score without removing - O(1)"},
+    {"peekitem", (PyCFunction)DequeDict_peekitem_locked, METH_NOARGS,
+     "Return the (key, value) with the highest score without removing - O(1)"},
+    {"popleft", (PyCFunction)DequeDict_popleft_locked, METH_NOARGS,
+     "Remove and return the value with the lowest score - O(1)"},
+    {"popleftitem", (PyCFunction)DequeDict_popleftitem_locked, METH_NOARGS,
+     "Remove and return the (key, value) with the lowest score - O(1)"},
+    {"pop", (PyCFunction)(void(*)(void))DequeDict_pop_locked, METH_FASTCALL,
+     "Remove and return value by key or with the highest score - O(1)"},
+    {"popitem", (PyCFunction)DequeDict_popitem_locked, METH_NOARGS,
+     "Remove and return the (key, value) with the highest score - O(1)"},
+    {"popleft_n", (PyCFunction)DequeDict_popleft_n_locked, METH_O,
+     "Remove and return up to n values, lowest scores first - O(n)"},
+    {"pop_n", (PyCFunction)DequeDict_pop_n_locked, METH_O,
+     "Remove and return up to n values, highest scores first - O(n)"},
+    {"popleftitems_n", (PyCFunction)DequeDict_popleftitems_n_locked, METH_O,
+     "Remove and return up to n (key, value) pairs, lowest scores first - O(n)"},
+
+    /* Scores */
+    {"push", (PyCFunction)(void(*)(void))PriorityDequeDict_push_locked, METH_FASTCALL,
+     "Insert (key, value) with score, or replace its value and score - O(log n)"},
+    {"update_score", (PyCFunction)(void(*)(void))PriorityDequeDict_update_score_locked, METH_FASTCALL,
+     "Move key to its place for a new score - O(log n)"},
+    {"score_of", (PyCFunction)PriorityDequeDict_score_of_locked, METH_O,
+     "Return the score of key - O(1)"},
+
+    /* Dict-like operations */
+    {"get", (PyCFunction)(void(*)(void))DequeDict_get_locked, METH_FASTCALL, "D.get(k[,d]) -> D[k] if k in D, else d"},
+    {"keys", (PyCFunction)DequeDict_keys, METH_NOARGS, "D.keys() -> keys by score"},
+    {"values", (PyCFunction)DequeDict_values, METH_NOARGS, "D.values() -> values by score"},
+    {"items", (PyCFunction)DequeDict_items, METH_NOARGS, "D.items() -> (key, value) by score"},
+    {"clear", (PyCFunction)DequeDict_clear_method_locked, METH_NOARGS, "D.clear() -- remove all items"},
+    {"copy", (PyCFunction)PriorityDequeDict_copy_locked, METH_NOARGS, "D.copy() -> a shallow copy"},
+    {"__copy__", (PyCFunction)PriorityDequeDict_copy_locked, METH_NOARGS, "Shallow copy"},
+    {"__reduce__", (PyCFunction)PriorityDequeDict_reduce_locked, METH_NOARGS,
+     "Pickle as a list of (key, value, score) triples"},
+    {"__reversed__", (PyCFunction)DequeDict_reversed_locked, METH_NOARGS, "D.__reversed__() -- return reverse iterator"},
+    {"__sizeof__", (PyCFunction)DequeDict_sizeof_locked, METH_NOARGS, "D.__sizeof__() -> size of D in memory, in bytes"},
+    {"__class_getitem__", (PyCFunction)DequeDict_class_getitem, METH_O | METH_CLASS,
+     "See PEP 585"},
+    {NULL}
+};
+
+static PyMappingMethods PriorityDequeDict_as_mapping = {
+    .mp_length = (lenfunc)DequeDict_len_locked,
+    .mp_subscript = (binaryfunc)DequeDict_getitem_locked,
+    .mp_ass_subscript = (objobjargproc)PriorityDequeDict_setitem_locked,
+};
+
+static PyTypeObject PriorityDequeDict_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "dequedict.PriorityDequeDict",
+    .tp_basicsize = sizeof(DequeDictObject),
+    .tp_dealloc = (destructor)DequeDict_dealloc,
+    .tp_hash = PyObject_HashNotImplemented,
+    .tp_repr = (reprfunc)PriorityDequeDict_repr_locked,
+    .tp_as_sequence = &DequeDict_as_sequence,
+    .tp_as_mapping = &PriorityDequeDict_as_mapping,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_doc = "Dictionary ordered by a float score per key.\n\n"
+              "O(1) lookup, delete and peek/pop at the lowest (left) and highest\n"
+              "score; push() and update_score() place keys in O(log n).",
+    .tp_traverse = (traverseproc)DequeDict_traverse,
+    .tp_clear = (inquiry)DequeDict_tp_clear,
+    .tp_richcompare = (richcmpfunc)DequeDict_richcompare_locked,
+    .tp_iter = (getiterfunc)DequeDict_iter_locked,
+    .tp_methods = PriorityDequeDict_methods,
+    .tp_init = (initproc)PriorityDequeDict_init_locked,
+    .tp_new = PriorityDequeDict_new,
+};
+
+/* (functools.partial(type, **kwds), (items,)) - __reduce__ for types whose
+ * options are keyword-only; steals kwds and items */
+static PyObject *
+DequeDict_reduce_keywords(PyObject *type, PyObject *kwds, PyObject *items)
+{
+    PyObject *functools = NULL, *partial = NULL, *args = NULL, *ctor = NULL, *result = NULL;
+    if (kwds && items)
+        functools = PyImport_ImportModule("functools");
+    if (functools) {
+        partial = PyObject_GetAttrString(functools, "partial");
+        Py_DECREF(functools);
+    }
+    args = partial ? PyTuple_Pack(1, type) : NULL;
+    ctor = args ? PyObject_Call(partial, args, kwds) : NULL;
+    result = ctor ? Py_BuildValue("O(O)", ctor, items) : NULL;
+    Py_XDECREF(partial);
+    Py_XDECREF(args);
+    Py_XDECREF(ctor);
+    Py_XDECREF(kwds);
+    Py_XDECREF(items);
+    return result;
+}
+
+/* ========================================================================
+ * ShardedDequeDict
+ *
+ * Keys are hash-partitioned over N independent DequeDicts, each with its
+ * own list, index and lock, so threads working on different shards do not
+ * contend. Order is kept within each shard. popleft() without a shard
+ * takes the shards in turn, which approximates global FIFO/LRU order when
+ * keys spread evenly. maxsize is split evenly over the shards.
+ * ======================================================================== */
+
+#define SHARDS_DEFAULT 16
+#define SHARDS_MAX 65536
+
+typedef struct {
+    PyObject_HEAD
+    DequeDictObject **shards;
+    Py_ssize_t nshards;
+    Py_ssize_t maxsize;             /* Total capacity, PY_SSIZE_T_MAX when unbounded */
+    Py_ssize_t cursor;              /* Next shard for popleft() */
+} ShardedDequeDictObject;
+
+static PyTypeObject ShardedDequeDict_Type;
+
+static int
+ShardedDequeDict_traverse(ShardedDequeDictObject *self, visitproc visit, void *arg)
+{
+    for (Py_ssize_t i = 0; i < self->nshards; i++)
+        Py_VISIT(self->shards[i]);
+    return 0;
+}
+
+/* Detach the whole array before releasing the shards: code run by a
+ * shard's dealloc that reaches self sees no shards, never freed ones */
+static int
+ShardedDequeDict_tp_clear(ShardedDequeDictObject *self)
+{
+    DequeDictObject **shards = self->shards;
+    Py_ssize_t nshards = self->nshards;
+    self->shards = NULL;
+    self->nshards = 0;
+    for (Py_ssize_t i = 0; i < nshards; i++)
+        Py_XDECREF(shards[i]);
+    PyMem_Free(shards);
+    return 0;
+}
+
+static void
+ShardedDequeDict_dealloc(ShardedDequeDictObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    ShardedDequeDict_tp_clear(self);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+/* 0, or -1 with RuntimeError once the garbage collector has cleared the
+ * shards. Loops over nshards need no check: it is 0 then. */
+static inline int
+ShardedDequeDict_check_shards(ShardedDequeDictObject *self)
+{
+    if (self->shards)
+        return 0;
+    PyErr_SetString(PyExc_RuntimeError, "ShardedDequeDict has been cleared");
+    return -1;
+}
+
+/* Shard index for a hash: the high bits of a Fibonacci-hash product, so
+ * the keys of one shard still spread over the low bits its table uses */
+static inline Py_ssize_t
+ShardedDequeDict_index(ShardedDequeDictObject *self, Py_hash_t hash)
+{
+    uint64_t h = (uint64_t)hash * UINT64_C(0x9E3779B97F4A7C15);
+    return (Py_ssize_t)(((h >> 32) * (uint64_t)self->nshards) >> 32);
+}
+
+/* The shard holding hash, or NULL with an exception */
+static inline DequeDictObject *
+ShardedDequeDict_shard_for(ShardedDequeDictObject *self, Py_hash_t hash)
+{
+    if (ShardedDequeDict_check_shards(self) < 0)
+        return NULL;
+    return self->shards[ShardedDequeDict_index(self, hash)];
+}
+
+static int ShardedDequeDict_setitem(ShardedDequeDictObject *self, PyObject *key, PyObject *value);
+
+/* Insert pairs from a mapping or an iterable of (key, value) tuples */
+static int
+ShardedDequeDict_merge(ShardedDequeDictObject *self, PyObject *other)
+{
+    PyObject *items = other;
+    if (PyDict_CheckExact(other))
+        items = PyDict_Items(other);
+    else if (PyDict_Check(other) || PyObject_TypeCheck(other, &DequeDict_Type)
+             || PyObject_TypeCheck(other, &ShardedDequeDict_Type))
+        items = PyMapping_Items(other);
+    else
+        Py_INCREF(items);
+    if (!items) return -1;
+    PyObject *iter = PyObject_GetIter(items);
+    Py_DECREF(items);
+    if (!iter) return -1;
+
+    int r = 0;
+    PyObject *pair;
+    while ((pair = PyIter_Next(iter)) != NULL) {
+        if (!PyTuple_Check(pair) || PyTuple_GET_SIZE(pair) != 2) {
+            PyErr_SetString(PyExc_ValueError, "ShardedDequeDict requires sequence of (key, value) pairs");
+            r = -1;
+        }
+        else
+            r = ShardedDequeDict_setitem(self, PyTuple_GET_ITEM(pair, 0), PyTuple_GET_ITEM(pair, 1));
+        Py_DECREF(pair);
+        if (r < 0)
+            break;
+    }
+    Py_DECREF(iter);
+    if (r == 0 && PyErr_Occurred())
+        r = -1;
+    return r;
+}
+
+static PyObject *
+ShardedDequeDict_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"items", "shards", "maxsize", "on_evict", "touch", NULL};
+    PyObject *items = NULL;
+    Py_ssize_t nshards = SHARDS_DEFAULT;
+    PyObject *maxsize = Py_None;
+    PyObject *on_evict = Py_None;
+    int touch = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O$nOOp", kwlist,
+                                     &items, &nshards, &maxsize, &on_evict, &touch))
+        return NULL;
+    if (nshards < 1 || nshards > SHARDS_MAX) {
+        PyErr_Format(PyExc_ValueError, "shards must be between 1 and %d", SHARDS_MAX);
+        return NULL;
+    }
+
+    /* Each shard holds its share of maxsize, rounded up */
+    Py_ssize_t total = PY_SSIZE_T_MAX;
+    PyObject *per_shard = Py_None;
+    if (maxsize != Py_None) {
+        total = PyNumber_AsSsize_t(maxsize, PyExc_OverflowError);
+        if (total == -1 && PyErr_Occurred())
+            return NULL;
+        if (total < 0) {
+            PyErr_SetString(PyExc_ValueError, "maxsize must be non-negative or None");
+            return NULL;
+        }
+        per_shard = PyLong_FromSsize_t(total / nshards + (total % nshards != 0));
+        if (!per_shard) return NULL;
+    }
+    else
+        Py_INCREF(per_shard);
+
+    ShardedDequeDictObject *self = (ShardedDequeDictObject *)type->tp_alloc(type, 0);
+    if (!self) {
+        Py_DECREF(per_shard);
+        return NULL;
+    }
+    self->maxsize = total;
+    self->shards = PyMem_Calloc(nshards, sizeof(DequeDictObject *));
+    if (!self->shards) {
+        Py_DECREF(per_shard);
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    self->nshards = nshards;
+
+    for (Py_ssize_t i = 0; i < nshards; i++) {
+        DequeDictObject *shard = (DequeDictObject *)DequeDict_new(&DequeDict_Type, NULL, NULL);
+        if (!shard || DequeDict_configure(shard, per_shard, on_evict, touch, 1, NULL, NULL, 0, NULL, 0) < 0) {
+            Py_XDECREF(shard);
+            Py_DECREF(per_shard);
+            Py_DECREF(self);
+            return NULL;
+        }
+        self->shards[i] = shard;
+    }
+    Py_DECREF(per_shard);
+
+    if (items && ShardedDequeDict_merge(self, items) < 0) {
+        Py_DECREF(self);
+        return NULL;
+    }
+    return (PyObject *)self;
+}
+
+static Py_ssize_t
+ShardedDequeDict_len(ShardedDequeDictObject *self)
+{
+    Py_ssize_t size = 0;
+    for (Py_ssize_t i = 0; i < self->nshards; i++) {
+        DequeDictObject *shard = self->shards[i];
+        Py_BEGIN_CRITICAL_SECTION(shard);
+        size += shard->size;
+        Py_END_CRITICAL_SECTION();
+    }
+    return size;
+}
+
+/* __getitem__ - locks only the key's shard; touch mode moves it to the end */
+static PyObject *
+ShardedDequeDict_getitem(ShardedDequeDictObject *self, PyObject *key)
+{
+    Py_hash_t hash = PyObject_Hash(key);
+    if (hash == -1)
+        return NULL;
+    DequeDictObject *shard = ShardedDequeDict_shard_for(self, hash);
+    if (!shard) return NULL;
+    PyObject *value = NULL;
+
+    Py_BEGIN_CRITICAL_SECTION(shard);
+    Py_ssize_t ix;
+    int found = DequeDict_lookup(shard, key, hash, &ix, NULL);
+    if (found > 0) {
+        if (shard->touch)
+            DequeDict_touch_entry(shard, ix);
+        value = ENTRY(shard, ix)->value;
+        Py_INCREF(value);
+    }
+    else if (found == 0)
+        PyErr_SetObject(PyExc_KeyError, key);
+    Py_END_CRITICAL_SECTION();
+    return value;
+}
+
+/* __setitem__ / __delitem__ */
+static int
+ShardedDequeDict_setitem(ShardedDequeDictObject *self, PyObject *key, PyObject *value)
+{
+    Py_hash_t hash = PyObject_Hash(key);
+    if (hash == -1)
+        return -1;
+    DequeDictObject *shard = ShardedDequeDict_shard_for(self, hash);
+    if (!shard) return -1;
+    int r;
+
+    Py_BEGIN_CRITICAL_SECTION(shard);
+    if (value)
+        r = DequeDict_finish(shard, DequeDict_set_hash(shard, key, hash, value));
+    else {
+        Py_ssize_t ix, slot;
+        r = DequeDict_lookup(shard, key, hash, &ix, &slot);
+        if (r > 0) {
+            Py_DECREF(DequeDict_detach(shard, ix, slot));
+            r = 0;
+        }
+        else if (r == 0) {
+            PyErr_SetObject(PyExc_KeyError, key);
+            r = -1;
+        }
+    }
+    Py_END_CRITICAL_SECTION();
+    return r;
+}
+
+static int
+ShardedDequeDict_contains(ShardedDequeDictObject *self, PyObject *key)
+{
+    Py_hash_t hash = PyObject_Hash(key);
+    if (hash == -1)
+        return -1;
+    DequeDictObject *shard = ShardedDequeDict_shard_for(self, hash);
+    if (!shard) return -1;
+    int found;
+
+    Py_BEGIN_CRITICAL_SECTION(shard);
+    Py_ssize_t ix;
+    found = DequeDict_lookup(shard, key, hash, &ix, NULL);
+    Py_END_CRITICAL_SECTION();
+    return found;
+}
+
+/* get(key, default=None), pop(key[, default]) and setdefault(key,
+ * default=None) - one shard lookup each */
+typedef enum { SHARD_GET, SHARD_POP, SHARD_SETDEFAULT } ShardedKeyOp;
+
+static PyObject *
+ShardedDequeDict_key_op(ShardedDequeDictObject *self, PyObject *const *args, Py_ssize_t nargs,
+                        ShardedKeyOp op)
+{
+    static const char *const names[] = {"get", "pop", "setdefault"};
+    if (!DequeDict_check_nargs(names[op], nargs, 1, 2))
+        return NULL;
+    PyObject *key = args[0];
+    PyObject *default_val = nargs > 1 ? args[1] : (op == SHARD_POP ? NULL : Py_None);
+
+    Py_hash_t hash = PyObject_Hash(key);
+    if (hash == -1)
+        return NULL;
+    DequeDictObject *shard = ShardedDequeDict_shard_for(self, hash);
+    if (!shard) return NULL;
+    PyObject *result = NULL;
+
+    Py_BEGIN_CRITICAL_SECTION(shard);
+    Py_ssize_t ix, slot;
+    int found = DequeDict_lookup(shard, key, hash, &ix, &slot);
+    if (found > 0) {
+        if (op == SHARD_POP)
+            result = DequeDict_detach(shard, ix, slot);
+        else {
+            result = ENTRY(shard, ix)->value;
+            Py_INCREF(result);
+        }
+    }
+    else if (found == 0) {
+        if (!default_val)
+            PyErr_SetObject(PyExc_KeyError, key);
+        else if (op != SHARD_SETDEFAULT
+                 || DequeDict_finish(shard, DequeDict_append_new(shard, key, hash, default_val)) == 0) {
+            result = default_val;
+            Py_INCREF(result);
+        }
+    }
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+static PyObject *
+ShardedDequeDict_get(ShardedDequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    return ShardedDequeDict_key_op(self, args, nargs, SHARD_GET);
+}
+
+static PyObject *
+ShardedDequeDict_pop(ShardedDequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    return ShardedDequeDict_key_op(self, args, nargs, SHARD_POP);
+}
+
+static PyObject *
+ShardedDequeDict_setdefault(ShardedDequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    return ShardedDequeDict_key_op(self, args, nargs, SHARD_SETDEFAULT);
+}
+
+/* Shard number argument, negative counting from the end */
+static int
+ShardedDequeDict_shard_arg(ShardedDequeDictObject *self, PyObject *arg, Py_ssize_t *out)
+{
+    Py_ssize_t i;
+    if (DequeDict_index_arg(arg, &i) < 0)
+        return -1;
+    if (i < 0)
+        i += self->nshards;
+    if (i < 0 || i >= self->nshards) {
+        PyErr_SetString(PyExc_IndexError, "shard index out of range");
+        return -1;
+    }
+    *out = i;
+    return 0;
+}
+
+/* popleft(shard=None) / popleftitem(shard=None) - remove the head of the
+ * given shard, or of the next non-empty shard in turn */
+static PyObject *
+ShardedDequeDict_popleft_impl(ShardedDequeDictObject *self, PyObject *const *args, Py_ssize_t nargs,
+                              PyObject *kwnames, int items)
+{
+    static const char *const kwlist[] = {"shard", NULL};
+    PyObject *shard_arg = NULL;
+    if (nargs || kwnames) {
+        if (DequeDict_parse_args(items ? "popleftitem" : "popleft", args, nargs, kwnames, kwlist, 1, 0,
+                                 &shard_arg) < 0)
+            return NULL;
+    }
+
+    Py_ssize_t first, tries = self->nshards;
+    if (shard_arg && shard_arg != Py_None) {
+        if (ShardedDequeDict_shard_arg(self, shard_arg, &first) < 0)
+            return NULL;
+        tries = 1;
+    }
+    else {
+        Py_BEGIN_CRITICAL_SECTION(self);
+        first = self->cursor;
+        Py_END_CRITICAL_SECTION();
+    }
+
+    for (Py_ssize_t t = 0; t < tries; t++) {
+        Py_ssize_t i = (first + t) % self->nshards;
+        DequeDictObject *shard = self->shards[i];
+        PyObject *result = NULL;
+        int empty;
+
+        Py_BEGIN_CRITICAL_SECTION(shard);
+        empty = shard->head == LINK_NONE;
+        if (!empty)
+            result = items ? DequeDict_popleftitem(shard, NULL) : DequeDict_popleft(shard, NULL);
+        Py_END_CRITICAL_SECTION();
+
+        if (!empty) {
+            if (tries > 1) {
+                Py_BEGIN_CRITICAL_SECTION(self);
+                self->cursor = (i + 1) % self->nshards;
+                Py_END_CRITICAL_SECTION();
+            }
+            return result;
+        }
+    }
+    if (items)
+        PyErr_SetString(PyExc_KeyError, "popleftitem from an empty ShardedDequeDict");
+    else
+        PyErr_SetString(PyExc_IndexError, "pop from an empty ShardedDequeDict");
+    return NULL;
+}
+
+static PyObject *
+ShardedDequeDict_popleft(ShardedDequeDictObject *self, PyObject *const *args, Py_ssize_t nargs,
+                         PyObject *kwnames)
+{
+    return ShardedDequeDict_popleft_impl(self, args, nargs, kwnames, 0);
+}
+
+static PyObject *
+ShardedDequeDict_popleftitem(ShardedDequeDictObject *self, PyObject *const *args, Py_ssize_t nargs,
+                             PyObject *kwnames)
+{
+    return ShardedDequeDict_popleft_impl(self, args, nargs, kwnames, 1);
+}
+
+/* popitem() - remove the last (key, value) in iteration order, the tail of
+ * the last non-empty shard */
+static PyObject *
+ShardedDequeDict_popitem(ShardedDequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    for (Py_ssize_t i = self->nshards - 1; i >= 0; i--) {
+        DequeDictObject *shard = self->shards[i];
+        PyObject *result = NULL;
+        int empty;
+
+        Py_BEGIN_CRITICAL_SECTION(shard);
+        empty = shard->tail == LINK_NONE;
+        if (!empty)
+            result = DequeDict_popitem(shard, NULL);
+        Py_END_CRITICAL_SECTION();
+
+        if (!empty)
+            return result;
+    }
+    PyErr_SetString(PyExc_KeyError, "popitem from an empty ShardedDequeDict");
+    return NULL;
+}
+
+/* move_to_end(key, last=True) - to either end of the key's shard */
+static PyObject *
+ShardedDequeDict_move_to_end(ShardedDequeDictObject *self, PyObject *const *args, Py_ssize_t nargs,
+                             PyObject *kwnames)
+{
+    static const char *const kwlist[] = {"key", "last", NULL};
+    PyObject *argv[2] = {NULL, NULL};
+    int last = 1;
+
+    if (nargs == 1 && !kwnames)
+        argv[0] = args[0];
+    else if (DequeDict_parse_args("move_to_end", args, nargs, kwnames, kwlist, 2, 1, argv) < 0)
+        return NULL;
+    if (argv[1] && (last = PyObject_IsTrue(argv[1])) < 0)
+        return NULL;
+    Py_hash_t hash = PyObject_Hash(argv[0]);
+    if (hash == -1)
+        return NULL;
+    DequeDictObject *shard = ShardedDequeDict_shard_for(self, hash);
+    if (!shard) return NULL;
+
+    int r;
+    Py_BEGIN_CRITICAL_SECTION(shard);
+    r = DequeDict_move_key(shard, argv[0], last);
+    Py_END_CRITICAL_SECTION();
+    if (r < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+/* Keys (0), values (1) or pairs (2) of every shard, shard by shard. Each
+ * shard is read atomically; the whole is not a snapshot. */
+static PyObject *
+ShardedDequeDict_collect(ShardedDequeDictObject *self, int kind)
+{
+    PyObject *list = PyList_New(0);
+    if (!list) return NULL;
+
+    for (Py_ssize_t i = 0; i < self->nshards; i++) {
+        DequeDictObject *shard = self->shards[i];
+        int r = 0;
+        Py_BEGIN_CRITICAL_SECTION(shard);
+        for (Py_ssize_t ix = shard->head; ix != LINK_NONE && r == 0; ix = ENTRY(shard, ix)->next) {
+            DequeDictEntry *entry = ENTRY(shard, ix);
+            if (kind == 2) {
+                PyObject *pair = PyTuple_Pack(2, entry->key, entry->value);
+                r = pair ? PyList_Append(list, pair) : -1;
+                Py_XDECREF(pair);
+            }
+            else
+                r = PyList_Append(list, kind == 0 ? entry->key : entry->value);
+        }
+        Py_END_CRITICAL_SECTION();
+        if (r < 0) {
+            Py_DECREF(list);
+            return NULL;
+        }
+    }
+    return list;
+}
+
+static PyObject *
+ShardedDequeDict_keys(ShardedDequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    return ShardedDequeDict_collect(self, 0);
+}
+
+static PyObject *
+ShardedDequeDict_values(ShardedDequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    return ShardedDequeDict_collect(self, 1);
+}
+
+static PyObject *
+ShardedDequeDict_items(ShardedDequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    return ShardedDequeDict_collect(self, 2);
+}
+
+static PyObject *
+ShardedDequeDict_iter(ShardedDequeDictObject *self)
+{
+    PyObject *keys = ShardedDequeDict_collect(self, 0);
+    if (!keys) return NULL;
+    PyObject *iter = PyObject_GetIter(keys);
+    Py_DECREF(keys);
+    return iter;
+}
+
+static PyObject *
+ShardedDequeDict_clear_method(ShardedDequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    for (Py_ssize_t i = 0; i < self->nshards; i++) {
+        DequeDictObject *shard = self->shards[i];
+        Py_BEGIN_CRITICAL_SECTION(shard);
+        DequeDict_clear(shard);
+        Py_END_CRITICAL_SECTION();
+    }
+    Py_RETURN_NONE;
+}
+
+/* update(other) */
+static PyObject *
+ShardedDequeDict_update(ShardedDequeDictObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *other = NULL;
+    if (!PyArg_ParseTuple(args, "|O:update", &other))
+        return NULL;
+    if (other && ShardedDequeDict_merge(self, other) < 0)
+        return NULL;
+    if (kwds) {
+        PyObject *key, *value;
+        Py_ssize_t pos = 0;
+        while (PyDict_Next(kwds, &pos, &key, &value)) {
+            if (ShardedDequeDict_setitem(self, key, value) < 0)
+                return NULL;
+        }
+    }
+    Py_RETURN_NONE;
+}
+
+/* shard(index) - the DequeDict holding one partition */
+static PyObject *
+ShardedDequeDict_shard(ShardedDequeDictObject *self, PyObject *arg)
+{
+    Py_ssize_t i;
+    if (ShardedDequeDict_shard_arg(self, arg, &i) < 0)
+        return NULL;
+    Py_INCREF(self->shards[i]);
+    return (PyObject *)self->shards[i];
+}
+
+/* shard_of(key) - index of the shard key belongs to */
+static PyObject *
+ShardedDequeDict_shard_of(ShardedDequeDictObject *self, PyObject *key)
+{
+    Py_hash_t hash = PyObject_Hash(key);
+    if (hash == -1 || ShardedDequeDict_check_shards(self) < 0)
+        return NULL;
+    return PyLong_FromSsize_t(ShardedDequeDict_index(self, hash));
+}
+
+/* shards, maxsize, on_evict and touch as constructor keywords */
+static PyObject *
+ShardedDequeDict_options(ShardedDequeDictObject *self)
+{
+    if (ShardedDequeDict_check_shards(self) < 0)
+        return NULL;
+    DequeDictObject *first = self->shards[0];
+    PyObject *kwds = Py_BuildValue("{sn}", "shards", self->nshards);
+    if (!kwds) return NULL;
+    if (self->maxsize != PY_SSIZE_T_MAX) {
+        PyObject *maxsize = PyLong_FromSsize_t(self->maxsize);
+        if (!maxsize || PyDict_SetItemString(kwds, "maxsize", maxsize) < 0)
+            Py_CLEAR(kwds);
+        Py_XDECREF(maxsize);
+    }
+    if (kwds && first->on_evict && PyDict_SetItemString(kwds, "on_evict", first->on_evict) < 0)
+        Py_CLEAR(kwds);
+    if (kwds && first->touch && PyDict_SetItemString(kwds, "touch", Py_True) < 0)
+        Py_CLEAR(kwds);
+    return kwds;
+}
+
+/* copy() / __copy__ - same type and options; each shard is cloned whole,
+ * as a key hashes to the same shard index in both */
+static PyObject *
+ShardedDequeDict_copy(ShardedDequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    PyObject *kwds = ShardedDequeDict_options(self);
+    if (!kwds) return NULL;
+    PyObject *args = PyTuple_New(0);
+    ShardedDequeDictObject *copy = args ? (ShardedDequeDictObject *)ShardedDequeDict_new(Py_TYPE(self), args, kwds)
+                                        : NULL;
+    Py_XDECREF(args);
+    Py_DECREF(kwds);
+    if (!copy) return NULL;
+
+    for (Py_ssize_t i = 0; i < copy->nshards; i++) {
+        DequeDictObject *shard = self->shards[i], *target = copy->shards[i];
+        int r;
+        Py_BEGIN_CRITICAL_SECTION(shard);
+        r = DequeDict_finish(target, DequeDict_merge_dequedict(target, shard));
+        Py_END_CRITICAL_SECTION();
+        if (r < 0) {
+            Py_DECREF(copy);
+            return NULL;
+        }
+    }
+    return (PyObject *)copy;
+}
+
+/* __reduce__ - the items plus shards, maxsize, on_evict and touch */
+static PyObject *
+ShardedDequeDict_reduce(ShardedDequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    PyObject *kwds = ShardedDequeDict_options(self);
+    PyObject *items = kwds ? ShardedDequeDict_collect(self, 2) : NULL;
+    return DequeDict_reduce_keywords((PyObject *)Py_TYPE(self), kwds, items);
+}
+
+static PyObject *
+ShardedDequeDict_repr(ShardedDequeDictObject *self)
+{
+    int status = Py_ReprEnter((PyObject *)self);
+    if (status != 0)
+        return status > 0 ? PyUnicode_FromString("...") : NULL;
+
+    PyObject *repr = NULL;
+    PyObject *items = ShardedDequeDict_collect(self, 2);
+    if (items) {
+        if (PyList_GET_SIZE(items) == 0)
+            repr = PyUnicode_FromFormat("ShardedDequeDict(shards=%zd)", self->nshards);
+        else
+            repr = PyUnicode_FromFormat("ShardedDequeDict(%R, shards=%zd)", items, self->nshards);
+        Py_DECREF(items);
+    }
+    Py_ReprLeave((PyObject *)self);
+    return repr;
+}
+
+/* == and != against dicts and DequeDicts, ignoring order like dict */
+static PyObject *
+ShardedDequeDict_richcompare(ShardedDequeDictObject *self, PyObject *other, int op)
+{
+    if (op != Py_EQ && op != Py_NE)
+        Py_RETURN_NOTIMPLEMENTED;
+    if (!PyDict_Check(other) && !PyObject_TypeCheck(other, &DequeDict_Type)
+        && !PyObject_TypeCheck(other, &ShardedDequeDict_Type))
+        Py_RETURN_NOTIMPLEMENTED;
+
+    PyObject *items = ShardedDequeDict_collect(self, 2);
+    if (!items) return NULL;
+    Py_ssize_t other_len = PyMapping_Size(other);
+    if (other_len == -1) {
+        Py_DECREF(items);
+        PyErr_Clear();
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+
+    int equal = PyList_GET_SIZE(items) == other_len;
+    for (Py_ssize_t i = 0; equal && i < PyList_GET_SIZE(items); i++) {
+        PyObject *pair = PyList_GET_ITEM(items, i);
+        PyObject *other_val = PyObject_GetItem(other, PyTuple_GET_ITEM(pair, 0));
+        if (!other_val) {
+            if (!PyErr_ExceptionMatches(PyExc_KeyError)) {
+                Py_DECREF(items);
+                return NULL;
+            }
+            PyErr_Clear();
+            equal = 0;
+            break;
+        }
+        equal = PyObject_RichCompareBool(PyTuple_GET_ITEM(pair, 1), other_val, Py_EQ);
+        Py_DECREF(other_val);
+        if (equal < 0) {
+            Py_DECREF(items);
+            return NULL;
+        }
+    }
+    Py_DECREF(items);
+    return PyBool_FromLong(op == Py_EQ ? equal : !equal);
+}
+
+static PyObject *
+ShardedDequeDict_get_maxsize(ShardedDequeDictObject *self, void *Py_UNUSED(closure))
+{
+    if (self->maxsize == PY_SSIZE_T_MAX)
+        Py_RETURN_NONE;
+    return PyLong_FromSsize_t(self->maxsize);
+}
+
+static PyObject *
+ShardedDequeDict_get_shard_count(ShardedDequeDictObject *self, void *Py_UNUSED(closure))
+{
+    return PyLong_FromSsize_t(self->nshards);
+}
+
+static PyMethodDef ShardedDequeDict_methods[] = {
+    {"popleft", (PyCFunction)(void(*)(void))ShardedDequeDict_popleft, METH_FASTCALL | METH_KEYWORDS,
+     "Remove and return the first value of a shard, or of the shards in turn - O(1)"},
+    {"popleftitem", (PyCFunction)(void(*)(void))ShardedDequeDict_popleftitem, METH_FASTCALL | METH_KEYWORDS,
+     "Remove and return the first (key, value) of a shard, or of the shards in turn - O(1)"},
+    {"get", (PyCFunction)(void(*)(void))ShardedDequeDict_get, METH_FASTCALL,
+     "D.get(k[,d]) -> D[k] if k in D, else d"},
+    {"pop", (PyCFunction)(void(*)(void))ShardedDequeDict_pop, METH_FASTCALL,
+     "D.pop(k[,d]) -> remove key and return its value, else d or KeyError"},
+    {"setdefault", (PyCFunction)(void(*)(void))ShardedDequeDict_setdefault, METH_FASTCALL,
+     "D.setdefault(k[,d])"},
+    {"popitem", (PyCFunction)ShardedDequeDict_popitem, METH_NOARGS,
+     "Remove and return the last (key, value) of the last non-empty shard - O(1)"},
+    {"move_to_end", (PyCFunction)(void(*)(void))ShardedDequeDict_move_to_end, METH_FASTCALL | METH_KEYWORDS,
+     "Move existing key to the front (last=False) or back (last=True) of its shard - O(1)"},
+    {"keys", (PyCFunction)ShardedDequeDict_keys, METH_NOARGS, "D.keys() -> list of keys, shard by shard"},
+    {"values", (PyCFunction)ShardedDequeDict_values, METH_NOARGS,
+     "D.values() -> list of values, shard by shard"},
+    {"items", (PyCFunction)ShardedDequeDict_items, METH_NOARGS,
+     "D.items() -> list of (key, value), shard by shard"},
+    {"clear", (PyCFunction)ShardedDequeDict_clear_method, METH_NOARGS, "D.clear() -- remove all items"},
+    {"update", (PyCFunction)ShardedDequeDict_update, METH_VARARGS | METH_KEYWORDS, "D.update([E, ]**F)"},
+    {"shard", (PyCFunction)ShardedDequeDict_shard, METH_O, "Return the DequeDict holding shard index"},
+    {"shard_of", (PyCFunction)ShardedDequeDict_shard_of, METH_O, "Return the shard index key belongs to"},
+    {"copy", (PyCFunction)ShardedDequeDict_copy, METH_NOARGS, "D.copy() -> a shallow copy"},
+    {"__copy__", (PyCFunction)ShardedDequeDict_copy, METH_NOARGS, "Shallow copy of the same type"},
+    {"__reduce__", (PyCFunction)ShardedDequeDict_reduce, METH_NOARGS,
+     "Pickle as the items plus shards, maxsize, on_evict and touch"},
+    {"__class_getitem__", (PyCFunction)DequeDict_class_getitem, METH_O | METH_CLASS,
+     "See PEP 585"},
+    {NULL}
+};
+
+static PyGetSetDef ShardedDequeDict_getset[] = {
+    {"maxsize", (getter)ShardedDequeDict_get_maxsize, NULL,
+     "Total capacity, or None if unbounded", NULL},
+    {"shard_count", (getter)ShardedDequeDict_get_shard_count, NULL, "Number of shards", NULL},
+    {NULL}
+};
+
+static PySequenceMethods ShardedDequeDict_as_sequence = {
+    .sq_contains = (objobjproc)ShardedDequeDict_contains,
+};
+
+static PyMappingMethods ShardedDequeDict_as_mapping = {
+    .mp_length = (lenfunc)ShardedDequeDict_len,
+    .mp_subscript = (binaryfunc)ShardedDequeDict_getitem,
+    .mp_ass_subscript = (objobjargproc)ShardedDequeDict_setitem,
+};
+
+static PyTypeObject ShardedDequeDict_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "dequedict.ShardedDequeDict",
+    .tp_basicsize = sizeof(ShardedDequeDictObject),
+    .tp_dealloc = (destructor)ShardedDequeDict_dealloc,
+    .tp_hash = PyObject_HashNotImplemented,
+    .tp_repr = (reprfunc)ShardedDequeDict_repr,
+    .tp_as_sequence = &ShardedDequeDict_as_sequence,
+    .tp_as_mapping = &ShardedDequeDict_as_mapping,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,
+    .tp_doc = "DequeDict hash-partitioned into independently locked shards.\n\n"
+              "Lookups and inserts on different shards run in parallel on free-threaded\n"
+              "builds. Order is kept per shard; popleft() takes the shards in turn.",
+    .tp_traverse = (traverseproc)ShardedDequeDict_traverse,
+    .tp_clear = (inquiry)ShardedDequeDict_tp_clear,
+    .tp_richcompare = (richcmpfunc)ShardedDequeDict_richcompare,
+    .tp_iter = (getiterfunc)ShardedDequeDict_iter,
+    .tp_methods = ShardedDequeDict_methods,
+    .tp_getset = ShardedDequeDict_getset,
+    .tp_new = ShardedDequeDict_new,
+};
+
+/* ========================================================================
+ * Typed storage: TypedDequeDict and SharedDequeDict
+ *
+ * A DequeDict of fixed-width keys and values laid out in one flat region
+ * that holds no PyObject pointers: no per-entry objects, no GC traversal,
+ * integer hashing and memcmp equality. TypedDequeDict owns its region and
+ * grows it; SharedDequeDict uses a caller's buffer, which can live in
+ * memory mapped by many processes (mmap, multiprocessing.shared_memory):
+ *
+ *   header | entries[capacity] | table[table_size]
+ *
+ * Everything is addressed by entry number. Keys are "i8" (int64) or
+ * "S<n>" (bytes of at most n); values may also be "f8" (float64). Hashes
+ * are computed from the raw key, so they agree across processes whatever
+ * PYTHONHASHSEED is. A full region grows (TypedDequeDict below maxsize)
+ * or evicts its head. A shared region carries no lock; writers in
+ * different processes must serialise themselves.
+ * ======================================================================== */
+
+#define TYPED_MAGIC "DQDICT1"
+#define TYPED_I8 1
+#define TYPED_F8 2
+#define TYPED_BYTES 3
+#define TYPED_BYTES_MAX (1 << 20)
+#define TYPED_CAPACITY_MAX ((int64_t)1 << 30)
+#define LINK_FREE (-2)              /* prev of an entry on the free list */
+#define TYPED_MIN_CAPACITY 8
+
+typedef struct {
+    char magic[8];
+    uint32_t entry_size;            /* Bytes per entry, a multiple of 8 */
+    uint8_t key_kind;
+    uint8_t value_kind;
+    uint16_t reserved;
+    uint32_t key_size;              /* Payload bytes: 8, or n for S<n> */
+    uint32_t value_size;
+    int64_t capacity;               /* Entries */
+    int64_t table_size;             /* Power of 2, at least 2 * capacity */
+    int64_t size;
+    int64_t used;                   /* Entries [0, used) have been handed out */
+    int64_t fill;                   /* Live + deleted table slots */
+    uint64_t version;               /* Bumped by every insert, delete and move */
+    int32_t head;
+    int32_t tail;
+    int32_t free_list;
+    int32_t reserved2;
+} TypedHeader;
+
+#define TYPED_HEADER_SIZE (((sizeof(TypedHeader) + 63) / 64) * 64)
+
+/* Entry header; the key payload follows, then the value payload, each
+ * padded to 8 bytes. S<n> payloads are a uint32 length and n bytes. */
+typedef struct {
+    uint64_t hash;
+    int32_t prev;
+    int32_t next;
+} TypedEntry;
 
-/* View iterator */
 typedef struct {
     PyObject_HEAD
-    DequeDictObject *dd;
-    DequeDictEntry *current;
-    int kind;
-    int reverse;  /* 0=forward (->next), 1=reverse (->prev) */
-} DequeDictViewIterObject;
+    Py_buffer view;                 /* SharedDequeDict's buffer; view.obj is NULL once closed */
+    char *owned;                    /* TypedDequeDict's PyMem region, NULL if shared */
+    int64_t maxsize;                /* TypedDequeDict growth limit, -1 for none */
+    TypedHeader *hdr;               /* NULL once closed */
+    char *entries;
+    int32_t *table;
+    uint32_t value_offset;          /* Value payload offset within an entry */
+    char readonly;
+} TypedDequeDictObject;
+
+static PyTypeObject TypedDequeDict_Type;
+static PyTypeObject SharedDequeDict_Type;
+
+/* A key ready for lookup: the raw value and its hash */
+typedef struct {
+    int64_t i;
+    const char *data;
+    Py_ssize_t len;
+    uint64_t hash;
+} TypedKey;
+
+/* A value checked and ready to store */
+typedef struct {
+    int64_t i;
+    double f;
+    const char *data;
+    Py_ssize_t len;
+} TypedValue;
+
+#define TENTRY(self, ix) ((TypedEntry *)((self)->entries + (size_t)(ix) * (self)->hdr->entry_size))
+#define TKEY(e) ((char *)(e) + sizeof(TypedEntry))
+#define TVALUE(self, e) ((char *)(e) + (self)->value_offset)
+
+static inline uint32_t
+typed_payload(uint8_t kind, uint32_t size)
+{
+    uint32_t bytes = kind == TYPED_BYTES ? size + 4 : 8;
+    return (bytes + 7) & ~7u;
+}
+
+static inline int64_t
+typed_table_size(int64_t capacity)
+{
+    int64_t n = 8;
+    while (n < capacity * 2)
+        n <<= 1;
+    return n;
+}
+
+/* Parse "i8", "f8" (values only) or "S<n>" */
+static int
+typed_parse_type(PyObject *code, int is_value, uint8_t *kind, uint32_t *size)
+{
+    const char *s = PyUnicode_Check(code) ? PyUnicode_AsUTF8(code) : NULL;
+    if (!s) {
+        if (!PyErr_Occurred())
+            PyErr_SetString(PyExc_TypeError, "type code must be a str");
+        return -1;
+    }
+    if (strcmp(s, "i8") == 0) {
+        *kind = TYPED_I8;
+        *size = 8;
+        return 0;
+    }
+    if (is_value && strcmp(s, "f8") == 0) {
+        *kind = TYPED_F8;
+        *size = 8;
+        return 0;
+    }
+    if (s[0] == 'S' && s[1] >= '1' && s[1] <= '9') {
+        char *end;
+        long n = strtol(s + 1, &end, 10);
+        if (*end == '\0' && n >= 1 && n <= TYPED_BYTES_MAX) {
+            *kind = TYPED_BYTES;
+            *size = (uint32_t)n;
+            return 0;
+        }
+    }
+    PyErr_Format(PyExc_ValueError, "%s type must be %s or 'S<n>' with 1 <= n <= %d, not %R",
+                 is_value ? "value" : "key", is_value ? "'i8', 'f8'" : "'i8'", TYPED_BYTES_MAX, code);
+    return -1;
+}
+
+static PyObject *
+typed_type_name(uint8_t kind, uint32_t size)
+{
+    if (kind == TYPED_I8)
+        return PyUnicode_FromString("i8");
+    if (kind == TYPED_F8)
+        return PyUnicode_FromString("f8");
+    return PyUnicode_FromFormat("S%u", size);
+}
+
+/* Region bytes for a capacity, or -1 with OverflowError */
+static Py_ssize_t
+typed_nbytes(int64_t capacity, uint32_t entry_size)
+{
+    int64_t table = typed_table_size(capacity);
+    if (capacity > (PY_SSIZE_T_MAX - (Py_ssize_t)TYPED_HEADER_SIZE - table * 4) / entry_size) {
+        PyErr_SetString(PyExc_OverflowError, "capacity too large");
+        return -1;
+    }
+    return (Py_ssize_t)(TYPED_HEADER_SIZE + capacity * entry_size + table * 4);
+}
+
+/* Splitmix64 finaliser: spreads int keys and FNV output over all bits */
+static inline uint64_t
+typed_mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= UINT64_C(0xbf58476d1ce4e5b9);
+    x ^= x >> 27;
+    x *= UINT64_C(0x94d049bb133111eb);
+    return x ^ (x >> 31);
+}
+
+static inline uint64_t
+typed_hash_bytes(const char *data, Py_ssize_t len)
+{
+    uint64_t h = UINT64_C(0xcbf29ce484222325);
+    for (Py_ssize_t i = 0; i < len; i++) {
+        h ^= (unsigned char)data[i];
+        h *= UINT64_C(0x100000001b3);
+    }
+    return typed_mix(h);
+}
+
+/* Convert a key. Returns 1, or 0 with TypeError/OverflowError/ValueError
+ * set if no key of this type can equal it, or -1 on other errors. */
+static int
+typed_key(TypedDequeDictObject *self, PyObject *key, TypedKey *out)
+{
+    if (self->hdr->key_kind == TYPED_I8) {
+        if (!PyLong_Check(key)) {
+            PyErr_Format(PyExc_TypeError, "key must be int, not %.200s", Py_TYPE(key)->tp_name);
+            return 0;
+        }
+        int overflow;
+        out->i = PyLong_AsLongLongAndOverflow(key, &overflow);
+        if (overflow) {
+            PyErr_SetString(PyExc_OverflowError, "key does not fit in int64");
+            return 0;
+        }
+        if (out->i == -1 && PyErr_Occurred())
+            return -1;
+        out->hash = typed_mix((uint64_t)out->i);
+        return 1;
+    }
+    if (!PyBytes_Check(key)) {
+        PyErr_Format(PyExc_TypeError, "key must be bytes, not %.200s", Py_TYPE(key)->tp_name);
+        return 0;
+    }
+    out->data = PyBytes_AS_STRING(key);
+    out->len = PyBytes_GET_SIZE(key);
+    if (out->len > (Py_ssize_t)self->hdr->key_size) {
+        PyErr_Format(PyExc_ValueError, "key longer than %u bytes", self->hdr->key_size);
+        return 0;
+    }
+    out->hash = typed_hash_bytes(out->data, out->len);
+    return 1;
+}
+
+/* typed_key() for lookups: a key that cannot be stored is simply absent */
+static inline int
+typed_lookup_key(TypedDequeDictObject *self, PyObject *key, TypedKey *out)
+{
+    int r = typed_key(self, key, out);
+    if (r == 0)
+        PyErr_Clear();
+    return r;
+}
+
+static int
+typed_value(TypedDequeDictObject *self, PyObject *value, TypedValue *out)
+{
+    switch (self->hdr->value_kind) {
+    case TYPED_I8:
+        if (!PyLong_Check(value)) {
+            PyErr_Format(PyExc_TypeError, "value must be int, not %.200s", Py_TYPE(value)->tp_name);
+            return -1;
+        }
+        out->i = PyLong_AsLongLong(value);
+        return out->i == -1 && PyErr_Occurred() ? -1 : 0;
+    case TYPED_F8:
+        out->f = PyFloat_AsDouble(value);
+        return out->f == -1.0 && PyErr_Occurred() ? -1 : 0;
+    default:
+        if (!PyBytes_Check(value)) {
+            PyErr_Format(PyExc_TypeError, "value must be bytes, not %.200s", Py_TYPE(value)->tp_name);
+            return -1;
+        }
+        out->data = PyBytes_AS_STRING(value);
+        out->len = PyBytes_GET_SIZE(value);
+        if (out->len > (Py_ssize_t)self->hdr->value_size) {
+            PyErr_Format(PyExc_ValueError, "value longer than %u bytes", self->hdr->value_size);
+            return -1;
+        }
+        return 0;
+    }
+}
+
+static int
+typed_corrupt(void)
+{
+    PyErr_SetString(PyExc_RuntimeError, "DequeDict region is corrupt (unsynchronised writers?)");
+    return -1;
+}
+
+static PyObject *
+typed_box_key(TypedDequeDictObject *self, TypedEntry *e)
+{
+    if (self->hdr->key_kind == TYPED_I8) {
+        int64_t i;
+        memcpy(&i, TKEY(e), 8);
+        return PyLong_FromLongLong(i);
+    }
+    uint32_t len;
+    memcpy(&len, TKEY(e), 4);
+    if (len > self->hdr->key_size) {
+        typed_corrupt();
+        return NULL;
+    }
+    return PyBytes_FromStringAndSize(TKEY(e) + 4, len);
+}
+
+static PyObject *
+typed_box_value(TypedDequeDictObject *self, TypedEntry *e)
+{
+    char *p = TVALUE(self, e);
+    switch (self->hdr->value_kind) {
+    case TYPED_I8: {
+        int64_t i;
+        memcpy(&i, p, 8);
+        return PyLong_FromLongLong(i);
+    }
+    case TYPED_F8: {
+        double f;
+        memcpy(&f, p, 8);
+        return PyFloat_FromDouble(f);
+    }
+    default: {
+        uint32_t len;
+        memcpy(&len, p, 4);
+        if (len > self->hdr->value_size) {
+            typed_corrupt();
+            return NULL;
+        }
+        return PyBytes_FromStringAndSize(p + 4, len);
+    }
+    }
+}
+
+static inline void
+typed_store_key(TypedDequeDictObject *self, TypedEntry *e, const TypedKey *key)
+{
+    e->hash = key->hash;
+    if (self->hdr->key_kind == TYPED_I8) {
+        memcpy(TKEY(e), &key->i, 8);
+    } else {
+        uint32_t len = (uint32_t)key->len;
+        memcpy(TKEY(e), &len, 4);
+        memcpy(TKEY(e) + 4, key->data, len);
+    }
+}
+
+static inline void
+typed_store_value(TypedDequeDictObject *self, TypedEntry *e, const TypedValue *value)
+{
+    char *p = TVALUE(self, e);
+    switch (self->hdr->value_kind) {
+    case TYPED_I8:
+        memcpy(p, &value->i, 8);
+        break;
+    case TYPED_F8:
+        memcpy(p, &value->f, 8);
+        break;
+    default: {
+        uint32_t len = (uint32_t)value->len;
+        memcpy(p, &len, 4);
+        memcpy(p + 4, value->data, len);
+    }
+    }
+}
 
-static PyTypeObject DequeDictViewIter_Type;
+static inline int
+typed_key_equal(TypedDequeDictObject *self, TypedEntry *e, const TypedKey *key)
+{
+    if (e->hash != key->hash)
+        return 0;
+    if (self->hdr->key_kind == TYPED_I8) {
+        int64_t i;
+        memcpy(&i, TKEY(e), 8);
+        return i == key->i;
+    }
+    uint32_t len;
+    memcpy(&len, TKEY(e), 4);
+    return len == (uint32_t)key->len && memcmp(TKEY(e) + 4, key->data, len) == 0;
+}
+
+/* Checked next link of a list walk; LINK_NONE ends it */
+static inline int
+typed_link_ok(TypedDequeDictObject *self, int64_t ix)
+{
+    return ix == LINK_NONE || (ix >= 0 && ix < self->hdr->used);
+}
 
+/* Find key: returns 1 (entry number and slot stored), 0, or -1 */
 static int
-DequeDictViewIter_traverse(DequeDictViewIterObject *it, visitproc visit, void *arg)
+typed_lookup(TypedDequeDictObject *self, const TypedKey *key, int64_t *ix_out, int64_t *slot_out)
 {
-    Py_VISIT(it->dd);
+    TypedHeader *hdr = self->hdr;
+    uint64_t mask = (uint64_t)hdr->table_size - 1;
+    uint64_t perturb = key->hash;
+    uint64_t i = perturb & mask;
+    for (int64_t probes = 0; probes < hdr->table_size + 64; probes++) {
+        int32_t ix = self->table[i];
+        if (ix == SLOT_EMPTY)
+            return 0;
+        if (ix >= 0) {
+            if (ix >= hdr->used)
+                return typed_corrupt();
+            if (typed_key_equal(self, TENTRY(self, ix), key)) {
+                *ix_out = ix;
+                if (slot_out)
+                    *slot_out = (int64_t)i;
+                return 1;
+            }
+        }
+        perturb >>= PERTURB_SHIFT;
+        i = (i * 5 + perturb + 1) & mask;
+    }
     return 0;
 }
 
+/* Table slot holding entry ix */
+static int64_t
+typed_slot_of(TypedDequeDictObject *self, int64_t ix)
+{
+    uint64_t mask = (uint64_t)self->hdr->table_size - 1;
+    uint64_t perturb = TENTRY(self, ix)->hash;
+    uint64_t i = perturb & mask;
+    for (int64_t probes = 0; probes < self->hdr->table_size + 64; probes++) {
+        if (self->table[i] == ix)
+            return (int64_t)i;
+        if (self->table[i] == SLOT_EMPTY)
+            break;
+        perturb >>= PERTURB_SHIFT;
+        i = (i * 5 + perturb + 1) & mask;
+    }
+    return typed_corrupt();
+}
+
 static int
-DequeDictViewIter_clear(DequeDictViewIterObject *it)
+typed_insert_slot(TypedDequeDictObject *self, int64_t ix)
 {
-    Py_CLEAR(it->dd);
+    uint64_t mask = (uint64_t)self->hdr->table_size - 1;
+    uint64_t perturb = TENTRY(self, ix)->hash;
+    uint64_t i = perturb & mask;
+    for (int64_t probes = 0; self->table[i] != SLOT_EMPTY; probes++) {
+        if (probes > self->hdr->table_size + 64)
+            return typed_corrupt();
+        perturb >>= PERTURB_SHIFT;
+        i = (i * 5 + perturb + 1) & mask;
+    }
+    self->table[i] = (int32_t)ix;
+    self->hdr->fill++;
     return 0;
 }
 
-static void
-DequeDictViewIter_dealloc(DequeDictViewIterObject *it)
+/* Rebuild the table in place, dropping dummies */
+static int
+typed_rehash(TypedDequeDictObject *self)
 {
-    PyObject_GC_UnTrack(it);
-    DequeDictViewIter_clear(it);
-    Py_TYPE(it)->tp_free(it);
+    TypedHeader *hdr = self->hdr;
+    memset(self->table, 0xff, (size_t)hdr->table_size * sizeof(int32_t));
+    hdr->fill = 0;
+    int64_t n = 0;
+    for (int64_t ix = hdr->head; ix != LINK_NONE; ix = TENTRY(self, ix)->next) {
+        if (!typed_link_ok(self, ix) || n++ >= hdr->size)
+            return typed_corrupt();
+        if (typed_insert_slot(self, ix) < 0)
+            return -1;
+    }
+    return 0;
 }
 
-static PyObject *
-DequeDictViewIter_next(DequeDictViewIterObject *it)
+static int
+typed_unlink(TypedDequeDictObject *self, int64_t ix)
 {
-    if (!it->current) return NULL;
+    TypedHeader *hdr = self->hdr;
+    TypedEntry *e = TENTRY(self, ix);
+    if (!typed_link_ok(self, e->prev) || !typed_link_ok(self, e->next))
+        return typed_corrupt();
+    if (e->prev != LINK_NONE)
+        TENTRY(self, e->prev)->next = e->next;
+    else
+        hdr->head = e->next;
+    if (e->next != LINK_NONE)
+        TENTRY(self, e->next)->prev = e->prev;
+    else
+        hdr->tail = e->prev;
+    hdr->version++;
+    return 0;
+}
 
-    PyObject *result;
-    if (it->kind == 0) {
-        result = it->current->key;
-        Py_INCREF(result);
-    } else if (it->kind == 1) {
-        result = it->current->value;
-        Py_INCREF(result);
+static int
+typed_link(TypedDequeDictObject *self, int64_t ix, int last)
+{
+    TypedHeader *hdr = self->hdr;
+    TypedEntry *e = TENTRY(self, ix);
+    if (!typed_link_ok(self, hdr->head) || !typed_link_ok(self, hdr->tail))
+        return typed_corrupt();
+    if (last) {
+        e->prev = hdr->tail;
+        e->next = LINK_NONE;
+        if (hdr->tail != LINK_NONE)
+            TENTRY(self, hdr->tail)->next = (int32_t)ix;
+        else
+            hdr->head = (int32_t)ix;
+        hdr->tail = (int32_t)ix;
     } else {
-        result = PyTuple_Pack(2, it->current->key, it->current->value);
+        e->prev = LINK_NONE;
+        e->next = hdr->head;
+        if (hdr->head != LINK_NONE)
+            TENTRY(self, hdr->head)->prev = (int32_t)ix;
+        else
+            hdr->tail = (int32_t)ix;
+        hdr->head = (int32_t)ix;
     }
-
-    it->current = it->reverse ? it->current->prev : it->current->next;
-    return result;
+    hdr->version++;
+    return 0;
 }
 
-static PyObject *
-DequeDictView_iter(DequeDictViewObject *self)
+/* Unlink entry ix (in table slot, or -1 to find it) and free it */
+static int
+typed_remove(TypedDequeDictObject *self, int64_t ix, int64_t slot)
 {
-    DequeDictViewIterObject *it = PyObject_GC_New(DequeDictViewIterObject, &DequeDictViewIter_Type);
-    if (!it) return NULL;
-
-    Py_INCREF(self->dd);
-    it->dd = self->dd;
-    it->current = self->dd->head;
-    it->kind = self->kind;
-    it->reverse = 0;
-    PyObject_GC_Track(it);
-    return (PyObject *)it;
+    if (slot < 0 && (slot = typed_slot_of(self, ix)) < 0)
+        return -1;
+    TypedHeader *hdr = self->hdr;
+    if (typed_unlink(self, ix) < 0)
+        return -1;
+    self->table[slot] = SLOT_DUMMY;
+    TypedEntry *e = TENTRY(self, ix);
+    e->prev = LINK_FREE;
+    e->next = hdr->free_list;
+    hdr->free_list = (int32_t)ix;
+    hdr->size--;
+    return 0;
 }
 
-static PyObject *
-DequeDictView_reversed(DequeDictViewObject *self)
+/* Point the object at a formatted region */
+static void
+typed_bind(TypedDequeDictObject *self, char *base)
 {
-    DequeDictViewIterObject *it = PyObject_GC_New(DequeDictViewIterObject, &DequeDictViewIter_Type);
-    if (!it) return NULL;
-
-    Py_INCREF(self->dd);
-    it->dd = self->dd;
-    it->current = self->dd->tail;
-    it->kind = self->kind;
-    it->reverse = 1;
-    PyObject_GC_Track(it);
-    return (PyObject *)it;
+    self->hdr = (TypedHeader *)base;
+    self->entries = base + TYPED_HEADER_SIZE;
+    self->table = (int32_t *)(self->entries + (size_t)self->hdr->capacity * self->hdr->entry_size);
+    self->value_offset = (uint32_t)sizeof(TypedEntry) + typed_payload(self->hdr->key_kind, self->hdr->key_size);
 }
 
-static int
-DequeDictKeysView_contains(DequeDictViewObject *self, PyObject *key)
+static void
+typed_format(char *base, int64_t capacity, uint8_t key_kind, uint32_t key_size,
+             uint8_t value_kind, uint32_t value_size)
 {
-    return PyDict_Contains(self->dd->dict, key);
+    TypedHeader *hdr = (TypedHeader *)base;
+    memset(hdr, 0, TYPED_HEADER_SIZE);
+    memcpy(hdr->magic, TYPED_MAGIC, sizeof(hdr->magic));
+    hdr->key_kind = key_kind;
+    hdr->key_size = key_size;
+    hdr->value_kind = value_kind;
+    hdr->value_size = value_size;
+    hdr->entry_size = (uint32_t)sizeof(TypedEntry) + typed_payload(key_kind, key_size)
+                      + typed_payload(value_kind, value_size);
+    hdr->capacity = capacity;
+    hdr->table_size = typed_table_size(capacity);
+    hdr->head = hdr->tail = hdr->free_list = LINK_NONE;
+    int32_t *table = (int32_t *)(base + TYPED_HEADER_SIZE + (size_t)capacity * hdr->entry_size);
+    memset(table, 0xff, (size_t)hdr->table_size * sizeof(int32_t));
 }
 
+/* Move a TypedDequeDict's entries, in order, into a new region of the
+ * given capacity (at least its size), dropping holes and dummies */
 static int
-DequeDictValuesView_contains(DequeDictViewObject *self, PyObject *value)
+typed_resize(TypedDequeDictObject *self, int64_t capacity)
 {
-    DequeDictEntry *entry = self->dd->head;
-    while (entry) {
-        int cmp = PyObject_RichCompareBool(entry->value, value, Py_EQ);
-        if (cmp != 0) return cmp;
-        entry = entry->next;
+    TypedHeader *old = self->hdr;
+    char *old_entries = self->entries;
+    Py_ssize_t nbytes = typed_nbytes(capacity, old->entry_size);
+    if (nbytes < 0)
+        return -1;
+    char *base = PyMem_Malloc(nbytes);
+    if (!base) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    typed_format(base, capacity, old->key_kind, old->key_size, old->value_kind, old->value_size);
+    typed_bind(self, base);
+    TypedHeader *hdr = self->hdr;
+    hdr->version = old->version + 1;
+
+    int64_t n = 0;
+    for (int64_t ix = old->head; ix != LINK_NONE; n++) {
+        TypedEntry *src = (TypedEntry *)(old_entries + (size_t)ix * old->entry_size);
+        TypedEntry *dst = TENTRY(self, n);
+        memcpy(dst, src, old->entry_size);
+        dst->prev = n ? (int32_t)(n - 1) : LINK_NONE;
+        dst->next = LINK_NONE;
+        if (n)
+            TENTRY(self, n - 1)->next = (int32_t)n;
+        hdr->used = hdr->size = n + 1;
+        (void)typed_insert_slot(self, n);   /* Cannot fail on a fresh table */
+        ix = src->next;
     }
+    if (n) {
+        hdr->head = 0;
+        hdr->tail = (int32_t)(n - 1);
+    }
+    PyMem_Free(self->owned);
+    self->owned = base;
     return 0;
 }
 
+/* Halve an owned region once a quarter full, like DequeDict's compaction.
+ * Only an optimisation, so a failed allocation is ignored. */
+static void
+typed_maybe_shrink(TypedDequeDictObject *self)
+{
+    int64_t capacity = self->hdr->capacity;
+    if (self->owned && capacity > TYPED_MIN_CAPACITY && self->hdr->size * 4 <= capacity
+        && typed_resize(self, capacity / 2) < 0)
+        PyErr_Clear();
+}
+
+/* Add an absent key at the tail (or head). A full region grows if it is
+ * owned and below maxsize, otherwise it evicts from the other end. */
 static int
-DequeDictItemsView_contains(DequeDictViewObject *self, PyObject *item)
+typed_insert(TypedDequeDictObject *self, const TypedKey *key, const TypedValue *value, int last)
 {
-    if (!PyTuple_Check(item) || PyTuple_GET_SIZE(item) != 2)
+    TypedHeader *hdr = self->hdr;
+    if (self->owned && hdr->size >= hdr->capacity
+        && (self->maxsize < 0 || hdr->capacity < self->maxsize)) {
+        int64_t limit = self->maxsize < 0 ? TYPED_CAPACITY_MAX : self->maxsize;
+        if (hdr->capacity >= limit) {
+            PyErr_SetString(PyExc_OverflowError, "TypedDequeDict is full");
+            return -1;
+        }
+        if (typed_resize(self, Py_MIN(hdr->capacity * 2, limit)) < 0)
+            return -1;
+        hdr = self->hdr;
+    }
+    if (hdr->capacity == 0)
         return 0;
+    if (hdr->size >= hdr->capacity) {
+        int64_t victim = last ? hdr->head : hdr->tail;
+        if (victim == LINK_NONE || !typed_link_ok(self, victim))
+            return typed_corrupt();
+        if (typed_remove(self, victim, -1) < 0)
+            return -1;
+    }
+    if ((hdr->fill + 1) * 4 > hdr->table_size * 3 && typed_rehash(self) < 0)
+        return -1;
 
-    PyObject *key = PyTuple_GET_ITEM(item, 0);
-    PyObject *value = PyTuple_GET_ITEM(item, 1);
+    int64_t ix = hdr->free_list;
+    if (ix != LINK_NONE) {
+        if (ix < 0 || ix >= hdr->used)
+            return typed_corrupt();
+        hdr->free_list = TENTRY(self, ix)->next;
+    }
+    else if (hdr->used < hdr->capacity)
+        ix = hdr->used++;
+    else
+        return typed_corrupt();
+
+    TypedEntry *e = TENTRY(self, ix);
+    typed_store_key(self, e, key);
+    typed_store_value(self, e, value);
+    if (typed_link(self, ix, last) < 0)
+        return -1;
+    hdr->size++;
+    if (typed_insert_slot(self, ix) < 0)
+        return -1;
+    return 0;
+}
 
-    PyObject *capsule = PyDict_GetItem(self->dd->dict, key);
-    if (!capsule) return 0;
+static void
+typed_clear(TypedDequeDictObject *self)
+{
+    TypedHeader *hdr = self->hdr;
+    if (self->owned && hdr->capacity > TYPED_MIN_CAPACITY) {
+        hdr->head = LINK_NONE;      /* Resize as an empty list */
+        if (typed_resize(self, TYPED_MIN_CAPACITY) == 0)
+            return;
+        PyErr_Clear();
+    }
+    memset(self->table, 0xff, (size_t)hdr->table_size * sizeof(int32_t));
+    hdr->head = hdr->tail = hdr->free_list = LINK_NONE;
+    hdr->size = hdr->used = hdr->fill = 0;
+    hdr->version++;
+}
 
-    DequeDictEntry *entry = (DequeDictEntry *)PyLong_AsVoidPtr(capsule);
-    if (!entry) return 0;
+/* Keys (0), values (1) or pairs (2) in order */
+static PyObject *
+typed_collect(TypedDequeDictObject *self, int kind)
+{
+    TypedHeader *hdr = self->hdr;
+    PyObject *list = PyList_New(hdr->size);
+    if (!list) return NULL;
+    int64_t i = 0;
+    for (int64_t ix = hdr->head; ix != LINK_NONE; ix = TENTRY(self, ix)->next, i++) {
+        if (!typed_link_ok(self, ix) || i >= hdr->size) {
+            Py_DECREF(list);
+            typed_corrupt();
+            return NULL;
+        }
+        TypedEntry *e = TENTRY(self, ix);
+        PyObject *item;
+        if (kind == 0)
+            item = typed_box_key(self, e);
+        else if (kind == 1)
+            item = typed_box_value(self, e);
+        else {
+            PyObject *k = typed_box_key(self, e);
+            PyObject *v = k ? typed_box_value(self, e) : NULL;
+            item = v ? PyTuple_Pack(2, k, v) : NULL;
+            Py_XDECREF(k);
+            Py_XDECREF(v);
+        }
+        if (!item) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, item);
+    }
+    if (i != hdr->size) {
+        Py_DECREF(list);
+        typed_corrupt();
+        return NULL;
+    }
+    return list;
+}
 
-    return PyObject_RichCompareBool(entry->value, value, Py_EQ);
+/* Check that a region holds a consistent header that fits in len bytes */
+static int
+typed_check_header(const char *base, Py_ssize_t len)
+{
+    const TypedHeader *hdr = (const TypedHeader *)base;
+    if (len < (Py_ssize_t)TYPED_HEADER_SIZE || memcmp(hdr->magic, TYPED_MAGIC, sizeof(hdr->magic)) != 0) {
+        PyErr_SetString(PyExc_ValueError, "buffer does not hold a SharedDequeDict");
+        return -1;
+    }
+    int kinds_ok = (hdr->key_kind == TYPED_I8 && hdr->key_size == 8)
+                   || (hdr->key_kind == TYPED_BYTES && hdr->key_size >= 1 && hdr->key_size <= TYPED_BYTES_MAX);
+    kinds_ok = kinds_ok && ((hdr->value_kind == TYPED_I8 || hdr->value_kind == TYPED_F8) ? hdr->value_size == 8
+                            : hdr->value_kind == TYPED_BYTES && hdr->value_size >= 1
+                              && hdr->value_size <= TYPED_BYTES_MAX);
+    if (!kinds_ok || hdr->capacity < 0 || hdr->capacity > TYPED_CAPACITY_MAX
+        || hdr->entry_size != sizeof(TypedEntry) + typed_payload(hdr->key_kind, hdr->key_size)
+                              + typed_payload(hdr->value_kind, hdr->value_size)
+        || hdr->table_size != typed_table_size(hdr->capacity)) {
+        PyErr_SetString(PyExc_ValueError, "SharedDequeDict header is corrupt");
+        return -1;
+    }
+    Py_ssize_t need = typed_nbytes(hdr->capacity, hdr->entry_size);
+    if (need < 0)
+        return -1;
+    if (need > len) {
+        PyErr_Format(PyExc_ValueError, "buffer of %zd bytes is too small for a SharedDequeDict of %zd bytes",
+                     len, need);
+        return -1;
+    }
+    if (hdr->size < 0 || hdr->size > hdr->capacity || hdr->used < hdr->size || hdr->used > hdr->capacity
+        || !(hdr->head == LINK_NONE || (hdr->head >= 0 && hdr->head < hdr->used))
+        || !(hdr->tail == LINK_NONE || (hdr->tail >= 0 && hdr->tail < hdr->used))) {
+        PyErr_SetString(PyExc_ValueError, "SharedDequeDict header is corrupt");
+        return -1;
+    }
+    return 0;
 }
 
-static PySequenceMethods DequeDictKeysView_as_seq = {
-    .sq_length = (lenfunc)DequeDictView_len,
-    .sq_contains = (objobjproc)DequeDictKeysView_contains,
-};
+/* ---- Operations common to TypedDequeDict and SharedDequeDict ---- */
 
-static PySequenceMethods DequeDictValuesView_as_seq = {
-    .sq_length = (lenfunc)DequeDictView_len,
-    .sq_contains = (objobjproc)DequeDictValuesView_contains,
-};
+#define TYPED_CHECK_OPEN(self, ret) \
+    do { \
+        if (!(self)->hdr) { \
+            PyErr_SetString(PyExc_ValueError, "operation on a closed SharedDequeDict"); \
+            return ret; \
+        } \
+    } while (0)
 
-static PySequenceMethods DequeDictItemsView_as_seq = {
-    .sq_length = (lenfunc)DequeDictView_len,
-    .sq_contains = (objobjproc)DequeDictItemsView_contains,
-};
+#define TYPED_CHECK_WRITABLE(self, ret) \
+    do { \
+        TYPED_CHECK_OPEN(self, ret); \
+        if ((self)->readonly) { \
+            PyErr_SetString(PyExc_TypeError, "SharedDequeDict buffer is read-only"); \
+            return ret; \
+        } \
+    } while (0)
 
-static PyMethodDef DequeDictKeysView_methods[] = {
-    {"__reversed__", (PyCFunction)DequeDictView_reversed, METH_NOARGS, NULL},
-    {NULL}
-};
+#define TYPED_NAME(self) ((self)->owned ? "TypedDequeDict" : "SharedDequeDict")
 
-static PyMethodDef DequeDictValuesView_methods[] = {
-    {"__reversed__", (PyCFunction)DequeDictView_reversed, METH_NOARGS, NULL},
-    {NULL}
-};
+static Py_ssize_t
+TypedDequeDict_len(TypedDequeDictObject *self)
+{
+    TYPED_CHECK_OPEN(self, -1);
+    return (Py_ssize_t)self->hdr->size;
+}
 
-static PyMethodDef DequeDictItemsView_methods[] = {
-    {"__reversed__", (PyCFunction)DequeDictView_reversed, METH_NOARGS, NULL},
-    {NULL}
-};
+static PyObject *
+TypedDequeDict_getitem(TypedDequeDictObject *self, PyObject *key)
+{
+    TYPED_CHECK_OPEN(self, NULL);
+    TypedKey k;
+    int64_t ix;
+    int r = typed_lookup_key(self, key, &k);
+    if (r > 0)
+        r = typed_lookup(self, &k, &ix, NULL);
+    if (r < 0)
+        return NULL;
+    if (r == 0) {
+        PyErr_SetObject(PyExc_KeyError, key);
+        return NULL;
+    }
+    return typed_box_value(self, TENTRY(self, ix));
+}
 
-static PyTypeObject DequeDictViewIter_Type = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "dequedict.DequeDictViewIter",
-    .tp_basicsize = sizeof(DequeDictViewIterObject),
-    .tp_dealloc = (destructor)DequeDictViewIter_dealloc,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
-    .tp_traverse = (traverseproc)DequeDictViewIter_traverse,
-    .tp_clear = (inquiry)DequeDictViewIter_clear,
-    .tp_iter = PyObject_SelfIter,
-    .tp_iternext = (iternextfunc)DequeDictViewIter_next,
-};
+/* Set key to value: updates keep position, new keys go to the end */
+static int
+TypedDequeDict_set(TypedDequeDictObject *self, PyObject *key, PyObject *value)
+{
+    TypedKey k;
+    TypedValue v = {0};
+    int64_t ix;
+    int r = typed_key(self, key, &k);
+    if (r <= 0 || typed_value(self, value, &v) < 0)
+        return -1;
+    if ((r = typed_lookup(self, &k, &ix, NULL)) < 0)
+        return -1;
+    if (r) {
+        typed_store_value(self, TENTRY(self, ix), &v);
+        return 0;
+    }
+    return typed_insert(self, &k, &v, 1);
+}
 
-static PyTypeObject DequeDictKeysView_Type = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "dequedict.DequeDictKeys",
-    .tp_basicsize = sizeof(DequeDictViewObject),
-    .tp_dealloc = (destructor)DequeDictView_dealloc,
-    .tp_as_sequence = &DequeDictKeysView_as_seq,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
-    .tp_traverse = (traverseproc)DequeDictView_traverse,
-    .tp_clear = (inquiry)DequeDictView_clear,
-    .tp_iter = (getiterfunc)DequeDictView_iter,
-    .tp_methods = DequeDictKeysView_methods,
-};
+static int
+TypedDequeDict_setitem(TypedDequeDictObject *self, PyObject *key, PyObject *value)
+{
+    TYPED_CHECK_WRITABLE(self, -1);
+    if (value)
+        return TypedDequeDict_set(self, key, value);
+
+    TypedKey k;
+    int64_t ix, slot;
+    int r = typed_lookup_key(self, key, &k);
+    if (r > 0)
+        r = typed_lookup(self, &k, &ix, &slot);
+    if (r < 0)
+        return -1;
+    if (r == 0) {
+        PyErr_SetObject(PyExc_KeyError, key);
+        return -1;
+    }
+    if (typed_remove(self, ix, slot) < 0)
+        return -1;
+    typed_maybe_shrink(self);
+    return 0;
+}
 
-static PyTypeObject DequeDictValuesView_Type = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "dequedict.DequeDictValues",
-    .tp_basicsize = sizeof(DequeDictViewObject),
-    .tp_dealloc = (destructor)DequeDictView_dealloc,
-    .tp_as_sequence = &DequeDictValuesView_as_seq,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
-    .tp_traverse = (traverseproc)DequeDictView_traverse,
-    .tp_clear = (inquiry)DequeDictView_clear,
-    .tp_iter = (getiterfunc)DequeDictView_iter,
-    .tp_methods = DequeDictValuesView_methods,
-};
+static int
+TypedDequeDict_contains(TypedDequeDictObject *self, PyObject *key)
+{
+    TYPED_CHECK_OPEN(self, -1);
+    TypedKey k;
+    int64_t ix;
+    int r = typed_lookup_key(self, key, &k);
+    return r > 0 ? typed_lookup(self, &k, &ix, NULL) : r;
+}
 
-static PyTypeObject DequeDictItemsView_Type = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "dequedict.DequeDictItems",
-    .tp_basicsize = sizeof(DequeDictViewObject),
-    .tp_dealloc = (destructor)DequeDictView_dealloc,
-    .tp_as_sequence = &DequeDictItemsView_as_seq,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
-    .tp_traverse = (traverseproc)DequeDictView_traverse,
-    .tp_clear = (inquiry)DequeDictView_clear,
-    .tp_iter = (getiterfunc)DequeDictView_iter,
-    .tp_methods = DequeDictItemsView_methods,
-};
+/* get(key, default=None) */
+static PyObject *
+TypedDequeDict_get(TypedDequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    TYPED_CHECK_OPEN(self, NULL);
+    if (!DequeDict_check_nargs("get", nargs, 1, 2))
+        return NULL;
+    TypedKey k;
+    int64_t ix;
+    int r = typed_lookup_key(self, args[0], &k);
+    if (r > 0)
+        r = typed_lookup(self, &k, &ix, NULL);
+    if (r < 0)
+        return NULL;
+    if (r)
+        return typed_box_value(self, TENTRY(self, ix));
+    PyObject *default_val = nargs > 1 ? args[1] : Py_None;
+    Py_INCREF(default_val);
+    return default_val;
+}
+
+/* pop(key[, default]) */
+static PyObject *
+TypedDequeDict_pop(TypedDequeDictObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    TYPED_CHECK_WRITABLE(self, NULL);
+    if (!DequeDict_check_nargs("pop", nargs, 1, 2))
+        return NULL;
+    TypedKey k;
+    int64_t ix, slot;
+    int r = typed_lookup_key(self, args[0], &k);
+    if (r > 0)
+        r = typed_lookup(self, &k, &ix, &slot);
+    if (r < 0)
+        return NULL;
+    if (r == 0) {
+        if (nargs > 1) {
+            Py_INCREF(args[1]);
+            return args[1];
+        }
+        PyErr_SetObject(PyExc_KeyError, args[0]);
+        return NULL;
+    }
+    PyObject *value = typed_box_value(self, TENTRY(self, ix));
+    if (value && typed_remove(self, ix, slot) < 0)
+        Py_CLEAR(value);
+    else if (value)
+        typed_maybe_shrink(self);
+    return value;
+}
+
+/* popleft() / popleftitem() */
+static PyObject *
+TypedDequeDict_popleft_impl(TypedDequeDictObject *self, int items)
+{
+    TYPED_CHECK_WRITABLE(self, NULL);
+    int64_t ix = self->hdr->head;
+    if (ix == LINK_NONE) {
+        if (items)
+            PyErr_Format(PyExc_KeyError, "popleftitem from an empty %s", TYPED_NAME(self));
+        else
+            PyErr_Format(PyExc_IndexError, "pop from an empty %s", TYPED_NAME(self));
+        return NULL;
+    }
+    if (!typed_link_ok(self, ix)) {
+        typed_corrupt();
+        return NULL;
+    }
+    TypedEntry *e = TENTRY(self, ix);
+    PyObject *result;
+    if (items) {
+        PyObject *k = typed_box_key(self, e);
+        PyObject *v = k ? typed_box_value(self, e) : NULL;
+        result = v ? PyTuple_Pack(2, k, v) : NULL;
+        Py_XDECREF(k);
+        Py_XDECREF(v);
+    }
+    else
+        result = typed_box_value(self, e);
+    if (result && typed_remove(self, ix, -1) < 0)
+        Py_CLEAR(result);
+    else if (result)
+        typed_maybe_shrink(self);
+    return result;
+}
+
+static PyObject *
+TypedDequeDict_popleft(TypedDequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    return TypedDequeDict_popleft_impl(self, 0);
+}
+
+static PyObject *
+TypedDequeDict_popleftitem(TypedDequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    return TypedDequeDict_popleft_impl(self, 1);
+}
 
-/* keys() - O(1) returns view */
+/* peekleft() / peek() */
 static PyObject *
-DequeDict_keys(DequeDictObject *self, PyObject *Py_UNUSED(args))
+TypedDequeDict_peek_impl(TypedDequeDictObject *self, int last)
 {
-    DequeDictViewObject *view = PyObject_GC_New(DequeDictViewObject, &DequeDictKeysView_Type);
-    if (!view) return NULL;
-    Py_INCREF(self);
-    view->dd = self;
-    view->kind = 0;
-    PyObject_GC_Track(view);
-    return (PyObject *)view;
+    TYPED_CHECK_OPEN(self, NULL);
+    int64_t ix = last ? self->hdr->tail : self->hdr->head;
+    if (ix == LINK_NONE) {
+        PyErr_Format(PyExc_IndexError, "peek from an empty %s", TYPED_NAME(self));
+        return NULL;
+    }
+    if (!typed_link_ok(self, ix)) {
+        typed_corrupt();
+        return NULL;
+    }
+    return typed_box_value(self, TENTRY(self, ix));
 }
 
-/* values() - O(1) returns view */
 static PyObject *
-DequeDict_values(DequeDictObject *self, PyObject *Py_UNUSED(args))
+TypedDequeDict_peekleft(TypedDequeDictObject *self, PyObject *Py_UNUSED(args))
 {
-    DequeDictViewObject *view = PyObject_GC_New(DequeDictViewObject, &DequeDictValuesView_Type);
-    if (!view) return NULL;
-    Py_INCREF(self);
-    view->dd = self;
-    view->kind = 1;
-    PyObject_GC_Track(view);
-    return (PyObject *)view;
+    return TypedDequeDict_peek_impl(self, 0);
 }
 
-/* items() - O(1) returns view */
 static PyObject *
-DequeDict_items(DequeDictObject *self, PyObject *Py_UNUSED(args))
+TypedDequeDict_peek(TypedDequeDictObject *self, PyObject *Py_UNUSED(args))
 {
-    DequeDictViewObject *view = PyObject_GC_New(DequeDictViewObject, &DequeDictItemsView_Type);
-    if (!view) return NULL;
-    Py_INCREF(self);
-    view->dd = self;
-    view->kind = 2;
-    PyObject_GC_Track(view);
-    return (PyObject *)view;
+    return TypedDequeDict_peek_impl(self, 1);
 }
 
-/* clear() - Python method */
+/* move_to_end(key, last=True) */
 static PyObject *
-DequeDict_clear_method(DequeDictObject *self, PyObject *Py_UNUSED(args))
+TypedDequeDict_move_to_end(TypedDequeDictObject *self, PyObject *const *args, Py_ssize_t nargs,
+                            PyObject *kwnames)
 {
-    DequeDictEntry *entry = self->head;
-    while (entry) {
-        DequeDictEntry *next = entry->next;
-        Py_DECREF(entry->key);
-        Py_DECREF(entry->value);
-        entry_free(entry);
-        entry = next;
+    static const char *const kwlist[] = {"key", "last", NULL};
+    PyObject *argv[2] = {NULL, NULL};
+    int last = 1;
+    TYPED_CHECK_WRITABLE(self, NULL);
+    if (DequeDict_parse_args("move_to_end", args, nargs, kwnames, kwlist, 2, 1, argv) < 0)
+        return NULL;
+    if (argv[1] && (last = PyObject_IsTrue(argv[1])) < 0)
+        return NULL;
+
+    TypedKey k;
+    int64_t ix;
+    int r = typed_lookup_key(self, argv[0], &k);
+    if (r > 0)
+        r = typed_lookup(self, &k, &ix, NULL);
+    if (r < 0)
+        return NULL;
+    if (r == 0) {
+        PyErr_SetObject(PyExc_KeyError, argv[0]);
+        return NULL;
     }
+    if (ix != (last ? self->hdr->tail : self->hdr->head)
+        && (typed_unlink(self, ix) < 0 || typed_link(self, ix, last) < 0))
+        return NULL;
+    Py_RETURN_NONE;
+}
 
-    PyDict_Clear(self->dict);
-    self->head = NULL;
-    self->tail = NULL;
-    self->size = 0;
-    DequeDict_invalidate_cache(self);
+static PyObject *
+TypedDequeDict_keys(TypedDequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    TYPED_CHECK_OPEN(self, NULL);
+    return typed_collect(self, 0);
+}
 
-    Py_RETURN_NONE;
+static PyObject *
+TypedDequeDict_values(TypedDequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    TYPED_CHECK_OPEN(self, NULL);
+    return typed_collect(self, 1);
 }
 
-/* copy() */
 static PyObject *
-DequeDict_copy(DequeDictObject *self, PyObject *Py_UNUSED(args))
+TypedDequeDict_items(TypedDequeDictObject *self, PyObject *Py_UNUSED(args))
 {
-    PyObject *items = DequeDict_items(self, NULL);
-    if (!items) return NULL;
+    TYPED_CHECK_OPEN(self, NULL);
+    return typed_collect(self, 2);
+}
 
-    PyObject *result = PyObject_CallFunctionObjArgs((PyObject *)&DequeDict_Type, items, NULL);
-    Py_DECREF(items);
-    return result;
+/* keys_array() / values_array(): one pass over the list into a block */
+static PyObject *
+typed_array(TypedDequeDictObject *self, int values)
+{
+    TypedHeader *hdr = self->hdr;
+    uint8_t kind = values ? hdr->value_kind : hdr->key_kind;
+    uint32_t size = values ? hdr->value_size : hdr->key_size;
+    char format[16];
+    if (kind == TYPED_BYTES)
+        snprintf(format, sizeof(format), "%us", size);
+    else
+        snprintf(format, sizeof(format), "%s", kind == TYPED_F8 ? "d" : "q");
+
+    DequeDictArrayObject *array = DequeDictArray_new(hdr->size, size, format);
+    if (!array) return NULL;
+    char *out = array->data;
+    int64_t i = 0;
+    for (int64_t ix = hdr->head; ix != LINK_NONE; ix = TENTRY(self, ix)->next, i++, out += size) {
+        if (!typed_link_ok(self, ix) || i >= hdr->size) {
+            Py_DECREF(array);
+            typed_corrupt();
+            return NULL;
+        }
+        char *p = values ? TVALUE(self, TENTRY(self, ix)) : TKEY(TENTRY(self, ix));
+        if (kind != TYPED_BYTES) {
+            memcpy(out, p, 8);
+            continue;
+        }
+        uint32_t len;
+        memcpy(&len, p, 4);
+        if (len > size) {
+            Py_DECREF(array);
+            typed_corrupt();
+            return NULL;
+        }
+        memcpy(out, p + 4, len);    /* The block is zero-filled */
+    }
+    return DequeDictArray_view(array);
 }
 
-/* update(other) */
 static PyObject *
-DequeDict_update(DequeDictObject *self, PyObject *args, PyObject *kwds)
+TypedDequeDict_keys_array(TypedDequeDictObject *self, PyObject *Py_UNUSED(args))
 {
-    PyObject *other = NULL;
+    TYPED_CHECK_OPEN(self, NULL);
+    return typed_array(self, 0);
+}
 
-    if (!PyArg_ParseTuple(args, "|O", &other))
-        return NULL;
+static PyObject *
+TypedDequeDict_values_array(TypedDequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    TYPED_CHECK_OPEN(self, NULL);
+    return typed_array(self, 1);
+}
 
-    if (other) {
-        if (PyDict_Check(other)) {
-            PyObject *key, *value;
-            Py_ssize_t pos = 0;
-            while (PyDict_Next(other, &pos, &key, &value)) {
-                if (DequeDict_setitem(self, key, value) < 0)
-                    return NULL;
-            }
-        } else {
-            PyObject *iter = PyObject_GetIter(other);
-            if (!iter) return NULL;
-
-            PyObject *pair;
-            while ((pair = PyIter_Next(iter)) != NULL) {
-                if (!PyTuple_Check(pair) || PyTuple_GET_SIZE(pair) != 2) {
-                    Py_DECREF(pair);
-                    Py_DECREF(iter);
-                    PyErr_SetString(PyExc_ValueError,
-                        "update requires sequence of (key, value) pairs");
-                    return NULL;
-                }
+static PyObject *
+TypedDequeDict_iter(TypedDequeDictObject *self)
+{
+    PyObject *keys = TypedDequeDict_keys(self, NULL);
+    if (!keys) return NULL;
+    PyObject *iter = PyObject_GetIter(keys);
+    Py_DECREF(keys);
+    return iter;
+}
 
-                PyObject *key = PyTuple_GET_ITEM(pair, 0);
-                PyObject *value = PyTuple_GET_ITEM(pair, 1);
+static PyObject *
+TypedDequeDict_clear_method(TypedDequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    TYPED_CHECK_WRITABLE(self, NULL);
+    typed_clear(self);
+    Py_RETURN_NONE;
+}
 
-                if (DequeDict_setitem(self, key, value) < 0) {
-                    Py_DECREF(pair);
-                    Py_DECREF(iter);
-                    return NULL;
-                }
-                Py_DECREF(pair);
-            }
-            Py_DECREF(iter);
-            if (PyErr_Occurred()) return NULL;
+/* update(other) - a mapping or an iterable of (key, value) pairs */
+static PyObject *
+TypedDequeDict_update(TypedDequeDictObject *self, PyObject *other)
+{
+    TYPED_CHECK_WRITABLE(self, NULL);
+    PyObject *items = other;
+    if (PyDict_CheckExact(other))
+        items = PyDict_Items(other);
+    else if (PyMapping_Check(other) && PyObject_HasAttrString(other, "items"))
+        items = PyMapping_Items(other);
+    else
+        Py_INCREF(items);
+    if (!items) return NULL;
+    PyObject *iter = PyObject_GetIter(items);
+    Py_DECREF(items);
+    if (!iter) return NULL;
+
+    PyObject *pair;
+    int r = 0;
+    while (r == 0 && (pair = PyIter_Next(iter)) != NULL) {
+        if (!PyTuple_Check(pair) || PyTuple_GET_SIZE(pair) != 2) {
+            PyErr_SetString(PyExc_ValueError, "update requires sequence of (key, value) pairs");
+            r = -1;
         }
+        else
+            r = TypedDequeDict_set(self, PyTuple_GET_ITEM(pair, 0), PyTuple_GET_ITEM(pair, 1));
+        Py_DECREF(pair);
     }
+    Py_DECREF(iter);
+    if (r < 0 || PyErr_Occurred())
+        return NULL;
+    Py_RETURN_NONE;
+}
 
-    /* Process keyword arguments */
-    if (kwds) {
-        PyObject *key, *value;
-        Py_ssize_t pos = 0;
-        while (PyDict_Next(kwds, &pos, &key, &value)) {
-            if (DequeDict_setitem(self, key, value) < 0)
-                return NULL;
-        }
-    }
+static PyObject *
+TypedDequeDict_repr(TypedDequeDictObject *self)
+{
+    if (!self->hdr)
+        return PyUnicode_FromString("<closed SharedDequeDict>");
+    PyObject *items = typed_collect(self, 2);
+    PyObject *k = typed_type_name(self->hdr->key_kind, self->hdr->key_size);
+    PyObject *v = typed_type_name(self->hdr->value_kind, self->hdr->value_size);
+    PyObject *repr = NULL;
+    if (items && k && v && !self->owned)
+        repr = PyUnicode_FromFormat("SharedDequeDict(%R, key_type=%R, value_type=%R, capacity=%lld)",
+                                    items, k, v, (long long)self->hdr->capacity);
+    else if (items && k && v && self->maxsize >= 0)
+        repr = PyUnicode_FromFormat("TypedDequeDict(%R, key_type=%R, value_type=%R, maxsize=%lld)",
+                                    items, k, v, (long long)self->maxsize);
+    else if (items && k && v)
+        repr = PyUnicode_FromFormat("TypedDequeDict(%R, key_type=%R, value_type=%R)", items, k, v);
+    Py_XDECREF(items);
+    Py_XDECREF(k);
+    Py_XDECREF(v);
+    return repr;
+}
 
-    Py_RETURN_NONE;
+static PyObject *
+TypedDequeDict_get_capacity(TypedDequeDictObject *self, void *Py_UNUSED(closure))
+{
+    TYPED_CHECK_OPEN(self, NULL);
+    return PyLong_FromLongLong(self->hdr->capacity);
 }
 
-/* setdefault(key, default=None) */
 static PyObject *
-DequeDict_setdefault(DequeDictObject *self, PyObject *args)
+TypedDequeDict_get_key_type(TypedDequeDictObject *self, void *Py_UNUSED(closure))
 {
-    PyObject *key;
-    PyObject *default_val = Py_None;
+    TYPED_CHECK_OPEN(self, NULL);
+    return typed_type_name(self->hdr->key_kind, self->hdr->key_size);
+}
 
-    if (!PyArg_ParseTuple(args, "O|O", &key, &default_val))
+static PyObject *
+TypedDequeDict_get_value_type(TypedDequeDictObject *self, void *Py_UNUSED(closure))
+{
+    TYPED_CHECK_OPEN(self, NULL);
+    return typed_type_name(self->hdr->value_kind, self->hdr->value_size);
+}
+
+#define TYPED_LOCKED(name, params, args) DEQUEDICT_LOCKED(PyObject *, name, self, params, args)
+#define TYPED_LOCKED_METH_O(name) TYPED_LOCKED(name, (TypedDequeDictObject *self, PyObject *arg), (self, arg))
+
+TYPED_LOCKED(TypedDequeDict_get, (TypedDequeDictObject *self, PyObject *const *args, Py_ssize_t nargs),
+             (self, args, nargs))
+TYPED_LOCKED(TypedDequeDict_pop, (TypedDequeDictObject *self, PyObject *const *args, Py_ssize_t nargs),
+             (self, args, nargs))
+TYPED_LOCKED(TypedDequeDict_move_to_end,
+             (TypedDequeDictObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames),
+             (self, args, nargs, kwnames))
+TYPED_LOCKED_METH_O(TypedDequeDict_popleft)
+TYPED_LOCKED_METH_O(TypedDequeDict_popleftitem)
+TYPED_LOCKED_METH_O(TypedDequeDict_peekleft)
+TYPED_LOCKED_METH_O(TypedDequeDict_peek)
+TYPED_LOCKED_METH_O(TypedDequeDict_keys)
+TYPED_LOCKED_METH_O(TypedDequeDict_values)
+TYPED_LOCKED_METH_O(TypedDequeDict_items)
+TYPED_LOCKED_METH_O(TypedDequeDict_keys_array)
+TYPED_LOCKED_METH_O(TypedDequeDict_values_array)
+TYPED_LOCKED_METH_O(TypedDequeDict_clear_method)
+TYPED_LOCKED_METH_O(TypedDequeDict_update)
+TYPED_LOCKED(TypedDequeDict_getitem, (TypedDequeDictObject *self, PyObject *key), (self, key))
+TYPED_LOCKED(TypedDequeDict_iter, (TypedDequeDictObject *self), (self))
+TYPED_LOCKED(TypedDequeDict_repr, (TypedDequeDictObject *self), (self))
+DEQUEDICT_LOCKED(int, TypedDequeDict_setitem, self,
+                 (TypedDequeDictObject *self, PyObject *key, PyObject *value), (self, key, value))
+DEQUEDICT_LOCKED(int, TypedDequeDict_contains, self, (TypedDequeDictObject *self, PyObject *key), (self, key))
+
+/* ==, != against a dict, DequeDict or typed dict - same items in any order */
+static PyObject *
+TypedDequeDict_richcompare(TypedDequeDictObject *self, PyObject *other, int op)
+{
+    if (op != Py_EQ && op != Py_NE)
+        Py_RETURN_NOTIMPLEMENTED;
+    if (!PyDict_Check(other) && !PyObject_TypeCheck(other, &DequeDict_Type)
+        && !PyObject_TypeCheck(other, &TypedDequeDict_Type) && !PyObject_TypeCheck(other, &SharedDequeDict_Type))
+        Py_RETURN_NOTIMPLEMENTED;
+
+    PyObject *items = TypedDequeDict_items_locked(self, NULL);
+    if (!items) return NULL;
+    Py_ssize_t other_len = PyMapping_Size(other);
+    if (other_len == -1) {
+        Py_DECREF(items);
         return NULL;
+    }
 
-    PyObject *capsule = PyDict_GetItem(self->dict, key);
-    if (capsule) {
-        DequeDictEntry *entry = (DequeDictEntry *)PyLong_AsVoidPtr(capsule);
-        if (entry) {
-            Py_INCREF(entry->value);
-            return entry->value;
+    int equal = PyList_GET_SIZE(items) == other_len;
+    for (Py_ssize_t i = 0; equal && i < PyList_GET_SIZE(items); i++) {
+        PyObject *pair = PyList_GET_ITEM(items, i);
+        PyObject *other_val = PyObject_GetItem(other, PyTuple_GET_ITEM(pair, 0));
+        if (!other_val) {
+            if (!PyErr_ExceptionMatches(PyExc_KeyError)) {
+                Py_DECREF(items);
+                return NULL;
+            }
+            PyErr_Clear();
+            equal = 0;
+            break;
+        }
+        equal = PyObject_RichCompareBool(PyTuple_GET_ITEM(pair, 1), other_val, Py_EQ);
+        Py_DECREF(other_val);
+        if (equal < 0) {
+            Py_DECREF(items);
+            return NULL;
         }
     }
+    Py_DECREF(items);
+    return PyBool_FromLong(op == Py_EQ ? equal : !equal);
+}
 
-    /* Key doesn't exist - add it */
-    if (DequeDict_setitem(self, key, default_val) < 0)
-        return NULL;
+static PySequenceMethods TypedDequeDict_as_sequence = {
+    .sq_contains = (objobjproc)TypedDequeDict_contains_locked,
+};
 
-    Py_INCREF(default_val);
-    return default_val;
+static PyMappingMethods TypedDequeDict_as_mapping = {
+    .mp_length = (lenfunc)TypedDequeDict_len,
+    .mp_subscript = (binaryfunc)TypedDequeDict_getitem_locked,
+    .mp_ass_subscript = (objobjargproc)TypedDequeDict_setitem_locked,
+};
+
+/* ---- SharedDequeDict: a typed region in a caller-supplied buffer ---- */
+
+static void
+SharedDequeDict_release(TypedDequeDictObject *self)
+{
+    self->hdr = NULL;
+    self->entries = NULL;
+    self->table = NULL;
+    if (self->view.obj)
+        PyBuffer_Release(&self->view);
 }
 
-/* __class_getitem__(params) - support generic subscript syntax e.g. DequeDict[str, int] */
-static PyObject *
-DequeDict_class_getitem(PyObject *cls, PyObject *args)
+static void
+SharedDequeDict_dealloc(TypedDequeDictObject *self)
 {
-    return Py_GenericAlias(cls, args);
+    SharedDequeDict_release(self);
+    Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
-/* at(index) - O(1) via entry pointer cache */
+/* SharedDequeDict(buffer, key_type=None, value_type=None, *, capacity=None)
+ * - with capacity, format the buffer; without, attach to the region in it */
 static PyObject *
-DequeDict_at(DequeDictObject *self, PyObject *args)
+SharedDequeDict_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
-    Py_ssize_t index;
+    static char *kwlist[] = {"buffer", "key_type", "value_type", "capacity", NULL};
+    PyObject *buffer, *key_type = Py_None, *value_type = Py_None, *capacity_obj = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|OO$O:SharedDequeDict", kwlist,
+                                     &buffer, &key_type, &value_type, &capacity_obj))
+        return NULL;
 
-    if (!PyArg_ParseTuple(args, "n", &index))
+    uint8_t key_kind = 0, value_kind = 0;
+    uint32_t key_size = 0, value_size = 0;
+    if ((key_type != Py_None && typed_parse_type(key_type, 0, &key_kind, &key_size) < 0)
+        || (value_type != Py_None && typed_parse_type(value_type, 1, &value_kind, &value_size) < 0))
         return NULL;
 
-    /* Build cache if needed */
-    if (!self->index_cache) {
-        if (DequeDict_rebuild_cache(self) < 0)
+    int64_t capacity = -1;
+    if (capacity_obj != Py_None) {
+        Py_ssize_t n = PyNumber_AsSsize_t(capacity_obj, PyExc_OverflowError);
+        if (n == -1 && PyErr_Occurred())
             return NULL;
-        if (!self->index_cache) {
-            /* Empty dict, size==0, no cache allocated */
-            PyErr_SetString(PyExc_IndexError, "index out of range");
+        if (n < 0 || n > TYPED_CAPACITY_MAX) {
+            PyErr_Format(PyExc_ValueError, "capacity must be between 0 and %lld", (long long)TYPED_CAPACITY_MAX);
+            return NULL;
+        }
+        if (!key_kind || !value_kind) {
+            PyErr_SetString(PyExc_TypeError, "creating a SharedDequeDict needs key_type and value_type");
             return NULL;
         }
+        capacity = n;
     }
 
-    Py_ssize_t logical_size = self->cache_size - self->cache_offset;
+    TypedDequeDictObject *self = (TypedDequeDictObject *)type->tp_alloc(type, 0);
+    if (!self) return NULL;
+    if (PyObject_GetBuffer(buffer, &self->view, PyBUF_WRITABLE) < 0) {
+        if (capacity >= 0 || !PyErr_ExceptionMatches(PyExc_BufferError)) {
+            Py_DECREF(self);
+            return NULL;
+        }
+        /* Read-only buffers can still be attached for lookups */
+        PyErr_Clear();
+        if (PyObject_GetBuffer(buffer, &self->view, PyBUF_SIMPLE) < 0) {
+            Py_DECREF(self);
+            return NULL;
+        }
+        self->readonly = 1;
+    }
+    char *base = self->view.buf;
+    if ((uintptr_t)base % 8 != 0) {
+        PyErr_SetString(PyExc_ValueError, "SharedDequeDict buffer must be 8-byte aligned");
+        Py_DECREF(self);
+        return NULL;
+    }
 
-    if (index < 0)
-        index += logical_size;
+    if (capacity >= 0) {
+        uint32_t entry_size = (uint32_t)sizeof(TypedEntry) + typed_payload(key_kind, key_size)
+                              + typed_payload(value_kind, value_size);
+        Py_ssize_t need = typed_nbytes(capacity, entry_size);
+        if (need < 0 || need > self->view.len) {
+            if (need >= 0)
+                PyErr_Format(PyExc_ValueError, "buffer of %zd bytes is too small; capacity %lld needs %zd",
+                             self->view.len, (long long)capacity, need);
+            Py_DECREF(self);
+            return NULL;
+        }
+        typed_format(base, capacity, key_kind, key_size, value_kind, value_size);
+    }
+    else if (typed_check_header(base, self->view.len) < 0) {
+        Py_DECREF(self);
+        return NULL;
+    }
+    typed_bind(self, base);
+
+    if ((key_kind && (key_kind != self->hdr->key_kind || key_size != self->hdr->key_size))
+        || (value_kind && (value_kind != self->hdr->value_kind || value_size != self->hdr->value_size))) {
+        PyObject *k = typed_type_name(self->hdr->key_kind, self->hdr->key_size);
+        PyObject *v = typed_type_name(self->hdr->value_kind, self->hdr->value_size);
+        if (k && v)
+            PyErr_Format(PyExc_ValueError, "buffer holds a SharedDequeDict of %U -> %U", k, v);
+        Py_XDECREF(k);
+        Py_XDECREF(v);
+        Py_DECREF(self);
+        return NULL;
+    }
+    return (PyObject *)self;
+}
 
-    if (index < 0 || index >= logical_size) {
-        PyErr_SetString(PyExc_IndexError, "index out of range");
+/* nbytes(capacity, key_type, value_type) - buffer size needed */
+static PyObject *
+SharedDequeDict_nbytes_for(PyObject *Py_UNUSED(cls), PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"capacity", "key_type", "value_type", NULL};
+    Py_ssize_t capacity;
+    PyObject *key_type, *value_type;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "nOO:nbytes", kwlist, &capacity, &key_type, &value_type))
+        return NULL;
+    uint8_t key_kind, value_kind;
+    uint32_t key_size, value_size;
+    if (typed_parse_type(key_type, 0, &key_kind, &key_size) < 0
+        || typed_parse_type(value_type, 1, &value_kind, &value_size) < 0)
+        return NULL;
+    if (capacity < 0 || capacity > TYPED_CAPACITY_MAX) {
+        PyErr_Format(PyExc_ValueError, "capacity must be between 0 and %lld", (long long)TYPED_CAPACITY_MAX);
         return NULL;
     }
+    Py_ssize_t n = typed_nbytes(capacity, (uint32_t)sizeof(TypedEntry) + typed_payload(key_kind, key_size)
+                                          + typed_payload(value_kind, value_size));
+    return n < 0 ? NULL : PyLong_FromSsize_t(n);
+}
 
-    DequeDictEntry *entry = self->index_cache[self->cache_offset + index];
-    Py_INCREF(entry->value);
-    return entry->value;
+/* close() - release the buffer so its owner can be closed or unlinked */
+static PyObject *
+SharedDequeDict_close(TypedDequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    SharedDequeDict_release(self);
+    Py_RETURN_NONE;
 }
 
-/* move_to_end(key, last=True) - O(1) move key to front or back — invalidates cache */
 static PyObject *
-DequeDict_move_to_end(DequeDictObject *self, PyObject *args, PyObject *kwds)
+SharedDequeDict_enter(TypedDequeDictObject *self, PyObject *Py_UNUSED(args))
 {
-    static char *kwlist[] = {"key", "last", NULL};
-    PyObject *key;
-    int last = 1;
+    TYPED_CHECK_OPEN(self, NULL);
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|p", kwlist, &key, &last))
-        return NULL;
+static PyObject *
+SharedDequeDict_exit(TypedDequeDictObject *self, PyObject *Py_UNUSED(args))
+{
+    SharedDequeDict_release(self);
+    Py_RETURN_FALSE;
+}
 
-    PyObject *capsule = PyDict_GetItem(self->dict, key);
-    if (!capsule) {
-        PyErr_SetObject(PyExc_KeyError, key);
-        return NULL;
-    }
+static PyObject *
+SharedDequeDict_get_readonly(TypedDequeDictObject *self, void *Py_UNUSED(closure))
+{
+    return PyBool_FromLong(self->readonly);
+}
 
-    DequeDictEntry *entry = (DequeDictEntry *)PyLong_AsVoidPtr(capsule);
-    if (!entry) return NULL;
+static PyObject *
+SharedDequeDict_get_closed(TypedDequeDictObject *self, void *Py_UNUSED(closure))
+{
+    return PyBool_FromLong(self->hdr == NULL);
+}
 
-    /* Already at the right position? */
-    if ((last && entry == self->tail) || (!last && entry == self->head)) {
-        Py_RETURN_NONE;
-    }
+TYPED_LOCKED_METH_O(SharedDequeDict_close)
+TYPED_LOCKED_METH_O(SharedDequeDict_exit)
 
-    /* Unlink entry */
-    if (entry->prev) {
-        entry->prev->next = entry->next;
-    } else {
-        self->head = entry->next;
-    }
-    if (entry->next) {
-        entry->next->prev = entry->prev;
-    } else {
-        self->tail = entry->prev;
-    }
+static PyMethodDef SharedDequeDict_methods[] = {
+    {"get", (PyCFunction)(void(*)(void))TypedDequeDict_get_locked, METH_FASTCALL,
+     "D.get(k[,d]) -> D[k] if k in D, else d"},
+    {"pop", (PyCFunction)(void(*)(void))TypedDequeDict_pop_locked, METH_FASTCALL,
+     "D.pop(k[,d]) -> remove key and return its value, else d or KeyError"},
+    {"popleft", (PyCFunction)TypedDequeDict_popleft_locked, METH_NOARGS,
+     "Remove and return first value - O(1)"},
+    {"popleftitem", (PyCFunction)TypedDequeDict_popleftitem_locked, METH_NOARGS,
+     "Remove and return first (key, value) - O(1)"},
+    {"peekleft", (PyCFunction)TypedDequeDict_peekleft_locked, METH_NOARGS,
+     "Return first value without removing - O(1)"},
+    {"peek", (PyCFunction)TypedDequeDict_peek_locked, METH_NOARGS,
+     "Return last value without removing - O(1)"},
+    {"move_to_end", (PyCFunction)(void(*)(void))TypedDequeDict_move_to_end_locked,
+     METH_FASTCALL | METH_KEYWORDS, "Move existing key to front (last=False) or back (last=True) - O(1)"},
+    {"keys", (PyCFunction)TypedDequeDict_keys_locked, METH_NOARGS, "D.keys() -> list of keys in order"},
+    {"values", (PyCFunction)TypedDequeDict_values_locked, METH_NOARGS,
+     "D.values() -> list of values in order"},
+    {"items", (PyCFunction)TypedDequeDict_items_locked, METH_NOARGS,
+     "D.items() -> list of (key, value) in order"},
+    {"keys_array", (PyCFunction)TypedDequeDict_keys_array_locked, METH_NOARGS,
+     "D.keys_array() -> read-only memoryview of the keys in order"},
+    {"values_array", (PyCFunction)TypedDequeDict_values_array_locked, METH_NOARGS,
+     "D.values_array() -> read-only memoryview of the values in order"},
+    {"clear", (PyCFunction)TypedDequeDict_clear_method_locked, METH_NOARGS, "D.clear() -- remove all items"},
+    {"update", (PyCFunction)TypedDequeDict_update_locked, METH_O, "D.update(E)"},
+    {"close", (PyCFunction)SharedDequeDict_close_locked, METH_NOARGS,
+     "Release the buffer; the region itself is left as it is"},
+    {"__enter__", (PyCFunction)SharedDequeDict_enter, METH_NOARGS, NULL},
+    {"__exit__", (PyCFunction)SharedDequeDict_exit_locked, METH_VARARGS, NULL},
+    {"nbytes", (PyCFunction)(void(*)(void))SharedDequeDict_nbytes_for, METH_VARARGS | METH_KEYWORDS | METH_STATIC,
+     "nbytes(capacity, key_type, value_type) -> buffer size needed"},
+    {NULL}
+};
 
-    DequeDict_invalidate_cache(self);
+static PyGetSetDef SharedDequeDict_getset[] = {
+    {"capacity", (getter)TypedDequeDict_get_capacity, NULL, "Maximum number of entries", NULL},
+    {"key_type", (getter)TypedDequeDict_get_key_type, NULL, "Key type code", NULL},
+    {"value_type", (getter)TypedDequeDict_get_value_type, NULL, "Value type code", NULL},
+    {"readonly", (getter)SharedDequeDict_get_readonly, NULL, "True if attached to a read-only buffer", NULL},
+    {"closed", (getter)SharedDequeDict_get_closed, NULL, "True once close() has released the buffer", NULL},
+    {NULL}
+};
 
-    if (last) {
-        /* Move to end */
-        entry->prev = self->tail;
-        entry->next = NULL;
-        if (self->tail) {
-            self->tail->next = entry;
-        } else {
-            self->head = entry;
-        }
-        self->tail = entry;
-    } else {
-        /* Move to front */
-        entry->prev = NULL;
-        entry->next = self->head;
-        if (self->head) {
-            self->head->prev = entry;
-        } else {
-            self->tail = entry;
-        }
-        self->head = entry;
-    }
+static PyTypeObject SharedDequeDict_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "dequedict.SharedDequeDict",
+    .tp_basicsize = sizeof(TypedDequeDictObject),
+    .tp_dealloc = (destructor)SharedDequeDict_dealloc,
+    .tp_hash = PyObject_HashNotImplemented,
+    .tp_repr = (reprfunc)TypedDequeDict_repr_locked,
+    .tp_as_sequence = &TypedDequeDict_as_sequence,
+    .tp_as_mapping = &TypedDequeDict_as_mapping,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .tp_doc = "DequeDict of fixed-width keys and values stored in a shared buffer.\n\n"
+              "SharedDequeDict(buffer, key_type, value_type, capacity=n) formats the buffer;\n"
+              "SharedDequeDict(buffer) attaches to a region another process formatted.\n"
+              "Types: 'i8' (int64), 'f8' (float64, values only), 'S<n>' (bytes up to n).",
+    .tp_richcompare = (richcmpfunc)TypedDequeDict_richcompare,
+    .tp_iter = (getiterfunc)TypedDequeDict_iter_locked,
+    .tp_methods = SharedDequeDict_methods,
+    .tp_getset = SharedDequeDict_getset,
+    .tp_new = SharedDequeDict_new,
+};
 
-    Py_RETURN_NONE;
+/* ---- TypedDequeDict: a typed region the object owns and grows ---- */
+
+static void
+TypedDequeDict_dealloc(TypedDequeDictObject *self)
+{
+    PyMem_Free(self->owned);
+    Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
-/* Iterator */
-typedef struct {
-    PyObject_HEAD
-    DequeDictObject *dequedict;
-    DequeDictEntry *current;
-} DequeDictIterObject;
+/* TypedDequeDict(items=None, *, key_type="i8", value_type="i8", maxsize=None) */
+static PyObject *
+TypedDequeDict_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"items", "key_type", "value_type", "maxsize", NULL};
+    PyObject *items = NULL, *key_type = NULL, *value_type = NULL, *maxsize_obj = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O$OOO:TypedDequeDict", kwlist,
+                                     &items, &key_type, &value_type, &maxsize_obj))
+        return NULL;
+
+    uint8_t key_kind = TYPED_I8, value_kind = TYPED_I8;
+    uint32_t key_size = 8, value_size = 8;
+    if ((key_type && typed_parse_type(key_type, 0, &key_kind, &key_size) < 0)
+        || (value_type && typed_parse_type(value_type, 1, &value_kind, &value_size) < 0))
+        return NULL;
+
+    int64_t maxsize = -1;
+    if (maxsize_obj != Py_None) {
+        Py_ssize_t n = PyNumber_AsSsize_t(maxsize_obj, PyExc_OverflowError);
+        if (n == -1 && PyErr_Occurred())
+            return NULL;
+        if (n < 0 || n > TYPED_CAPACITY_MAX) {
+            PyErr_Format(PyExc_ValueError, "maxsize must be between 0 and %lld", (long long)TYPED_CAPACITY_MAX);
+            return NULL;
+        }
+        maxsize = n;
+    }
+
+    /* Presize for sized inputs, up to maxsize */
+    int64_t capacity = TYPED_MIN_CAPACITY;
+    Py_ssize_t hint = items && items != Py_None ? PyObject_LengthHint(items, 0) : 0;
+    if (hint < 0)
+        return NULL;
+    while (capacity < hint && capacity < TYPED_CAPACITY_MAX)
+        capacity *= 2;
+    if (maxsize >= 0 && capacity > maxsize)
+        capacity = maxsize;
+
+    uint32_t entry_size = (uint32_t)sizeof(TypedEntry) + typed_payload(key_kind, key_size)
+                          + typed_payload(value_kind, value_size);
+    Py_ssize_t nbytes = typed_nbytes(capacity, entry_size);
+    if (nbytes < 0)
+        return NULL;
+    TypedDequeDictObject *self = (TypedDequeDictObject *)type->tp_alloc(type, 0);
+    if (!self) return NULL;
+    self->maxsize = maxsize;
+    self->owned = PyMem_Malloc(nbytes);
+    if (!self->owned) {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    typed_format(self->owned, capacity, key_kind, key_size, value_kind, value_size);
+    typed_bind(self, self->owned);
 
-static PyTypeObject DequeDictIter_Type;
+    if (items && items != Py_None) {
+        PyObject *r = TypedDequeDict_update(self, items);
+        if (!r) {
+            Py_DECREF(self);
+            return NULL;
+        }
+        Py_DECREF(r);
+    }
+    return (PyObject *)self;
+}
 
-static int
-DequeDictIter_traverse(DequeDictIterObject *it, visitproc visit, void *arg)
+static PyObject *
+TypedDequeDict_get_maxsize(TypedDequeDictObject *self, void *Py_UNUSED(closure))
 {
-    Py_VISIT(it->dequedict);
-    return 0;
+    if (self->maxsize < 0)
+        Py_RETURN_NONE;
+    return PyLong_FromLongLong(self->maxsize);
 }
 
-static int
-DequeDictIter_clear(DequeDictIterObject *it)
+/* Bytes used by the region, for comparison with sys.getsizeof(DequeDict) */
+static PyObject *
+TypedDequeDict_sizeof(TypedDequeDictObject *self, PyObject *Py_UNUSED(args))
 {
-    Py_CLEAR(it->dequedict);
-    return 0;
+    Py_ssize_t n = typed_nbytes(self->hdr->capacity, self->hdr->entry_size);
+    return n < 0 ? NULL : PyLong_FromSsize_t(Py_TYPE(self)->tp_basicsize + n);
 }
 
-static void
-DequeDictIter_dealloc(DequeDictIterObject *it)
+/* copy() / __copy__ - the owned region is position independent, so one
+ * memcpy clones it */
+static PyObject *
+TypedDequeDict_copy(TypedDequeDictObject *self, PyObject *Py_UNUSED(args))
 {
-    PyObject_GC_UnTrack(it);
-    DequeDictIter_clear(it);
-    Py_TYPE(it)->tp_free(it);
+    Py_ssize_t nbytes = typed_nbytes(self->hdr->capacity, self->hdr->entry_size);
+    if (nbytes < 0) return NULL;
+    PyTypeObject *type = Py_TYPE(self);
+    TypedDequeDictObject *copy = (TypedDequeDictObject *)type->tp_alloc(type, 0);
+    if (!copy) return NULL;
+    copy->maxsize = self->maxsize;
+    copy->owned = PyMem_Malloc(nbytes);
+    if (!copy->owned) {
+        Py_DECREF(copy);
+        return PyErr_NoMemory();
+    }
+    memcpy(copy->owned, self->owned, nbytes);
+    typed_bind(copy, copy->owned);
+    return (PyObject *)copy;
 }
 
+/* key_type, value_type and maxsize as constructor keywords */
 static PyObject *
-DequeDictIter_next(DequeDictIterObject *it)
+TypedDequeDict_options(TypedDequeDictObject *self)
 {
-    if (!it->current) return NULL;
-
-    PyObject *key = it->current->key;
-    Py_INCREF(key);
-    it->current = it->current->next;
-    return key;
+    PyObject *k = typed_type_name(self->hdr->key_kind, self->hdr->key_size);
+    PyObject *v = typed_type_name(self->hdr->value_kind, self->hdr->value_size);
+    PyObject *kwds = k && v ? Py_BuildValue("{sOsO}", "key_type", k, "value_type", v) : NULL;
+    Py_XDECREF(k);
+    Py_XDECREF(v);
+    if (kwds && self->maxsize >= 0) {
+        PyObject *maxsize = PyLong_FromLongLong(self->maxsize);
+        if (!maxsize || PyDict_SetItemString(kwds, "maxsize", maxsize) < 0)
+            Py_CLEAR(kwds);
+        Py_XDECREF(maxsize);
+    }
+    return kwds;
 }
 
+TYPED_LOCKED_METH_O(TypedDequeDict_sizeof)
+TYPED_LOCKED_METH_O(TypedDequeDict_copy)
+
+/* __reduce__ - the items plus key_type, value_type and maxsize */
 static PyObject *
-DequeDict_iter(DequeDictObject *self)
+TypedDequeDict_reduce(TypedDequeDictObject *self, PyObject *Py_UNUSED(args))
 {
-    DequeDictIterObject *it = PyObject_GC_New(DequeDictIterObject, &DequeDictIter_Type);
-    if (!it) return NULL;
-
-    Py_INCREF(self);
-    it->dequedict = self;
-    it->current = self->head;
-    PyObject_GC_Track(it);
-    return (PyObject *)it;
+    PyObject *kwds = TypedDequeDict_options(self);
+    PyObject *items = kwds ? TypedDequeDict_items_locked(self, NULL) : NULL;
+    return DequeDict_reduce_keywords((PyObject *)Py_TYPE(self), kwds, items);
 }
 
-/* Reverse iterator */
-typedef struct {
-    PyObject_HEAD
-    DequeDictObject *dequedict;
-    DequeDictEntry *current;
-} DequeDictRevIterObject;
+static PyMethodDef TypedDequeDict_methods[] = {
+    {"get", (PyCFunction)(void(*)(void))TypedDequeDict_get_locked, METH_FASTCALL,
+     "D.get(k[,d]) -> D[k] if k in D, else d"},
+    {"pop", (PyCFunction)(void(*)(void))TypedDequeDict_pop_locked, METH_FASTCALL,
+     "D.pop(k[,d]) -> remove key and return its value, else d or KeyError"},
+    {"popleft", (PyCFunction)TypedDequeDict_popleft_locked, METH_NOARGS,
+     "Remove and return first value - O(1)"},
+    {"popleftitem", (PyCFunction)TypedDequeDict_popleftitem_locked, METH_NOARGS,
+     "Remove and return first (key, value) - O(1)"},
+    {"peekleft", (PyCFunction)TypedDequeDict_peekleft_locked, METH_NOARGS,
+     "Return first value without removing - O(1)"},
+    {"peek", (PyCFunction)TypedDequeDict_peek_locked, METH_NOARGS,
+     "Return last value without removing - O(1)"},
+    {"move_to_end", (PyCFunction)(void(*)(void))TypedDequeDict_move_to_end_locked,
+     METH_FASTCALL | METH_KEYWORDS, "Move existing key to front (last=False) or back (last=True) - O(1)"},
+    {"keys", (PyCFunction)TypedDequeDict_keys_locked, METH_NOARGS, "D.keys() -> list of keys in order"},
+    {"values", (PyCFunction)TypedDequeDict_values_locked, METH_NOARGS,
+     "D.values() -> list of values in order"},
+    {"items", (PyCFunction)TypedDequeDict_items_locked, METH_NOARGS,
+     "D.items() -> list of (key, value) in order"},
+    {"keys_array", (PyCFunction)TypedDequeDict_keys_array_locked, METH_NOARGS,
+     "D.keys_array() -> read-only memoryview of the keys in order"},
+    {"values_array", (PyCFunction)TypedDequeDict_values_array_locked, METH_NOARGS,
+     "D.values_array() -> read-only memoryview of the values in order"},
+    {"clear", (PyCFunction)TypedDequeDict_clear_method_locked, METH_NOARGS, "D.clear() -- remove all items"},
+    {"update", (PyCFunction)TypedDequeDict_update_locked, METH_O, "D.update(E)"},
+    {"copy", (PyCFunction)TypedDequeDict_copy_locked, METH_NOARGS, "D.copy() -> a shallow copy"},
+    {"__copy__", (PyCFunction)TypedDequeDict_copy_locked, METH_NOARGS, "Shallow copy of the same type"},
+    {"__reduce__", (PyCFunction)TypedDequeDict_reduce, METH_NOARGS,
+     "Pickle as the items plus key_type, value_type and maxsize"},
+    {"__sizeof__", (PyCFunction)TypedDequeDict_sizeof_locked, METH_NOARGS, NULL},
+    {"__class_getitem__", Py_GenericAlias, METH_O | METH_CLASS, "See PEP 585"},
+    {NULL}
+};
 
-static PyTypeObject DequeDictRevIter_Type;
+static PyGetSetDef TypedDequeDict_getset[] = {
+    {"key_type", (getter)TypedDequeDict_get_key_type, NULL, "Key type code", NULL},
+    {"value_type", (getter)TypedDequeDict_get_value_type, NULL, "Value type code", NULL},
+    {"maxsize", (getter)TypedDequeDict_get_maxsize, NULL, "Maximum size, or None if unbounded", NULL},
+    {NULL}
+};
 
-static int
-DequeDictRevIter_traverse(DequeDictRevIterObject *it, visitproc visit, void *arg)
+static PyTypeObject TypedDequeDict_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "dequedict.TypedDequeDict",
+    .tp_basicsize = sizeof(TypedDequeDictObject),
+    .tp_dealloc = (destructor)TypedDequeDict_dealloc,
+    .tp_hash = PyObject_HashNotImplemented,
+    .tp_repr = (reprfunc)TypedDequeDict_repr_locked,
+    .tp_as_sequence = &TypedDequeDict_as_sequence,
+    .tp_as_mapping = &TypedDequeDict_as_mapping,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .tp_doc = "DequeDict storing raw int64, float64 or bytes keys and values.\n\n"
+              "TypedDequeDict(items=None, *, key_type='i8', value_type='i8', maxsize=None)\n"
+              "Types: 'i8' (int64), 'f8' (float64, values only), 'S<n>' (bytes up to n).",
+    .tp_richcompare = (richcmpfunc)TypedDequeDict_richcompare,
+    .tp_iter = (getiterfunc)TypedDequeDict_iter_locked,
+    .tp_methods = TypedDequeDict_methods,
+    .tp_getset = TypedDequeDict_getset,
+    .tp_new = TypedDequeDict_new,
+};
+
+/* ========================================================================
+ * C API: the DequeDict_CAPI table of dequedict.h, exported as the capsule
+ * dequedict._dequedict._C_API
+ * ======================================================================== */
+
+DEQUEDICT_LOCKED(int, DequeDict_get_known_hash, self,
+                 (DequeDictObject *self, PyObject *key, Py_hash_t hash, PyObject **out),
+                 (self, key, hash, out))
+DEQUEDICT_LOCKED(int, DequeDict_set_known_hash, self,
+                 (DequeDictObject *self, PyObject *key, Py_hash_t hash, PyObject *value),
+                 (self, key, hash, value))
+DEQUEDICT_LOCKED(int, DequeDict_pop_known_hash, self,
+                 (DequeDictObject *self, PyObject *key, Py_hash_t hash, PyObject **out),
+                 (self, key, hash, out))
+
+static inline int
+DequeDict_CAPI_check(PyObject *dd)
 {
-    Py_VISIT(it->dequedict);
+    if (PyObject_TypeCheck(dd, &DequeDict_Type))
+        return 1;
+    PyErr_BadInternalCall();
     return 0;
 }
 
 static int
-DequeDictRevIter_clear(DequeDictRevIterObject *it)
+DequeDict_CAPI_GetItemRefKnownHash(PyObject *dd, PyObject *key, Py_hash_t hash, PyObject **result)
 {
-    Py_CLEAR(it->dequedict);
-    return 0;
+    if (!DequeDict_CAPI_check(dd)) {
+        *result = NULL;
+        return -1;
+    }
+    return DequeDict_get_known_hash_locked((DequeDictObject *)dd, key, hash, result);
 }
 
-static void
-DequeDictRevIter_dealloc(DequeDictRevIterObject *it)
+static int
+DequeDict_CAPI_SetItemKnownHash(PyObject *dd, PyObject *key, Py_hash_t hash, PyObject *value)
 {
-    PyObject_GC_UnTrack(it);
-    DequeDictRevIter_clear(it);
-    Py_TYPE(it)->tp_free(it);
+    if (!DequeDict_CAPI_check(dd))
+        return -1;
+    return DequeDict_set_known_hash_locked((DequeDictObject *)dd, key, hash, value);
 }
 
-static PyObject *
-DequeDictRevIter_next(DequeDictRevIterObject *it)
+static int
+DequeDict_CAPI_PopKnownHash(PyObject *dd, PyObject *key, Py_hash_t hash, PyObject **result)
 {
-    if (!it->current) return NULL;
+    if (!DequeDict_CAPI_check(dd)) {
+        *result = NULL;
+        return -1;
+    }
+    return DequeDict_pop_known_hash_locked((DequeDictObject *)dd, key, hash, result);
+}
 
-    PyObject *key = it->current->key;
-    Py_INCREF(key);
-    it->current = it->current->prev;
-    return key;
+/* Version 2 cores that have no method of their own */
+
+static int
+DequeDict_next_entry(DequeDictObject *self, Py_ssize_t *pos, PyObject **key, PyObject **value, Py_hash_t *hash)
+{
+    /* *pos is 0 before the head, entry number + 1 after, -1 at the end */
+    Py_ssize_t ix = *pos == 0 ? self->head : *pos - 1;
+    if (*pos < 0 || ix == LINK_NONE || ix >= self->entries_alloc || !ENTRY(self, ix)->key)
+        return 0;
+    DequeDictEntry *entry = ENTRY(self, ix);
+    *pos = entry->next == LINK_NONE ? -1 : entry->next + 1;
+    if (key)
+        *key = entry->key;
+    if (value)
+        *value = entry->value;
+    if (hash)
+        *hash = entry->hash;
+    return 1;
 }
 
-static PyObject *
-DequeDict_reversed(DequeDictObject *self, PyObject *Py_UNUSED(args))
+static int
+DequeDict_set_items(DequeDictObject *self, PyObject *const *keys, PyObject *const *values, Py_ssize_t n)
 {
-    DequeDictRevIterObject *it = PyObject_GC_New(DequeDictRevIterObject, &DequeDictRevIter_Type);
-    if (!it) return NULL;
+    if (DequeDict_presize(self, n) < 0 || DequeDict_tick(self) < 0)
+        return -1;
+    int r = 0;
+    for (Py_ssize_t i = 0; i < n && r == 0; i++)
+        r = DequeDict_set(self, keys[i], values[i]);
+    return DequeDict_finish(self, r);
+}
 
-    Py_INCREF(self);
-    it->dequedict = self;
-    it->current = self->tail;
-    PyObject_GC_Track(it);
-    return (PyObject *)it;
+DEQUEDICT_LOCKED(PyObject *, DequeDict_at_index, self, (DequeDictObject *self, Py_ssize_t index), (self, index))
+DEQUEDICT_LOCKED(int, DequeDict_move_key, self, (DequeDictObject *self, PyObject *key, int last), (self, key, last))
+DEQUEDICT_LOCKED(int, DequeDict_next_entry, self,
+                 (DequeDictObject *self, Py_ssize_t *pos, PyObject **key, PyObject **value, Py_hash_t *hash),
+                 (self, pos, key, value, hash))
+DEQUEDICT_LOCKED(int, DequeDict_set_items, self,
+                 (DequeDictObject *self, PyObject *const *keys, PyObject *const *values, Py_ssize_t n),
+                 (self, keys, values, n))
+DEQUEDICT_LOCKED(PyObject *, DequeDict_pop_count, self,
+                 (DequeDictObject *self, Py_ssize_t n, int from_head, int items), (self, n, from_head, items))
+
+static Py_ssize_t
+DequeDict_CAPI_Size(PyObject *dd)
+{
+    if (!DequeDict_CAPI_check(dd))
+        return -1;
+    return DequeDict_len_locked((DequeDictObject *)dd);
 }
 
-/* __eq__ */
 static PyObject *
-DequeDict_richcompare(DequeDictObject *self, PyObject *other, int op)
+DequeDict_CAPI_GetItem(PyObject *dd, PyObject *key)
 {
-    if (op != Py_EQ && op != Py_NE) {
-        Py_RETURN_NOTIMPLEMENTED;
-    }
+    if (!DequeDict_CAPI_check(dd))
+        return NULL;
+    return DequeDict_getitem_locked((DequeDictObject *)dd, key);
+}
 
-    if (!PyMapping_Check(other)) {
-        if (op == Py_EQ) Py_RETURN_FALSE;
-        Py_RETURN_TRUE;
-    }
+static int
+DequeDict_CAPI_SetItem(PyObject *dd, PyObject *key, PyObject *value)
+{
+    if (!DequeDict_CAPI_check(dd))
+        return -1;
+    return DequeDict_setitem_locked((DequeDictObject *)dd, key, value);
+}
 
-    Py_ssize_t other_len = PyMapping_Size(other);
-    if (other_len == -1) {
-        PyErr_Clear();
-        Py_RETURN_NOTIMPLEMENTED;
-    }
+static PyObject *
+DequeDict_CAPI_PopLeft(PyObject *dd)
+{
+    if (!DequeDict_CAPI_check(dd))
+        return NULL;
+    return DequeDict_popleft_locked((DequeDictObject *)dd, NULL);
+}
 
-    if (self->size != other_len) {
-        if (op == Py_EQ) Py_RETURN_FALSE;
-        Py_RETURN_TRUE;
-    }
+static PyObject *
+DequeDict_CAPI_PeekLeft(PyObject *dd)
+{
+    if (!DequeDict_CAPI_check(dd))
+        return NULL;
+    return DequeDict_peekleft_locked((DequeDictObject *)dd, NULL);
+}
 
-    /* Compare each key-value pair */
-    DequeDictEntry *entry = self->head;
-    while (entry) {
-        PyObject *other_val = PyObject_GetItem(other, entry->key);
-        if (!other_val) {
-            if (PyErr_ExceptionMatches(PyExc_KeyError)) {
-                PyErr_Clear();
-                if (op == Py_EQ) Py_RETURN_FALSE;
-                Py_RETURN_TRUE;
-            }
-            return NULL;
-        }
+static int
+DequeDict_CAPI_MoveToEnd(PyObject *dd, PyObject *key, int last)
+{
+    if (!DequeDict_CAPI_check(dd))
+        return -1;
+    return DequeDict_move_key_locked((DequeDictObject *)dd, key, last);
+}
 
-        int cmp = PyObject_RichCompareBool(entry->value, other_val, Py_EQ);
-        Py_DECREF(other_val);
+static PyObject *
+DequeDict_CAPI_At(PyObject *dd, Py_ssize_t index)
+{
+    if (!DequeDict_CAPI_check(dd))
+        return NULL;
+    return DequeDict_at_index_locked((DequeDictObject *)dd, index);
+}
 
-        if (cmp < 0) return NULL;
-        if (!cmp) {
-            if (op == Py_EQ) Py_RETURN_FALSE;
-            Py_RETURN_TRUE;
-        }
+static int
+DequeDict_CAPI_Next(PyObject *dd, Py_ssize_t *pos, PyObject **key, PyObject **value, Py_hash_t *hash)
+{
+    if (!PyObject_TypeCheck(dd, &DequeDict_Type))
+        return 0;
+    return DequeDict_next_entry_locked((DequeDictObject *)dd, pos, key, value, hash);
+}
 
-        entry = entry->next;
+static int
+DequeDict_CAPI_SetItems(PyObject *dd, PyObject *const *keys, PyObject *const *values, Py_ssize_t n)
+{
+    if (!DequeDict_CAPI_check(dd))
+        return -1;
+    if (n < 0) {
+        PyErr_SetString(PyExc_ValueError, "n must be non-negative");
+        return -1;
     }
+    return DequeDict_set_items_locked((DequeDictObject *)dd, keys, values, n);
+}
 
-    if (op == Py_EQ) Py_RETURN_TRUE;
-    Py_RETURN_FALSE;
+static int
+DequeDict_CAPI_Extend(PyObject *dd, PyObject *pairs)
+{
+    if (!DequeDict_CAPI_check(dd))
+        return -1;
+    PyObject *r = DequeDict_extend_locked((DequeDictObject *)dd, pairs);
+    if (!r)
+        return -1;
+    Py_DECREF(r);
+    return 0;
 }
 
 static PyObject *
-DequeDict_repr(DequeDictObject *self)
+DequeDict_CAPI_PopMany(PyObject *dd, Py_ssize_t n, int from_head, int items)
 {
-    if (self->size == 0) {
-        return PyUnicode_FromString("DequeDict()");
+    if (!DequeDict_CAPI_check(dd))
+        return NULL;
+    if (n < 0) {
+        PyErr_SetString(PyExc_ValueError, "n must be non-negative");
+        return NULL;
     }
-
-    PyObject *items = DequeDict_items(self, NULL);
-    if (!items) return NULL;
-
-    PyObject *repr = PyUnicode_FromFormat("DequeDict(%R)", items);
-    Py_DECREF(items);
-    return repr;
+    return DequeDict_pop_count_locked((DequeDictObject *)dd, n, from_head, items);
 }
 
-static PyMethodDef DequeDict_methods[] = {
-    /* Deque-like operations - O(1) */
-    {"peekleft", (PyCFunction)DequeDict_peekleft, METH_NOARGS,
-     "Return first value without removing - O(1)"},
-    {"peekleftitem", (PyCFunction)DequeDict_peekleftitem, METH_NOARGS,
-     "Return first (key, value) without removing - O(1)"},
-    {"peekleftkey", (PyCFunction)DequeDict_peekleftkey, METH_NOARGS,
-     "Return first key without removing - O(1)"},
-    {"peek", (PyCFunction)DequeDict_peek, METH_NOARGS,
-     "Return last value without removing - O(1)"},
-    {"peekitem", (PyCFunction)DequeDict_peekitem, METH_NOARGS,
-     "Return last (key, value) without removing - O(1)"},
-    {"popleft", (PyCFunction)DequeDict_popleft, METH_NOARGS,
-     "Remove and return first value - O(1)"},
-    {"popleftitem", (PyCFunction)DequeDict_popleftitem, METH_NOARGS,
-     "Remove and return first (key, value) - O(1)"},
-    {"pop", (PyCFunction)DequeDict_pop, METH_VARARGS,
-     "Remove and return value by key or from end - O(1)"},
-    {"popitem", (PyCFunction)DequeDict_popitem, METH_NOARGS,
-     "Remove and return last (key, value) - O(1)"},
-    {"appendleft", (PyCFunction)DequeDict_appendleft, METH_VARARGS,
-     "Insert (key, value) at front - O(1)"},
-    {"move_to_end", (PyCFunction)DequeDict_move_to_end, METH_VARARGS | METH_KEYWORDS,
-     "Move key to front (last=False) or back (last=True) - O(1)"},
-
-    /* Dict-like operations */
-    {"get", (PyCFunction)DequeDict_get, METH_VARARGS, "D.get(k[,d]) -> D[k] if k in D, else d"},
-    {"keys", (PyCFunction)DequeDict_keys, METH_NOARGS, "D.keys() -> list of keys in order"},
-    {"values", (PyCFunction)DequeDict_values, METH_NOARGS, "D.values() -> list of values in order"},
-    {"items", (PyCFunction)DequeDict_items, METH_NOARGS, "D.items() -> list of (key, value) in order"},
-    {"clear", (PyCFunction)DequeDict_clear_method, METH_NOARGS, "D.clear() -- remove all items"},
-    {"copy", (PyCFunction)DequeDict_copy, METH_NOARGS, "D.copy() -> a shallow copy"},
-    {"update", (PyCFunction)DequeDict_update, METH_VARARGS | METH_KEYWORDS, "D.update([E, ]**F)"},
-    {"setdefault", (PyCFunction)DequeDict_setdefault, METH_VARARGS, "D.setdefault(k[,d])"},
-    {"at", (PyCFunction)DequeDict_at, METH_VARARGS,
-     "Return value at index position. O(1) via entry pointer cache."},
-    {"__reversed__", (PyCFunction)DequeDict_reversed, METH_NOARGS, "D.__reversed__() -- return reverse iterator"},
-    {"__class_getitem__", (PyCFunction)DequeDict_class_getitem, METH_O | METH_CLASS,
-     "See PEP 585"},
-    {NULL}
-};
-
-static PySequenceMethods DequeDict_as_sequence = {
-    .sq_contains = (objobjproc)DequeDict_contains,
-};
-
-static PyMappingMethods DequeDict_as_mapping = {
-    .mp_length = (lenfunc)DequeDict_len,
-    .mp_subscript = (binaryfunc)DequeDict_getitem,
-    .mp_ass_subscript = (objobjargproc)DequeDict_setitem,
-};
-
-static PyTypeObject DequeDictIter_Type = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "dequedict.DequeDictIter",
-    .tp_basicsize = sizeof(DequeDictIterObject),
-    .tp_dealloc = (destructor)DequeDictIter_dealloc,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
-    .tp_traverse = (traverseproc)DequeDictIter_traverse,
-    .tp_clear = (inquiry)DequeDictIter_clear,
-    .tp_iter = PyObject_SelfIter,
-    .tp_iternext = (iternextfunc)DequeDictIter_next,
-};
-
-static PyTypeObject DequeDictRevIter_Type = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "dequedict.DequeDictRevIter",
-    .tp_basicsize = sizeof(DequeDictRevIterObject),
-    .tp_dealloc = (destructor)DequeDictRevIter_dealloc,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
-    .tp_traverse = (traverseproc)DequeDictRevIter_traverse,
-    .tp_clear = (inquiry)DequeDictRevIter_clear,
-    .tp_iter = PyObject_SelfIter,
-    .tp_iternext = (iternextfunc)DequeDictRevIter_next,
-};
-
-static PyTypeObject DequeDict_Type = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "dequedict.DequeDict",
-    .tp_basicsize = sizeof(DequeDictObject),
-    .tp_dealloc = (destructor)DequeDict_dealloc,
-    .tp_hash = PyObject_HashNotImplemented,
-    .tp_repr = (reprfunc)DequeDict_repr,
-    .tp_as_sequence = &DequeDict_as_sequence,
-    .tp_as_mapping = &DequeDict_as_mapping,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,
-    .tp_doc = "Ordered dictionary with O(1) deque operations at both ends.\n\n"
-              "Provides dict-like key lookup plus efficient popleft/peekleft operations.\n"
-              "Similar to collections.OrderedDict but with deque-like operations.",
-    .tp_traverse = (traverseproc)DequeDict_traverse,
-    .tp_clear = (inquiry)DequeDict_clear,
-    .tp_richcompare = (richcmpfunc)DequeDict_richcompare,
-    .tp_iter = (getiterfunc)DequeDict_iter,
-    .tp_methods = DequeDict_methods,
-    .tp_init = (initproc)DequeDict_init,
-    .tp_new = PyType_GenericNew,
+static DequeDict_CAPI DequeDict_capi = {
+    .version = DEQUEDICT_CAPI_VERSION,
+    .size = sizeof(DequeDict_CAPI),
+    .DequeDict_Type = &DequeDict_Type,
+    .GetItemRefKnownHash = DequeDict_CAPI_GetItemRefKnownHash,
+    .SetItemKnownHash = DequeDict_CAPI_SetItemKnownHash,
+    .PopKnownHash = DequeDict_CAPI_PopKnownHash,
+    .Size = DequeDict_CAPI_Size,
+    .GetItem = DequeDict_CAPI_GetItem,
+    .SetItem = DequeDict_CAPI_SetItem,
+    .PopLeft = DequeDict_CAPI_PopLeft,
+    .PeekLeft = DequeDict_CAPI_PeekLeft,
+    .MoveToEnd = DequeDict_CAPI_MoveToEnd,
+    .At = DequeDict_CAPI_At,
+    .Next = DequeDict_CAPI_Next,
+    .SetItems = DequeDict_CAPI_SetItems,
+    .Extend = DequeDict_CAPI_Extend,
+    .PopMany = DequeDict_CAPI_PopMany,
 };
 
 static struct PyModuleDef moduledef = {
@@ -1580,10 +9647,62 @@ PyInit__dequedict(void)
     if (PyType_Ready(&DequeDictKeysView_Type) < 0) return NULL;
     if (PyType_Ready(&DequeDictValuesView_Type) < 0) return NULL;
     if (PyType_Ready(&DequeDictItemsView_Type) < 0) return NULL;
+    if (PyType_Ready(&DequeDictArray_Type) < 0) return NULL;
     if (PyType_Ready(&DequeDict_Type) < 0) return NULL;
+    DefaultDequeDict_Type.tp_base = &DequeDict_Type;
+    if (PyType_Ready(&DefaultDequeDict_Type) < 0) return NULL;
+    AsyncDequeDict_Type.tp_base = &DequeDict_Type;
+    if (PyType_Ready(&AsyncDequeDict_Type) < 0) return NULL;
+    if (PyType_Ready(&DequeDictAwaiter_Type) < 0) return NULL;
+    if (PyType_Ready(&PriorityDequeDict_Type) < 0) return NULL;
+    if (PyType_Ready(&ShardedDequeDict_Type) < 0) return NULL;
+    if (PyType_Ready(&TypedDequeDict_Type) < 0) return NULL;
+    if (PyType_Ready(&SharedDequeDict_Type) < 0) return NULL;
+
+    str___missing__ = PyUnicode_InternFromString("__missing__");
+    if (!str___missing__) return NULL;
+    str___dict__ = PyUnicode_InternFromString("__dict__");
+    if (!str___dict__) return NULL;
+    if (!(str_done = PyUnicode_InternFromString("done"))
+        || !(str_result = PyUnicode_InternFromString("result"))
+        || !(str_set_result = PyUnicode_InternFromString("set_result"))
+        || !(str_create_future = PyUnicode_InternFromString("create_future"))
+        || !(str_call_later = PyUnicode_InternFromString("call_later"))
+        || !(str_call_soon_threadsafe = PyUnicode_InternFromString("call_soon_threadsafe"))
+        || !(str_cancel = PyUnicode_InternFromString("cancel"))
+        || !(str__asyncio_future_blocking = PyUnicode_InternFromString("_asyncio_future_blocking")))
+        return NULL;
+    PyObject *time_module = PyImport_ImportModule("time");
+    if (!time_module) return NULL;
+    time_monotonic = PyObject_GetAttrString(time_module, "monotonic");
+    Py_DECREF(time_module);
+    if (!time_monotonic) return NULL;
 
     Py_INCREF(&DequeDict_Type);
     PyModule_AddObject(m, "DequeDict", (PyObject *)&DequeDict_Type);
+    Py_INCREF(&DefaultDequeDict_Type);
+    PyModule_AddObject(m, "DefaultDequeDict", (PyObject *)&DefaultDequeDict_Type);
+    Py_INCREF(&AsyncDequeDict_Type);
+    PyModule_AddObject(m, "AsyncDequeDict", (PyObject *)&AsyncDequeDict_Type);
+    Py_INCREF(&PriorityDequeDict_Type);
+    PyModule_AddObject(m, "PriorityDequeDict", (PyObject *)&PriorityDequeDict_Type);
+    Py_INCREF(&ShardedDequeDict_Type);
+    PyModule_AddObject(m, "ShardedDequeDict", (PyObject *)&ShardedDequeDict_Type);
+    Py_INCREF(&TypedDequeDict_Type);
+    PyModule_AddObject(m, "TypedDequeDict", (PyObject *)&TypedDequeDict_Type);
+    Py_INCREF(&SharedDequeDict_Type);
+    PyModule_AddObject(m, "SharedDequeDict", (PyObject *)&SharedDequeDict_Type);
+
+    PyObject *capi = PyCapsule_New(&DequeDict_capi, DEQUEDICT_CAPSULE_NAME, NULL);
+    if (!capi || PyModule_AddObject(m, "_C_API", capi) < 0) {
+        Py_XDECREF(capi);
+        return NULL;
+    }
+
+#ifdef Py_GIL_DISABLED
+    /* Every entry point locks the instance it works on */
+    PyUnstable_Module_SetGIL(m, Py_MOD_GIL_NOT_USED);
+#endif
 
     return m;
 }
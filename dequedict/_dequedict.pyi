@@ -1,10 +1,15 @@
 """Typing stubs for dequedict."""
 import types
-from typing import TypeVar, Iterator, ItemsView, KeysView, ValuesView, Callable, overload
+from typing import Generic, TypeVar, Iterator, ItemsView, KeysView, ValuesView, Callable, Literal, overload
 from collections.abc import Iterable, Mapping
 
 K = TypeVar("K")
 V = TypeVar("V")
+_D = TypeVar("_D", bound="DequeDict")
+
+def get_include() -> str:
+    """Directory holding dequedict.h, the header of the C API capsule."""
+    ...
 
 class _DequeDictKeysView(KeysView[K]):
     def __reversed__(self) -> Iterator[K]: ...
@@ -25,10 +30,45 @@ class DequeDict(Mapping[K, V]):
     - O(1) appendleft (insert at front)
     - O(1) lookup by key
     - Maintains insertion order
+    - Optional maxsize with eviction callback and LRU touch mode
     """
 
+    touch: bool
+    """If true, lookups and updates move the key to the end."""
+    on_evict: Callable[[list[tuple[K, V]]], object] | None
+    """Called with a list of evicted (key, value) pairs, or None."""
+
     def __class_getitem__(cls, params: object) -> types.GenericAlias: ...
-    def __init__(self, items: Mapping[K, V] | Iterable[tuple[K, V]] | None = None) -> None: ...
+    def __init__(
+        self,
+        items: Mapping[K, V] | Iterable[tuple[K, V]] | None = None,
+        *,
+        maxsize: int | None = None,
+        on_evict: Callable[[list[tuple[K, V]]], object] | None = None,
+        touch: bool = False,
+        gc_tracking: bool = True,
+        ttl: float | None = None,
+        clock: Callable[[], float] | None = None,
+        stats: bool = False,
+        policy: Literal["fifo", "lru", "clock", "slru", "2q", "s3fifo"] | None = None,
+        track_values: bool = False,
+    ) -> None: ...
+    @property
+    def maxsize(self) -> int | None:
+        """Capacity, or None if unbounded."""
+        ...
+    @property
+    def policy(self) -> str:
+        """Eviction policy: 'fifo', 'lru', 'clock', 'slru', '2q' or 's3fifo'."""
+        ...
+    @property
+    def ttl(self) -> float | None:
+        """Entry lifetime in seconds, or None."""
+        ...
+    @property
+    def track_values(self) -> bool:
+        """If true, values are indexed for keys_for(), remove_value() and value membership."""
+        ...
     def __len__(self) -> int: ...
     def __contains__(self, key: object) -> bool: ...
     def __getitem__(self, key: K) -> V: ...
@@ -38,6 +78,9 @@ class DequeDict(Mapping[K, V]):
     def __reversed__(self) -> Iterator[K]: ...
     def __repr__(self) -> str: ...
     def __eq__(self, other: object) -> bool: ...
+    def __or__(self: _D, other: Mapping[K, V]) -> _D: ...
+    def __ror__(self: _D, other: Mapping[K, V]) -> _D: ...
+    def __ior__(self: _D, other: Mapping[K, V] | Iterable[tuple[K, V]]) -> _D: ...
     def __ne__(self, other: object) -> bool: ...
 
     # Deque-like operations - O(1)
@@ -61,14 +104,19 @@ class DequeDict(Mapping[K, V]):
         """Return last (key, value) without removing - O(1)."""
         ...
 
-    def popleft(self) -> V:
-        """Remove and return first value - O(1)."""
+    def popleft(self, timeout: float | None = None) -> V:
+        """Remove and return first value - O(1). With a timeout, wait up to that many seconds if empty."""
         ...
 
-    def popleftitem(self) -> tuple[K, V]:
-        """Remove and return first (key, value) - O(1)."""
+    def popleftitem(self, timeout: float | None = None) -> tuple[K, V]:
+        """Remove and return first (key, value) - O(1). With a timeout, wait up to that many seconds if empty."""
         ...
 
+    @overload
+    def try_popleft(self) -> V | None: ...
+    @overload
+    def try_popleft(self, default: V) -> V: ...
+
     @overload
     def pop(self) -> V: ...
     @overload
@@ -81,7 +129,32 @@ class DequeDict(Mapping[K, V]):
         ...
 
     def appendleft(self, key: K, value: V) -> None:
-        """Insert (key, value) at front - O(1)."""
+        """Insert (key, value) at front, evicting from the end when over capacity - O(1)."""
+        ...
+
+    # Bulk operations - one C loop, presized once
+    def popleft_n(self, n: int) -> list[V]:
+        """Remove and return up to n first values."""
+        ...
+
+    def pop_n(self, n: int) -> list[V]:
+        """Remove and return up to n last values, last first."""
+        ...
+
+    def popleftitems_n(self, n: int) -> list[tuple[K, V]]:
+        """Remove and return up to n first (key, value) pairs."""
+        ...
+
+    def extend(self, pairs: Mapping[K, V] | Iterable[tuple[K, V]]) -> None:
+        """Set each (key, value) pair, appending new keys."""
+        ...
+
+    def extendleft(self, pairs: Mapping[K, V] | Iterable[tuple[K, V]]) -> None:
+        """appendleft() each (key, value) pair, so they end up in reverse order."""
+        ...
+
+    def presize(self, n: int) -> None:
+        """Reserve room for n more items so a bulk load does not rehash."""
         ...
 
     def move_to_end(self, key: K, last: bool = True) -> None:
@@ -93,6 +166,39 @@ class DequeDict(Mapping[K, V]):
     def get(self, key: K) -> V | None: ...
     @overload
     def get(self, key: K, default: V) -> V: ...
+    @overload
+    def get_and_touch(self, key: K) -> V | None: ...
+    @overload
+    def get_and_touch(self, key: K, default: V) -> V: ...
+
+    # Known-hash variants: h must be hash(key), computed once by the caller
+    @overload
+    def get_with_hash(self, key: K, h: int) -> V | None: ...
+    @overload
+    def get_with_hash(self, key: K, h: int, default: V) -> V: ...
+    def set_with_hash(self, key: K, h: int, value: V) -> None:
+        """self[key] = value, reusing h == hash(key)."""
+        ...
+    @overload
+    def pop_with_hash(self, key: K, h: int) -> V: ...
+    @overload
+    def pop_with_hash(self, key: K, h: int, default: V) -> V: ...
+
+    def expire(self, now: float | None = None) -> int:
+        """Remove entries older than ttl at now (default clock()) from the head; return how many."""
+        ...
+
+    def expire_before(self, ts: float) -> int:
+        """Remove entries stamped before ts from the head; return how many."""
+        ...
+
+    def stats(self) -> dict[str, int]:
+        """Hit, miss, eviction, probe, rebuild and freelist counters (needs stats=True)."""
+        ...
+
+    def reset_stats(self) -> None:
+        """Zero the counters."""
+        ...
 
     def keys(self) -> _DequeDictKeysView[K]:
         """D.keys() -> view of keys in order."""
@@ -106,14 +212,30 @@ class DequeDict(Mapping[K, V]):
         """D.items() -> view of (key, value) in order."""
         ...
 
+    def keys_array(self, type_code: str = "i8") -> memoryview:
+        """Keys in order as a read-only int64 ("i8") or float64 ("f8") memoryview - one C pass."""
+        ...
+
+    def values_array(self, type_code: str = "f8") -> memoryview:
+        """Values in order as a read-only int64 ("i8") or float64 ("f8") memoryview - one C pass."""
+        ...
+
     def clear(self) -> None:
         """D.clear() -- remove all items."""
         ...
 
     def copy(self) -> DequeDict[K, V]:
-        """D.copy() -> a shallow copy."""
+        """D.copy() -> a shallow copy, cloned without rehashing - O(n)."""
+        ...
+
+    def __copy__(self: _D) -> _D: ...
+    def __deepcopy__(self: _D, memo: dict[int, object]) -> _D: ...
+    def __reduce__(self) -> tuple[type[DequeDict[K, V]], tuple[object, ...], tuple[object, ...]]:
+        """Pickle as flat key and value lists plus the constructor options."""
         ...
 
+    def __setstate__(self, state: tuple[object, ...]) -> None: ...
+
     def update(self, other: Mapping[K, V] | Iterable[tuple[K, V]] | None = None, **kwargs: V) -> None:
         """D.update([E, ]**F)."""
         ...
@@ -122,11 +244,35 @@ class DequeDict(Mapping[K, V]):
         """Return value at index position. Supports negative indexing. O(1) amortized."""
         ...
 
+    def index_of(self, key: K) -> int:
+        """Return the position of key - O(log n)."""
+        ...
+
+    def insert_at(self, index: int, key: K, value: V) -> None:
+        """Insert (key, value) before position index, clamped like list.insert() - O(log n)."""
+        ...
+
+    def del_at(self, index: int) -> tuple[K, V]:
+        """Remove and return the (key, value) at position index - O(log n)."""
+        ...
+
+    def islice(self, start: int | None = None, stop: int | None = None) -> list[tuple[K, V]]:
+        """Return the (key, value) pairs in positions [start, stop) - O(log n + k)."""
+        ...
+
     @overload
     def setdefault(self, key: K) -> V | None: ...
     @overload
     def setdefault(self, key: K, default: V) -> V: ...
 
+    def keys_for(self, value: object) -> list[K]:
+        """Return the keys whose value equals value - O(1) average with track_values, else O(n)."""
+        ...
+
+    def remove_value(self, value: object) -> int:
+        """Remove every key whose value equals value and return the count."""
+        ...
+
 
 class DefaultDequeDict(DequeDict[K, V]):
     """DequeDict with default_factory for missing keys."""
@@ -137,7 +283,296 @@ class DefaultDequeDict(DequeDict[K, V]):
         self,
         default_factory: Callable[[], V] | None = None,
         items: Mapping[K, V] | Iterable[tuple[K, V]] | None = None,
+        *,
+        maxsize: int | None = None,
+        on_evict: Callable[[list[tuple[K, V]]], object] | None = None,
+        touch: bool = False,
+        gc_tracking: bool = True,
+        ttl: float | None = None,
+        clock: Callable[[], float] | None = None,
+        stats: bool = False,
+        policy: Literal["fifo", "lru", "clock", "slru", "2q", "s3fifo"] | None = None,
+        track_values: bool = False,
     ) -> None: ...
 
     def __missing__(self, key: K) -> V: ...
     def copy(self) -> DefaultDequeDict[K, V]: ...
+
+
+class AsyncDequeDict(DequeDict[K, V]):
+    """DequeDict whose consumers can await pops on an asyncio loop.
+
+    Inserts wake waiting consumers in the order they started waiting, one
+    per new entry and once per call, so extend() wakes a batch together.
+    """
+
+    async def apopleft(self, timeout: float | None = None) -> V:
+        """Remove and return first value, waiting for one; asyncio.TimeoutError after timeout seconds."""
+        ...
+
+    async def apopleftitem(self, timeout: float | None = None) -> tuple[K, V]:
+        """Remove and return first (key, value), waiting for one; asyncio.TimeoutError after timeout seconds."""
+        ...
+
+    async def apopleft_n(self, n: int, timeout: float | None = None) -> list[V]:
+        """Wait for an entry, then remove and return up to n first values; [] after timeout seconds."""
+        ...
+
+
+class PriorityDequeDict(Generic[K, V]):
+    """Mapping kept sorted by a float score per key, lowest first.
+
+    Equal scores keep insertion order. push() and update_score() are
+    O(log n) expected, O(1) for a score at or past the maximum; deletes
+    and both ends are O(1).
+    """
+
+    def __init__(self, items: Iterable[tuple[K, V, float]] | None = None) -> None: ...
+    def __class_getitem__(cls, params: object) -> types.GenericAlias: ...
+
+    def __len__(self) -> int: ...
+    def __contains__(self, key: object) -> bool: ...
+    def __getitem__(self, key: K) -> V: ...
+    def __delitem__(self, key: K) -> None: ...
+    def __iter__(self) -> Iterator[K]: ...
+    def __reversed__(self) -> Iterator[K]: ...
+    def __repr__(self) -> str: ...
+    def __eq__(self, other: object) -> bool: ...
+    def __ne__(self, other: object) -> bool: ...
+
+    def push(self, key: K, value: V, score: float) -> None:
+        """Insert or replace key with this score, after entries of equal score."""
+        ...
+
+    def update_score(self, key: K, score: float) -> None:
+        """Move an existing key to a new score; KeyError if missing."""
+        ...
+
+    def score_of(self, key: K) -> float:
+        """Return the score of key; KeyError if missing."""
+        ...
+
+    def peekleft(self) -> V:
+        """Return the value with the lowest score - O(1)."""
+        ...
+
+    def peekleftitem(self) -> tuple[K, V]: ...
+    def peekleftkey(self) -> K: ...
+    def peek(self) -> V:
+        """Return the value with the highest score - O(1)."""
+        ...
+
+    def peekitem(self) -> tuple[K, V]: ...
+    def popleft(self) -> V:
+        """Remove and return the value with the lowest score - O(1)."""
+        ...
+
+    def popleftitem(self) -> tuple[K, V]: ...
+    @overload
+    def pop(self) -> V: ...
+    @overload
+    def pop(self, key: K) -> V: ...
+    @overload
+    def pop(self, key: K, default: V) -> V: ...
+    def popitem(self) -> tuple[K, V]: ...
+    def popleft_n(self, n: int) -> list[V]: ...
+    def pop_n(self, n: int) -> list[V]: ...
+    def popleftitems_n(self, n: int) -> list[tuple[K, V]]: ...
+
+    @overload
+    def get(self, key: K) -> V | None: ...
+    @overload
+    def get(self, key: K, default: V) -> V: ...
+    def keys(self) -> _DequeDictKeysView[K]: ...
+    def values(self) -> _DequeDictValuesView[V]: ...
+    def items(self) -> _DequeDictItemsView[K, V]: ...
+    def clear(self) -> None: ...
+    def copy(self) -> PriorityDequeDict[K, V]: ...
+    def __copy__(self) -> PriorityDequeDict[K, V]: ...
+    def __sizeof__(self) -> int: ...
+
+
+class ShardedDequeDict(Generic[K, V]):
+    """DequeDict hash-partitioned into independently locked shards."""
+
+    def __init__(
+        self,
+        items: Mapping[K, V] | Iterable[tuple[K, V]] | None = None,
+        *,
+        shards: int = 16,
+        maxsize: int | None = None,
+        on_evict: Callable[[list[tuple[K, V]]], object] | None = None,
+        touch: bool = False,
+    ) -> None: ...
+
+    def __class_getitem__(cls, params: object) -> types.GenericAlias: ...
+    @property
+    def maxsize(self) -> int | None: ...
+    @property
+    def shard_count(self) -> int: ...
+
+    def __len__(self) -> int: ...
+    def __getitem__(self, key: K) -> V: ...
+    def __setitem__(self, key: K, value: V) -> None: ...
+    def __delitem__(self, key: K) -> None: ...
+    def __contains__(self, key: object) -> bool: ...
+    def __iter__(self) -> Iterator[K]: ...
+
+    def shard(self, index: int) -> DequeDict[K, V]:
+        """Return the DequeDict holding one shard."""
+        ...
+
+    def shard_of(self, key: K) -> int:
+        """Return the index of the shard key belongs to."""
+        ...
+
+    def popleft(self, shard: int | None = None) -> V:
+        """Remove and return the first value of a shard, or of the shards in turn."""
+        ...
+
+    def popleftitem(self, shard: int | None = None) -> tuple[K, V]:
+        """Remove and return the first (key, value) of a shard, or of the shards in turn."""
+        ...
+
+    def popitem(self) -> tuple[K, V]:
+        """Remove and return the last (key, value) of the last non-empty shard."""
+        ...
+
+    def move_to_end(self, key: K, last: bool = True) -> None:
+        """Move an existing key to either end of its shard."""
+        ...
+
+    @overload
+    def get(self, key: K) -> V | None: ...
+    @overload
+    def get(self, key: K, default: V) -> V: ...
+    @overload
+    def pop(self, key: K) -> V: ...
+    @overload
+    def pop(self, key: K, default: V) -> V: ...
+    @overload
+    def setdefault(self, key: K) -> V | None: ...
+    @overload
+    def setdefault(self, key: K, default: V) -> V: ...
+
+    def keys(self) -> list[K]: ...
+    def values(self) -> list[V]: ...
+    def items(self) -> list[tuple[K, V]]: ...
+    def clear(self) -> None: ...
+    def update(self, other: Mapping[K, V] | Iterable[tuple[K, V]] | None = None, **kwargs: V) -> None: ...
+    def copy(self) -> ShardedDequeDict[K, V]: ...
+    def __copy__(self) -> ShardedDequeDict[K, V]: ...
+    def __reduce__(self) -> tuple[object, ...]: ...
+    def __eq__(self, other: object) -> bool: ...
+
+class TypedDequeDict(Generic[K, V]):
+    """DequeDict storing raw int64, float64 or bytes keys and values."""
+
+    def __init__(
+        self,
+        items: Mapping[K, V] | Iterable[tuple[K, V]] | None = None,
+        *,
+        key_type: str = "i8",
+        value_type: str = "i8",
+        maxsize: int | None = None,
+    ) -> None: ...
+
+    def __class_getitem__(cls, params: object) -> types.GenericAlias: ...
+    @property
+    def key_type(self) -> str: ...
+    @property
+    def value_type(self) -> str: ...
+    @property
+    def maxsize(self) -> int | None: ...
+
+    def __len__(self) -> int: ...
+    def __getitem__(self, key: K) -> V: ...
+    def __setitem__(self, key: K, value: V) -> None: ...
+    def __delitem__(self, key: K) -> None: ...
+    def __contains__(self, key: object) -> bool: ...
+    def __iter__(self) -> Iterator[K]: ...
+
+    @overload
+    def get(self, key: K) -> V | None: ...
+    @overload
+    def get(self, key: K, default: V) -> V: ...
+    @overload
+    def pop(self, key: K) -> V: ...
+    @overload
+    def pop(self, key: K, default: V) -> V: ...
+    def popleft(self) -> V: ...
+    def popleftitem(self) -> tuple[K, V]: ...
+    def peekleft(self) -> V: ...
+    def peek(self) -> V: ...
+    def move_to_end(self, key: K, last: bool = True) -> None: ...
+    def keys(self) -> list[K]: ...
+    def values(self) -> list[V]: ...
+    def items(self) -> list[tuple[K, V]]: ...
+    def keys_array(self) -> memoryview: ...
+    def values_array(self) -> memoryview: ...
+    def clear(self) -> None: ...
+    def update(self, other: Mapping[K, V] | Iterable[tuple[K, V]]) -> None: ...
+    def copy(self) -> TypedDequeDict[K, V]: ...
+    def __copy__(self) -> TypedDequeDict[K, V]: ...
+    def __reduce__(self) -> tuple[object, ...]: ...
+    def __eq__(self, other: object) -> bool: ...
+
+_Key = int | bytes
+_Value = int | float | bytes
+
+class SharedDequeDict:
+    """DequeDict of fixed-width keys and values stored in a shared buffer (C extension only)."""
+
+    def __init__(
+        self,
+        buffer: object,
+        key_type: str | None = None,
+        value_type: str | None = None,
+        *,
+        capacity: int | None = None,
+    ) -> None: ...
+
+    @staticmethod
+    def nbytes(capacity: int, key_type: str, value_type: str) -> int:
+        """Return the buffer size a region of this capacity and types needs."""
+        ...
+
+    @property
+    def capacity(self) -> int: ...
+    @property
+    def key_type(self) -> str: ...
+    @property
+    def value_type(self) -> str: ...
+    @property
+    def readonly(self) -> bool: ...
+    @property
+    def closed(self) -> bool: ...
+
+    def __len__(self) -> int: ...
+    def __getitem__(self, key: _Key) -> _Value: ...
+    def __setitem__(self, key: _Key, value: _Value) -> None: ...
+    def __delitem__(self, key: _Key) -> None: ...
+    def __contains__(self, key: object) -> bool: ...
+    def __iter__(self) -> Iterator[_Key]: ...
+    def __enter__(self) -> SharedDequeDict: ...
+    def __exit__(self, *args: object) -> bool: ...
+
+    def get(self, key: _Key, default: object = None) -> object: ...
+    def pop(self, key: _Key, default: object = ...) -> object: ...
+    def popleft(self) -> _Value: ...
+    def popleftitem(self) -> tuple[_Key, _Value]: ...
+    def peekleft(self) -> _Value: ...
+    def peek(self) -> _Value: ...
+    def move_to_end(self, key: _Key, last: bool = True) -> None: ...
+    def keys(self) -> list[_Key]: ...
+    def values(self) -> list[_Value]: ...
+    def items(self) -> list[tuple[_Key, _Value]]: ...
+    def keys_array(self) -> memoryview: ...
+    def values_array(self) -> memoryview: ...
+    def clear(self) -> None: ...
+    def update(self, other: Mapping[_Key, _Value] | Iterable[tuple[_Key, _Value]]) -> None: ...
+    def __eq__(self, other: object) -> bool: ...
+
+    def close(self) -> None:
+        """Release the buffer; the region itself is left as it is."""
+        ...
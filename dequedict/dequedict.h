@@ -0,0 +1,103 @@
+/*
+ * dequedict.h - C API of dequedict._dequedict for other extensions
+ *
+ * The module exports a table of function pointers in the capsule
+ * "dequedict._dequedict._C_API". Import it once, at module init:
+ *
+ *     #include "dequedict.h"
+ *
+ *     static DequeDict_CAPI *dd_api;
+ *     ...
+ *     dd_api = DequeDict_ImportCAPI();
+ *     if (!dd_api) return NULL;
+ *
+ *     PyObject *value = dd_api->PopLeft(dd);
+ *
+ * Build with the directory returned by dequedict.get_include() on the
+ * include path; Cython code declares the table in a cdef extern from
+ * "dequedict.h" block. Members are only ever appended: a consumer built
+ * against an older header works with a newer module, and one that needs
+ * newer members checks version (DequeDict_ImportCAPI() fails if the
+ * module's table is older than this header's).
+ *
+ * The functions take the instance lock like the methods do, and accept a
+ * DequeDict or a subclass (DefaultDequeDict, AsyncDequeDict); anything
+ * else raises SystemError (Next() just returns 0, like PyDict_Next()).
+ */
+
+#ifndef DEQUEDICT_H
+#define DEQUEDICT_H
+
+#include <Python.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEQUEDICT_CAPSULE_NAME "dequedict._dequedict._C_API"
+#define DEQUEDICT_CAPI_VERSION 2
+
+typedef struct {
+    /* DEQUEDICT_CAPI_VERSION and sizeof(DequeDict_CAPI) of the module */
+    int version;
+    size_t size;
+
+    PyTypeObject *DequeDict_Type;
+
+    /* Version 1: lookups with a hash the caller already has, which must be
+     * PyObject_Hash(key). GetItemRefKnownHash and PopKnownHash return 1
+     * and store a new reference in *result, return 0 and store NULL if
+     * key is absent, or return -1 with an exception set. A ttl expires
+     * the entry on lookup, like get(). SetItemKnownHash returns 0 or -1. */
+    int (*GetItemRefKnownHash)(PyObject *dd, PyObject *key, Py_hash_t hash, PyObject **result);
+    int (*SetItemKnownHash)(PyObject *dd, PyObject *key, Py_hash_t hash, PyObject *value);
+    int (*PopKnownHash)(PyObject *dd, PyObject *key, Py_hash_t hash, PyObject **result);
+
+    /* Version 2: the hot methods without attribute lookup or argument
+     * parsing. Functions returning PyObject * return a new reference, or
+     * NULL with the exception the method raises (KeyError, IndexError).
+     * SetItem with value NULL deletes key. */
+    Py_ssize_t (*Size)(PyObject *dd);
+    PyObject *(*GetItem)(PyObject *dd, PyObject *key);
+    int (*SetItem)(PyObject *dd, PyObject *key, PyObject *value);
+    PyObject *(*PopLeft)(PyObject *dd);
+    PyObject *(*PeekLeft)(PyObject *dd);
+    int (*MoveToEnd)(PyObject *dd, PyObject *key, int last);
+    PyObject *(*At)(PyObject *dd, Py_ssize_t index);
+
+    /* Walk the entries in order, like PyDict_Next(): start with *pos = 0;
+     * each call returning 1 stores borrowed references to the next key and
+     * value and its cached hash (any of the three may be NULL), and 0 means
+     * the end. The DequeDict must not gain, lose or reorder keys meanwhile.
+     * On free-threaded builds, hold Py_BEGIN_CRITICAL_SECTION(dd) around
+     * the loop so the borrowed references stay valid. */
+    int (*Next)(PyObject *dd, Py_ssize_t *pos, PyObject **key, PyObject **value, Py_hash_t *hash);
+
+    /* Bulk operations. SetItems sets keys[i] = values[i] in order with one
+     * presize, like extend(); Extend takes any extend() argument. PopMany
+     * removes up to n entries from the head (from_head) or the tail and
+     * returns a list of their values, or of (key, value) tuples (items). */
+    int (*SetItems)(PyObject *dd, PyObject *const *keys, PyObject *const *values, Py_ssize_t n);
+    int (*Extend)(PyObject *dd, PyObject *pairs);
+    PyObject *(*PopMany)(PyObject *dd, Py_ssize_t n, int from_head, int items);
+} DequeDict_CAPI;
+
+/* Import the table, or return NULL with an exception set */
+static inline DequeDict_CAPI *
+DequeDict_ImportCAPI(void)
+{
+    DequeDict_CAPI *api = (DequeDict_CAPI *)PyCapsule_Import(DEQUEDICT_CAPSULE_NAME, 0);
+    if (api && api->version < DEQUEDICT_CAPI_VERSION) {
+        PyErr_Format(PyExc_ImportError,
+                     "dequedict C API version %d is older than the required %d",
+                     api->version, DEQUEDICT_CAPI_VERSION);
+        return NULL;
+    }
+    return api;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEQUEDICT_H */
@@ -4,6 +4,7 @@ extensions = [
     Extension(
         "dequedict._dequedict",
         sources=["dequedict/_dequedict.c"],
+        depends=["dequedict/dequedict.h"],
         extra_compile_args=["-O3", "-Wall"],
     ),
 ]
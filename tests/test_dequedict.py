@@ -1,12 +1,30 @@
 """Tests for DequeDict following SETUP → EXPECTED → ACT → ASSERT pattern."""
 from __future__ import annotations
 import pytest
-from dequedict import DequeDict, DefaultDequeDict
+import sys
+from dequedict import AsyncDequeDict, DequeDict, DefaultDequeDict, PriorityDequeDict, ShardedDequeDict, TypedDequeDict
+
+try:
+    from dequedict._dequedict import DequeDict as _CDequeDict, SharedDequeDict
+except ImportError:
+    _CDequeDict = SharedDequeDict = None
+
+requires_c = pytest.mark.skipif(DequeDict is not _CDequeDict, reason="requires the C extension")
 
 
 class TestDequeDictInit:
     """Tests for DequeDict initialization."""
 
+    def test_has_c_extension_flags_the_imported_class(self):
+        # SETUP
+        import dequedict
+
+        # ACT
+        flag = dequedict.HAS_C_EXTENSION
+
+        # ASSERT
+        assert flag is (DequeDict is _CDequeDict)
+
     def test_init_empty_creates_empty_dequedict(self):
         # ACT
         dd = DequeDict()
@@ -49,6 +67,21 @@ class TestDequeDictInit:
         assert dd.peekleftkey() == expected_first_key
         assert dd.peekitem()[0] == expected_last_key
 
+    def test_init_accepts_keywords_and_rejects_bad_arguments(self):
+        # ACT
+        dd = DequeDict(items=[("a", 1)], maxsize=4, touch=1)
+
+        # ASSERT
+        assert list(dd.items()) == [("a", 1)]
+        assert dd.maxsize == 4
+        assert dd.touch is True
+        with pytest.raises(TypeError):
+            DequeDict([], [])
+        with pytest.raises(TypeError):
+            DequeDict(size=1)
+        with pytest.raises(TypeError):
+            DequeDict([], items=[])
+
 
 class TestDequeDictGetSet:
     """Tests for getting and setting items."""
@@ -358,6 +391,138 @@ class TestDequeDictAppendLeft:
             dd.appendleft("a", 99)
 
 
+class TestDequeDictBulk:
+    """Tests for popleft_n, pop_n, popleftitems_n, extend and extendleft."""
+
+    def test_popleft_n(self):
+        # SETUP
+        dd = DequeDict((i, i * 10) for i in range(5))
+
+        # ACT
+        result = dd.popleft_n(3)
+
+        # ASSERT
+        assert result == [0, 10, 20]
+        assert list(dd) == [3, 4]
+
+    def test_pop_n_returns_last_first(self):
+        # SETUP
+        dd = DequeDict((i, i * 10) for i in range(5))
+
+        # ACT
+        result = dd.pop_n(2)
+
+        # ASSERT
+        assert result == [40, 30]
+        assert list(dd) == [0, 1, 2]
+
+    def test_popleftitems_n(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2), ("c", 3)])
+
+        # ACT
+        result = dd.popleftitems_n(2)
+
+        # ASSERT
+        assert result == [("a", 1), ("b", 2)]
+        assert list(dd.items()) == [("c", 3)]
+
+    def test_pop_more_than_size_drains(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2)])
+
+        # ACT
+        result = dd.popleft_n(10)
+
+        # ASSERT
+        assert result == [1, 2]
+        assert len(dd) == 0
+        assert dd.pop_n(3) == []
+        assert dd.popleftitems_n(0) == []
+
+    def test_negative_count_raises(self):
+        # SETUP
+        dd = DequeDict([("a", 1)])
+
+        # ACT & ASSERT
+        with pytest.raises(ValueError):
+            dd.popleft_n(-1)
+        with pytest.raises(ValueError):
+            dd.popleftitems_n(-1)
+        assert list(dd) == ["a"]
+
+    def test_bulk_pop_keeps_at_and_lookup(self):
+        # SETUP
+        dd = DequeDict((i, i) for i in range(3000))
+        assert dd.at(0) == 0
+
+        # ACT
+        dd.popleft_n(1000)
+        dd.pop_n(1000)
+
+        # ASSERT
+        assert len(dd) == 1000
+        assert dd.at(0) == 1000
+        assert dd.at(-1) == 1999
+        assert 1500 in dd and 999 not in dd and 2000 not in dd
+
+    def test_extend(self):
+        # SETUP
+        dd = DequeDict([("a", 1)])
+
+        # ACT
+        dd.extend([("b", 2), ("a", 10)])
+        dd.extend({"c": 3})
+
+        # ASSERT
+        assert list(dd.items()) == [("a", 10), ("b", 2), ("c", 3)]
+
+    def test_extendleft_reverses_like_deque(self):
+        # SETUP
+        dd = DequeDict([("c", 3)])
+
+        # ACT
+        dd.extendleft([("b", 2), ("a", 1)])
+
+        # ASSERT
+        assert list(dd) == ["a", "b", "c"]
+
+    def test_extendleft_existing_key_raises(self):
+        # SETUP
+        dd = DequeDict([("a", 1)])
+
+        # ACT & ASSERT
+        with pytest.raises(KeyError):
+            dd.extendleft([("x", 0), ("a", 2)])
+        assert list(dd.items()) == [("x", 0), ("a", 1)]
+
+    def test_extend_large_batch(self):
+        # SETUP
+        dd = DequeDict()
+        pairs = [(i, -i) for i in range(4096)]
+
+        # ACT
+        dd.extend(pairs)
+
+        # ASSERT
+        assert len(dd) == 4096
+        assert dd[4095] == -4095
+        assert dd.popleftitems_n(4096) == pairs
+
+    def test_extend_with_maxsize_evicts_once(self):
+        # SETUP
+        batches = []
+        dd = DequeDict(maxsize=4, on_evict=batches.append)
+
+        # ACT
+        dd.extend((i, i) for i in range(10))
+
+        # ASSERT
+        assert list(dd) == [6, 7, 8, 9]
+        assert len(batches) == 1
+        assert [k for k, _ in batches[0]] == [0, 1, 2, 3, 4, 5]
+
+
 class TestDequeDictMoveToEnd:
     """Tests for move_to_end operation."""
 
@@ -395,6 +560,23 @@ class TestDequeDictMoveToEnd:
         with pytest.raises(KeyError):
             dd.move_to_end("missing")
 
+    def test_move_to_end_keywords(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2), ("c", 3)])
+
+        # ACT
+        dd.move_to_end(key="a")
+        dd.move_to_end("c", last=0)
+
+        # ASSERT
+        assert list(dd.keys()) == ["c", "b", "a"]
+        with pytest.raises(TypeError):
+            dd.move_to_end()
+        with pytest.raises(TypeError):
+            dd.move_to_end("a", key="a")
+        with pytest.raises(TypeError):
+            dd.move_to_end("a", first=True)
+
 
 class TestDequeDictGet:
     """Tests for get method."""
@@ -546,6 +728,61 @@ class TestDequeDictViews:
         assert next(reversed(dd.items())) == ("c", 3)
 
 
+class TestDequeDictArrays:
+    """Tests for keys_array/values_array: ordered int64/float64 snapshots."""
+
+    def test_arrays_follow_order_and_type_code(self):
+        # SETUP
+        dd = DequeDict([(3, 1), (1, 2.5), (2, True)])
+        dd.move_to_end(3)
+
+        # EXPECTED
+        expected_keys = [1, 2, 3]
+        expected_values = [2.5, 1.0, 1.0]
+
+        # ACT
+        keys = dd.keys_array()
+        values = dd.values_array()
+
+        # ASSERT
+        assert keys.format == "q" and keys.tolist() == expected_keys
+        assert values.format == "d" and values.tolist() == expected_values
+        assert keys.readonly and values.readonly
+        assert dd.keys_array("f8").tolist() == [1.0, 2.0, 3.0]
+        assert DequeDict().values_array().tolist() == []
+
+    def test_arrays_reject_unconvertible_items(self):
+        # SETUP
+        dd = DequeDict([("a", 1.5)])
+
+        # ACT / ASSERT
+        with pytest.raises(TypeError):
+            dd.keys_array()
+        with pytest.raises(TypeError):
+            dd.values_array("i8")
+        with pytest.raises(ValueError):
+            dd.values_array("f4")
+        with pytest.raises(OverflowError):
+            DequeDict({1 << 64: 0}).keys_array()
+
+    @requires_c
+    def test_arrays_detect_mutation_by_index(self):
+        # SETUP
+        dd = DequeDict()
+
+        class Clearing:
+            def __index__(self):
+                dd.clear()
+                return 1
+
+        dd[Clearing()] = 1
+        dd["x"] = 2
+
+        # ACT / ASSERT
+        with pytest.raises(RuntimeError):
+            dd.keys_array()
+
+
 class TestDequeDictIteration:
     """Tests for iteration."""
 
@@ -576,6 +813,69 @@ class TestDequeDictIteration:
         assert result == expected_keys
 
 
+    def test_mutation_during_iteration_raises(self):
+        # SETUP
+        mutations = [
+            lambda dd: dd.popleft(),
+            lambda dd: dd.pop(),
+            lambda dd: dd.__setitem__("z", 0),
+            lambda dd: dd.appendleft("z", 0),
+            lambda dd: dd.move_to_end("a"),
+            lambda dd: dd.__delitem__("b"),
+            lambda dd: dd.clear(),
+        ]
+        iterators = [
+            iter, reversed,
+            lambda dd: iter(dd.values()), lambda dd: iter(dd.items()), lambda dd: reversed(dd.items()),
+        ]
+
+        for mutate in mutations:
+            for make_iter in iterators:
+                dd = DequeDict([("a", 1), ("b", 2), ("c", 3)])
+                it = make_iter(dd)
+                next(it)
+
+                # ACT
+                mutate(dd)
+
+                # ASSERT
+                with pytest.raises(RuntimeError, match="mutated during iteration"):
+                    next(it)
+
+    def test_value_update_during_iteration_is_allowed(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2), ("c", 3)])
+
+        # ACT
+        for k in dd:
+            dd[k] *= 10
+
+        # ASSERT
+        assert list(dd.items()) == [("a", 10), ("b", 20), ("c", 30)]
+
+    def test_touch_lookup_during_iteration_raises(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2), ("c", 3)], touch=True)
+
+        # ACT / ASSERT
+        with pytest.raises(RuntimeError):
+            for k in dd:
+                dd[k]
+
+    def test_recycled_entry_is_not_followed(self):
+        # SETUP: pop the entry the iterator points at and reuse its slot
+        dd = DequeDict([("a", 1), ("b", 2)])
+        it = iter(dd)
+        next(it)
+
+        # ACT
+        dd.pop("b")
+        dd["c"] = 3
+
+        # ASSERT
+        with pytest.raises(RuntimeError):
+            next(it)
+
 class TestDequeDictClearCopy:
     """Tests for clear and copy operations."""
 
@@ -607,6 +907,124 @@ class TestDequeDictClearCopy:
         assert list(copy.items()) == expected_items
         assert "c" not in copy
 
+    def test_copy_after_deletions_keeps_order_and_lookups(self):
+        # SETUP
+        dd = DequeDict((i, str(i)) for i in range(100))
+        for i in range(0, 100, 3):
+            del dd[i]
+        dd.move_to_end(1, last=False)
+        dd.appendleft(-1, "-1")
+
+        # EXPECTED
+        expected_items = list(dd.items())
+
+        # ACT
+        copy = dd.copy()
+        copy[1000] = "1000"
+        del copy[2]
+
+        # ASSERT
+        assert list(copy.items()) == [kv for kv in expected_items if kv[0] != 2] + [(1000, "1000")]
+        assert all(copy[k] == v for k, v in expected_items if k != 2)
+        assert list(dd.items()) == expected_items
+
+    def test_copy_keeps_colliding_keys_findable(self):
+        # SETUP
+        keys = [_CollidingKey(i) for i in range(20)]
+        dd = DequeDict((k, k.name) for k in keys)
+
+        # ACT
+        copy = dd.copy()
+
+        # ASSERT
+        assert [copy[k] for k in keys] == list(range(20))
+        assert copy.index_of(keys[7]) == 7
+
+
+class _PickleSubclass(DequeDict):
+    pass
+
+
+class TestDequeDictPickle:
+    """Tests for pickle, copy.copy and copy.deepcopy."""
+
+    def test_pickle_round_trip_keeps_order_and_options(self):
+        # SETUP
+        import pickle
+        dd = DequeDict(((i, str(i)) for i in range(50)), maxsize=60, touch=True)
+        del dd[10]
+        dd.move_to_end(3, last=False)
+
+        # EXPECTED
+        expected_items = list(dd.items())
+
+        # ACT
+        restored = pickle.loads(pickle.dumps(dd, pickle.HIGHEST_PROTOCOL))
+
+        # ASSERT
+        assert type(restored) is DequeDict
+        assert list(restored.items()) == expected_items
+        assert restored.maxsize == 60 and restored.touch
+        assert restored.index_of(3) == 0
+
+    def test_reduce_emits_flat_key_and_value_lists(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2)])
+
+        # ACT
+        cls, args, state = dd.__reduce__()
+
+        # ASSERT
+        assert cls is DequeDict and args == ()
+        assert state == (["a", "b"], [1, 2], {})
+
+    def test_pickle_default_dequedict_and_subclass(self):
+        # SETUP
+        import pickle
+        ddd = DefaultDequeDict(list, [("a", [1])])
+        sub = _PickleSubclass([("x", 1)])
+        sub.tag = "t"
+
+        # ACT
+        ddd2 = pickle.loads(pickle.dumps(ddd))
+        sub2 = pickle.loads(pickle.dumps(sub))
+
+        # ASSERT
+        assert ddd2.default_factory is list and ddd2["a"] == [1]
+        ddd2["new"].append(2)
+        assert ddd2["new"] == [2]
+        assert type(sub2) is _PickleSubclass and sub2.tag == "t" and sub2["x"] == 1
+
+    def test_copy_module_hooks(self):
+        # SETUP
+        import copy
+        value = [1]
+        dd = _PickleSubclass([("a", value)], maxsize=4)
+        ddd = DefaultDequeDict(list, [("a", value)])
+
+        # ACT
+        shallow = copy.copy(dd)
+        deep = copy.deepcopy(dd)
+        deep_default = copy.deepcopy(ddd)
+
+        # ASSERT
+        assert type(shallow) is _PickleSubclass and shallow["a"] is value
+        assert type(deep) is _PickleSubclass and deep.maxsize == 4
+        assert deep["a"] == value and deep["a"] is not value
+        assert deep_default.default_factory is list and deep_default["a"] is not value
+
+    def test_deepcopy_preserves_self_reference(self):
+        # SETUP
+        import copy
+        dd = DequeDict()
+        dd["self"] = dd
+
+        # ACT
+        clone = copy.deepcopy(dd)
+
+        # ASSERT
+        assert clone["self"] is clone
+
 
 class TestDequeDictUpdate:
     """Tests for update method."""
@@ -652,6 +1070,81 @@ class TestDequeDictUpdate:
         # ASSERT
         assert dd["x"] == expected_x
 
+    def test_init_and_update_from_dequedict(self):
+        # SETUP
+        src = DequeDict([("a", 1), ("b", 2), ("c", 3)])
+        dd = DequeDict([("b", 20), ("z", 26)])
+
+        # EXPECTED
+        expected_init = [("a", 1), ("b", 2), ("c", 3)]
+        expected_update = [("b", 2), ("z", 26), ("a", 1), ("c", 3)]
+
+        # ACT
+        built = DequeDict(src)
+        dd.update(src)
+
+        # ASSERT
+        assert list(built.items()) == expected_init
+        assert list(dd.items()) == expected_update
+
+    def test_update_from_self_is_noop(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2)], touch=True)
+
+        # ACT
+        dd.update(dd)
+
+        # ASSERT
+        assert list(dd.items()) == [("a", 1), ("b", 2)]
+
+    def test_init_from_dequedict_respects_maxsize(self):
+        # SETUP
+        src = DequeDict((i, i) for i in range(10))
+        evicted = []
+
+        # ACT
+        dd = DequeDict(src, maxsize=3, on_evict=evicted.extend)
+
+        # ASSERT
+        assert list(dd.keys()) == [7, 8, 9]
+        assert evicted == [(i, i) for i in range(7)]
+
+    def test_ordered_dict_keeps_its_order(self):
+        # SETUP
+        from collections import OrderedDict
+        od = OrderedDict([("a", 1), ("b", 2), ("c", 3)])
+        od.move_to_end("a")
+        dd = DequeDict()
+
+        # EXPECTED
+        expected_keys = ["b", "c", "a"]
+
+        # ACT
+        built = DequeDict(od)
+        dd.update(od)
+        left = DequeDict()
+        left.extendleft(od)
+
+        # ASSERT
+        assert list(built.keys()) == expected_keys
+        assert list(dd.keys()) == expected_keys
+        assert list(left.keys()) == expected_keys[::-1]
+        assert list(built.items()) == [("b", 2), ("c", 3), ("a", 1)]
+
+    def test_presize(self):
+        # SETUP
+        dd = DequeDict([("a", 1)])
+
+        # ACT
+        dd.presize(10_000)
+        dd.update((i, i) for i in range(10_000))
+
+        # ASSERT
+        assert len(dd) == 10_001
+        assert dd[9_999] == 9_999
+        with pytest.raises(ValueError):
+            dd.presize(-1)
+
 
 class TestDequeDictSetDefault:
     """Tests for setdefault method."""
@@ -740,6 +1233,16 @@ class TestDequeDictRepr:
         assert "DequeDict" in result
         assert "a" in result
 
+    def test_repr_lists_items(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2)])
+
+        # ACT
+        result = repr(dd)
+
+        # ASSERT
+        assert result == "DequeDict([('a', 1), ('b', 2)])"
+
 
 class TestDequeDictClassGetItem:
     """Tests for __class_getitem__ (generic subscript support)."""
@@ -826,40 +1329,259 @@ class TestDequeDictAt:
         assert dd.at(0) == 42
         assert dd.at(-1) == 42
 
+    def test_at_after_middle_delete(self):
+        # SETUP
+        dd = DequeDict((i, i) for i in range(10))
+        assert dd.at(0) == 0
 
-class TestDefaultDequeDict:
-    """Tests for DefaultDequeDict with default_factory."""
+        # ACT
+        del dd[2]
+        dd.pop(7)
 
-    def test_default_factory_list_creates_on_access(self):
-        # SETUP
-        dd = DefaultDequeDict(list)
+        # ASSERT
+        assert [dd.at(i) for i in range(len(dd))] == [0, 1, 3, 4, 5, 6, 8, 9]
 
-        # EXPECTED
-        expected_value = [1, 2]
+    def test_at_after_appendleft(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2)])
+        assert dd.at(0) == 1
 
         # ACT
-        dd["a"].append(1)
-        dd["a"].append(2)
+        for i in range(20):
+            dd.appendleft(f"z{i}", -i)
 
         # ASSERT
-        assert dd["a"] == expected_value
+        assert dd.at(0) == -19
+        assert dd.at(19) == 0
+        assert dd.at(-1) == 2
 
-    def test_default_factory_int_starts_at_zero(self):
+    def test_at_after_move_to_end(self):
         # SETUP
-        dd = DefaultDequeDict(int)
-
-        # EXPECTED
-        expected_value = 5
+        dd = DequeDict((i, i) for i in range(5))
+        assert dd.at(0) == 0
 
         # ACT
-        dd["x"] += 5
+        dd.move_to_end(1)
+        dd.move_to_end(3, last=False)
 
         # ASSERT
-        assert dd["x"] == expected_value
+        assert [dd.at(i) for i in range(5)] == [3, 0, 2, 4, 1]
 
-    def test_no_factory_raises_keyerror(self):
+    def test_at_sliding_window(self):
         # SETUP
-        dd = DefaultDequeDict()
+        from collections import OrderedDict
+
+        dd = DequeDict((i, i) for i in range(50))
+        ref = OrderedDict((i, i) for i in range(50))
+
+        # ACT & ASSERT
+        for step in range(500):
+            key = (step * 17) % 50
+            dd.move_to_end(key, last=step % 3 != 0)
+            ref.move_to_end(key, last=step % 3 != 0)
+            pos = step % 50
+            assert dd.at(pos) == list(ref.values())[pos]
+
+    @requires_c
+    def test_cache_survives_mutation(self):
+        # SETUP
+        dd = DequeDict((i, i) for i in range(1000))
+        dd.at(0)
+        with_cache = sys.getsizeof(dd)
+
+        # ACT
+        del dd[500]
+        dd.move_to_end(10)
+        dd.pop(990)
+
+        # ASSERT
+        assert sys.getsizeof(dd) == with_cache
+
+
+class TestDequeDictPositional:
+    """Tests for index_of(), insert_at(), del_at() and islice()."""
+
+    def test_index_of(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2), ("c", 3)])
+
+        # ACT & ASSERT
+        assert dd.index_of("a") == 0
+        assert dd.index_of("b") == 1
+        assert dd.index_of("c") == 2
+
+    def test_index_of_missing_key_raises(self):
+        # SETUP
+        dd = DequeDict([("a", 1)])
+
+        # ACT & ASSERT
+        with pytest.raises(KeyError):
+            dd.index_of("x")
+
+    def test_index_of_tracks_mutations(self):
+        # SETUP
+        dd = DequeDict((i, i) for i in range(10))
+        assert dd.index_of(5) == 5
+
+        # ACT
+        del dd[2]
+        dd.appendleft("z", 0)
+        dd.move_to_end(0)
+        dd.popleft()
+
+        # ASSERT
+        assert list(dd) == [1, 3, 4, 5, 6, 7, 8, 9, 0]
+        assert [dd.index_of(k) for k in dd] == list(range(9))
+
+    def test_insert_at_middle(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2), ("c", 3)])
+
+        # ACT
+        dd.insert_at(1, "x", 9)
+
+        # ASSERT
+        assert list(dd.items()) == [("a", 1), ("x", 9), ("b", 2), ("c", 3)]
+        assert dd.index_of("x") == 1
+        assert dd.at(1) == 9
+
+    def test_insert_at_clamps_like_list_insert(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2)])
+
+        # ACT
+        dd.insert_at(100, "end", 0)
+        dd.insert_at(-100, "front", 0)
+        dd.insert_at(-1, "penultimate", 0)
+
+        # ASSERT
+        assert list(dd) == ["front", "a", "b", "penultimate", "end"]
+
+    def test_insert_at_existing_key_raises(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2)])
+
+        # ACT & ASSERT
+        with pytest.raises(KeyError):
+            dd.insert_at(1, "a", 5)
+        assert list(dd.items()) == [("a", 1), ("b", 2)]
+
+    def test_insert_at_evicts_head_when_full(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2), ("c", 3)], maxsize=3)
+
+        # ACT
+        dd.insert_at(2, "x", 9)
+
+        # ASSERT
+        assert list(dd) == ["b", "x", "c"]
+
+    def test_del_at(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2), ("c", 3), ("d", 4)])
+
+        # ACT
+        middle = dd.del_at(1)
+        last = dd.del_at(-1)
+
+        # ASSERT
+        assert middle == ("b", 2)
+        assert last == ("d", 4)
+        assert list(dd.items()) == [("a", 1), ("c", 3)]
+
+    def test_del_at_out_of_range_raises(self):
+        # SETUP
+        dd = DequeDict([("a", 1)])
+
+        # ACT & ASSERT
+        with pytest.raises(IndexError, match="index out of range"):
+            dd.del_at(1)
+        with pytest.raises(IndexError, match="index out of range"):
+            dd.del_at(-2)
+
+    def test_islice(self):
+        # SETUP
+        dd = DequeDict((i, i * 10) for i in range(6))
+
+        # ACT & ASSERT
+        assert dd.islice(1, 3) == [(1, 10), (2, 20)]
+        assert dd.islice(4) == [(4, 40), (5, 50)]
+        assert dd.islice(None, 2) == [(0, 0), (1, 10)]
+        assert dd.islice(-2) == [(4, 40), (5, 50)]
+        assert dd.islice(3, 1) == []
+        assert dd.islice() == list(dd.items())
+
+    def test_positional_ops_match_list(self):
+        # SETUP
+        import random
+
+        rng = random.Random(7)
+        dd = DequeDict()
+        ref = []
+
+        # ACT & ASSERT
+        for step in range(2000):
+            if ref and rng.random() < 0.4:
+                i = rng.randrange(len(ref))
+                assert dd.del_at(i) == ref.pop(i)
+            else:
+                i = rng.randrange(len(ref) + 1)
+                dd.insert_at(i, step, -step)
+                ref.insert(i, (step, -step))
+            if ref and step % 50 == 0:
+                k = rng.choice(ref)[0]
+                assert dd.index_of(k) == [p[0] for p in ref].index(k)
+        assert list(dd.items()) == ref
+        assert dd.islice(10, 20) == ref[10:20]
+
+    def test_positional_ops_survive_compaction(self):
+        # SETUP
+        dd = DequeDict((i, i) for i in range(4096))
+        assert dd.index_of(2000) == 2000
+
+        # ACT
+        for i in range(4000):
+            dd.del_at(0 if i % 2 else -1)
+
+        # ASSERT
+        assert len(dd) == 96
+        assert dd.index_of(2050) == 50
+        assert dd.islice(0, 2) == [(2000, 2000), (2001, 2001)]
+
+
+class TestDefaultDequeDict:
+    """Tests for DefaultDequeDict with default_factory."""
+
+    def test_default_factory_list_creates_on_access(self):
+        # SETUP
+        dd = DefaultDequeDict(list)
+
+        # EXPECTED
+        expected_value = [1, 2]
+
+        # ACT
+        dd["a"].append(1)
+        dd["a"].append(2)
+
+        # ASSERT
+        assert dd["a"] == expected_value
+
+    def test_default_factory_int_starts_at_zero(self):
+        # SETUP
+        dd = DefaultDequeDict(int)
+
+        # EXPECTED
+        expected_value = 5
+
+        # ACT
+        dd["x"] += 5
+
+        # ASSERT
+        assert dd["x"] == expected_value
+
+    def test_no_factory_raises_keyerror(self):
+        # SETUP
+        dd = DefaultDequeDict()
 
         # ACT & ASSERT
         with pytest.raises(KeyError):
@@ -894,6 +1616,2266 @@ class TestDefaultDequeDict:
         assert copy["b"] == [2]
         assert copy.default_factory is list
 
+    def test_is_a_dequedict(self):
+        # ACT
+        dd = DefaultDequeDict(list, [("a", [1])])
+
+        # ASSERT
+        assert isinstance(dd, DequeDict)
+        assert dd.peekleftitem() == ("a", [1])
+
+    def test_missing_key_appends_at_end(self):
+        # SETUP
+        dd = DefaultDequeDict(int, [("a", 1)])
+
+        # ACT
+        value = dd["b"]
+
+        # ASSERT
+        assert value == 0
+        assert list(dd.items()) == [("a", 1), ("b", 0)]
+
+    def test_get_and_contains_do_not_create_keys(self):
+        # SETUP
+        dd = DefaultDequeDict(list)
+
+        # ACT
+        result = dd.get("a")
+
+        # ASSERT
+        assert result is None
+        assert "a" not in dd
+        assert len(dd) == 0
+
+    def test_default_factory_can_be_reassigned(self):
+        # SETUP
+        dd = DefaultDequeDict(list)
+
+        # ACT
+        dd.default_factory = set
+        value = dd["x"]
+
+        # ASSERT
+        assert value == set()
+
+    def test_repr_shows_factory_and_items(self):
+        # SETUP
+        dd = DefaultDequeDict(int, [("a", 1)])
+
+        # ACT
+        result = repr(dd)
+
+        # ASSERT
+        assert result == "DefaultDequeDict(<class 'int'>, [('a', 1)])"
+
+    @requires_c
+    def test_non_callable_factory_raises_typeerror(self):
+        # ACT & ASSERT
+        with pytest.raises(TypeError):
+            DefaultDequeDict(42)
+
+    @requires_c
+    def test_dealloc_frees_wait_lock_and_stats(self):
+        # SETUP
+        import gc
+        import tracemalloc
+
+        def churn(n):
+            for _ in range(n):
+                dd = DefaultDequeDict(list, stats=True)
+                with pytest.raises(IndexError):
+                    dd.popleft(timeout=1e-6)
+
+        churn(100)
+        gc.collect()
+
+        # ACT
+        tracemalloc.start()
+        try:
+            before = tracemalloc.get_traced_memory()[0]
+            churn(1000)
+            gc.collect()
+            grown = tracemalloc.get_traced_memory()[0] - before
+        finally:
+            tracemalloc.stop()
+
+        # ASSERT
+        assert grown < 1000 * 8
+
+
+class TestDequeDictMissing:
+    """Tests for __missing__ on DequeDict subclasses."""
+
+    def test_subclass_missing_is_called(self):
+        # SETUP
+        class Fallback(DequeDict):
+            def __missing__(self, key):
+                return key * 2
+
+        dd = Fallback([("a", "x")])
+
+        # ACT & ASSERT
+        assert dd["a"] == "x"
+        assert dd["bb"] == "bbbb"
+        assert "bb" not in dd
+
+
+
+class _CollidingKey:
+    """Key with a constant hash to force index collisions."""
+
+    def __init__(self, name):
+        self.name = name
+
+    def __hash__(self):
+        return 42
+
+    def __eq__(self, other):
+        return isinstance(other, _CollidingKey) and self.name == other.name
+
+
+class TestDequeDictHashIndex:
+    """Tests for key lookup through the hash index."""
+
+    def test_many_keys_survive_growth_and_deletes(self):
+        # SETUP
+        n = 5000
+        dd = DequeDict((i, i * 2) for i in range(n))
+
+        # EXPECTED
+        expected_keys = [i for i in range(n) if i % 3]
+
+        # ACT
+        for i in range(0, n, 3):
+            del dd[i]
+
+        # ASSERT
+        assert list(dd) == expected_keys
+        assert all(dd[i] == i * 2 for i in expected_keys)
+        assert all(i not in dd for i in range(0, n, 3))
+
+    def test_colliding_hashes_resolved_by_equality(self):
+        # SETUP
+        keys = [_CollidingKey(str(i)) for i in range(50)]
+        dd = DequeDict((k, k.name) for k in keys)
+
+        # ACT
+        dd.pop(keys[10])
+        del dd[keys[20]]
+
+        # ASSERT
+        assert len(dd) == 48
+        assert dd[_CollidingKey("30")] == "30"
+        assert _CollidingKey("10") not in dd
+        assert _CollidingKey("20") not in dd
+
+    def test_reinsert_after_delete_reuses_key(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2)])
+
+        # ACT
+        for _ in range(100):
+            del dd["a"]
+            dd["a"] = 3
+
+        # ASSERT
+        assert list(dd.items()) == [("b", 2), ("a", 3)]
+
+    def test_unhashable_key_raises_typeerror(self):
+        # SETUP
+        dd = DequeDict([("a", 1)])
+
+        # ACT & ASSERT
+        with pytest.raises(TypeError):
+            dd[["a"]] = 1
+        with pytest.raises(TypeError):
+            _ = ["a"] in dd
+
+    def test_init_with_duplicate_keys_keeps_first_position(self):
+        # ACT
+        dd = DequeDict([("a", 1), ("b", 2), ("a", 3)])
+
+        # ASSERT
+        assert list(dd.items()) == [("a", 3), ("b", 2)]
+
+
+
+class TestDequeDictEntryStorage:
+    """Tests for entry allocation, reuse and release."""
+
+    def test_drain_and_refill_preserves_order(self):
+        # SETUP
+        n = 10_000
+        dd = DequeDict((i, i) for i in range(n))
+
+        # ACT
+        drained = [dd.popleft() for _ in range(n - 10)]
+        for i in range(n, n + 100):
+            dd[i] = i
+
+        # ASSERT
+        assert drained == list(range(n - 10))
+        assert list(dd) == list(range(n - 10, n + 100))
+        assert dd[n - 5] == n - 5
+        assert dd.at(10) == n
+
+    def test_churn_keeps_contents_consistent(self):
+        # SETUP
+        dd = DequeDict()
+
+        # ACT
+        for i in range(20_000):
+            dd[i] = i
+            if i % 4 != 3:
+                dd.popleft()
+
+        # ASSERT
+        assert len(dd) == 5000
+        assert list(dd.values()) == list(range(15_000, 20_000))
+        assert all(k in dd for k in range(15_000, 20_000))
+
+    @requires_c
+    def test_sizeof_shrinks_after_drain(self):
+        # SETUP
+        dd = DequeDict((i, i) for i in range(100_000))
+        full_size = sys.getsizeof(dd)
+
+        # ACT
+        for _ in range(99_990):
+            dd.popleft()
+
+        # ASSERT
+        assert sys.getsizeof(dd) < full_size // 100
+        assert list(dd) == list(range(99_990, 100_000))
+
+    @requires_c
+    def test_per_entry_overhead_is_compact(self):
+        # SETUP
+        n = 100_000
+
+        # ACT
+        dd = DequeDict((i, None) for i in range(n))
+
+        # ASSERT
+        assert sys.getsizeof(dd) / n < 64
+
+    @requires_c
+    def test_new_without_init_is_empty(self):
+        # ACT
+        dd = DequeDict.__new__(DequeDict)
+
+        # ASSERT
+        assert len(dd) == 0
+        assert list(dd) == []
+        dd["a"] = 1
+        assert dd.peekleftitem() == ("a", 1)
+
+    @requires_c
+    def test_clear_releases_storage(self):
+        # SETUP
+        dd = DequeDict((i, i) for i in range(10_000))
+        empty_size = sys.getsizeof(DequeDict())
+
+        # ACT
+        dd.clear()
+
+        # ASSERT
+        assert sys.getsizeof(dd) == empty_size
+
+
+class TestDequeDictGCTracking:
+    """Tests for lazy garbage-collector tracking and gc_tracking=False."""
+
+    @requires_c
+    def test_atomic_contents_stay_untracked(self):
+        # SETUP
+        import gc
+
+        # ACT
+        dd = DequeDict((str(i), i) for i in range(100))
+        dd.appendleft("f", 1.5)
+        dd.insert_at(3, b"b", None)
+        dd["t"] = (1, "x")
+
+        # ASSERT
+        assert not gc.is_tracked(dd)
+        assert not gc.is_tracked(dd.copy())
+
+    @requires_c
+    def test_container_starts_tracking(self):
+        # SETUP
+        import gc
+        stores = [
+            lambda dd: dd.__setitem__("k", []),
+            lambda dd: dd.appendleft("k", {}),
+            lambda dd: dd.insert_at(0, "k", [1]),
+            lambda dd: dd.update([(frozenset([1]), 1)]),
+        ]
+
+        for store in stores:
+            dd = DequeDict([("a", 1)])
+
+            # ACT
+            store(dd)
+
+            # ASSERT
+            assert gc.is_tracked(dd)
+            assert gc.is_tracked(dd.copy())
+            assert gc.is_tracked(DequeDict(dd))
+
+    @requires_c
+    def test_cycle_through_value_is_collected(self):
+        # SETUP
+        import gc
+        import weakref
+        marker = _PickleSubclass()
+        dd = DequeDict([("a", 1)])
+        dd["self"] = [dd, marker]
+        ref = weakref.ref(marker)
+        del marker
+
+        # ACT
+        del dd
+        gc.collect()
+
+        # ASSERT
+        assert ref() is None
+
+    @requires_c
+    def test_gc_tracking_false_never_tracks(self):
+        # SETUP
+        import gc
+
+        # ACT
+        dd = DequeDict([("a", [])], gc_tracking=False, on_evict=print)
+        dd["b"] = {}
+
+        # ASSERT
+        assert not gc.is_tracked(dd)
+        assert not gc.is_tracked(dd.copy())
+
+    @requires_c
+    def test_subclass_and_default_dequedict_are_tracked(self):
+        # SETUP
+        import gc
+
+        # ASSERT
+        assert gc.is_tracked(DefaultDequeDict(list))
+        assert gc.is_tracked(_PickleSubclass())
+        assert not gc.is_tracked(DefaultDequeDict(list, gc_tracking=False))
+
+    def test_gc_tracking_option_survives_copy_and_pickle(self):
+        # SETUP
+        import copy
+        import pickle
+        dd = DequeDict([("a", 1)], gc_tracking=False)
+
+        # ACT
+        clones = [dd.copy(), copy.copy(dd), copy.deepcopy(dd), pickle.loads(pickle.dumps(dd))]
+
+        # ASSERT
+        assert dd.__reduce__()[2][2] == {"gc_tracking": False}
+        for clone in clones:
+            assert clone.__reduce__()[2][2] == {"gc_tracking": False}
+            assert list(clone.items()) == [("a", 1)]
+
+
+class _FakeClock:
+    def __init__(self, t: float = 0.0) -> None:
+        self.t = t
+
+    def __call__(self) -> float:
+        return self.t
+
+
+class TestDequeDictTTL:
+    """Tests for ttl/clock timestamps, expire() and expire_before()."""
+
+    def test_expire_pops_expired_prefix(self):
+        # SETUP
+        clock = _FakeClock()
+        dd = DequeDict(ttl=10, clock=clock)
+        for i in range(5):
+            clock.t = i
+            dd[i] = str(i)
+
+        # ACT
+        clock.t = 12
+        removed = dd.expire()
+
+        # ASSERT
+        assert removed == 3
+        assert list(dd) == [3, 4]
+        assert dd.expire(now=14) == 2
+        assert len(dd) == 0
+
+    def test_expire_before_uses_given_timestamp(self):
+        # SETUP
+        clock = _FakeClock()
+        dd = DequeDict(clock=clock)
+        for i in range(4):
+            clock.t = i
+            dd[i] = i
+
+        # ACT
+        removed = dd.expire_before(2)
+
+        # ASSERT
+        assert removed == 2
+        assert list(dd) == [2, 3]
+        assert dd.ttl is None
+
+    def test_lookups_drop_expired_entries(self):
+        # SETUP
+        clock = _FakeClock()
+        evicted = []
+        dd = DequeDict([("a", 1), ("b", 2)], ttl=5, clock=clock, on_evict=evicted.extend)
+
+        # ACT
+        clock.t = 5
+
+        # ASSERT
+        assert "a" not in dd
+        assert dd.get("b", 0) == 0
+        with pytest.raises(KeyError):
+            dd["b"]
+        assert len(dd) == 0
+        assert evicted == [("a", 1), ("b", 2)]
+
+    def test_write_restamps_and_moves_to_end(self):
+        # SETUP
+        clock = _FakeClock()
+        dd = DequeDict([("a", 1), ("b", 2)], ttl=5, clock=clock)
+
+        # ACT
+        clock.t = 3
+        dd["a"] = 10
+        clock.t = 6
+
+        # ASSERT
+        assert list(dd) == ["b", "a"]
+        assert dd.expire() == 1
+        assert dict(dd.items()) == {"a": 10}
+
+    def test_expire_feeds_on_evict(self):
+        # SETUP
+        clock = _FakeClock()
+        evicted = []
+        dd = DequeDict([("a", 1), ("b", 2)], ttl=1, clock=clock, on_evict=evicted.extend)
+
+        # ACT
+        clock.t = 1
+        dd.expire()
+
+        # ASSERT
+        assert evicted == [("a", 1), ("b", 2)]
+
+    def test_without_ttl_raises(self):
+        # SETUP
+        dd = DequeDict([("a", 1)])
+
+        # ASSERT
+        with pytest.raises(ValueError):
+            dd.expire()
+        with pytest.raises(ValueError):
+            dd.expire_before(0)
+        with pytest.raises(ValueError):
+            DequeDict(ttl=0)
+        with pytest.raises(TypeError):
+            DequeDict(ttl=1, clock=1)
+
+    def test_ttl_survives_copy_and_pickle(self):
+        # SETUP
+        import pickle
+        clock = _FakeClock()
+        dd = DequeDict([("a", 1)], ttl=2, clock=clock)
+
+        # ACT
+        clone = dd.copy()
+        restored = pickle.loads(pickle.dumps(dd))
+        clock.t = 2
+
+        # ASSERT
+        assert clone.ttl == restored.ttl == 2.0
+        assert clone.expire() == 1
+        assert list(restored.items()) == [("a", 1)]
+        assert DefaultDequeDict(list, ttl=3).ttl == 3.0
+
+
+class TestDequeDictStats:
+    """Tests for stats=True counters, stats() and reset_stats()."""
+
+    def test_counts_hits_misses_and_evictions(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2)], maxsize=2, stats=True)
+
+        # ACT
+        dd["a"]
+        "b" in dd
+        dd.get("x")
+        dd["c"] = 3
+
+        # ASSERT
+        stats = dd.stats()
+        assert (stats["hits"], stats["misses"], stats["evictions"]) == (2, 1, 1)
+
+    def test_counts_expirations(self):
+        # SETUP
+        clock = _FakeClock()
+        dd = DequeDict([("a", 1), ("b", 2), ("c", 3)], ttl=1, clock=clock, stats=True)
+        clock.t = 1
+
+        # ACT
+        "a" in dd
+        dd.expire()
+
+        # ASSERT
+        stats = dd.stats()
+        assert (stats["expirations"], stats["misses"]) == (3, 1)
+
+    @requires_c
+    def test_counts_hash_index_and_storage_events(self):
+        # SETUP
+        dd = DequeDict(((i, i) for i in range(100)), stats=True)
+
+        # ACT
+        del dd[50]
+        dd[100] = 100
+        dd.at(10)
+
+        # ASSERT
+        stats = dd.stats()
+        assert stats["probes"] >= 100
+        assert stats["index_resizes"] >= 1
+        assert stats["cache_rebuilds"] == 1
+        assert stats["freelist_hits"] == 1
+        assert stats["freelist_misses"] == 100
+        assert stats["collisions"] >= stats["max_probe"]
+
+    def test_reset_stats_zeroes_counters(self):
+        # SETUP
+        dd = DequeDict([("a", 1)], stats=True)
+        dd["a"]
+
+        # ACT
+        dd.reset_stats()
+
+        # ASSERT
+        assert set(dd.stats().values()) == {0}
+
+    def test_disabled_by_default(self):
+        # SETUP
+        dd = DequeDict([("a", 1)])
+
+        # ASSERT
+        with pytest.raises(ValueError):
+            dd.stats()
+        with pytest.raises(ValueError):
+            dd.reset_stats()
+
+    def test_option_survives_copy_and_pickle(self):
+        # SETUP
+        import pickle
+        dd = DequeDict([("a", 1)], stats=True)
+        dd["a"]
+
+        # ACT
+        clones = [dd.copy(), pickle.loads(pickle.dumps(dd)), DefaultDequeDict(list, stats=True)]
+
+        # ASSERT
+        for clone in clones:
+            assert clone.stats()["hits"] == 0
+
+
+class TestDequeDictPolicy:
+    """Tests for the clock, slru, 2q and s3fifo eviction policies."""
+
+    def _scan_resistance(self, policy):
+        # Hot keys are read between scans of one-hit keys
+        dd = DequeDict(maxsize=10, policy=policy)
+        for k in range(5):
+            dd[k] = k
+        for scan in range(100, 200):
+            for k in range(5):
+                if dd.get(k) is None:
+                    dd[k] = k
+            dd[scan] = scan
+        return sum(k in dd for k in range(5))
+
+    def test_policies_keep_hot_keys_through_scans(self):
+        # SETUP
+        policies = ["clock", "slru", "2q", "s3fifo"]
+
+        # ACT
+        kept = {policy: self._scan_resistance(policy) for policy in policies}
+
+        # ASSERT
+        assert kept == dict.fromkeys(policies, 5)
+
+    def test_clock_hit_does_not_reorder(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2), ("c", 3)], maxsize=3, policy="clock")
+
+        # ACT
+        dd["a"]
+        order_after_hit = list(dd)
+        dd["d"] = 4
+
+        # ASSERT
+        assert order_after_hit == ["a", "b", "c"]
+        assert list(dd) == ["c", "d", "a"]
+
+    def test_slru_promotes_hit_from_probation(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2), ("c", 3)], maxsize=3, policy="slru")
+
+        # ACT
+        dd["a"]
+        dd["d"] = 4
+
+        # ASSERT
+        assert list(dd) == ["c", "d", "a"]
+
+    def test_slru_move_to_end_keeps_protected_capped(self):
+        # SETUP
+        dd = DequeDict([(k, k) for k in range(10)], maxsize=10, policy="slru")
+
+        # ACT
+        for k in range(10):
+            dd.move_to_end(k)
+        dd["hot"] = 1
+
+        # ASSERT
+        assert "hot" in dd
+        assert 0 not in dd
+
+    def test_slru_insert_at_end_admits_to_probation(self):
+        # SETUP
+        dd = DequeDict(maxsize=10, policy="slru")
+
+        # ACT
+        for k in range(10):
+            dd.insert_at(len(dd), k, k)
+        dd["hot"] = 1
+
+        # ASSERT
+        assert "hot" in dd
+        assert list(dd) == list(range(1, 10)) + ["hot"]
+
+    def test_s3fifo_admits_ghost_to_main(self):
+        # SETUP
+        evicted = []
+        dd = DequeDict(maxsize=10, policy="s3fifo", on_evict=evicted.extend)
+        for k in range(11):
+            dd[k] = k
+
+        # ACT
+        dd[0] = 0
+        for k in range(11, 21):
+            dd[k] = k
+
+        # ASSERT
+        assert evicted[0] == (0, 0)
+        assert 0 in dd
+
+    def test_key_never_evicted_is_not_a_ghost(self):
+        # SETUP
+        orders = {}
+
+        # ACT
+        for policy in ["2q", "s3fifo"]:
+            dd = DequeDict(maxsize=2, policy=policy)
+            for k in [10, 20, 30]:
+                dd[k] = 0
+            dd[1] = 1  # hash(1) == 1 must not match an empty ghost slot
+            orders[policy] = list(dd)
+
+        # ASSERT
+        assert orders == {"2q": [30, 1], "s3fifo": [30, 1]}
+
+    def test_invariants_under_mixed_operations(self):
+        # SETUP
+        import random
+        rng = random.Random(3)
+
+        for policy in ["clock", "slru", "2q", "s3fifo"]:
+            evicted = []
+            dd = DequeDict(maxsize=7, policy=policy, on_evict=evicted.extend)
+            model = {}
+
+            # ACT
+            for step in range(2000):
+                k = rng.randrange(20)
+                op = rng.random()
+                if op < 0.5:
+                    dd[k] = step
+                    model[k] = step
+                elif op < 0.8:
+                    assert dd.get(k) == model.get(k)
+                elif op < 0.85 and k in model:
+                    del dd[k]
+                    del model[k]
+                elif op < 0.9 and k not in model:
+                    dd.appendleft(k, step)
+                    model[k] = step
+                elif op < 0.95 and k in model:
+                    dd.move_to_end(k, last=op < 0.925)
+                elif len(dd):
+                    assert dd.at(-1) == model[list(dd)[-1]]
+                for key, value in evicted:
+                    assert model.pop(key) == value
+                evicted.clear()
+
+                # ASSERT
+                assert len(dd) <= 7
+                assert dict(dd.items()) == model
+
+    def test_policy_option_and_validation(self):
+        # SETUP
+        import pickle
+        dd = DequeDict([("a", 1)], maxsize=4, policy="2q")
+
+        # ASSERT
+        assert dd.policy == "2q"
+        assert dd.copy().policy == pickle.loads(pickle.dumps(dd)).policy == "2q"
+        assert DequeDict(policy="lru").touch
+        assert DequeDict().policy == "fifo"
+        assert DefaultDequeDict(list, maxsize=2, policy="clock").policy == "clock"
+        with pytest.raises(ValueError):
+            DequeDict(policy="clock")
+        with pytest.raises(ValueError):
+            DequeDict(maxsize=2, policy="arc")
+        with pytest.raises(ValueError):
+            DequeDict(maxsize=2, policy="slru", touch=True)
+        with pytest.raises(ValueError):
+            DequeDict(maxsize=2, policy="s3fifo", ttl=1)
+
+
+class TestPriorityDequeDict:
+    """Tests for PriorityDequeDict: entries sorted by a score per key."""
+
+    def test_orders_by_score_and_keeps_ties_in_insertion_order(self):
+        # SETUP
+        pq = PriorityDequeDict([("c", 3, 3.0), ("a", 1, 1.0)])
+
+        # ACT
+        pq.push("b1", 2, 2.0)
+        pq.push("b2", 2, 2.0)
+        pq.push("z", 0, float("-inf"))
+        pq.push("end", 9, 9.0)
+
+        # ASSERT
+        assert list(pq) == ["z", "a", "b1", "b2", "c", "end"]
+        assert pq["b2"] == 2 and pq.score_of("end") == 9.0 and len(pq) == 6
+        assert pq.peekleftitem() == ("z", 0) and pq.peekleftkey() == "z"
+        assert pq.peek() == 9 and pq.peekitem() == ("end", 9)
+        assert list(reversed(pq)) == ["end", "c", "b2", "b1", "a", "z"]
+        assert list(pq.values()) == [0, 1, 2, 2, 3, 9]
+
+    def test_update_score_and_push_move_entries(self):
+        # SETUP
+        pq = PriorityDequeDict([(k, k.upper(), 1.0) for k in "abcd"])
+
+        # ACT
+        pq.update_score("a", 1.0)
+        pq.update_score("b", 0.5)
+        pq.update_score("c", 2.0)
+        pq.push("d", "D2", 1.0)
+        pq.push("e", "E", 1.0)
+
+        # ASSERT
+        assert list(pq.items()) == [("b", "B"), ("a", "A"), ("d", "D2"), ("e", "E"), ("c", "C")]
+        assert pq.score_of("b") == 0.5 and pq.score_of("d") == 1.0
+        with pytest.raises(KeyError):
+            pq.update_score("missing", 1.0)
+        with pytest.raises(KeyError):
+            pq.score_of("missing")
+
+    def test_deletes_and_pops_at_both_ends(self):
+        # SETUP
+        pq = PriorityDequeDict([(i, str(i), float(i % 5)) for i in range(10)])
+
+        # ACT
+        del pq[5]
+        popped_key = pq.pop(6)
+        popped_default = pq.pop("missing", None)
+        first = pq.popleft()
+        last = pq.popitem()
+        lows = pq.popleftitems_n(2)
+
+        # ASSERT
+        assert popped_key == "6" and popped_default is None
+        assert first == "0" and last == (9, "9")
+        assert lows == [(1, "1"), (2, "2")]
+        assert list(pq) == [7, 3, 8, 4] and 5 not in pq
+        assert pq.pop() == "4" and pq.pop_n(5) == ["8", "3", "7"]
+        with pytest.raises(KeyError):
+            del pq[5]
+        with pytest.raises(IndexError):
+            pq.popleft()
+
+    def test_rejects_entries_without_a_valid_score(self):
+        # SETUP
+        pq = PriorityDequeDict([("a", 1, 1)])
+
+        # ACT / ASSERT
+        with pytest.raises(TypeError):
+            pq["b"] = 2
+        with pytest.raises(TypeError):
+            pq["a"] = 2
+        with pytest.raises(TypeError):
+            pq.push("b", 2, "high")
+        with pytest.raises(ValueError):
+            pq.push("b", 2, float("nan"))
+        with pytest.raises(ValueError):
+            pq.update_score("a", float("nan"))
+        with pytest.raises(ValueError):
+            PriorityDequeDict([("a", 1)])
+        with pytest.raises(TypeError):
+            hash(pq)
+        assert list(pq.items()) == [("a", 1)] and pq.score_of("a") == 1.0
+
+    def test_copy_pickle_and_repr_keep_scores(self):
+        # SETUP
+        import copy
+        import pickle
+
+        pq = PriorityDequeDict([("b", [2], 2.0), ("a", [1], 1.0), ("c", [3], 2.0)])
+
+        # ACT
+        clones = [pq.copy(), copy.copy(pq), copy.deepcopy(pq), pickle.loads(pickle.dumps(pq))]
+
+        # ASSERT
+        assert repr(pq) == "PriorityDequeDict([('a', [1], 1.0), ('b', [2], 2.0), ('c', [3], 2.0)])"
+        assert repr(PriorityDequeDict()) == "PriorityDequeDict()"
+        for clone in clones:
+            assert type(clone) is PriorityDequeDict and clone == pq
+            assert [clone.score_of(k) for k in clone] == [1.0, 2.0, 2.0]
+            clone.push("d", [0], 0.0)
+            assert list(clone)[0] == "d" and "d" not in pq
+
+    def test_random_operations_match_sorted_reference(self):
+        # SETUP
+        import random
+
+        rng = random.Random(11)
+        pq = PriorityDequeDict()
+        ref = {}
+        seq = 0
+
+        # ACT / ASSERT
+        for step in range(3000):
+            op = rng.random()
+            key = rng.randrange(200)
+            score = float(rng.randrange(50))
+            if op < 0.45:
+                pq.push(key, step, score)
+                ref[key] = (score, seq, step)
+                seq += 1
+            elif op < 0.65 and key in ref:
+                pq.update_score(key, score)
+                if ref[key][0] != score:
+                    ref[key] = (score, seq, ref[key][2])
+                    seq += 1
+            elif op < 0.8 and key in ref:
+                del pq[key]
+                del ref[key]
+            elif op < 0.9 and ref:
+                first = min(ref, key=lambda k: ref[k][:2])
+                assert pq.popleftitem() == (first, ref.pop(first)[2])
+            elif ref:
+                last = max(ref, key=lambda k: ref[k][:2])
+                assert pq.popitem() == (last, ref.pop(last)[2])
+            if step % 100 == 0:
+                expected = sorted(ref, key=lambda k: ref[k][:2])
+                assert list(pq) == expected
+                assert [pq[k] for k in expected] == [ref[k][2] for k in expected]
+        assert list(pq) == sorted(ref, key=lambda k: ref[k][:2])
+
+
+class TestAsyncDequeDict:
+    """Tests for AsyncDequeDict: awaitable pops woken by inserts."""
+
+    def test_waiters_are_served_in_order_by_one_extend(self):
+        # SETUP
+        import asyncio
+
+        dd = AsyncDequeDict([("ready", 0)], maxsize=100)
+
+        async def run():
+            first = await dd.apopleft()
+            waiters = [asyncio.ensure_future(dd.apopleft()) for _ in range(3)]
+            batch = asyncio.ensure_future(dd.apopleft_n(10))
+            pair = asyncio.ensure_future(dd.apopleftitem())
+            await asyncio.sleep(0)
+
+            # ACT
+            dd.extend([("a", 1), ("b", 2), ("c", 3), ("d", 4), ("e", 5)])
+            results = await asyncio.gather(*waiters, batch, pair)
+            return first, results
+
+        first, results = asyncio.run(run())
+
+        # ASSERT
+        assert isinstance(dd, DequeDict) and dd.maxsize == 100
+        assert first == 0
+        assert results == [1, 2, 3, [4], ("e", 5)]
+        assert len(dd) == 0
+
+    def test_timeouts(self):
+        # SETUP
+        import asyncio
+
+        dd = AsyncDequeDict()
+
+        async def run():
+            outcomes = []
+            for timeout in (0, 0.01):
+                with pytest.raises(asyncio.TimeoutError):
+                    await dd.apopleft(timeout=timeout)
+                outcomes.append(await dd.apopleft_n(5, timeout=timeout))
+            with pytest.raises(asyncio.TimeoutError):
+                await dd.apopleftitem(timeout=0.01)
+            late = asyncio.ensure_future(dd.apopleft(timeout=5))
+            await asyncio.sleep(0.01)
+            dd["k"] = "v"
+            outcomes.append(await late)
+            return outcomes
+
+        # ACT
+        outcomes = asyncio.run(run())
+
+        # ASSERT
+        assert outcomes == [[], [], "v"]
+        for bad in (-1, float("nan")):
+            with pytest.raises(ValueError):
+                asyncio.run(dd.apopleft(timeout=bad))
+        with pytest.raises(ValueError):
+            asyncio.run(dd.apopleft_n(-1))
+        assert asyncio.run(dd.apopleft_n(0)) == []
+
+    def test_cancelled_or_robbed_waiter_passes_the_entry_on(self):
+        # SETUP
+        import asyncio
+
+        dd = AsyncDequeDict()
+
+        async def run():
+            first = asyncio.ensure_future(dd.apopleft())
+            second = asyncio.ensure_future(dd.apopleft())
+            await asyncio.sleep(0)
+
+            # ACT: first is woken, then cancelled before it runs
+            dd["a"] = 1
+            first.cancel()
+            got_second = await second
+            with pytest.raises(asyncio.CancelledError):
+                await first
+
+            # ACT: a synchronous pop takes the entry a waiter was woken for
+            third = asyncio.ensure_future(dd.apopleft())
+            fourth = asyncio.ensure_future(dd.apopleft())
+            await asyncio.sleep(0)
+            dd["b"] = 2
+            robbed = dd.popleft()
+            await asyncio.sleep(0)
+            dd["c"] = 3
+            dd["d"] = 4
+            return got_second, robbed, await third, await fourth
+
+        got_second, robbed, third, fourth = asyncio.run(run())
+
+        # ASSERT
+        assert got_second == 1
+        assert robbed == 2 and (third, fourth) == (3, 4)
+
+    def test_wait_for_and_producer_thread(self):
+        # SETUP
+        import asyncio
+        import threading
+
+        dd = AsyncDequeDict()
+
+        async def run():
+            with pytest.raises(asyncio.TimeoutError):
+                await asyncio.wait_for(dd.apopleft(), 0.01)
+            waiter = asyncio.ensure_future(dd.apopleft_n(10, timeout=5))
+            await asyncio.sleep(0)
+
+            # ACT
+            producer = threading.Thread(target=dd.extend, args=([(i, i) for i in range(3)],))
+            producer.start()
+            got = await waiter
+            producer.join()
+            return got
+
+        got = asyncio.run(run())
+
+        # ASSERT
+        assert got == [0, 1, 2]
+        assert len(dd) == 0
+
+
+class TestDequeDictSetOps:
+    """Tests for &, |, - and ^ on keys/items views and | / |= on DequeDict."""
+
+    def test_view_ops_match_dict_views(self):
+        # SETUP
+        import operator
+
+        left = {"a": 1, "b": 2, "c": 3, "d": 4}
+        right = {"c": 3, "d": 40, "e": 5}
+        dd_left, dd_right = DequeDict(left.items()), DequeDict(right.items())
+        ops = (operator.and_, operator.or_, operator.sub, operator.xor)
+
+        for op in ops:
+            for view in ("keys", "items"):
+                # EXPECTED
+                expected = op(getattr(left, view)(), getattr(right, view)())
+                expected_set = op(getattr(left, view)(), set(getattr(right, view)()))
+                expected_rev = op(set(getattr(right, view)()), getattr(left, view)())
+
+                # ACT
+                native = op(getattr(dd_left, view)(), getattr(dd_right, view)())
+                with_set = op(getattr(dd_left, view)(), set(getattr(dd_right, view)()))
+                with_list = op(getattr(dd_left, view)(), list(getattr(dd_right, view)()))
+                reflected = op(set(getattr(dd_right, view)()), getattr(dd_left, view)())
+
+                # ASSERT
+                assert native == expected and isinstance(native, set)
+                assert with_set == with_list == expected_set
+                assert reflected == expected_rev
+
+    @requires_c
+    def test_view_op_detects_mutation(self):
+        # SETUP
+        class Key:
+            def __init__(self, dd):
+                self.dd = dd
+
+            def __hash__(self):
+                return 1
+
+            def __eq__(self, other):
+                self.dd.pop("x", None)
+                return False
+
+        # Probing large runs the __eq__ of its key, which shrinks small
+        small = DequeDict([("x", 2)])
+        small[Key(small)] = 1
+        large = DequeDict([(Key(small), 1), ("y", 2), ("z", 3)])
+
+        # ACT / ASSERT
+        with pytest.raises(RuntimeError):
+            small.keys() & large.keys()
+
+    def test_merge_operators(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2)], maxsize=3)
+
+        # ACT
+        merged = dd | DequeDict([("b", 20), ("c", 3)])
+        evicting = dd | {"c": 3, "d": 4}
+        reflected = {"z": 0, "a": 10} | dd
+        dd |= [("c", 3)]
+
+        # ASSERT
+        assert list(merged.items()) == [("a", 1), ("b", 20), ("c", 3)] and merged.maxsize == 3
+        assert list(evicting.items()) == [("b", 2), ("c", 3), ("d", 4)]
+        assert isinstance(reflected, DequeDict) and list(reflected.items()) == [("z", 0), ("a", 1), ("b", 2)]
+        assert list(dd.items()) == [("a", 1), ("b", 2), ("c", 3)]
+        with pytest.raises(TypeError):
+            dd | [("x", 1)]
+
+    def test_merge_operators_keep_type_without_calling_copy(self):
+        # SETUP
+        class Sub(DequeDict):
+            def copy(self):
+                return {"x": 1}
+
+        sub = Sub([("a", 1)], maxsize=2)
+        dflt = DefaultDequeDict(list, [("a", [1])], maxsize=2, touch=True)
+
+        # ACT
+        merged = sub | {"b": 2, "c": 3}
+        reflected = {"z": 0} | sub
+        dflt_merged = dflt | {"b": [2]}
+        dflt_reflected = {"z": [0], "a": [9]} | dflt
+
+        # ASSERT
+        assert type(merged) is Sub and list(merged.items()) == [("b", 2), ("c", 3)] and merged.maxsize == 2
+        assert type(reflected) is Sub and list(reflected.items()) == [("z", 0), ("a", 1)]
+        assert list(sub.items()) == [("a", 1)]
+        for result in (dflt_merged, dflt_reflected):
+            assert type(result) is DefaultDequeDict and result.default_factory is list
+            assert result.maxsize == 2 and result.touch
+        assert list(dflt_merged.items()) == [("a", [1]), ("b", [2])]
+        assert list(dflt_reflected.items()) == [("z", [0]), ("a", [1])]
+        assert dflt_reflected["new"] == [] and list(dflt.keys()) == ["a"]
+
+
+class TestDequeDictKnownHash:
+    """Tests for get_with_hash/set_with_hash/pop_with_hash and the C API capsule."""
+
+    def test_with_hash_matches_plain_operations(self):
+        # SETUP
+        dd = DequeDict([(("a", 1), 1), (("b", 2), 2)])
+        key = ("c", 3)
+        h = hash(key)
+
+        # ACT
+        dd.set_with_hash(key, h, 3)
+        dd.set_with_hash(("a", 1), hash(("a", 1)), 10)
+        got = dd.get_with_hash(key, h)
+        missing = dd.get_with_hash(("z", 0), hash(("z", 0))), dd.get_with_hash(("z", 0), hash(("z", 0)), "d")
+        popped = dd.pop_with_hash(("b", 2), hash(("b", 2)))
+        default = dd.pop_with_hash(("b", 2), hash(("b", 2)), None)
+
+        # ASSERT
+        assert got == 3 and dd[key] == 3
+        assert missing == (None, "d")
+        assert popped == 2 and default is None
+        assert list(dd.items()) == [(("a", 1), 10), (("c", 3), 3)]
+        with pytest.raises(KeyError):
+            dd.pop_with_hash(("b", 2), hash(("b", 2)))
+
+    @requires_c
+    def test_known_hash_skips_hashing_the_key(self):
+        # SETUP
+        class Key:
+            calls = 0
+
+            def __hash__(self):
+                Key.calls += 1
+                return 7
+
+        key = Key()
+        dd = DequeDict(maxsize=4, touch=True)
+
+        # ACT
+        dd.set_with_hash(key, 7, "v")
+        value = dd.get_with_hash(key, 7)
+        popped = dd.pop_with_hash(key, 7)
+
+        # ASSERT
+        assert Key.calls == 0
+        assert value == popped == "v" and len(dd) == 0
+        with pytest.raises(ValueError):
+            dd.get_with_hash(key, -1)
+        with pytest.raises(TypeError):
+            dd.get_with_hash(key, "7")
+
+    @requires_c
+    def test_c_api_capsule(self):
+        # SETUP
+        import ctypes
+        import os
+        from dequedict import _dequedict, get_include
+
+        get_pointer = ctypes.pythonapi.PyCapsule_GetPointer
+        get_pointer.restype = ctypes.c_void_p
+        get_pointer.argtypes = [ctypes.py_object, ctypes.c_char_p]
+        lookup = ctypes.PYFUNCTYPE(
+            ctypes.c_int, ctypes.py_object, ctypes.py_object, ctypes.c_ssize_t, ctypes.POINTER(ctypes.py_object),
+        )
+
+        class CAPI(ctypes.Structure):
+            _fields_ = [
+                ("version", ctypes.c_int), ("size", ctypes.c_size_t), ("DequeDict_Type", ctypes.c_void_p),
+                ("GetItemRefKnownHash", lookup), ("SetItemKnownHash", ctypes.c_void_p), ("PopKnownHash", lookup),
+            ]
+
+        dd = DequeDict([("k", "v")])
+        result = ctypes.py_object()
+
+        # ACT
+        api = CAPI.from_address(get_pointer(_dequedict._C_API, b"dequedict._dequedict._C_API"))
+        found = api.GetItemRefKnownHash(dd, "k", hash("k"), ctypes.byref(result))
+        value = result.value
+        popped = api.PopKnownHash(dd, "k", hash("k"), ctypes.byref(result))
+
+        # ASSERT
+        assert os.path.exists(os.path.join(get_include(), "dequedict.h"))
+        assert api.version >= 1 and api.size >= ctypes.sizeof(CAPI)
+        assert found == 1 and value == "v"
+        assert popped == 1 and len(dd) == 0
+
+
+class TestDequeDictCAPI:
+    """Tests for the DequeDict_CAPI table, called through ctypes as an extension would."""
+
+    @staticmethod
+    def _api():
+        import ctypes
+        from dequedict import _dequedict
+
+        obj, ssize, hash_t = ctypes.py_object, ctypes.c_ssize_t, ctypes.c_ssize_t
+        pobj = ctypes.POINTER(ctypes.py_object)
+        f = ctypes.PYFUNCTYPE
+        fields = [
+            ("version", ctypes.c_int), ("size", ctypes.c_size_t), ("DequeDict_Type", ctypes.c_void_p),
+            ("GetItemRefKnownHash", f(ctypes.c_int, obj, obj, hash_t, pobj)),
+            ("SetItemKnownHash", f(ctypes.c_int, obj, obj, hash_t, obj)),
+            ("PopKnownHash", f(ctypes.c_int, obj, obj, hash_t, pobj)),
+            ("Size", f(ssize, obj)),
+            ("GetItem", f(obj, obj, obj)),
+            ("SetItem", f(ctypes.c_int, obj, obj, obj)),
+            ("PopLeft", f(obj, obj)),
+            ("PeekLeft", f(obj, obj)),
+            ("MoveToEnd", f(ctypes.c_int, obj, obj, ctypes.c_int)),
+            ("At", f(obj, obj, ssize)),
+            ("Next", f(ctypes.c_int, obj, ctypes.POINTER(ssize), ctypes.POINTER(ctypes.c_void_p),
+                       ctypes.POINTER(ctypes.c_void_p), ctypes.POINTER(hash_t))),
+            ("SetItems", f(ctypes.c_int, obj, ctypes.POINTER(obj), ctypes.POINTER(obj), ssize)),
+            ("Extend", f(ctypes.c_int, obj, obj)),
+            ("PopMany", f(obj, obj, ssize, ctypes.c_int, ctypes.c_int)),
+        ]
+        table = type("DequeDictCAPI", (ctypes.Structure,), {"_fields_": fields})
+        get_pointer = ctypes.pythonapi.PyCapsule_GetPointer
+        get_pointer.restype = ctypes.c_void_p
+        get_pointer.argtypes = [ctypes.py_object, ctypes.c_char_p]
+        return table.from_address(get_pointer(_dequedict._C_API, b"dequedict._dequedict._C_API"))
+
+    @requires_c
+    def test_hot_methods(self):
+        # SETUP
+        import ctypes
+
+        api = self._api()
+        dd = DequeDict([("a", 1), ("b", 2), ("c", 3)])
+
+        # ACT
+        api.SetItem(dd, "d", 4)
+        api.MoveToEnd(dd, "a", 1)
+        peeked = api.PeekLeft(dd)
+        popped = api.PopLeft(dd)
+        got, at = api.GetItem(dd, "a"), api.At(dd, -1)
+
+        # ASSERT
+        assert api.version >= 2 and api.size >= ctypes.sizeof(api)
+        assert peeked == popped == 2
+        assert got == at == 1
+        assert api.Size(dd) == 3 and list(dd) == ["c", "d", "a"]
+        with pytest.raises(KeyError):
+            api.GetItem(dd, "b")
+        with pytest.raises(IndexError):
+            api.At(dd, 3)
+        with pytest.raises(SystemError):
+            api.PopLeft({})
+
+    @requires_c
+    def test_next_and_bulk_ops(self):
+        # SETUP
+        import ctypes
+
+        api = self._api()
+        dd = DequeDict(maxsize=5)
+        keys = (ctypes.py_object * 3)("a", "b", "c")
+        values = (ctypes.py_object * 3)(1, 2, 3)
+
+        # ACT
+        api.SetItems(dd, keys, values, 3)
+        api.Extend(dd, [("d", 4), ("e", 5), ("f", 6)])
+        pos, key, h = ctypes.c_ssize_t(0), ctypes.c_void_p(), ctypes.c_ssize_t()
+        walked = []
+        while api.Next(dd, ctypes.byref(pos), ctypes.byref(key), None, ctypes.byref(h)):
+            walked.append((ctypes.cast(key, ctypes.py_object).value, h.value))
+        head = api.PopMany(dd, 2, 1, 1)
+        tail = api.PopMany(dd, 10, 0, 0)
+
+        # ASSERT
+        assert walked == [(k, hash(k)) for k in "bcdef"]
+        assert head == [("b", 2), ("c", 3)]
+        assert tail == [6, 5, 4] and len(dd) == 0
+
+
+class TestDequeDictTrackValues:
+    """Tests for the track_values index behind keys_for, remove_value and values() membership."""
+
+    def test_index_follows_mutations(self):
+        # SETUP
+        import random
+
+        rng = random.Random(7)
+        tracked = DequeDict(maxsize=60, track_values=True)
+        plain = DequeDict(maxsize=60)
+
+        for step in range(3000):
+            key, value = rng.randrange(100), rng.randrange(8)
+            for dd in (tracked, plain):
+                # ACT
+                if step % 5 == 0:
+                    dd.pop(key, -1)
+                elif step % 11 == 0 and dd:
+                    dd.popleft()
+                elif step % 13 == 0 and key not in dd:
+                    dd.appendleft(key, value)
+                elif step % 17 == 0 and key not in dd:
+                    dd.insert_at(len(dd) // 2, key, value)
+                else:
+                    dd[key] = value
+            if step == 2000:
+                for key in list(tracked)[:50]:
+                    del tracked[key], plain[key]
+
+            if step % 100 == 0:
+                for value in range(8):
+                    # EXPECTED
+                    expected = sorted(k for k, v in plain.items() if v == value)
+
+                    # ASSERT
+                    assert sorted(tracked.keys_for(value)) == expected
+                    assert plain.keys_for(value) == [k for k, v in plain.items() if v == value]
+                    assert (value in tracked.values()) == bool(expected)
+
+    def test_remove_value_and_options(self):
+        # SETUP
+        import pickle
+
+        dd = DequeDict([("a", 1), ("b", 2), ("c", 1.0), ("d", True)], track_values=True)
+
+        # ACT
+        clone = dd.copy()
+        restored = pickle.loads(pickle.dumps(dd))
+        removed = dd.remove_value(1)
+        missing = dd.remove_value(9)
+
+        # ASSERT
+        assert removed == 3 and missing == 0
+        assert list(dd.items()) == [("b", 2)]
+        assert 1 not in dd.values() and 2 in dd.values()
+        assert clone.track_values and restored.track_values
+        assert sorted(clone.keys_for(1)) == sorted(restored.keys_for(1)) == ["a", "c", "d"]
+        assert DefaultDequeDict(list, track_values=True).track_values
+        assert not DequeDict().track_values
+        assert DequeDict([("a", [])]).remove_value([]) == 1
+
+    def test_unhashable_values(self):
+        # SETUP
+        dd = DequeDict([("a", 1)], track_values=True)
+
+        # ACT / ASSERT
+        with pytest.raises(TypeError):
+            dd["b"] = []
+        with pytest.raises(TypeError):
+            dd["a"] = {}
+        assert list(dd.items()) == [("a", 1)]
+        assert [] not in dd.values() and dd.keys_for([]) == []
+
+    def test_repeated_updates_keep_lookups_terminating(self):
+        # SETUP
+        dd = DequeDict(track_values=True)
+        dd["a"] = 0
+
+        # ACT
+        for i in range(1000):
+            dd["a"] = i
+        dd.update({"a": "x"}, b="x")
+        for i in range(1000):
+            dd["b"] = i
+
+        # ASSERT
+        assert -5 not in dd.values()
+        assert dd.keys_for(-5) == [] and dd.remove_value(-5) == 0
+        assert dd.keys_for("x") == ["a"] and dd.keys_for(999) == ["b"]
+
+    def test_keys_for_reports_each_key_once(self):
+        # SETUP
+        dd = DequeDict(track_values=True)
+        dd["a"] = 0
+
+        # ACT
+        dd["a"] = 101  # Its probe chain comes back to the slot it lands in
+
+        # ASSERT
+        assert dd.keys_for(101) == ["a"]
+        assert dd.remove_value(101) == 1
+
+
+class TestDequeDictSlotReuse:
+    """Tests for reusing the storage of removed entries, which both implementations do."""
+
+    def test_drain_and_refill_keeps_order(self):
+        # SETUP
+        dd = DequeDict((i, i) for i in range(1000))
+        dd.at(0)
+
+        # ACT
+        for i in range(0, 1000, 2):
+            del dd[i]
+        for i in range(1000, 1300):
+            dd[i] = i
+        half = [dd.popleft() for _ in range(400)]
+        while dd:
+            dd.pop()
+        dd.update((i, -i) for i in range(5))
+
+        # EXPECTED
+        expected = list(range(1, 800, 2))
+
+        # ASSERT
+        assert half == expected
+        assert list(dd.items()) == [(i, -i) for i in range(5)]
+        assert [dd.at(i) for i in range(5)] == [0, -1, -2, -3, -4]
+        assert dd.index_of(4) == 4
+
+    def test_key_eq_mutating_during_insert(self):
+        # SETUP
+        dd = DequeDict((i, i) for i in range(3))
+
+        class Key:
+            armed = True
+
+            def __hash__(self):
+                return hash(0)
+
+            def __eq__(self, other):
+                if Key.armed:
+                    Key.armed = False
+                    dd[100] = "other"
+                return self is other
+
+        key = Key()
+
+        # ACT
+        dd[key] = "key"
+
+        # ASSERT
+        assert list(dd.items()) == [(0, 0), (1, 1), (2, 2), (100, "other"), (key, "key")]
+        assert dd[100] == "other" and dd[key] == "key"
+
+
+class TestDequeDictThreads:
+    """Tests for one DequeDict shared by several threads."""
+
+    @requires_c
+    def test_concurrent_mutation_keeps_invariants(self):
+        # SETUP
+        import threading
+        dd = DequeDict(maxsize=64, touch=True)
+        errors = []
+
+        def worker(seed):
+            for i in range(2000):
+                k = (seed * 7 + i) % 100
+                try:
+                    dd[k] = i
+                    dd.get((k * 3) % 100)
+                    if i % 5 == 0:
+                        dd.pop(k, None)
+                    if i % 11 == 0:
+                        dd.at(-1)
+                        dd.move_to_end(dd.peekleftkey(), last=True)
+                except (KeyError, IndexError):
+                    pass  # Raced with another thread emptying it
+                except Exception as e:  # pragma: no cover - reported below
+                    errors.append(e)
+
+        threads = [threading.Thread(target=worker, args=(n,)) for n in range(8)]
+
+        # ACT
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+
+        # ASSERT
+        assert errors == []
+        keys = list(dd)
+        assert len(keys) == len(dd) <= 64
+        assert len(set(keys)) == len(keys)
+        assert [dd.at(i) for i in range(len(dd))] == [dd.get(k) for k in keys]
+
+    def test_try_popleft(self):
+        # SETUP
+        dd = DequeDict([("a", 1)])
+
+        # ACT / ASSERT
+        assert dd.try_popleft() == 1
+        assert dd.try_popleft() is None
+        assert dd.try_popleft("empty") == "empty"
+
+    def test_popleft_timeout_expires_on_empty(self):
+        # SETUP
+        import time
+        dd = DequeDict()
+
+        # ACT
+        start = time.monotonic()
+        with pytest.raises(IndexError):
+            dd.popleft(timeout=0.05)
+        with pytest.raises(KeyError):
+            dd.popleftitem(timeout=0)
+        elapsed = time.monotonic() - start
+
+        # ASSERT
+        assert elapsed >= 0.04
+        with pytest.raises(ValueError, match="timeout"):
+            dd.popleft(timeout=-1)
+        dd["a"] = 1
+        assert dd.popleft(timeout=None) == 1
+
+    def test_blocking_popleft_drains_producer(self):
+        # SETUP
+        import threading
+        dd = DequeDict()
+        n = 2000
+        received = []
+
+        def produce():
+            for i in range(n):
+                if i not in dd:
+                    dd[i] = i * 2
+
+        def consume():
+            for _ in range(n):
+                received.append(dd.popleftitem(timeout=10))
+
+        consumer = threading.Thread(target=consume)
+        producer = threading.Thread(target=produce)
+
+        # ACT
+        consumer.start()
+        producer.start()
+        producer.join()
+        consumer.join(timeout=30)
+
+        # ASSERT
+        assert not consumer.is_alive()
+        assert received == [(i, i * 2) for i in range(n)]
+        assert len(dd) == 0
+
+class TestShardedDequeDict:
+    """Tests for ShardedDequeDict: a DequeDict hash-partitioned into shards."""
+
+    def test_mapping_api(self):
+        # SETUP
+        sd = ShardedDequeDict([("a", 1), ("b", 2)], shards=4)
+
+        # ACT
+        sd["c"] = 3
+        sd.update({"d": 4}, e=5)
+        del sd["a"]
+
+        # ASSERT
+        assert len(sd) == 4
+        assert "a" not in sd and "b" in sd
+        assert sd["c"] == 3
+        assert sd.get("a") is None and sd.get("a", 0) == 0
+        assert sd.setdefault("f", 6) == 6 and sd.setdefault("f", 7) == 6
+        assert sd.pop("f") == 6 and sd.pop("f", None) is None
+        assert sorted(sd) == sorted(sd.keys()) == ["b", "c", "d", "e"]
+        assert sorted(sd.items()) == [("b", 2), ("c", 3), ("d", 4), ("e", 5)]
+        assert sd == {"b": 2, "c": 3, "d": 4, "e": 5}
+        with pytest.raises(KeyError):
+            sd["a"]
+        with pytest.raises(KeyError):
+            sd.pop("a")
+        with pytest.raises(TypeError):
+            hash(sd)
+
+    def test_keys_land_in_their_shard_in_order(self):
+        # SETUP
+        sd = ShardedDequeDict(shards=8)
+
+        # ACT
+        for i in range(200):
+            sd[i] = i
+
+        # ASSERT
+        assert sd.shard_count == 8
+        for s in range(8):
+            keys = list(sd.shard(s).keys())
+            assert keys == sorted(keys)
+            assert all(sd.shard_of(k) == s for k in keys)
+        assert sum(len(sd.shard(s)) for s in range(8)) == 200
+        assert sd.shard(-1) is sd.shard(7)
+        with pytest.raises(IndexError, match="shard index out of range"):
+            sd.shard(8)
+
+    def test_popleft_from_one_shard(self):
+        # SETUP
+        sd = ShardedDequeDict(shards=4)
+        for i in range(40):
+            sd[i] = i * 10
+        s = sd.shard_of(0)
+        # EXPECTED
+        expected = list(sd.shard(s).items())
+
+        # ACT
+        popped = [sd.popleftitem(shard=s) for _ in range(len(expected))]
+
+        # ASSERT
+        assert popped == expected
+        assert len(sd.shard(s)) == 0
+        with pytest.raises(KeyError):
+            sd.popleftitem(shard=s)
+
+    def test_popleft_round_robin_drains_everything(self):
+        # SETUP
+        sd = ShardedDequeDict(((i, i) for i in range(100)), shards=4)
+
+        # ACT
+        popped = [sd.popleft() for _ in range(100)]
+
+        # ASSERT
+        assert sorted(popped) == list(range(100))
+        assert len(sd) == 0
+        with pytest.raises(IndexError, match="empty"):
+            sd.popleft()
+
+    def test_maxsize_is_split_over_shards(self):
+        # SETUP
+        evicted = []
+        sd = ShardedDequeDict(shards=4, maxsize=10, on_evict=evicted.extend)
+
+        # ACT
+        for i in range(1000):
+            sd[i] = i
+
+        # ASSERT
+        assert sd.maxsize == 10
+        assert all(sd.shard(s).maxsize == 3 for s in range(4))
+        assert len(sd) <= 12
+        assert len(evicted) + len(sd) == 1000
+
+    def test_invalid_arguments(self):
+        with pytest.raises(ValueError, match="shards"):
+            ShardedDequeDict(shards=0)
+        with pytest.raises(ValueError, match="maxsize"):
+            ShardedDequeDict(maxsize=-1)
+        with pytest.raises(ValueError):
+            ShardedDequeDict([1, 2])
+
+    def test_repr(self):
+        assert repr(ShardedDequeDict(shards=2)) == "ShardedDequeDict(shards=2)"
+        assert repr(ShardedDequeDict({"a": 1}, shards=2)) == "ShardedDequeDict([('a', 1)], shards=2)"
+
+    def test_popitem_move_to_end_copy_and_pickle(self):
+        # SETUP
+        import copy
+        import pickle
+        sd = ShardedDequeDict(((i, i) for i in range(8)), shards=3, maxsize=30, touch=True)
+        k = 3
+        same_shard = [key for key in sd.shard(sd.shard_of(k)) if key != k]
+
+        # ACT
+        sd.move_to_end(k, last=False)
+        head = list(sd.shard(sd.shard_of(k)))[0]
+        sd.move_to_end(k)
+        tail = list(sd.shard(sd.shard_of(k)))[-1]
+        last = sd.items()[-1]
+        popped = sd.popitem()
+        clone = sd.copy()
+        shallow = copy.copy(sd)
+        restored = pickle.loads(pickle.dumps(sd))
+        clone[100] = 100
+
+        # ASSERT
+        assert head == k and tail == k and same_shard
+        assert popped == last and popped[0] not in sd and len(sd) == 7
+        for result in (shallow, restored):
+            assert type(result) is ShardedDequeDict and result == sd
+            assert result.shard_count == 3 and result.maxsize == 30
+            assert [list(result.shard(i)) for i in range(3)] == [list(sd.shard(i)) for i in range(3)]
+        assert 100 in clone and 100 not in sd
+        assert restored.shard(0).touch
+        assert pickle.loads(pickle.dumps(ShardedDequeDict(shards=2))).maxsize is None
+        with pytest.raises(KeyError):
+            sd.move_to_end("missing")
+        with pytest.raises(KeyError):
+            ShardedDequeDict(shards=2).popitem()
+
+    @requires_c
+    def test_concurrent_mutation_keeps_invariants(self):
+        # SETUP
+        import threading
+        sd = ShardedDequeDict(shards=8, maxsize=256, touch=True)
+        errors = []
+
+        def worker(seed):
+            for i in range(2000):
+                k = (seed * 7919 + i) % 1000
+                try:
+                    sd[k] = i
+                    sd.get((k * 3) % 1000)
+                    if i % 5 == 0:
+                        sd.pop(k, None)
+                    if i % 13 == 0:
+                        sd.popleft()
+                except (KeyError, IndexError):
+                    pass  # Raced with another thread emptying it
+                except Exception as e:  # pragma: no cover - reported below
+                    errors.append(e)
+
+        threads = [threading.Thread(target=worker, args=(n,)) for n in range(8)]
+
+        # ACT
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+
+        # ASSERT
+        assert errors == []
+        keys = list(sd)
+        assert len(keys) == len(sd) <= 256
+        assert len(set(keys)) == len(keys)
+        assert all(sd.shard(sd.shard_of(k))[k] == sd[k] for k in keys)
+
+
+class TestTypedDequeDict:
+    """Tests for TypedDequeDict: a DequeDict of raw int64/float64/bytes data."""
+
+    def test_mapping_and_deque_api(self):
+        # SETUP
+        td = TypedDequeDict([(1, 1.5), (2, 2.5)], key_type="i8", value_type="f8")
+
+        # ACT
+        td[3] = 3
+        td[1] = 0.5
+        td.move_to_end(3, last=False)
+
+        # ASSERT
+        assert len(td) == 3 and td.key_type == "i8" and td.value_type == "f8" and td.maxsize is None
+        assert td.items() == [(3, 3.0), (1, 0.5), (2, 2.5)]
+        assert list(td) == td.keys() == [3, 1, 2]
+        assert td.values() == [3.0, 0.5, 2.5] and isinstance(td[3], float)
+        assert td.peekleft() == 3.0 and td.peek() == 2.5
+        assert td.get(9) is None and td.get(9, -1) == -1
+        assert "x" not in td and 2 ** 70 not in td and td.get(1.0) is None
+        assert td.pop(1) == 0.5 and td.pop(1, None) is None
+        assert td.popleftitem() == (3, 3.0)
+        assert td.popleft() == 2.5
+        assert repr(td) == "TypedDequeDict([], key_type='i8', value_type='f8')"
+        with pytest.raises(IndexError):
+            td.popleft()
+        with pytest.raises(KeyError):
+            td.popleftitem()
+        with pytest.raises(KeyError):
+            td["x"]
+        with pytest.raises(TypeError):
+            hash(td)
+
+    def test_rejects_unrepresentable_entries(self):
+        # SETUP
+        td = TypedDequeDict(key_type="S3", value_type="i8")
+
+        # ACT
+        td[b"abc"] = -(1 << 63)
+
+        # ASSERT
+        for key, value, error in [
+            ("abc", 1, TypeError),
+            (b"abcd", 1, ValueError),
+            (b"a", 1 << 63, OverflowError),
+            (b"a", 1.0, TypeError),
+        ]:
+            with pytest.raises(error):
+                td[key] = value
+        assert td.items() == [(b"abc", -(1 << 63))]
+        for bad in ({"key_type": "f8"}, {"value_type": "S0"}, {"value_type": "u4"}, {"key_type": 8}):
+            with pytest.raises((TypeError, ValueError)):
+                TypedDequeDict(**bad)
+        with pytest.raises(TypeError):
+            TypedDequeDict(value_type="f8")[1] = "1.5"
+
+    def test_grows_shrinks_and_keeps_order(self):
+        # SETUP
+        td = TypedDequeDict()
+        expected = {}
+
+        # ACT
+        for i in range(5000):
+            td[i * 7919 % 10007] = i
+            expected[i * 7919 % 10007] = i
+        for k in list(expected)[:4900]:
+            assert td.pop(k) == expected.pop(k)
+
+        # ASSERT
+        assert td.items() == list(expected.items())
+        assert all(td[k] == v for k, v in expected.items())
+        td.clear()
+        assert len(td) == 0 and td.items() == []
+        td[1] = 1
+        assert td.items() == [(1, 1)]
+
+    def test_maxsize_evicts_head(self):
+        # SETUP
+        td = TypedDequeDict(((i, i) for i in range(10)), value_type="i8", maxsize=4)
+
+        # ACT
+        td[0] = 0
+        td.move_to_end(7, last=False)
+        td[10] = 10
+
+        # ASSERT
+        assert td.maxsize == 4
+        assert td.keys() == [8, 9, 0, 10]
+        assert repr(td) == "TypedDequeDict([(8, 8), (9, 9), (0, 0), (10, 10)], key_type='i8', value_type='i8', maxsize=4)"
+        assert len(TypedDequeDict({1: 1}, maxsize=0)) == 0
+
+    def test_arrays_export_in_order(self):
+        # SETUP
+        td = TypedDequeDict({3: 1.5, 1: 2.5, 2: -1.0}, value_type="f8")
+        td.move_to_end(3)
+
+        # ACT
+        keys = td.keys_array()
+        values = td.values_array()
+
+        # ASSERT
+        assert keys.format == "q" and keys.tolist() == [1, 2, 3]
+        assert values.format == "d" and values.tolist() == [2.5, -1.0, 1.5]
+        assert keys.readonly and values.readonly
+        td[4] = 4.0
+        assert values.tolist() == [2.5, -1.0, 1.5]  # A snapshot
+        assert TypedDequeDict().values_array().tolist() == []
+        assert TypedDequeDict({b"ab": 1, b"c": 2}, key_type="S3").keys_array().tobytes() == b"ab\0c\0\0"
+
+    def test_equality_copy_and_pickle(self):
+        # SETUP
+        import copy
+        import pickle
+        td = TypedDequeDict([(b"b", 2.5), (b"a", 1.5)], key_type="S2", value_type="f8", maxsize=3)
+
+        # ACT
+        clone = td.copy()
+        shallow = copy.copy(td)
+        restored = pickle.loads(pickle.dumps(td))
+        clone[b"c"] = 3.0
+        clone[b"d"] = 4.0
+
+        # ASSERT
+        assert TypedDequeDict({1: 2}) == {1: 2} and {1: 2} == TypedDequeDict({1: 2})
+        assert TypedDequeDict({1: 2}) != {1: 3} and TypedDequeDict({1: 2}) != {2: 2}
+        assert TypedDequeDict({1: 2, 2: 3}) == DequeDict([(2, 3), (1, 2)]) == TypedDequeDict({2: 3, 1: 2})
+        assert TypedDequeDict({1: 2}) != [(1, 2)]
+        for result in (shallow, restored):
+            assert type(result) is TypedDequeDict and result == td
+            assert result.items() == [(b"b", 2.5), (b"a", 1.5)]
+            assert (result.key_type, result.value_type, result.maxsize) == ("S2", "f8", 3)
+        assert clone.items() == [(b"a", 1.5), (b"c", 3.0), (b"d", 4.0)]
+        assert td.items() == [(b"b", 2.5), (b"a", 1.5)]
+        assert pickle.loads(pickle.dumps(TypedDequeDict({1: 2}))).maxsize is None
+
+    @requires_c
+    def test_stores_values_unboxed(self):
+        # SETUP
+        import gc
+        n = 10000
+        td = TypedDequeDict(((i, i * 0.5) for i in range(n)), value_type="f8")
+        dd = DequeDict((i, i * 0.5) for i in range(n))
+
+        # ACT
+        typed_size = sys.getsizeof(td)
+        boxed_size = sys.getsizeof(dd) + sum(sys.getsizeof(k) + sys.getsizeof(v) for k, v in dd.items())
+
+        # ASSERT
+        assert not gc.is_tracked(td)
+        assert typed_size * 1.5 < boxed_size
+
+
+@requires_c
+class TestSharedDequeDict:
+    """Tests for SharedDequeDict: a fixed-width DequeDict in a shared buffer."""
+
+    def _make(self, capacity=8, key_type="i8", value_type="f8"):
+        buf = bytearray(SharedDequeDict.nbytes(capacity, key_type, value_type))
+        return buf, SharedDequeDict(buf, key_type, value_type, capacity=capacity)
+
+    def test_mapping_and_deque_api(self):
+        # SETUP
+        _, sd = self._make()
+
+        # ACT
+        sd.update({1: 1.5, 2: 2.5})
+        sd[3] = 3
+        sd[1] = 0.5
+        sd.move_to_end(3, last=False)
+
+        # ASSERT
+        assert len(sd) == 3
+        assert sd.items() == [(3, 3.0), (1, 0.5), (2, 2.5)]
+        assert list(sd) == sd.keys() == [3, 1, 2]
+        assert sd.values() == [3.0, 0.5, 2.5]
+        assert sd.peekleft() == 3.0 and sd.peek() == 2.5
+        assert sd.get(9) is None and sd.get(9, -1) == -1
+        assert "x" not in sd and 2 ** 70 not in sd and sd.get("x") is None
+        assert sd.pop(1) == 0.5 and sd.pop(1, None) is None
+        assert sd.popleftitem() == (3, 3.0)
+        assert sd.popleft() == 2.5
+        with pytest.raises(IndexError):
+            sd.popleft()
+        with pytest.raises(KeyError):
+            del sd[1]
+        with pytest.raises(TypeError):
+            hash(sd)
+
+    def test_full_region_evicts_head(self):
+        # SETUP
+        _, sd = self._make(capacity=4)
+
+        # ACT
+        for i in range(1000):
+            sd[i] = i
+            if i % 3 == 0:
+                sd.pop(i - 1, None)
+
+        # ASSERT
+        assert len(sd) <= 4
+        assert sd.keys() == sorted(sd.keys())
+        assert sd.keys()[-1] == 999
+
+    def test_bytes_types_and_validation(self):
+        # SETUP
+        _, sd = self._make(capacity=4, key_type="S4", value_type="S3")
+
+        # ACT
+        sd[b""] = b"abc"
+        sd[b"long"] = b"x"
+
+        # ASSERT
+        assert sd.items() == [(b"", b"abc"), (b"long", b"x")]
+        assert sd.key_type == "S4" and sd.value_type == "S3" and sd.capacity == 4
+        with pytest.raises(ValueError):
+            sd[b"toolong"] = b""
+        with pytest.raises(ValueError):
+            sd[b"k"] = b"toolong"
+        with pytest.raises(TypeError):
+            sd["str"] = b""
+        with pytest.raises(TypeError):
+            sd[b"k"] = 1
+        assert b"toolong" not in sd and len(sd) == 2
+        for bad in ("i4", "f8", "S0", "S", "S99999999", 8):
+            with pytest.raises((ValueError, TypeError)):
+                SharedDequeDict.nbytes(4, bad, "i8")
+
+    def test_attach_validates_buffer(self):
+        # SETUP
+        buf, sd = self._make(capacity=4)
+        sd[7] = 7.0
+
+        # ACT
+        other = SharedDequeDict(buf)
+        readonly = SharedDequeDict(bytes(buf))
+
+        # ASSERT
+        assert other.items() == [(7, 7.0)] and other.key_type == "i8" and other.value_type == "f8"
+        assert other.keys_array().tolist() == [7] and other.values_array().tolist() == [7.0]
+        other[8] = 8.0
+        assert sd.keys() == [7, 8]
+        assert readonly.readonly and readonly[7] == 7.0
+        with pytest.raises(TypeError):
+            readonly[9] = 9.0
+        with pytest.raises(ValueError):
+            SharedDequeDict(buf, "S8", "f8")
+        with pytest.raises(ValueError):
+            SharedDequeDict(bytearray(len(buf)))
+        with pytest.raises(ValueError):
+            SharedDequeDict(buf[:100])
+        with pytest.raises(ValueError):
+            SharedDequeDict(bytearray(16), "i8", "i8", capacity=4)
+
+    def test_close_releases_buffer(self):
+        # SETUP
+        buf, sd = self._make()
+
+        # ACT
+        with sd:
+            sd[1] = 1.0
+        buf.extend(b"x")  # Resizing fails while an export is held
+
+        # ASSERT
+        assert sd.closed and repr(sd) == "<closed SharedDequeDict>"
+        with pytest.raises(ValueError):
+            len(sd)
+        with pytest.raises(ValueError):
+            sd[1]
+
+    def test_shared_across_processes(self):
+        # SETUP
+        import multiprocessing
+        from multiprocessing import shared_memory
+        shm = shared_memory.SharedMemory(create=True, size=SharedDequeDict.nbytes(64, "i8", "i8"))
+        sd = SharedDequeDict(shm.buf, "i8", "i8", capacity=64)
+        try:
+            sd.update((i, i * i) for i in range(10))
+            ctx = multiprocessing.get_context("spawn")
+
+            # ACT
+            p = ctx.Process(target=_shared_consumer, args=(shm.name,))
+            p.start()
+            p.join(30)
+
+            # ASSERT
+            assert p.exitcode == 0
+            assert sd.items() == [(i, i * i) for i in range(5, 10)] + [(-1, 0)]
+        finally:
+            sd.close()
+            shm.close()
+            shm.unlink()
+
+
+def _shared_consumer(name):
+    """Pop five entries from a SharedDequeDict and append a marker."""
+    from multiprocessing import shared_memory
+    shm = shared_memory.SharedMemory(name=name)
+    with SharedDequeDict(shm.buf) as sd:
+        for i in range(5):
+            assert sd.popleftitem() == (i, i * i)
+        sd[-1] = 0
+    shm.close()
+
+
+class TestDequeDictMaxsize:
+    """Tests for bounded capacity, on_evict and touch (LRU) mode."""
+
+    def test_unbounded_by_default(self):
+        # ACT
+        dd = DequeDict((i, i) for i in range(100))
+
+        # ASSERT
+        assert dd.maxsize is None
+        assert dd.on_evict is None
+        assert dd.touch is False
+        assert len(dd) == 100
+
+    def test_insert_past_capacity_evicts_from_head(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2)], maxsize=2)
+
+        # ACT
+        dd["c"] = 3
+
+        # ASSERT
+        assert list(dd.items()) == [("b", 2), ("c", 3)]
+
+    def test_update_existing_key_does_not_evict(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2)], maxsize=2)
+
+        # ACT
+        dd["a"] = 10
+
+        # ASSERT
+        assert list(dd.items()) == [("a", 10), ("b", 2)]
+
+    def test_init_keeps_last_items(self):
+        # ACT
+        dd = DequeDict(((i, i) for i in range(10)), maxsize=3)
+
+        # ASSERT
+        assert list(dd) == [7, 8, 9]
+
+    def test_on_evict_receives_one_list_per_call(self):
+        # SETUP
+        batches = []
+        dd = DequeDict([("a", 1)], maxsize=2, on_evict=batches.append)
+
+        # ACT
+        dd["b"] = 2
+        dd["c"] = 3
+        dd.update([("d", 4), ("e", 5)])
+
+        # ASSERT
+        assert batches == [[("a", 1)], [("b", 2), ("c", 3)]]
+        assert list(dd) == ["d", "e"]
+
+    def test_on_evict_batches_init(self):
+        # SETUP
+        batches = []
+
+        # ACT
+        DequeDict(((i, i) for i in range(5)), maxsize=2, on_evict=batches.append)
+
+        # ASSERT
+        assert batches == [[(0, 0), (1, 1), (2, 2)]]
+
+    def test_on_evict_sees_consistent_container(self):
+        # SETUP
+        seen = []
+        dd = DequeDict(maxsize=1)
+        dd.on_evict = lambda pairs: seen.append((pairs, list(dd.items())))
+        dd["a"] = 1
+
+        # ACT
+        dd["b"] = 2
+
+        # ASSERT
+        assert seen == [([("a", 1)], [("b", 2)])]
+
+    def test_on_evict_error_propagates(self):
+        # SETUP
+        def boom(pairs):
+            raise RuntimeError("boom")
+
+        dd = DequeDict([("a", 1)], maxsize=1, on_evict=boom)
+
+        # ACT & ASSERT
+        with pytest.raises(RuntimeError, match="boom"):
+            dd["b"] = 2
+        assert list(dd) == ["b"]
+
+    def test_appendleft_evicts_from_tail(self):
+        # SETUP
+        batches = []
+        dd = DequeDict([("a", 1), ("b", 2)], maxsize=2, on_evict=batches.append)
+
+        # ACT
+        dd.appendleft("z", 0)
+
+        # ASSERT
+        assert list(dd) == ["z", "a"]
+        assert batches == [[("b", 2)]]
+
+    def test_maxsize_zero_holds_nothing(self):
+        # SETUP
+        batches = []
+        dd = DequeDict(maxsize=0, on_evict=batches.append)
+
+        # ACT
+        dd["a"] = 1
+
+        # ASSERT
+        assert len(dd) == 0
+        assert batches == [[("a", 1)]]
+
+    def test_setdefault_evicts(self):
+        # SETUP
+        dd = DequeDict([("a", 1)], maxsize=1)
+
+        # ACT
+        result = dd.setdefault("b", 2)
+
+        # ASSERT
+        assert result == 2
+        assert list(dd.items()) == [("b", 2)]
+
+    def test_at_after_eviction(self):
+        # SETUP
+        dd = DequeDict(((i, i) for i in range(4)), maxsize=4)
+        assert dd.at(0) == 0
+
+        # ACT
+        for i in range(4, 100):
+            dd[i] = i
+
+        # ASSERT
+        assert [dd.at(i) for i in range(4)] == [96, 97, 98, 99]
+        assert dd.at(-1) == 99
+
+    def test_touch_getitem_moves_to_end(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2), ("c", 3)], maxsize=3, touch=True)
+
+        # ACT
+        value = dd["a"]
+        dd["d"] = 4
+
+        # ASSERT
+        assert value == 1
+        assert list(dd) == ["c", "a", "d"]
+
+    def test_touch_update_moves_to_end(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2)], touch=True)
+
+        # ACT
+        dd["a"] = 10
+
+        # ASSERT
+        assert list(dd.items()) == [("b", 2), ("a", 10)]
+
+    def test_touch_does_not_affect_get_and_contains(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2)], touch=True)
+
+        # ACT
+        dd.get("a")
+        "a" in dd
+
+        # ASSERT
+        assert list(dd) == ["a", "b"]
+
+    def test_get_and_touch(self):
+        # SETUP
+        dd = DequeDict([("a", 1), ("b", 2), ("c", 3)])
+
+        # ACT
+        hit = dd.get_and_touch("a")
+        miss = dd.get_and_touch("x", 0)
+
+        # ASSERT
+        assert hit == 1
+        assert miss == 0
+        assert list(dd) == ["b", "c", "a"]
+        assert dd.at(-1) == 1
+
+    def test_copy_keeps_options(self):
+        # SETUP
+        batches = []
+        dd = DequeDict([("a", 1)], maxsize=1, on_evict=batches.append, touch=True)
+
+        # ACT
+        copy = dd.copy()
+        copy["b"] = 2
+
+        # ASSERT
+        assert copy.maxsize == 1
+        assert copy.touch is True
+        assert batches == [[("a", 1)]]
+        assert list(dd) == ["a"]
+
+    def test_invalid_options(self):
+        # ACT & ASSERT
+        with pytest.raises(ValueError):
+            DequeDict(maxsize=-1)
+        with pytest.raises(TypeError):
+            DequeDict(maxsize=1.5)
+        with pytest.raises(TypeError):
+            DequeDict(on_evict=42)
+        with pytest.raises(TypeError):
+            DequeDict([], 3)
+
+    def test_default_dequedict_bounded(self):
+        # SETUP
+        batches = []
+        dd = DefaultDequeDict(list, maxsize=2, on_evict=batches.append)
+
+        # ACT
+        dd["a"].append(1)
+        dd["b"].append(2)
+        dd["c"].append(3)
+
+        # ASSERT
+        assert list(dd.items()) == [("b", [2]), ("c", [3])]
+        assert batches == [[("a", [1])]]
+        assert dd.copy().maxsize == 2
+
+    def test_lru_churn_matches_reference(self):
+        # SETUP
+        from collections import OrderedDict
+
+        cap = 16
+        dd = DequeDict(maxsize=cap, touch=True)
+        ref = OrderedDict()
+
+        # ACT
+        for i in range(5000):
+            key = (i * i + i // 7) % 41
+            if key in dd:
+                assert dd[key] == ref[key]
+                ref.move_to_end(key)
+            else:
+                dd[key] = i
+                ref[key] = i
+                if len(ref) > cap:
+                    ref.popitem(last=False)
+
+        # ASSERT
+        assert list(dd.items()) == list(ref.items())
+
 
 if __name__ == "__main__":
     pytest.main([__file__, "-vv"])